@@ -11,6 +11,11 @@
 #define semistatic static
 #endif
 
+/* Expose Linux-specific interfaces such as O_DIRECT. */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
 #include <stdarg.h>
 #include <time.h>
@@ -22,23 +27,61 @@
 #include <sys/stat.h>
 #include <ncurses.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
 #include <dirent.h>
 #include <ctype.h>
 #include <dlfcn.h>
 #include <sys/mount.h>
+#include <sys/sysmacros.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <zlib.h>
+#include <zstd.h>
+#include <linux/io_uring.h>
+#include <linux/loop.h>
+#include <linux/blkpg.h>
+#include <linux/fs.h>
 
 #include <limeos-common-lib.h>
 #include "constants.h"
 #include "config.h"
 
 #include "store/store.h"
+#include "utils/output.h"
+#include "utils/install_log.h"
+#include "utils/runtime.h"
+#include "utils/trace.h"
 #include "utils/command.h"
+#include "utils/mount.h"
+#include "utils/chroot.h"
 #include "utils/disk.h"
+#include "utils/disk_probe.h"
 #include "utils/system.h"
 #include "utils/hostname.h"
-#include "utils/install_log.h"
 #include "phases/phases.h"
 #include "phases/partitions/partitions.h"
+#include "phases/partitions/partition_table.h"
+#include "phases/partitions/format.h"
+#include "phases/partitions/wipe.h"
+#include "phases/rootfs/digest.h"
+#include "phases/rootfs/stream.h"
+#include "phases/rootfs/parallel.h"
+#include "phases/rootfs/manifest.h"
+#include "phases/rootfs/writer.h"
+#include "phases/rootfs/uring.h"
+#include "phases/rootfs/archive.h"
+#include "phases/rootfs/image.h"
 #include "phases/rootfs/rootfs.h"
 #include "phases/bootloader/bootloader.h"
 #include "phases/locale/locale.h"
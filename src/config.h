@@ -17,6 +17,21 @@
 /** The path where the rootfs tarball is stored on the live system. */
 #define CONFIG_ROOTFS_TARBALL_PATH "/usr/share/limeos/rootfs.tar.gz"
 
+/** The path of the zstd rootfs tarball, preferred when it exists. */
+#define CONFIG_ROOTFS_ZSTD_TARBALL_PATH "/usr/share/limeos/rootfs.tar.zst"
+
+/** The path of the ext4 rootfs image, which enables image mode. */
+#define CONFIG_ROOTFS_IMAGE_PATH "/usr/share/limeos/rootfs.img"
+
+/** The suffix of the optional block index stored next to the rootfs. */
+#define CONFIG_ROOTFS_INDEX_SUFFIX ".idx"
+
+/** The suffix of the SHA-256 digest shipped next to the rootfs archive. */
+#define CONFIG_ROOTFS_DIGEST_SUFFIX ".sha256"
+
+/** The suffix of the manifest listing the rootfs archive entries. */
+#define CONFIG_ROOTFS_MANIFEST_SUFFIX ".manifest"
+
 /** The mount point for the target system during installation. */
 #define CONFIG_TARGET_MOUNT_POINT "/mnt"
 
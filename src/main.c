@@ -7,26 +7,41 @@
 #include "all.h"
 
 static const char *libraries[] = {
-    "libncurses.so.6"
+    "libncurses.so.6",
+    "libz.so.1",
+    "libzstd.so.1"
 };
 
 static const char *commands[] = {
     // Partitioning.
-    "parted",
     "mkfs.ext4",
     "mkfs.vfat",
     "mkswap",
-    "mount",
-    "umount",
     "swapon",
     "swapoff",
     "mkdir",
-    // Rootfs extraction.
-    "tar",
     // Locale configuration.
     "sed"
 };
 
+static const char *image_commands[] = {
+    // Checking and growing the deployed rootfs image.
+    "e2fsck",
+    "resize2fs"
+};
+
+static void ensure_commands_available(const char *const names[], int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (!common.is_command_available(names[i]))
+        {
+            fprintf(stderr, "Missing command \"%s\".\n", names[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
 int main(int argc, char *argv[])
 {
     Store *store = get_store();
@@ -42,15 +57,15 @@ int main(int argc, char *argv[])
         }
     }
 
-    // Ensure that the required commands are available.
-    const int command_count = sizeof(commands) / sizeof(commands[0]);
-    for (int i = 0; i < command_count; i++)
+    // Deploy the root filesystem as a block image when one is shipped.
+    store->rootfs_image = access(CONFIG_ROOTFS_IMAGE_PATH, R_OK) == 0;
+
+    // Ensure that the required commands are available, including those
+    // only image deployment uses when an image is shipped.
+    ensure_commands_available(commands, sizeof(commands) / sizeof(commands[0]));
+    if (store->rootfs_image)
     {
-        if (!common.is_command_available(commands[i]))
-        {
-            fprintf(stderr, "Missing command \"%s\".\n", commands[i]);
-            exit(EXIT_FAILURE);
-        }
+        ensure_commands_available(image_commands, sizeof(image_commands) / sizeof(image_commands[0]));
     }
 
     // Parse command-line arguments.
@@ -60,6 +75,18 @@ int main(int argc, char *argv[])
         {
             store->dry_run = 1;
         }
+        else if (strcmp(argv[i], "--write-backend=sync") == 0)
+        {
+            store->write_backend = WRITE_BACKEND_SYNC;
+        }
+        else if (strcmp(argv[i], "--write-backend=uring") == 0)
+        {
+            store->write_backend = WRITE_BACKEND_URING;
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            store->trace_path = argv[++i];
+        }
     }
 
     // Initialize ncurses UI.
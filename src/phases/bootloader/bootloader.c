@@ -6,32 +6,25 @@
 
 #include "../../all.h"
 
-static int verify_chroot_works(void)
+static int verify_chroot_works(ChrootSession *session)
 {
-    const char *marker = "/mnt/tmp/.chroot_verify";
-
-    // Escape the marker path for shell command.
-    char escaped_marker[COMMON_MAX_QUOTED_LENGTH];
-    if (common.shell_escape(marker, escaped_marker, sizeof(escaped_marker)) != 0)
-    {
-        return -1;
-    }
+    const char *marker = CONFIG_TARGET_MOUNT_POINT "/tmp/.chroot_verify";
 
     // Create marker file inside chroot /mnt.
-    char cmd[COMMON_MAX_COMMAND_LENGTH];
-    snprintf(cmd, sizeof(cmd), "echo 'limeos' > %s", escaped_marker);
-    if (run_install_command(cmd) != 0)
+    const char *const echo_argv[] = { "echo", "limeos", NULL };
+    const CommandOptions marker_output = { .stdout_path = marker };
+    if (run_install_argv(echo_argv, &marker_output) != 0)
     {
         return -2;
     }
 
     // Verify chroot can see the marker at /tmp/.chroot_verify (not /mnt/tmp).
     // If chroot fails silently, cat would look at the host's /tmp and fail.
-    int result = run_install_command("chroot /mnt cat /tmp/.chroot_verify >/dev/null 2>&1");
+    int result = run_chroot_command(session, "cat", "cat /tmp/.chroot_verify >/dev/null");
 
     // Clean up marker file.
-    snprintf(cmd, sizeof(cmd), "rm -f %s", escaped_marker);
-    run_install_command(cmd);
+    const char *const rm_argv[] = { "rm", "-f", marker, NULL };
+    run_install_argv(rm_argv, NULL);
 
     return (result == 0) ? 0 : -3;
 }
@@ -45,86 +38,51 @@ static int verify_esp_mounted(void)
 {
     // The partitions phase mounts all partitions including ESP.
     // Just verify it's mounted where we expect.
-    if (run_install_command("mountpoint -q /mnt/boot/efi") != 0)
+    const char *const argv[] = { "mountpoint", "-q", "/mnt/boot/efi", NULL };
+    if (run_install_argv(argv, NULL) != 0)
     {
         return -1;
     }
     return 0;
 }
 
-static int mount_chroot_system_dirs(void)
+static int setup_chroot_environment(ChrootSession *session)
 {
-    // Bind mount /dev for device access inside chroot.
-    if (run_install_command("mount --bind /dev /mnt/dev") != 0)
+    write_install_log("Opening chroot session (dev, proc, sys)");
+    if (open_chroot_session(session) != 0)
     {
-        return -1;
-    }
-
-    // Mount proc filesystem for process information.
-    if (run_install_command("mount -t proc proc /mnt/proc") != 0)
-    {
-        run_install_command("umount /mnt/dev");
-        return -2;
-    }
-
-    // Mount sysfs for kernel and device information.
-    if (run_install_command("mount -t sysfs sys /mnt/sys") != 0)
-    {
-        run_install_command("umount /mnt/proc");
-        run_install_command("umount /mnt/dev");
-        return -3;
-    }
-
-    return 0;
-}
-
-static void unmount_chroot_system_dirs(void)
-{
-    // Unmount sysfs.
-    run_install_command("umount /mnt/sys");
-
-    // Unmount proc filesystem.
-    run_install_command("umount /mnt/proc");
-
-    // Unmount /dev bind mount.
-    run_install_command("umount /mnt/dev");
-}
-
-static int setup_chroot_environment(void)
-{
-    write_install_log("Mounting chroot system directories (dev, proc, sys)");
-    if (mount_chroot_system_dirs() != 0)
-    {
-        write_install_log("Failed to mount chroot system directories");
+        write_install_log("Failed to open chroot session");
         return -1;
     }
 
     write_install_log("Verifying chroot environment");
-    if (verify_chroot_works() != 0)
+    if (verify_chroot_works(session) != 0)
     {
         write_install_log("Chroot verification failed");
-        unmount_chroot_system_dirs();
+        close_chroot_session(session);
         return -2;
     }
-    
+
     write_install_log("Chroot environment verified");
 
     return 0;
 }
 
-static int install_grub_packages(int is_uefi)
+static int install_grub_packages(ChrootSession *session, int is_uefi)
 {
     // Ensure target apt cache directory exists.
-    if (run_install_command("mkdir -p /mnt/var/cache/apt/archives >>" CONFIG_INSTALL_LOG_PATH " 2>&1") != 0)
+    const char *const mkdir_argv[] = { "mkdir", "-p", "/mnt/var/cache/apt/archives", NULL };
+    if (run_install_argv(mkdir_argv, &COMMAND_TO_INSTALL_LOG) != 0)
     {
         return -1;
     }
 
     // Copy only the appropriate packages based on firmware type.
-    // UEFI uses grub-efi-*, BIOS uses grub-pc-*.
+    // UEFI uses grub-efi-*, BIOS uses grub-pc-*. This goes through the shell
+    // to expand the package globs.
     const char *cp_cmd = is_uefi
-        ? "cp /var/cache/apt/archives/grub-efi*.deb /mnt/var/cache/apt/archives/ >>" CONFIG_INSTALL_LOG_PATH " 2>&1"
-        : "cp /var/cache/apt/archives/grub-pc*.deb /mnt/var/cache/apt/archives/ >>" CONFIG_INSTALL_LOG_PATH " 2>&1";
+        ? "cp /var/cache/apt/archives/grub-efi*.deb /mnt/var/cache/apt/archives/"
+        : "cp /var/cache/apt/archives/grub-pc*.deb /mnt/var/cache/apt/archives/";
     if (run_install_command(cp_cmd) != 0)
     {
         return -2;
@@ -132,15 +90,15 @@ static int install_grub_packages(int is_uefi)
 
     // Install GRUB packages. Run dpkg twice: first pass unpacks all packages,
     // second pass configures them in dependency order.
-    // Note: Inner sh -c ensures the glob expands inside the chroot, not on the
+    // Note: The session shell expands the glob inside the chroot, not on the
     // host. Use `--no-triggers` to prevent dpkg from running initramfs-tools 
     // triggers, which would regenerate initramfs in the chroot (where firmware 
     // detection fails). The pre-built initramfs already has GPU 
     // firmware/drivers embedded.
-    run_install_command("chroot /mnt sh -c 'dpkg -i --no-triggers /var/cache/apt/archives/*.deb' >>" CONFIG_INSTALL_LOG_PATH " 2>&1");
+    run_chroot_command(session, "dpkg", "dpkg -i --no-triggers /var/cache/apt/archives/*.deb");
 
     // Configure installed packages.
-    if (run_install_command("chroot /mnt dpkg --configure -a --no-triggers >>" CONFIG_INSTALL_LOG_PATH " 2>&1") != 0)
+    if (run_chroot_command(session, "dpkg", "dpkg --configure -a --no-triggers") != 0)
     {
         return -3;
     }
@@ -148,14 +106,13 @@ static int install_grub_packages(int is_uefi)
     return 0;
 }
 
-static int run_grub_install(const char *disk, int is_uefi)
+static int run_grub_install(ChrootSession *session, const char *disk, int is_uefi)
 {
     if (is_uefi)
     {
         // Install GRUB for UEFI target with EFI directory.
-        if (run_install_command("chroot /mnt /usr/sbin/grub-install "
-            "--target=x86_64-efi --efi-directory=/boot/efi --bootloader-id=GRUB "
-            ">>" CONFIG_INSTALL_LOG_PATH " 2>&1") != 0)
+        if (run_chroot_command(session, "grub-install", "/usr/sbin/grub-install "
+            "--target=x86_64-efi --efi-directory=/boot/efi --bootloader-id=GRUB") != 0)
         {
             return -1;
         }
@@ -163,11 +120,15 @@ static int run_grub_install(const char *disk, int is_uefi)
         // Create fallback boot path. UEFI looks for /EFI/BOOT/BOOTX64.EFI when
         // no NVRAM boot entry exists. efibootmgr can't create NVRAM entries in
         // a chroot (no access to efivars), so we must provide this fallback.
-        if (run_install_command("mkdir -p /mnt/boot/efi/EFI/BOOT") != 0)
+        const char *const mkdir_argv[] = { "mkdir", "-p", "/mnt/boot/efi/EFI/BOOT", NULL };
+        if (run_install_argv(mkdir_argv, NULL) != 0)
         {
             return -4;
         }
-        if (run_install_command("cp /mnt/boot/efi/EFI/GRUB/grubx64.efi /mnt/boot/efi/EFI/BOOT/BOOTX64.EFI") != 0)
+        const char *const cp_argv[] = {
+            "cp", "/mnt/boot/efi/EFI/GRUB/grubx64.efi", "/mnt/boot/efi/EFI/BOOT/BOOTX64.EFI", NULL
+        };
+        if (run_install_argv(cp_argv, NULL) != 0)
         {
             return -5;
         }
@@ -183,10 +144,8 @@ static int run_grub_install(const char *disk, int is_uefi)
 
         // Install GRUB to disk MBR for BIOS boot.
         char cmd[COMMON_MAX_COMMAND_LENGTH];
-        snprintf(cmd, sizeof(cmd),
-            "chroot /mnt /usr/sbin/grub-install %s >>" CONFIG_INSTALL_LOG_PATH " 2>&1",
-            escaped_disk);
-        if (run_install_command(cmd) != 0)
+        snprintf(cmd, sizeof(cmd), "/usr/sbin/grub-install %s", escaped_disk);
+        if (run_chroot_command(session, "grub-install", cmd) != 0)
         {
             return -3;
         }
@@ -195,10 +154,10 @@ static int run_grub_install(const char *disk, int is_uefi)
     return 0;
 }
 
-static int run_update_grub(void)
+static int run_update_grub(ChrootSession *session)
 {
     // Run update-grub inside chroot to (re)generate GRUB config.
-    if (run_install_command("chroot /mnt /usr/sbin/update-grub >>" CONFIG_INSTALL_LOG_PATH " 2>&1") != 0)
+    if (run_chroot_command(session, "update-grub", "/usr/sbin/update-grub") != 0)
     {
         return -1;
     }
@@ -208,39 +167,40 @@ static int run_update_grub(void)
 
 static int setup_grub_bios(const char *disk)
 {
-    if (setup_chroot_environment() != 0)
+    ChrootSession session;
+    if (setup_chroot_environment(&session) != 0)
     {
         return -1;
     }
 
     // Install GRUB packages for BIOS.
     write_install_log("Installing GRUB BIOS packages from apt cache");
-    if (install_grub_packages(0) != 0)
+    if (install_grub_packages(&session, 0) != 0)
     {
         write_install_log("Failed to install GRUB packages");
-        unmount_chroot_system_dirs();
+        close_chroot_session(&session);
         return -3;
     }
 
     // Run grub-install for BIOS.
     write_install_log("Running grub-install for BIOS");
-    if (run_grub_install(disk, 0) != 0)
+    if (run_grub_install(&session, disk, 0) != 0)
     {
         write_install_log("grub-install failed");
-        unmount_chroot_system_dirs();
+        close_chroot_session(&session);
         return -4;
     }
 
     // Generate GRUB configuration.
     write_install_log("Running update-grub to generate configuration");
-    if (run_update_grub() != 0)
+    if (run_update_grub(&session) != 0)
     {
         write_install_log("update-grub failed");
-        unmount_chroot_system_dirs();
+        close_chroot_session(&session);
         return -5;
     }
 
-    unmount_chroot_system_dirs();
+    close_chroot_session(&session);
     
     return 0;
 }
@@ -255,40 +215,41 @@ static int setup_grub_uefi(const char *disk)
         return -1;
     }
 
-    if (setup_chroot_environment() != 0)
+    ChrootSession session;
+    if (setup_chroot_environment(&session) != 0)
     {
         return -2;
     }
 
     // Install GRUB packages for UEFI.
     write_install_log("Installing GRUB EFI packages from apt cache");
-    if (install_grub_packages(1) != 0)
+    if (install_grub_packages(&session, 1) != 0)
     {
         write_install_log("Failed to install GRUB packages");
-        unmount_chroot_system_dirs();
+        close_chroot_session(&session);
         return -4;
     }
 
     // Run grub-install for UEFI and create fallback boot path.
     write_install_log("Running grub-install for UEFI");
-    if (run_grub_install(disk, 1) != 0)
+    if (run_grub_install(&session, disk, 1) != 0)
     {
         write_install_log("grub-install failed");
-        unmount_chroot_system_dirs();
+        close_chroot_session(&session);
         return -5;
     }
     write_install_log("Created fallback boot path at /boot/efi/EFI/BOOT/BOOTX64.EFI");
 
     // Generate GRUB configuration.
     write_install_log("Running update-grub to generate configuration");
-    if (run_update_grub() != 0)
+    if (run_update_grub(&session) != 0)
     {
         write_install_log("update-grub failed");
-        unmount_chroot_system_dirs();
+        close_chroot_session(&session);
         return -6;
     }
 
-    unmount_chroot_system_dirs();
+    close_chroot_session(&session);
 
     return 0;
 }
@@ -6,33 +6,40 @@
 
 #include "../../all.h"
 
-int cleanup_mounts(void)
+static void restore_partition_options(const char *target, void *context)
 {
-    int errors = 0;
+    Store *store = context;
 
-    // Unmount chroot bind mounts in reverse order of mounting.
-    if (run_install_command("umount /mnt/sys >/dev/null 2>&1") != 0)
-    {
-        errors++;
-    }
-    if (run_install_command("umount /mnt/proc >/dev/null 2>&1") != 0)
-    {
-        errors++;
-    }
-    if (run_install_command("umount /mnt/dev >/dev/null 2>&1") != 0)
+    // Put back the options the target system uses on a partition, so
+    // nothing set only for the installation is left in effect.
+    for (int i = 0; i < store->partition_count; i++)
     {
-        errors++;
+        Partition *partition = &store->partitions[i];
+        if (partition->filesystem == FS_SWAP || partition->mount_point[0] != '/')
+        {
+            continue;
+        }
+        char mount_path[256];
+        snprintf(
+            mount_path, sizeof(mount_path), "%s%s", CONFIG_TARGET_MOUNT_POINT,
+            strcmp(partition->mount_point, "/") == 0 ? "" : partition->mount_point
+        );
+        if (strcmp(mount_path, target) == 0)
+        {
+            remount_partition(partition, target);
+            return;
+        }
     }
+}
 
-    // Unmount EFI partition (not an error if it wasn't mounted).
-    run_install_command("umount /mnt/boot/efi >/dev/null 2>&1");
-
-    // Disable swap partitions and unmount other partitions.
+int cleanup_mounts(void)
+{
     Store *store = get_store();
+
+    // Disable swap partitions.
     for (int i = store->partition_count - 1; i >= 0; i--)
     {
         Partition *partition = &store->partitions[i];
-        
         if (partition->filesystem == FS_SWAP)
         {
             // Get partition device path.
@@ -40,38 +47,11 @@ int cleanup_mounts(void)
             get_partition_device(store->disk, i + 1, partition_device, sizeof(partition_device));
 
             // Disable swap.
-            char escaped_device[COMMON_MAX_QUOTED_LENGTH];
-            if (common.shell_escape(partition_device, escaped_device, sizeof(escaped_device)) == 0)
-            {
-                char cmd[COMMON_MAX_COMMAND_LENGTH];
-                snprintf(cmd, sizeof(cmd), "swapoff %s >/dev/null 2>&1", escaped_device);
-                run_install_command(cmd);
-            }
+            const char *const argv[] = { "swapoff", partition_device, NULL };
+            run_install_argv(argv, &COMMAND_QUIET);
         }
-        else if (
-            strcmp(partition->mount_point, "/") != 0 &&
-            partition->mount_point[0] == '/'
-        ) {
-            // Construct full mount path.
-            char mount_path[256];
-            snprintf(mount_path, sizeof(mount_path), "/mnt%s", partition->mount_point);
-            
-            // Escape mount path and run unmount command.
-            char escaped_mount[COMMON_MAX_QUOTED_LENGTH];
-            if (common.shell_escape(mount_path, escaped_mount, sizeof(escaped_mount)) == 0)
-            {
-                char cmd[COMMON_MAX_COMMAND_LENGTH];
-                snprintf(cmd, sizeof(cmd), "umount %s >/dev/null 2>&1", escaped_mount);
-                run_install_command(cmd);
-            }
-        }
-    }
-
-    // Unmount root partition last.
-    if (run_install_command("umount /mnt >/dev/null 2>&1") != 0)
-    {
-        errors++;
     }
 
-    return errors;
+    // Unmount what the installation mounted, nested mounts first.
+    return unmount_registered_filesystems(restore_partition_options, store);
 }
@@ -4,14 +4,14 @@
  * Unmounts all filesystems mounted during installation.
  * Should be called on installation failure or completion.
  *
- * Unmounts in reverse order:
- * 1. Chroot bind mounts (/mnt/sys, /mnt/proc, /mnt/dev)
- * 2. EFI partition (/mnt/boot/efi)
- * 3. Swap partitions
- * 4. Other mount points (in reverse order for nested mounts)
- * 5. Root partition (/mnt)
+ * Disables swap partitions, then unmounts the filesystems in the mount
+ * registry that are still mounted, nested mounts before the ones they sit
+ * on, such as the chroot system directories and /mnt/boot/efi before /mnt.
+ * Each partition is remounted with its fstab options before it is
+ * unmounted, replacing the install-time ones.
  *
  * @return - `0` on success.
- * @return - `non-zero` if some unmounts failed (non-fatal).
+ * @return - `non-zero` if some filesystems had to be detached or could
+ *           not be unmounted (non-fatal).
  */
 int cleanup_mounts(void);
@@ -18,7 +18,7 @@ static int copy_component_binary(const Component *component)
     char cmd[COMMON_MAX_COMMAND_LENGTH];
     snprintf(
         cmd, sizeof(cmd),
-        "cp %s/%s %s/ >>" CONFIG_INSTALL_LOG_PATH " 2>&1",
+        "cp %s/%s %s/",
         CONFIG_LIVE_COMPONENT_PATH, component->binary_name, CONFIG_TARGET_COMPONENT_PATH
     );
     return run_install_command(cmd);
@@ -44,7 +44,7 @@ static int copy_component_binaries(void)
     }
 
     // Ensure target directory exists.
-    if (run_install_command("mkdir -p " CONFIG_TARGET_COMPONENT_PATH " >>" CONFIG_INSTALL_LOG_PATH " 2>&1") != 0)
+    if (run_install_command("mkdir -p " CONFIG_TARGET_COMPONENT_PATH) != 0)
     {
         return -1;
     }
@@ -65,7 +65,7 @@ static int copy_component_binaries(void)
     return 0;
 }
 
-static int install_component_packages(const Component *component)
+static int install_component_packages(ChrootSession *session, const Component *component)
 {
     // Check if bundled dependencies exist for this component.
     char deps_path[256];
@@ -78,7 +78,7 @@ static int install_component_packages(const Component *component)
     }
 
     // Ensure target apt cache directory exists.
-    if (run_install_command("mkdir -p " CONFIG_TARGET_MOUNT_POINT "/var/cache/apt/archives >>" CONFIG_INSTALL_LOG_PATH " 2>&1") != 0)
+    if (run_install_command("mkdir -p " CONFIG_TARGET_MOUNT_POINT "/var/cache/apt/archives") != 0)
     {
         return -1;
     }
@@ -87,7 +87,7 @@ static int install_component_packages(const Component *component)
     char cmd[COMMON_MAX_COMMAND_LENGTH];
     snprintf(
         cmd, sizeof(cmd),
-        "cp %s/*.deb " CONFIG_TARGET_MOUNT_POINT "/var/cache/apt/archives/ >>" CONFIG_INSTALL_LOG_PATH " 2>&1",
+        "cp %s/*.deb " CONFIG_TARGET_MOUNT_POINT "/var/cache/apt/archives/",
         deps_path
     );
     if (run_install_command(cmd) != 0)
@@ -96,8 +96,8 @@ static int install_component_packages(const Component *component)
     }
 
     // Install packages using dpkg (run twice for dependency resolution).
-    run_install_command("chroot " CONFIG_TARGET_MOUNT_POINT " dpkg -i /var/cache/apt/archives/*.deb >>" CONFIG_INSTALL_LOG_PATH " 2>&1");
-    if (run_install_command("chroot " CONFIG_TARGET_MOUNT_POINT " dpkg --configure -a >>" CONFIG_INSTALL_LOG_PATH " 2>&1") != 0)
+    run_chroot_command(session, "dpkg", "dpkg -i /var/cache/apt/archives/*.deb");
+    if (run_chroot_command(session, "dpkg", "dpkg --configure -a") != 0)
     {
         return -3;
     }
@@ -107,19 +107,29 @@ static int install_component_packages(const Component *component)
 
 static int install_all_component_packages(void)
 {
-    for (int i = 0; i < CONFIG_COMPONENT_COUNT; i++)
+    // Run every component's package installation in one chroot session.
+    ChrootSession session;
+    if (open_chroot_session(&session) != 0)
+    {
+        return -(CONFIG_COMPONENT_COUNT + 1);
+    }
+
+    int result = 0;
+    for (int i = 0; i < CONFIG_COMPONENT_COUNT && result == 0; i++)
     {
         const Component *component = &CONFIG_COMPONENTS[i];
         if (component_exists(component))
         {
-            if (install_component_packages(component) != 0)
+            if (install_component_packages(&session, component) != 0)
             {
-                return -(i + 1);
+                result = -(i + 1);
             }
         }
     }
 
-    return 0;
+    close_chroot_session(&session);
+
+    return result;
 }
 
 static int find_x11_startup_component(void)
@@ -138,7 +148,7 @@ static int find_x11_startup_component(void)
 static int write_xinitrc(const Component *component)
 {
     // Ensure X11 xinit directory exists.
-    if (run_install_command("mkdir -p " CONFIG_TARGET_MOUNT_POINT "/etc/X11/xinit >>" CONFIG_INSTALL_LOG_PATH " 2>&1") != 0)
+    if (run_install_command("mkdir -p " CONFIG_TARGET_MOUNT_POINT "/etc/X11/xinit") != 0)
     {
         return -1;
     }
@@ -164,7 +174,7 @@ static int write_xinitrc(const Component *component)
     }
 
     // Make xinitrc executable.
-    if (run_install_command("chmod +x " CONFIG_TARGET_XINITRC_PATH " >>" CONFIG_INSTALL_LOG_PATH " 2>&1") != 0)
+    if (run_install_command("chmod +x " CONFIG_TARGET_XINITRC_PATH) != 0)
     {
         return -3;
     }
@@ -175,7 +185,7 @@ static int write_xinitrc(const Component *component)
 static int write_xsession(const Component *component)
 {
     // Ensure /etc/skel exists.
-    if (run_install_command("mkdir -p " CONFIG_TARGET_MOUNT_POINT "/etc/skel >>" CONFIG_INSTALL_LOG_PATH " 2>&1") != 0)
+    if (run_install_command("mkdir -p " CONFIG_TARGET_MOUNT_POINT "/etc/skel") != 0)
     {
         return -1;
     }
@@ -200,7 +210,7 @@ static int write_xsession(const Component *component)
     }
 
     // Make .xsession executable.
-    if (run_install_command("chmod +x " CONFIG_TARGET_XSESSION_PATH " >>" CONFIG_INSTALL_LOG_PATH " 2>&1") != 0)
+    if (run_install_command("chmod +x " CONFIG_TARGET_XSESSION_PATH) != 0)
     {
         return -3;
     }
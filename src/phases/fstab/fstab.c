@@ -5,7 +5,7 @@
 
 #include "../../all.h"
 
-static const char *get_fs_type_string(PartitionFS fs)
+const char *get_fstab_fs_type(PartitionFS fs)
 {
     switch (fs)
     {
@@ -16,7 +16,7 @@ static const char *get_fs_type_string(PartitionFS fs)
     }
 }
 
-static const char *get_mount_options(PartitionFS fs, const char *mount_point)
+const char *get_fstab_mount_options(PartitionFS fs, const char *mount_point)
 {
     if (fs == FS_SWAP)
     {
@@ -40,33 +40,16 @@ static int get_fs_passno(const char *mount_point, PartitionFS fs)
     return 2;
 }
 
-int generate_fstab(void)
+semistatic int write_fstab_entries(FILE *fstab)
 {
     Store *store = get_store();
     const char *disk = store->disk;
 
-    // In dry-run mode, skip actual file operations.
-    if (store->dry_run)
-    {
-        write_install_log("Dry-run mode: skipping fstab generation");
-        return 0;
-    }
-
-    // Open fstab file for writing.
-    write_install_log("Opening /mnt/etc/fstab for writing");
-    FILE *fstab = fopen("/mnt/etc/fstab", "w");
-    if (!fstab)
-    {
-        write_install_log("Failed to open /mnt/etc/fstab");
-        return -1;
-    }
-
     // Write header comment.
     if (fprintf(fstab, "# /etc/fstab: static file system information.\n") < 0 ||
         fprintf(fstab, "# <device>  <mount>  <type>  <options>  <dump>  <pass>\n\n") < 0)
     {
         write_install_log("Failed to write fstab header");
-        fclose(fstab);
         return -2;
     }
 
@@ -76,7 +59,7 @@ int generate_fstab(void)
         Partition *partition = &store->partitions[i];
 
         // Skip partitions without a filesystem or mount point.
-        const char *fs_type = get_fs_type_string(partition->filesystem);
+        const char *fs_type = get_fstab_fs_type(partition->filesystem);
         if (!fs_type) continue;
 
         // Get partition device path.
@@ -92,7 +75,7 @@ int generate_fstab(void)
         if (!mount || mount[0] == '\0') continue;
 
         // Get mount options and pass number.
-        const char *options = get_mount_options(partition->filesystem, partition->mount_point);
+        const char *options = get_fstab_mount_options(partition->filesystem, partition->mount_point);
         int passno = get_fs_passno(partition->mount_point, partition->filesystem);
 
         // Write fstab entry.
@@ -101,11 +84,41 @@ int generate_fstab(void)
             device, mount, fs_type, options, passno) < 0)
         {
             write_install_log("Failed to write fstab entry for %s", device);
-            fclose(fstab);
             return -3;
         }
     }
 
+    return 0;
+}
+
+int generate_fstab(void)
+{
+    Store *store = get_store();
+
+    // In dry-run mode, skip actual file operations.
+    if (store->dry_run)
+    {
+        write_install_log("Dry-run mode: skipping fstab generation");
+        return 0;
+    }
+
+    // Open fstab file for writing.
+    write_install_log("Opening /mnt/etc/fstab for writing");
+    FILE *fstab = fopen("/mnt/etc/fstab", "w");
+    if (!fstab)
+    {
+        write_install_log("Failed to open /mnt/etc/fstab");
+        return -1;
+    }
+
+    // Write the header and an entry for each partition.
+    int result = write_fstab_entries(fstab);
+    if (result != 0)
+    {
+        fclose(fstab);
+        return result;
+    }
+
     // Ensure all data is flushed before closing.
     if (fflush(fstab) != 0)
     {
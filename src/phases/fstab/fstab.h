@@ -1,5 +1,24 @@
 #pragma once
 
+/**
+ * Gets the fstab filesystem type of a partition's filesystem.
+ *
+ * @param fs The partition's filesystem.
+ *
+ * @return The type, such as "ext4", or NULL if it has no filesystem.
+ */
+const char *get_fstab_fs_type(PartitionFS fs);
+
+/**
+ * Gets the fstab mount options the target system mounts a partition with.
+ *
+ * @param fs The partition's filesystem.
+ * @param mount_point The partition's mount point.
+ *
+ * @return The options, or "defaults" if there are none.
+ */
+const char *get_fstab_mount_options(PartitionFS fs, const char *mount_point);
+
 /**
  * Generates /etc/fstab on the target system.
  *
@@ -55,7 +55,7 @@ int configure_locale(void)
     // This uncomments the line matching the locale.
     char cmd[COMMON_MAX_COMMAND_LENGTH];
     snprintf(cmd, sizeof(cmd),
-        "sed -i '/^# %s/s/^# //' /mnt/etc/locale.gen >>" CONFIG_INSTALL_LOG_PATH " 2>&1",
+        "sed -i '/^# %s/s/^# //' /mnt/etc/locale.gen",
         store->locale);
     if (run_install_command(cmd) != 0)
     {
@@ -63,7 +63,14 @@ int configure_locale(void)
     }
 
     // Generate locales inside the chroot.
-    if (run_install_command("chroot /mnt /usr/sbin/locale-gen >>" CONFIG_INSTALL_LOG_PATH " 2>&1") != 0)
+    ChrootSession session;
+    if (open_chroot_session(&session) != 0)
+    {
+        return -3;
+    }
+    int result = run_chroot_command(&session, "locale-gen", "/usr/sbin/locale-gen");
+    close_chroot_session(&session);
+    if (result != 0)
     {
         return -3;
     }
@@ -0,0 +1,199 @@
+/**
+ * This code is responsible for formatting partitions with their filesystems,
+ * running the formatting programs of several partitions at the same time.
+ */
+
+#include "../../all.h"
+
+int get_format_worker_count(const char *disk, int job_count)
+{
+    // Format one partition at a time unless the disk is known to be solid-state.
+    if (job_count < 2 || is_disk_rotational(disk) != 0)
+    {
+        return 1;
+    }
+    return job_count > FORMAT_MAX_WORKERS ? FORMAT_MAX_WORKERS : job_count;
+}
+
+unsigned long long get_format_inode_ratio(unsigned long long partition_bytes, int entry_count)
+{
+    if (entry_count <= 0)
+    {
+        return 0;
+    }
+
+    // Take the largest power of two that still leaves the headroom.
+    unsigned long long fitting_ratio = partition_bytes / ((unsigned long long)entry_count * FORMAT_INODE_HEADROOM);
+    if (fitting_ratio <= FORMAT_MIN_INODE_RATIO)
+    {
+        return 0;
+    }
+    unsigned long long ratio = FORMAT_MIN_INODE_RATIO;
+    while (ratio * 2 <= fitting_ratio && ratio < FORMAT_MAX_INODE_RATIO)
+    {
+        ratio *= 2;
+    }
+    return ratio;
+}
+
+int build_format_job(
+    const Partition *partition, const char *device, int entry_count, int discarded,
+    FormatJob *out_job
+)
+{
+    memset(out_job, 0, sizeof(*out_job));
+    snprintf(out_job->device, sizeof(out_job->device), "%s", device);
+
+    // Determine formatting command based on filesystem type.
+    int count = 0;
+    if (partition->filesystem == FS_EXT4)
+    {
+        out_job->fs_name = "ext4";
+        out_job->argv[count++] = "mkfs.ext4";
+        out_job->argv[count++] = "-F";
+        out_job->argv[count++] = "-E";
+        if (partition->format_profile == FORMAT_PROFILE_FULL)
+        {
+            // Discard the partition only if the disk was not discarded already.
+            out_job->argv[count++] = discarded
+                ? "lazy_itable_init=0,lazy_journal_init=0,nodiscard"
+                : "lazy_itable_init=0,lazy_journal_init=0";
+        }
+        else
+        {
+            // Leave initialization to the kernel, and size the inode tables
+            // to what the partition will hold.
+            out_job->argv[count++] = "lazy_itable_init=1,lazy_journal_init=1,nodiscard";
+            unsigned long long ratio = get_format_inode_ratio(partition->size_bytes, entry_count);
+            if (ratio > 0)
+            {
+                snprintf(out_job->inode_ratio, sizeof(out_job->inode_ratio), "%llu", ratio);
+                out_job->argv[count++] = "-i";
+                out_job->argv[count++] = out_job->inode_ratio;
+            }
+        }
+    }
+    else if (partition->filesystem == FS_SWAP)
+    {
+        out_job->fs_name = "swap";
+        out_job->argv[count++] = "mkswap";
+    }
+    else if (partition->filesystem == FS_FAT32)
+    {
+        out_job->fs_name = "fat32";
+        out_job->argv[count++] = "mkfs.vfat";
+        out_job->argv[count++] = "-F";
+        out_job->argv[count++] = "32";
+    }
+    else
+    {
+        return -1;
+    }
+    out_job->argv[count++] = out_job->device;
+    out_job->argv[count] = NULL;
+
+    return 0;
+}
+
+static void *run_format_worker(void *argument)
+{
+    FormatPool *pool = argument;
+
+    while (1)
+    {
+        // Take the next partition, unless another has failed.
+        pthread_mutex_lock(&pool->mutex);
+        if (pool->failed || pool->next_job >= pool->job_count)
+        {
+            pthread_mutex_unlock(&pool->mutex);
+            break;
+        }
+        FormatJob *job = &pool->jobs[pool->next_job++];
+        pthread_mutex_unlock(&pool->mutex);
+
+        // Format it, logging the program's output as one block.
+        write_install_log("Formatting %s as %s", job->device, job->fs_name);
+        job->result = run_install_argv(job->argv, &COMMAND_TO_INSTALL_LOG_BLOCK);
+        if (job->result != 0)
+        {
+            pthread_mutex_lock(&pool->mutex);
+            pool->failed = 1;
+            pthread_mutex_unlock(&pool->mutex);
+        }
+    }
+
+    return NULL;
+}
+
+int format_partitions(const char *disk, const Store *store, int discarded)
+{
+    FormatPool pool;
+    memset(&pool, 0, sizeof(pool));
+
+    // Describe the formatting of each partition.
+    for (int i = 0; i < store->partition_count; i++)
+    {
+        const Partition *partition = &store->partitions[i];
+        char device[128];
+        get_partition_device(disk, i + 1, device, sizeof(device));
+
+        // Skip the root partition when its filesystem comes from the image.
+        int is_root = strcmp(partition->mount_point, "/") == 0;
+        if (is_root && use_rootfs_image())
+        {
+            write_install_log("Skipping format of %s; the rootfs image provides it", device);
+            continue;
+        }
+
+        // Size the root inode tables to the rootfs on a fast format.
+        int entry_count = 0;
+        if (is_root && partition->filesystem == FS_EXT4 && partition->format_profile == FORMAT_PROFILE_FAST)
+        {
+            entry_count = get_rootfs_entry_count();
+        }
+        if (build_format_job(partition, device, entry_count, discarded, &pool.jobs[pool.job_count]) == 0)
+        {
+            pool.job_count++;
+        }
+    }
+    if (pool.job_count == 0)
+    {
+        return 0;
+    }
+
+    // Start the extra workers, falling back to fewer if a thread cannot start.
+    int worker_count = store->dry_run ? 1 : get_format_worker_count(disk, pool.job_count);
+    pthread_t threads[FORMAT_MAX_WORKERS];
+    int thread_count = 0;
+    pthread_mutex_init(&pool.mutex, NULL);
+    for (int i = 1; i < worker_count; i++)
+    {
+        if (pthread_create(&threads[thread_count], NULL, run_format_worker, &pool) != 0)
+        {
+            break;
+        }
+        thread_count++;
+    }
+    write_install_log("Formatting %d partitions with %d workers", pool.job_count, thread_count + 1);
+
+    // Work alongside the extra workers, then wait for them to finish.
+    run_format_worker(&pool);
+    for (int i = 0; i < thread_count; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&pool.mutex);
+
+    // Report each partition that failed to format.
+    int result = 0;
+    for (int i = 0; i < pool.job_count; i++)
+    {
+        if (pool.jobs[i].result != 0)
+        {
+            write_install_log("Failed to format %s (exit %d)", pool.jobs[i].device, pool.jobs[i].result);
+            result = -1;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include "../../all.h"
+
+/** The maximum number of partitions formatted at the same time. */
+#define FORMAT_MAX_WORKERS 4
+
+/** The most arguments of a formatting command, including its terminator. */
+#define FORMAT_MAX_ARGUMENTS 16
+
+/** The inodes given to the root filesystem for each rootfs entry, leaving room for later files. */
+#define FORMAT_INODE_HEADROOM 8
+
+/** The bytes per inode mke2fs uses by default, and the fewest a fast format uses. */
+#define FORMAT_MIN_INODE_RATIO 16384ULL
+
+/** The most bytes per inode a fast format uses. */
+#define FORMAT_MAX_INODE_RATIO 65536ULL
+
+/** A type representing the formatting of one partition. */
+typedef struct {
+    char device[128];
+    const char *fs_name;
+    const char *argv[FORMAT_MAX_ARGUMENTS];
+    char inode_ratio[24];
+    int result;
+} FormatJob;
+
+/** A type representing the partitions being formatted by a pool of workers. */
+typedef struct {
+    pthread_mutex_t mutex;
+    FormatJob jobs[MAX_PARTITIONS];
+    int job_count;
+    int next_job;
+    int failed;
+} FormatPool;
+
+/**
+ * Gets the number of partitions to format at the same time on a disk.
+ *
+ * A disk that may be rotational formats one partition at a time, since
+ * concurrent writers would make its heads seek between partitions. Other
+ * disks format up to FORMAT_MAX_WORKERS partitions at once.
+ *
+ * @param disk The disk device path.
+ * @param job_count The number of partitions to format.
+ *
+ * @return The number of workers to use, between 1 and job_count.
+ */
+int get_format_worker_count(const char *disk, int job_count);
+
+/**
+ * Gets the bytes per inode for a root filesystem sized to the rootfs.
+ *
+ * The ratio gives the partition FORMAT_INODE_HEADROOM inodes per rootfs
+ * entry, rounded down to a power of two within FORMAT_MIN_INODE_RATIO and
+ * FORMAT_MAX_INODE_RATIO, so a large partition has fewer inode tables to
+ * initialize.
+ *
+ * @param partition_bytes The size of the partition.
+ * @param entry_count The number of entries in the rootfs, or 0 if unknown.
+ *
+ * @return - `>0` - The bytes per inode to format with.
+ * @return - `0` - Indicates the mke2fs default should be kept.
+ */
+unsigned long long get_format_inode_ratio(unsigned long long partition_bytes, int entry_count);
+
+/**
+ * Builds the command that formats a partition with its filesystem.
+ *
+ * An ext4 partition follows its format profile. The fast profile leaves
+ * inode tables and the journal to be initialized by the kernel in the
+ * background, skips discarding the partition, and sizes the inode tables to
+ * the rootfs when given its entry count. The full profile initializes
+ * everything while formatting, and discards the partition unless the disk
+ * was already discarded.
+ *
+ * @param partition The partition to format.
+ * @param device The partition device path.
+ * @param entry_count The number of rootfs entries the partition will hold,
+ *                    or 0 to keep the default inode ratio.
+ * @param discarded Whether the whole disk was discarded beforehand.
+ * @param out_job Output: the job, whose arguments point into itself.
+ *
+ * @return - `0` - Indicates the job was built.
+ * @return - `-1` - Indicates the partition has no filesystem to create.
+ */
+int build_format_job(
+    const Partition *partition, const char *device, int entry_count, int discarded,
+    FormatJob *out_job
+);
+
+/**
+ * Formats each configured partition with its filesystem.
+ *
+ * Partitions are formatted on a bounded pool of workers, the calling thread
+ * being one of them. Each program's output is captured on its own and
+ * written to the install log as one block once it exits. After a failure,
+ * partitions not yet started are skipped. In dry run mode, partitions are
+ * formatted one at a time so commands are logged in partition order.
+ *
+ * @param disk The disk device path.
+ * @param store The store holding the partitions.
+ * @param discarded Whether the whole disk was discarded beforehand.
+ *
+ * @return - `0` - Indicates every partition was formatted.
+ * @return - `-1` - Indicates a partition failed to format.
+ */
+int format_partitions(const char *disk, const Store *store, int discarded);
@@ -0,0 +1,537 @@
+/**
+ * This code is responsible for building the GPT or MBR partition table of
+ * the target disk in memory, writing it in one pass, and telling the kernel
+ * about the new partitions.
+ */
+
+#include "../../all.h"
+
+/** The GPT partition attribute marking a partition bootable by legacy BIOS. */
+#define GPT_ATTRIBUTE_LEGACY_BOOTABLE (1ULL << 2)
+
+/** The size of the GPT header fields covered by its checksum. */
+#define GPT_HEADER_BYTES 92
+
+/** The MBR partition type of a GPT protective partition. */
+#define MBR_TYPE_PROTECTIVE 0xee
+
+/** The number of times to look for a partition device after a reload. */
+#define PARTITION_DEVICE_ATTEMPTS 100
+
+/** The delay between looking for partition devices, in microseconds. */
+#define PARTITION_DEVICE_DELAY_US 20000
+
+/** A type representing the partition type of one kind of partition. */
+typedef struct {
+    const char *name;
+    const char *gpt_type;
+    unsigned char mbr_type;
+} PartitionKind;
+
+static const PartitionKind partition_kinds[] = {
+    { "linux",     "0FC63DAF-8483-4772-8E79-3D69D8477DE4", 0x83 },
+    { "swap",      "0657FD6D-A4AB-43C4-84E5-0933C84B4F4F", 0x82 },
+    { "esp",       "C12A7328-F81F-11D2-BA4B-00A0C93EC93B", 0xef },
+    { "bios_grub", "21686148-6449-6E6F-744E-656564454649", 0xda },
+    { "data",      "EBD0A0A2-B9E5-4433-87C0-68B6B72699C7", 0x0c },
+};
+
+static void put_le16(unsigned char *out, unsigned int value)
+{
+    out[0] = (unsigned char)value;
+    out[1] = (unsigned char)(value >> 8);
+}
+
+static void put_le32(unsigned char *out, unsigned int value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        out[i] = (unsigned char)(value >> (i * 8));
+    }
+}
+
+static void put_le64(unsigned char *out, unsigned long long value)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        out[i] = (unsigned char)(value >> (i * 8));
+    }
+}
+
+static void parse_guid(const char *text, unsigned char out_guid[16])
+{
+    // The first three fields are stored little-endian, the rest as written.
+    static const int byte_order[16] = { 3, 2, 1, 0, 5, 4, 7, 6, 8, 9, 10, 11, 12, 13, 14, 15 };
+    int index = 0;
+    for (const char *cursor = text; *cursor && index < 16; cursor++)
+    {
+        if (*cursor == '-')
+        {
+            continue;
+        }
+        unsigned int byte;
+        sscanf(cursor, "%2x", &byte);
+        out_guid[byte_order[index++]] = (unsigned char)byte;
+        cursor++;
+    }
+}
+
+static void generate_guid(unsigned char out_guid[16])
+{
+    // Read random bytes, mixing in the clock if the kernel cannot supply them.
+    int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+    ssize_t count = fd >= 0 ? read(fd, out_guid, 16) : -1;
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    if (count != 16)
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        unsigned long long seed = (unsigned long long)now.tv_nsec ^ ((unsigned long long)now.tv_sec << 20) ^ (unsigned long long)getpid();
+        for (int i = 0; i < 16; i++)
+        {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            out_guid[i] = (unsigned char)(seed >> 56);
+        }
+    }
+
+    // Mark the GUID as a random (version 4) one.
+    out_guid[7] = (out_guid[7] & 0x0f) | 0x40;
+    out_guid[8] = (out_guid[8] & 0x3f) | 0x80;
+}
+
+static const PartitionKind *get_partition_kind(const Partition *partition)
+{
+    if (partition->flag_bios_grub) return &partition_kinds[3];
+    if (partition->flag_esp) return &partition_kinds[2];
+    if (partition->filesystem == FS_SWAP) return &partition_kinds[1];
+    if (partition->filesystem == FS_FAT32) return &partition_kinds[4];
+    return &partition_kinds[0];
+}
+
+static unsigned long long align_up(unsigned long long bytes, unsigned long long alignment)
+{
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+
+static unsigned long long get_gpt_entry_sectors(unsigned int sector_bytes)
+{
+    return (GPT_ENTRY_COUNT * GPT_ENTRY_BYTES + sector_bytes - 1) / sector_bytes;
+}
+
+static unsigned long long get_last_usable_sector(const PartitionTable *table)
+{
+    if (table->label == DISK_LABEL_GPT)
+    {
+        return table->sector_count - 2 - get_gpt_entry_sectors(table->sector_bytes);
+    }
+    return table->sector_count - 1;
+}
+
+unsigned long long get_partition_alignment(unsigned long long io_alignment)
+{
+    if (io_alignment == 0)
+    {
+        return PARTITION_ALIGNMENT_BYTES;
+    }
+    unsigned long long alignment = get_least_common_multiple(PARTITION_ALIGNMENT_BYTES, io_alignment);
+    return alignment <= PARTITION_MAX_ALIGNMENT_BYTES ? alignment : PARTITION_ALIGNMENT_BYTES;
+}
+
+int build_partition_table(
+    const Store *store, unsigned int sector_bytes, unsigned long long sector_count,
+    PartitionTable *out_table
+)
+{
+    memset(out_table, 0, sizeof(PartitionTable));
+    out_table->label = store->disk_label;
+    out_table->sector_bytes = sector_bytes;
+    out_table->sector_count = sector_count;
+    out_table->alignment_bytes = store->disk_alignment ? store->disk_alignment : PARTITION_ALIGNMENT_BYTES;
+    out_table->count = store->partition_count;
+    generate_guid(out_table->disk_guid);
+
+    // Partition numbers follow the store, so an MBR holds primaries only.
+    if (store->disk_label == DISK_LABEL_MBR && store->partition_count > MBR_MAX_PARTITIONS)
+    {
+        return -1;
+    }
+
+    // Lay the partitions out from 1 MB, in decimal megabytes as the sizes
+    // were chosen, starting and ending each on an alignment boundary.
+    unsigned long long alignment = out_table->alignment_bytes;
+    unsigned long long start_bytes = 1000 * 1000;
+    for (int i = 0; i < store->partition_count; i++)
+    {
+        const Partition *partition = &store->partitions[i];
+        PartitionTableEntry *entry = &out_table->entries[i];
+        unsigned long long end_bytes = start_bytes + partition->size_bytes / (1000 * 1000) * (1000 * 1000);
+
+        entry->first_sector = align_up(start_bytes, alignment) / sector_bytes;
+        entry->last_sector = align_up(end_bytes, alignment) / sector_bytes - 1;
+        if (entry->last_sector < entry->first_sector)
+        {
+            return -2;
+        }
+
+        // Let the last partition give up its alignment padding at the end
+        // of the disk, but not any of the size that was asked for.
+        if (sector_count > 0 && entry->last_sector > get_last_usable_sector(out_table))
+        {
+            if (end_bytes / sector_bytes - 1 > get_last_usable_sector(out_table))
+            {
+                return -2;
+            }
+            entry->last_sector = get_last_usable_sector(out_table);
+        }
+
+        // An MBR addresses sectors with 32 bits.
+        if (store->disk_label == DISK_LABEL_MBR && entry->last_sector > 0xffffffffULL)
+        {
+            return -2;
+        }
+
+        const PartitionKind *kind = get_partition_kind(partition);
+        entry->type_name = kind->name;
+        parse_guid(kind->gpt_type, entry->gpt_type);
+        entry->mbr_type = kind->mbr_type;
+        entry->bootable = partition->flag_boot;
+        generate_guid(entry->unique_guid);
+
+        start_bytes = end_bytes;
+    }
+
+    return 0;
+}
+
+static void encode_mbr_entry(
+    unsigned char *out, int bootable, unsigned char type,
+    unsigned long long first_sector, unsigned long long sector_count
+)
+{
+    // Mark the CHS addresses as beyond reach, so only the LBA fields count.
+    out[0] = bootable ? 0x80 : 0x00;
+    out[1] = 0xfe;
+    out[2] = 0xff;
+    out[3] = 0xff;
+    out[4] = type;
+    out[5] = 0xfe;
+    out[6] = 0xff;
+    out[7] = 0xff;
+    put_le32(out + 8, (unsigned int)first_sector);
+    put_le32(out + 12, sector_count > 0xffffffffULL ? 0xffffffffU : (unsigned int)sector_count);
+}
+
+static void encode_mbr(const PartitionTable *table, unsigned char *out_sector)
+{
+    memset(out_sector, 0, table->sector_bytes);
+
+    // Fill the four primary entries, or a single protective one for a GPT.
+    if (table->label == DISK_LABEL_GPT)
+    {
+        encode_mbr_entry(out_sector + 446, 0, MBR_TYPE_PROTECTIVE, 1, table->sector_count - 1);
+        out_sector[447] = 0x00;
+        out_sector[448] = 0x02;
+        out_sector[449] = 0x00;
+        out_sector[451] = 0xff;
+    }
+    else
+    {
+        memcpy(out_sector + 440, table->disk_guid, 4);
+        for (int i = 0; i < table->count; i++)
+        {
+            const PartitionTableEntry *entry = &table->entries[i];
+            encode_mbr_entry(
+                out_sector + 446 + i * 16, entry->bootable, entry->mbr_type,
+                entry->first_sector, entry->last_sector - entry->first_sector + 1
+            );
+        }
+    }
+
+    out_sector[510] = 0x55;
+    out_sector[511] = 0xaa;
+}
+
+static void encode_gpt_entries(const PartitionTable *table, unsigned char *out_entries)
+{
+    memset(out_entries, 0, GPT_ENTRY_COUNT * GPT_ENTRY_BYTES);
+    for (int i = 0; i < table->count; i++)
+    {
+        const PartitionTableEntry *entry = &table->entries[i];
+        unsigned char *out = out_entries + i * GPT_ENTRY_BYTES;
+        memcpy(out, entry->gpt_type, 16);
+        memcpy(out + 16, entry->unique_guid, 16);
+        put_le64(out + 32, entry->first_sector);
+        put_le64(out + 40, entry->last_sector);
+        put_le64(out + 48, entry->bootable ? GPT_ATTRIBUTE_LEGACY_BOOTABLE : 0);
+
+        // Name the partition after its type, in UTF-16.
+        for (int c = 0; entry->type_name[c] && c < 36; c++)
+        {
+            put_le16(out + 56 + c * 2, (unsigned char)entry->type_name[c]);
+        }
+    }
+}
+
+static void encode_gpt_header(
+    const PartitionTable *table, unsigned long long header_sector,
+    unsigned long long alternate_sector, unsigned long long entries_sector,
+    unsigned int entries_checksum, unsigned char *out_sector
+)
+{
+    unsigned long long entry_sectors = get_gpt_entry_sectors(table->sector_bytes);
+    memset(out_sector, 0, table->sector_bytes);
+    memcpy(out_sector, "EFI PART", 8);
+    put_le32(out_sector + 8, 0x00010000);
+    put_le32(out_sector + 12, GPT_HEADER_BYTES);
+    put_le64(out_sector + 24, header_sector);
+    put_le64(out_sector + 32, alternate_sector);
+    put_le64(out_sector + 40, 2 + entry_sectors);
+    put_le64(out_sector + 48, get_last_usable_sector(table));
+    memcpy(out_sector + 56, table->disk_guid, 16);
+    put_le64(out_sector + 72, entries_sector);
+    put_le32(out_sector + 80, GPT_ENTRY_COUNT);
+    put_le32(out_sector + 84, GPT_ENTRY_BYTES);
+    put_le32(out_sector + 88, entries_checksum);
+
+    // Checksum the header with its own checksum field still zero.
+    put_le32(out_sector + 16, (unsigned int)crc32(0, out_sector, GPT_HEADER_BYTES));
+}
+
+static int write_table_bytes(int fd, const unsigned char *buffer, size_t length, unsigned long long offset)
+{
+    size_t done = 0;
+    while (done < length)
+    {
+        ssize_t count = pwrite(fd, buffer + done, length - done, (off_t)(offset + done));
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (count <= 0)
+        {
+            return -1;
+        }
+        done += (size_t)count;
+    }
+    return 0;
+}
+
+int write_partition_table(int fd, const PartitionTable *table)
+{
+    unsigned int sector_bytes = table->sector_bytes;
+    unsigned long long entry_sectors = get_gpt_entry_sectors(sector_bytes);
+    if (table->sector_count < 2 * entry_sectors + 3)
+    {
+        return -1;
+    }
+
+    // Build everything before the first usable sector, and for a GPT the
+    // copy kept at the end of the disk.
+    size_t head_bytes = (size_t)(2 + entry_sectors) * sector_bytes;
+    size_t tail_bytes = (size_t)(1 + entry_sectors) * sector_bytes;
+    unsigned char *head = calloc(1, head_bytes);
+    unsigned char *tail = calloc(1, tail_bytes);
+    if (!head || !tail)
+    {
+        free(head);
+        free(tail);
+        return -2;
+    }
+    encode_mbr(table, head);
+    unsigned long long last_sector = table->sector_count - 1;
+    if (table->label == DISK_LABEL_GPT)
+    {
+        unsigned char *entries = head + 2 * sector_bytes;
+        encode_gpt_entries(table, entries);
+        unsigned int entries_checksum = (unsigned int)crc32(0, entries, GPT_ENTRY_COUNT * GPT_ENTRY_BYTES);
+        memcpy(tail, entries, entry_sectors * sector_bytes);
+        encode_gpt_header(table, 1, last_sector, 2, entries_checksum, head + sector_bytes);
+        encode_gpt_header(
+            table, last_sector, 1, last_sector - entry_sectors, entries_checksum,
+            tail + entry_sectors * sector_bytes
+        );
+    }
+
+    // Write both ends, which for an MBR clears any earlier GPT, then sync.
+    int result = 0;
+    if (write_table_bytes(fd, head, head_bytes, 0) != 0 ||
+        write_table_bytes(fd, tail, tail_bytes, (last_sector - entry_sectors) * sector_bytes) != 0 ||
+        fsync(fd) != 0)
+    {
+        result = -2;
+    }
+
+    free(head);
+    free(tail);
+    return result;
+}
+
+int reload_partition_table(int fd, const PartitionTable *table)
+{
+    // Have the kernel reread the whole table at once.
+    if (ioctl(fd, BLKRRPART) == 0)
+    {
+        return 0;
+    }
+    write_install_log("Rereading the partition table failed (%s), updating partitions one by one", strerror(errno));
+
+    // Otherwise drop the partitions the kernel knows, then add the new ones.
+    for (int number = 1; number <= MAX_PARTITIONS; number++)
+    {
+        struct blkpg_partition partition = { .pno = number };
+        struct blkpg_ioctl_arg argument = {
+            .op = BLKPG_DEL_PARTITION, .datalen = sizeof(partition), .data = &partition
+        };
+        ioctl(fd, BLKPG, &argument);
+    }
+    for (int i = 0; i < table->count; i++)
+    {
+        const PartitionTableEntry *entry = &table->entries[i];
+        struct blkpg_partition partition = {
+            .start = (long long)(entry->first_sector * table->sector_bytes),
+            .length = (long long)((entry->last_sector - entry->first_sector + 1) * table->sector_bytes),
+            .pno = i + 1
+        };
+        struct blkpg_ioctl_arg argument = {
+            .op = BLKPG_ADD_PARTITION, .datalen = sizeof(partition), .data = &partition
+        };
+        if (ioctl(fd, BLKPG, &argument) != 0)
+        {
+            write_install_log("Adding partition %d to the kernel failed: %s", i + 1, strerror(errno));
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int wait_for_partition_devices(const char *disk, int count)
+{
+    // The device nodes appear once the kernel and udev have caught up.
+    for (int i = 0; i < count; i++)
+    {
+        char device[128];
+        get_partition_device(disk, i + 1, device, sizeof(device));
+        int attempt = 0;
+        while (access(device, F_OK) != 0)
+        {
+            if (++attempt >= PARTITION_DEVICE_ATTEMPTS)
+            {
+                write_install_log("Partition device %s did not appear", device);
+                return -1;
+            }
+            usleep(PARTITION_DEVICE_DELAY_US);
+        }
+    }
+    return 0;
+}
+
+static void log_partition_table(const char *disk, const PartitionTable *table)
+{
+    Store *store = get_store();
+    const char *label = table->label == DISK_LABEL_GPT ? "gpt" : "msdos";
+    if (store->dry_run)
+    {
+        write_dry_run_log("write-partition-table %s %s", label, disk);
+    }
+    else
+    {
+        write_install_log(
+            "Writing %s partition table to %s, aligned to %llu bytes", label, disk, table->alignment_bytes
+        );
+    }
+
+    for (int i = 0; i < table->count; i++)
+    {
+        const PartitionTableEntry *entry = &table->entries[i];
+        char device[128];
+        get_partition_device(disk, i + 1, device, sizeof(device));
+        if (store->dry_run)
+        {
+            write_dry_run_log(
+                "partition %s %llu-%llu %s%s", device, entry->first_sector, entry->last_sector,
+                entry->type_name, entry->bootable ? " boot" : ""
+            );
+        }
+        else
+        {
+            write_install_log(
+                "Partition %s: sectors %llu-%llu, type %s%s", device, entry->first_sector,
+                entry->last_sector, entry->type_name, entry->bootable ? ", bootable" : ""
+            );
+        }
+    }
+}
+
+int create_partition_table(const char *disk)
+{
+    Store *store = get_store();
+    PartitionTable table;
+
+    // In dry-run mode, lay the table out for the size the disk step found.
+    if (store->dry_run)
+    {
+        if (build_partition_table(store, 512, store->disk_size / 512, &table) != 0)
+        {
+            return -2;
+        }
+        log_partition_table(disk, &table);
+        return 0;
+    }
+
+    // Open the disk exclusively, so nothing else is using it.
+    int fd = open(disk, O_RDWR | O_CLOEXEC | O_EXCL);
+    if (fd < 0)
+    {
+        write_install_log("Failed to open %s: %s", disk, strerror(errno));
+        return -1;
+    }
+    unsigned int sector_bytes = 512;
+    int logical_sector_bytes = 0;
+    if (ioctl(fd, BLKSSZGET, &logical_sector_bytes) == 0 && logical_sector_bytes > 0)
+    {
+        sector_bytes = (unsigned int)logical_sector_bytes;
+    }
+    unsigned long long sector_count = get_open_disk_size(fd) / sector_bytes;
+    if (sector_count == 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    // Build the whole table, then write it in one pass.
+    int result = build_partition_table(store, sector_bytes, sector_count, &table);
+    if (result != 0)
+    {
+        if (result == -1)
+        {
+            write_install_log("An MBR holds at most %d partitions", MBR_MAX_PARTITIONS);
+        }
+        else
+        {
+            write_install_log("Partitions do not fit on %s", disk);
+        }
+        close(fd);
+        return -2;
+    }
+    log_partition_table(disk, &table);
+    if (write_partition_table(fd, &table) != 0)
+    {
+        write_install_log("Failed to write the partition table: %s", strerror(errno));
+        close(fd);
+        return -3;
+    }
+
+    // Tell the kernel about the partitions, and wait for their devices.
+    result = reload_partition_table(fd, &table);
+    close(fd);
+    if (result != 0 || wait_for_partition_devices(disk, table.count) != 0)
+    {
+        return -4;
+    }
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include "../../all.h"
+
+/** The boundary partitions are aligned to, as parted's optimal alignment. */
+#define PARTITION_ALIGNMENT_BYTES (1024ULL * 1024)
+
+/** The largest boundary a disk's I/O sizes may raise the alignment to. */
+#define PARTITION_MAX_ALIGNMENT_BYTES (16ULL * 1024 * 1024)
+
+/** The number of entries in a GPT partition entry array. */
+#define GPT_ENTRY_COUNT 128
+
+/** The size of one GPT partition entry. */
+#define GPT_ENTRY_BYTES 128
+
+/** The number of partitions an MBR holds without an extended partition. */
+#define MBR_MAX_PARTITIONS 4
+
+/** A type representing one partition of a table being written. */
+typedef struct {
+    unsigned long long first_sector;
+    unsigned long long last_sector;
+    const char *type_name;
+    unsigned char gpt_type[16];
+    unsigned char unique_guid[16];
+    unsigned char mbr_type;
+    int bootable;
+} PartitionTableEntry;
+
+/** A type representing a partition table built in memory. */
+typedef struct {
+    DiskLabel label;
+    unsigned int sector_bytes;
+    unsigned long long sector_count;
+    unsigned long long alignment_bytes;
+    unsigned char disk_guid[16];
+    PartitionTableEntry entries[MAX_PARTITIONS];
+    int count;
+} PartitionTable;
+
+/**
+ * Gets the boundary partitions on a disk are aligned to: the least common
+ * multiple of PARTITION_ALIGNMENT_BYTES and the disk's I/O alignment.
+ *
+ * An I/O alignment that would raise it past PARTITION_MAX_ALIGNMENT_BYTES is
+ * taken to be misreported, as some devices do with their optimal I/O size,
+ * and ignored.
+ *
+ * @param io_alignment The disk's I/O alignment, or 0 if unknown.
+ *
+ * @return The partition alignment in bytes.
+ */
+unsigned long long get_partition_alignment(unsigned long long io_alignment);
+
+/**
+ * Builds the partition table for the configured partitions.
+ *
+ * Partitions are laid out in order from 1 MB, each starting and ending on
+ * a boundary of the store's disk alignment, or PARTITION_ALIGNMENT_BYTES if
+ * it is unset, with their types and flags taken from the store. The last
+ * partition may end short of a boundary to fit the disk. A GPT gets random
+ * disk and partition GUIDs.
+ *
+ * @param store The store holding the disk label and partitions.
+ * @param sector_bytes The logical sector size of the disk.
+ * @param sector_count The number of sectors on the disk, or 0 to skip
+ *                     checking that the partitions fit.
+ * @param out_table Output: the built table.
+ *
+ * @return - `0` - Indicates the table was built.
+ * @return - `-1` - Indicates the label cannot hold that many partitions.
+ * @return - `-2` - Indicates the partitions do not fit on the disk.
+ */
+int build_partition_table(
+    const Store *store, unsigned int sector_bytes, unsigned long long sector_count,
+    PartitionTable *out_table
+);
+
+/**
+ * Writes a partition table to a disk in one pass.
+ *
+ * A GPT is written with its protective MBR, primary header and entries, and
+ * backup entries and header at the end of the disk. An MBR is written to the
+ * first sector, clearing any GPT headers left by an earlier label.
+ *
+ * @param fd The disk, open for writing.
+ * @param table The table to write, built for this disk.
+ *
+ * @return - `0` - Indicates the table was written and synced.
+ * @return - `-1` - Indicates the table does not describe a disk size.
+ * @return - `-2` - Indicates writing failed.
+ */
+int write_partition_table(int fd, const PartitionTable *table);
+
+/**
+ * Tells the kernel about all partitions of a freshly written table.
+ *
+ * Asks the kernel to reread the table with BLKRRPART, falling back to
+ * replacing its partitions one by one with BLKPG when the disk is busy.
+ *
+ * @param fd The disk, open for reading.
+ * @param table The table that was written.
+ *
+ * @return - `0` - Indicates the kernel knows the new partitions.
+ * @return - `-1` - Indicates the kernel could not be updated.
+ */
+int reload_partition_table(int fd, const PartitionTable *table);
+
+/**
+ * Writes the configured partition table to the target disk, and waits for
+ * the kernel to create the partition devices.
+ *
+ * In dry-run mode, the table is recorded in the dry-run log instead.
+ *
+ * @param disk The disk device path.
+ *
+ * @return - `0` - Indicates the partitions are ready.
+ * @return - `-1` - Indicates the disk could not be opened or measured.
+ * @return - `-2` - Indicates the partitions do not fit the disk label.
+ * @return - `-3` - Indicates writing the table failed.
+ * @return - `-4` - Indicates the kernel could not be updated.
+ */
+int create_partition_table(const char *disk);
@@ -5,193 +5,67 @@
 
 #include "../../all.h"
 
-static int create_gpt_table(const char *disk)
+int find_root_partition_index(Store *store)
 {
-    // Escape disk path for shell command.
-    char escaped_disk[COMMON_MAX_QUOTED_LENGTH];
-    if (common.shell_escape(disk, escaped_disk, sizeof(escaped_disk)) != 0)
+    // Search for partition with "/" mount point.
+    for (int i = 0; i < store->partition_count; i++)
     {
-        return -1;
+        if (strcmp(store->partitions[i].mount_point, "/") == 0)
+        {
+            return i;
+        }
     }
-
-    // Build and run parted command to create GPT label.
-    char command[COMMON_MAX_COMMAND_LENGTH];
-    snprintf(command, sizeof(command), "parted -s %s mklabel gpt >>" CONFIG_INSTALL_LOG_PATH " 2>&1", escaped_disk);
-
-    return run_install_command(command) == 0 ? 0 : -2;
+    return -1;
 }
 
-static int create_partition_entries(const char *disk, Store *store)
+static void build_mount_options(const Partition *partition, int final, char *out_options, size_t options_size)
 {
-    // Escape disk path for shell commands.
-    char escaped_disk[COMMON_MAX_QUOTED_LENGTH];
-    if (common.shell_escape(disk, escaped_disk, sizeof(escaped_disk)) != 0)
+    // Give ext4 a long journal commit interval while installing, and put
+    // back the default one for the target system.
+    const char *fstab_options = get_fstab_mount_options(partition->filesystem, partition->mount_point);
+    if (strcmp(fstab_options, "defaults") == 0)
     {
-        return -1;
+        fstab_options = "";
     }
-
-    // Track partition start position in megabytes.
-    unsigned long long start_megabytes = 1;
-
-    // Iterate through each partition in the store.
-    for (int i = 0; i < store->partition_count; i++)
+    if (partition->filesystem == FS_EXT4)
     {
-        Partition *partition = &store->partitions[i];
-        // Convert size from bytes to decimal megabytes (1 MB = 1,000,000 bytes).
-        unsigned long long size_megabytes = partition->size_bytes / (1000 * 1000);
-        unsigned long long end_megabytes = start_megabytes + size_megabytes;
-
-        write_install_log("Creating partition %d: %lluMB (%lluMB - %lluMB), mount=%s",
-            i + 1, size_megabytes, start_megabytes, end_megabytes, partition->mount_point);
-
-        // Create partition with calculated boundaries.
-        char command[COMMON_MAX_COMMAND_LENGTH];
         snprintf(
-            command, sizeof(command),
-            "parted -s %s mkpart %s %lluMB %lluMB >>" CONFIG_INSTALL_LOG_PATH " 2>&1",
-            escaped_disk,
-            (partition->type == PART_PRIMARY) ? "primary" : "logical",
-            start_megabytes, end_megabytes
+            out_options, options_size, "commit=%d%s%s",
+            final ? PARTITION_DEFAULT_COMMIT_SECONDS : PARTITION_INSTALL_COMMIT_SECONDS,
+            fstab_options[0] ? "," : "", fstab_options
         );
-        if (run_install_command(command) != 0)
-        {
-            return -2;
-        }
-
-        // Set boot flag if needed.
-        if (partition->flag_boot)
-        {
-            snprintf(
-                command, sizeof(command),
-                "parted -s %s set %d boot on >>" CONFIG_INSTALL_LOG_PATH " 2>&1",
-                escaped_disk, i + 1
-            );
-            if (run_install_command(command) != 0)
-            {
-                return -3;
-            }
-        }
-
-        // Set ESP flag if needed.
-        if (partition->flag_esp)
-        {
-            snprintf(
-                command, sizeof(command),
-                "parted -s %s set %d esp on >>" CONFIG_INSTALL_LOG_PATH " 2>&1",
-                escaped_disk, i + 1
-            );
-            if (run_install_command(command) != 0)
-            {
-                return -4;
-            }
-        }
-
-        // Set BIOS boot flag if needed (for GPT + BIOS boot).
-        if (partition->flag_bios_grub)
-        {
-            snprintf(
-                command, sizeof(command),
-                "parted -s %s set %d bios_grub on >>" CONFIG_INSTALL_LOG_PATH " 2>&1",
-                escaped_disk, i + 1
-            );
-            if (run_install_command(command) != 0)
-            {
-                return -5;
-            }
-        }
-
-        // Update start for next partition.
-        start_megabytes = end_megabytes;
     }
-
-    return 0;
-}
-
-static int format_partitions(const char *disk, Store *store)
-{
-    // Iterate through each partition in the store.
-    for (int i = 0; i < store->partition_count; i++)
+    else
     {
-        Partition *partition = &store->partitions[i];
-
-        // Get partition device path.
-        char partition_device[128];
-        get_partition_device(disk, i + 1, partition_device, sizeof(partition_device));
-
-        // Escape device path for shell command.
-        char escaped_device[COMMON_MAX_QUOTED_LENGTH];
-        if (common.shell_escape(partition_device, escaped_device, sizeof(escaped_device)) != 0)
-        {
-            return -1;
-        }
-
-        // Determine formatting command based on filesystem type.
-        char command[COMMON_MAX_COMMAND_LENGTH];
-        const char *fs_name = NULL;
-        if (partition->filesystem == FS_EXT4)
-        {
-            fs_name = "ext4";
-            snprintf(command, sizeof(command), "mkfs.ext4 -F %s >>" CONFIG_INSTALL_LOG_PATH " 2>&1", escaped_device);
-        }
-        else if (partition->filesystem == FS_SWAP)
-        {
-            fs_name = "swap";
-            snprintf(command, sizeof(command), "mkswap %s >>" CONFIG_INSTALL_LOG_PATH " 2>&1", escaped_device);
-        }
-        else if (partition->filesystem == FS_FAT32)
-        {
-            fs_name = "fat32";
-            snprintf(command, sizeof(command), "mkfs.vfat -F 32 %s >>" CONFIG_INSTALL_LOG_PATH " 2>&1", escaped_device);
-        }
-        else
-        {
-            // No filesystem specified, skip formatting.
-            continue;
-        }
-
-        write_install_log("Formatting %s as %s", partition_device, fs_name);
-
-        // Execute formatting command.
-        if (run_install_command(command) != 0)
-        {
-            return -2;
-        }
+        snprintf(out_options, options_size, "%s", fstab_options);
     }
+}
 
-    return 0;
+static int mount_partition(const Partition *partition, const char *device, const char *target)
+{
+    // Skip access time updates while files are being written.
+    char options[128];
+    build_mount_options(partition, 0, options, sizeof(options));
+    return mount_filesystem(
+        device, target, get_fstab_fs_type(partition->filesystem), MS_NOATIME, options
+    );
 }
 
-static int find_root_partition_index(Store *store)
+int remount_partition(const Partition *partition, const char *target)
 {
-    // Search for partition with "/" mount point.
-    for (int i = 0; i < store->partition_count; i++)
-    {
-        if (strcmp(store->partitions[i].mount_point, "/") == 0)
-        {
-            return i;
-        }
-    }
-    return -1;
+    // Name the atime mode, as a remount otherwise keeps the current one.
+    char options[128];
+    build_mount_options(partition, 1, options, sizeof(options));
+    return mount_filesystem(NULL, target, NULL, MS_REMOUNT | MS_RELATIME, options);
 }
 
-static int mount_root_partition(const char *disk, int root_index)
+static int mount_root_partition(const char *disk, Store *store, int root_index)
 {
     // Get root partition device path.
     char root_device[128];
     get_partition_device(disk, root_index + 1, root_device, sizeof(root_device));
 
-    // Escape device path for shell command.
-    char escaped_device[COMMON_MAX_QUOTED_LENGTH];
-    if (common.shell_escape(root_device, escaped_device, sizeof(escaped_device)) != 0)
-    {
-        return -1;
-    }
-
-    // Build and execute mount command.
-    char command[COMMON_MAX_COMMAND_LENGTH];
-    snprintf(command, sizeof(command), "mount %s /mnt >>" CONFIG_INSTALL_LOG_PATH " 2>&1", escaped_device);
-
-    return run_install_command(command) == 0 ? 0 : -2;
+    return mount_partition(&store->partitions[root_index], root_device, CONFIG_TARGET_MOUNT_POINT) == 0 ? 0 : -2;
 }
 
 static int mount_remaining_partitions(const char *disk, Store *store)
@@ -208,19 +82,10 @@ static int mount_remaining_partitions(const char *disk, Store *store)
             char partition_device[128];
             get_partition_device(disk, i + 1, partition_device, sizeof(partition_device));
 
-            // Escape device path for shell command.
-            char escaped_device[COMMON_MAX_QUOTED_LENGTH];
-            if (common.shell_escape(partition_device, escaped_device, sizeof(escaped_device)) != 0)
-            {
-                write_install_log("Warning: failed to escape device path %s", partition_device);
-                continue;
-            }
-
             // Enable swap.
             write_install_log("Enabling swap on %s", partition_device);
-            char command[COMMON_MAX_COMMAND_LENGTH];
-            snprintf(command, sizeof(command), "swapon %s >>" CONFIG_INSTALL_LOG_PATH " 2>&1", escaped_device);
-            if (run_install_command(command) != 0)
+            const char *const argv[] = { "swapon", partition_device, NULL };
+            if (run_install_argv(argv, &COMMAND_TO_INSTALL_LOG) != 0)
             {
                 write_install_log("Warning: failed to enable swap on %s", partition_device);
             }
@@ -234,27 +99,11 @@ static int mount_remaining_partitions(const char *disk, Store *store)
             // Construct full mount path.
             char mount_path[256];
             snprintf(mount_path, sizeof(mount_path), "/mnt%s", partition->mount_point);
-            
-            // Escape paths for shell command.
-            char escaped_mount[COMMON_MAX_QUOTED_LENGTH];
-            char escaped_device[COMMON_MAX_QUOTED_LENGTH];
-            if (
-                common.shell_escape(partition_device, escaped_device, sizeof(escaped_device)) != 0 ||
-                common.shell_escape(mount_path, escaped_mount, sizeof(escaped_mount)) != 0)
-            {
-                write_install_log("Warning: failed to escape paths for mount");
-                continue;
-            }
 
             // Create mount point and mount partition.
             write_install_log("Mounting %s at %s", partition_device, mount_path);
-            char command[COMMON_MAX_COMMAND_LENGTH];
-            snprintf(
-                command, sizeof(command),
-                "mkdir -p %s && mount %s %s >>" CONFIG_INSTALL_LOG_PATH " 2>&1",
-                escaped_mount, escaped_device, escaped_mount
-            );
-            if (run_install_command(command) != 0)
+            if (create_mount_point(mount_path) != 0 ||
+                mount_partition(partition, partition_device, mount_path) != 0)
             {
                 write_install_log("Warning: failed to mount %s at %s", partition_device, mount_path);
             }
@@ -264,6 +113,28 @@ static int mount_remaining_partitions(const char *disk, Store *store)
     return 0;
 }
 
+int mount_partitions(void)
+{
+    Store *store = get_store();
+
+    // Mount the root partition.
+    int root_index = find_root_partition_index(store);
+    write_install_log("Mounting root partition to /mnt");
+    if (root_index < 0 || mount_root_partition(store->disk, store, root_index) != 0)
+    {
+        write_install_log("Failed to mount root partition");
+        return -1;
+    }
+
+    // Mount remaining partitions and enable swap.
+    if (mount_remaining_partitions(store->disk, store) != 0)
+    {
+        return -2;
+    }
+
+    return 0;
+}
+
 int create_partitions(void)
 {
     Store *store = get_store();
@@ -272,22 +143,25 @@ int create_partitions(void)
     write_install_log("Target disk: %s", disk);
     write_install_log("Partition count: %d", store->partition_count);
 
-    // Create GPT partition table.
-    write_install_log("Creating GPT partition table on %s", disk);
-    if (create_gpt_table(disk) != 0)
+    // Clear old signatures, discarding the whole disk where supported.
+    int discarded = 0;
+    int wipe_result = wipe_disk(disk, &discarded);
+    if (wipe_result != 0)
     {
-        write_install_log("Failed to create GPT table");
+        write_install_log("Failed to prepare %s (error %d)", disk, wipe_result);
         return -1;
     }
 
-    // Create each partition in sequence.
-    if (create_partition_entries(disk, store) != 0)
+    // Write the partition table with every partition in one pass.
+    int table_result = create_partition_table(disk);
+    if (table_result != 0)
     {
-        return -2;
+        write_install_log("Failed to create the partition table (error %d)", table_result);
+        return table_result == -4 ? -2 : -1;
     }
 
     // Format each partition with appropriate filesystem.
-    if (format_partitions(disk, store) != 0)
+    if (format_partitions(disk, store, discarded) != 0)
     {
         return -3;
     }
@@ -301,18 +175,18 @@ int create_partitions(void)
     }
     write_install_log("Root partition found at index %d", root_index + 1);
 
-    // Mount the root partition.
-    write_install_log("Mounting root partition to /mnt");
-    if (mount_root_partition(disk, root_index) != 0)
+    // In image mode, nothing can be mounted until the image is written.
+    if (use_rootfs_image())
     {
-        write_install_log("Failed to mount root partition");
-        return -5;
+        write_install_log("Deferring mounts until the rootfs image is written");
+        return 0;
     }
 
-    // Mount remaining partitions and enable swap.
-    if (mount_remaining_partitions(disk, store) != 0)
+    // Mount the root partition, then the remaining partitions.
+    int result = mount_partitions();
+    if (result != 0)
     {
-        return -6;
+        return result == -1 ? -5 : -6;
     }
 
     return 0;
@@ -1,16 +1,58 @@
 #pragma once
 #include "../all.h"
 
+/** The journal commit interval ext4 is mounted with while installing. */
+#define PARTITION_INSTALL_COMMIT_SECONDS 60
+
+/** The journal commit interval ext4 uses by default. */
+#define PARTITION_DEFAULT_COMMIT_SECONDS 5
+
 /**
- * Creates partitions, formats them, and mounts them.
+ * Clears old signatures from the disk, creates partitions, formats them,
+ * and mounts them.
  *
  * @return - `0` - on success.
- * @return - `-1` - if partition table creation fails.
- * @return - `-2` - if partition creation fails.
- * @return - `-3` - if boot flag setting fails.
- * @return - `-4` - if ESP or BIOS boot flag setting fails.
- * @return - `-5` - if filesystem formatting fails.
- * @return - `-6` - if no root partition is configured.
- * @return - `-7` - if mounting root partition fails.
+ * @return - `-1` - if the disk cannot be wiped or the partition table cannot be written.
+ * @return - `-2` - if the kernel does not pick up the new partitions.
+ * @return - `-3` - if filesystem formatting fails.
+ * @return - `-4` - if no root partition is configured.
+ * @return - `-5` - if mounting the root partition fails.
+ * @return - `-6` - if mounting the remaining partitions fails.
  */
 int create_partitions(void);
+
+/**
+ * Mounts the root partition at /mnt, then mounts the remaining partitions
+ * beneath it and enables swap.
+ *
+ * Partitions are mounted with their fstab options, but without access time
+ * updates, and ext4 with a PARTITION_INSTALL_COMMIT_SECONDS journal commit
+ * interval, to cut metadata writes while the system is installed.
+ *
+ * @return - `0` - on success.
+ * @return - `-1` - if mounting the root partition fails.
+ * @return - `-2` - if mounting the remaining partitions fails.
+ */
+int mount_partitions(void);
+
+/**
+ * Remounts a partition with the options the target system will mount it
+ * with, in place of the install-time ones, before it is unmounted.
+ *
+ * @param partition The partition to remount.
+ * @param target The directory the partition is mounted at.
+ *
+ * @return - `0` - on success.
+ * @return - `-1` - if the remount fails.
+ */
+int remount_partition(const Partition *partition, const char *target);
+
+/**
+ * Finds the partition mounted at "/" in the store.
+ *
+ * @param store The store holding the partition configuration.
+ *
+ * @return - `>=0` - The index of the root partition.
+ * @return - `-1` - if no root partition is configured.
+ */
+int find_root_partition_index(Store *store);
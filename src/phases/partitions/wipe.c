@@ -0,0 +1,132 @@
+/**
+ * This code is responsible for clearing the target disk before it is
+ * partitioned, discarding it where supported and zeroing the regions that
+ * hold old partition table, RAID, LVM and filesystem signatures.
+ */
+
+#include "../../all.h"
+
+static int zero_disk_range(int fd, unsigned long long offset, unsigned long long length)
+{
+    // Let the kernel zero the range, offloading it to the device if possible.
+    unsigned long long range[2] = { offset, length };
+    if (ioctl(fd, BLKZEROOUT, range) == 0)
+    {
+        return 0;
+    }
+
+    // Otherwise, as for an image file, write the zeroes out.
+    static const unsigned char zeroes[64 * 1024];
+    while (length > 0)
+    {
+        size_t chunk = length < sizeof(zeroes) ? (size_t)length : sizeof(zeroes);
+        ssize_t written = pwrite(fd, zeroes, chunk, (off_t)offset);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            return -1;
+        }
+        offset += (unsigned long long)written;
+        length -= (unsigned long long)written;
+    }
+    return 0;
+}
+
+static int zero_range_ends(int fd, unsigned long long start, unsigned long long end)
+{
+    // Zero the start of the range, then its end where the two do not meet.
+    unsigned long long head_end = end - start > WIPE_REGION_BYTES ? start + WIPE_REGION_BYTES : end;
+    if (zero_disk_range(fd, start, head_end - start) != 0)
+    {
+        return -1;
+    }
+    unsigned long long tail_start = end - start > WIPE_REGION_BYTES ? end - WIPE_REGION_BYTES : start;
+    if (tail_start < head_end)
+    {
+        tail_start = head_end;
+    }
+    return tail_start < end ? zero_disk_range(fd, tail_start, end - tail_start) : 0;
+}
+
+static int discard_disk(int fd, const char *disk, unsigned long long disk_bytes)
+{
+    // Only ask devices that advertise discard support.
+    if (is_disk_discardable(disk) != 1)
+    {
+        return 0;
+    }
+
+    unsigned long long range[2] = { 0, disk_bytes };
+    if (ioctl(fd, BLKDISCARD, range) != 0)
+    {
+        write_install_log("Failed to discard %s: %s", disk, strerror(errno));
+        return 0;
+    }
+    write_install_log("Discarded all %llu bytes of %s", disk_bytes, disk);
+    return 1;
+}
+
+int wipe_disk(const char *disk, int *out_discarded)
+{
+    Store *store = get_store();
+    *out_discarded = 0;
+
+    // In dry-run mode, only record the wipe.
+    if (store->dry_run)
+    {
+        write_dry_run_log("wipe-signatures %s", disk);
+        return 0;
+    }
+
+    // Open the disk exclusively, so nothing else is using it.
+    int fd = open(disk, O_RDWR | O_CLOEXEC | O_EXCL);
+    if (fd < 0)
+    {
+        write_install_log("Failed to open %s: %s", disk, strerror(errno));
+        return -1;
+    }
+    unsigned int sector_bytes = 512;
+    int logical_sector_bytes = 0;
+    if (ioctl(fd, BLKSSZGET, &logical_sector_bytes) == 0 && logical_sector_bytes > 0)
+    {
+        sector_bytes = (unsigned int)logical_sector_bytes;
+    }
+    unsigned long long disk_bytes = get_open_disk_size(fd) / sector_bytes * sector_bytes;
+    if (disk_bytes == 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    // Discard the whole disk once, where the device supports it.
+    *out_discarded = discard_disk(fd, disk, disk_bytes);
+
+    // Zero both ends of the disk, then of each partition about to be
+    // created, where a signature left behind would be found again. A layout
+    // that does not fit is left for the partition table to report.
+    int result = zero_range_ends(fd, 0, disk_bytes);
+    PartitionTable table;
+    if (result == 0 && build_partition_table(store, sector_bytes, disk_bytes / sector_bytes, &table) == 0)
+    {
+        for (int i = 0; i < table.count && result == 0; i++)
+        {
+            result = zero_range_ends(
+                fd, table.entries[i].first_sector * sector_bytes,
+                (table.entries[i].last_sector + 1) * sector_bytes
+            );
+        }
+    }
+    if (result != 0 || fsync(fd) != 0)
+    {
+        write_install_log("Failed to clear the signatures on %s: %s", disk, strerror(errno));
+        close(fd);
+        return -2;
+    }
+    close(fd);
+
+    write_install_log("Cleared old signatures from %s", disk);
+    return 0;
+}
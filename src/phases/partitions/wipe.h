@@ -0,0 +1,27 @@
+#pragma once
+#include "../../all.h"
+
+/** The bytes cleared at each end of the disk and of each new partition. */
+#define WIPE_REGION_BYTES (1024ULL * 1024)
+
+/**
+ * Clears the target disk of old signatures before it is partitioned.
+ *
+ * A disk that supports discard is first discarded as a whole with one
+ * BLKDISCARD, so formatting need not discard each partition again. Since a
+ * discard need not read back as zeroes, the regions where partition tables,
+ * RAID, LVM and filesystem signatures live are then zeroed: the first and
+ * last WIPE_REGION_BYTES of the disk and of each partition about to be
+ * created.
+ *
+ * In dry-run mode, the wipe is recorded in the dry-run log instead, and the
+ * disk is reported as not discarded.
+ *
+ * @param disk The disk device path.
+ * @param out_discarded Output: whether the whole disk was discarded.
+ *
+ * @return - `0` - Indicates the disk was wiped.
+ * @return - `-1` - Indicates the disk could not be opened or measured.
+ * @return - `-2` - Indicates zeroing a signature region failed.
+ */
+int wipe_disk(const char *disk, int *out_discarded);
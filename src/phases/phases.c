@@ -1,61 +1,341 @@
 /**
  * This code is responsible for orchestrating the full installation process
  * by invoking partitioning, rootfs extraction, bootloader setup, and locale
- * configuration in sequence.
+ * configuration, running phases concurrently once their dependencies have
+ * completed.
  */
 
 #include "../all.h"
 
-/** The registry of all installation phases. */
+/**
+ * The registry of all installation phases.
+ *
+ * Components depend on the bootloader because both install packages from the
+ * same archive directory with dpkg, and on the locale because their dpkg
+ * triggers may run locale-gen while the locale phase does. Users depend on
+ * components because new home directories are copied from the /etc/skel
+ * that components write.
+ */
 const Phase install_phases[INSTALL_PHASE_COUNT] = {
-    { "Partitions",   "Partitioning",            create_partitions   },
-    { "System files", "Extracting system files", extract_rootfs      },
-    { "Fstab",        "Generating fstab",        generate_fstab      },
-    { "Bootloader",   "Installing bootloader",   setup_bootloader    },
-    { "Locale",       "Configuring locale",      configure_locale    },
-    { "Components",   "Installing components",   install_components  },
-    { "Users",        "Configuring users",       configure_users     },
+    { "Partitions",   "Partitioning",            create_partitions,  0 },
+    { "System files", "Extracting system files", extract_rootfs,     PHASE_DEPENDS_ON(0) },
+    { "Fstab",        "Generating fstab",        generate_fstab,     PHASE_DEPENDS_ON(1) },
+    { "Bootloader",   "Installing bootloader",   setup_bootloader,   PHASE_DEPENDS_ON(2) },
+    { "Locale",       "Configuring locale",      configure_locale,   PHASE_DEPENDS_ON(1) },
+    { "Components",   "Installing components",   install_components, PHASE_DEPENDS_ON(3) | PHASE_DEPENDS_ON(4) },
+    { "Users",        "Configuring users",       configure_users,    PHASE_DEPENDS_ON(5) },
 };
 
+/** A type representing the scheduling state of a phase. */
+typedef enum {
+    PHASE_WAITING,
+    PHASE_RUNNING,
+    PHASE_FINISHED,
+    PHASE_REPORTED
+} PhaseState;
+
+/** A type representing the phases of an installation in progress. */
+typedef struct {
+    pthread_mutex_t mutex;
+    int wake_fd;
+    PhaseState states[INSTALL_PHASE_COUNT];
+    int results[INSTALL_PHASE_COUNT];
+    double seconds[INSTALL_PHASE_COUNT];
+    pthread_t threads[INSTALL_PHASE_COUNT];
+    int running;
+} PhaseScheduler;
+
+/** A type representing the arguments of a phase worker thread. */
+typedef struct {
+    PhaseScheduler *scheduler;
+    int phase_index;
+} PhaseWorker;
+
 #define NOTIFY(event, phase_index, err) \
     if (progress_cb) progress_cb((event), (phase_index), (err), context)
 
-int run_install(install_progress_cb progress_cb, void *context)
+static double get_elapsed_seconds(const struct timespec *start)
 {
-    // Initialize install log file.
-    init_install_log();
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
 
-    // Enable periodic tick updates during command execution.
-    set_install_tick_modal(context);
-    set_command_tick_callback(tick_install);
+static void *run_phase_worker(void *argument)
+{
+    PhaseWorker *worker = argument;
+    PhaseScheduler *scheduler = worker->scheduler;
+    int index = worker->phase_index;
+    free(worker);
 
-    NOTIFY(INSTALL_START, 0, 0);
+    // Execute the phase, timing it for the wall time report and the trace.
+    TraceSpan span;
+    begin_trace_span(&span, "phase", install_phases[index].display_name);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int result = install_phases[index].execute();
+    double seconds = get_elapsed_seconds(&start);
+    end_trace_span(&span, result, NULL);
+
+    // Hand the result back to the scheduling thread.
+    pthread_mutex_lock(&scheduler->mutex);
+    scheduler->results[index] = result;
+    scheduler->seconds[index] = seconds;
+    scheduler->states[index] = PHASE_FINISHED;
+    pthread_mutex_unlock(&scheduler->mutex);
+
+    // Wake the scheduling thread.
+    uint64_t wake = 1;
+    ssize_t written = write(scheduler->wake_fd, &wake, sizeof(wake));
+    (void)written;
+
+    return NULL;
+}
+
+static int is_phase_ready(const PhaseScheduler *scheduler, int index)
+{
+    // Require every dependency to have succeeded and been reported.
+    for (int i = 0; i < INSTALL_PHASE_COUNT; i++)
+    {
+        if ((install_phases[index].dependencies & PHASE_DEPENDS_ON(i)) &&
+            (scheduler->states[i] != PHASE_REPORTED || scheduler->results[i] != 0))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int start_phase(PhaseScheduler *scheduler, int index)
+{
+    PhaseWorker *worker = malloc(sizeof(PhaseWorker));
+    if (!worker)
+    {
+        return -1;
+    }
+    worker->scheduler = scheduler;
+    worker->phase_index = index;
+
+    scheduler->states[index] = PHASE_RUNNING;
+    if (pthread_create(&scheduler->threads[index], NULL, run_phase_worker, worker) != 0)
+    {
+        scheduler->states[index] = PHASE_WAITING;
+        free(worker);
+        return -1;
+    }
+    scheduler->running++;
+    return 0;
+}
+
+static void wait_phase_change(PhaseScheduler *scheduler, Runtime *runtime)
+{
+    // Clear earlier wake-ups before checking, so none are missed.
+    uint64_t wakes;
+    ssize_t count = read(scheduler->wake_fd, &wakes, sizeof(wakes));
+    (void)count;
 
-    // Execute each installation phase in sequence.
+    pthread_mutex_lock(&scheduler->mutex);
+    int finished = 0;
     for (int i = 0; i < INSTALL_PHASE_COUNT; i++)
     {
-        const Phase *phase = &install_phases[i];
+        finished |= scheduler->states[i] == PHASE_FINISHED;
+    }
+    pthread_mutex_unlock(&scheduler->mutex);
+    if (finished)
+    {
+        return;
+    }
 
-        // Write phase header to install log.
-        write_install_log_header(phase->log_header);
-        write_install_log("Starting phase %d/%d: %s", i + 1, INSTALL_PHASE_COUNT, phase->display_name);
+    // Sleep until a worker wakes us, while the runtime's timer keeps the
+    // progress screen animating.
+    if (runtime)
+    {
+        run_runtime(runtime, -1);
+        return;
+    }
+    struct pollfd poll_fd = { .fd = scheduler->wake_fd, .events = POLLIN };
+    poll(&poll_fd, 1, COMMAND_TICK_INTERVAL_MS);
+    invoke_command_tick();
+}
 
-        // Notify phase start.
-        NOTIFY(INSTALL_STEP_BEGIN, i, 0);
+static int run_phases(install_progress_cb progress_cb, void *context)
+{
+    PhaseScheduler scheduler;
+    memset(&scheduler, 0, sizeof(scheduler));
+    pthread_mutex_init(&scheduler.mutex, NULL);
+    scheduler.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (scheduler.wake_fd < 0)
+    {
+        pthread_mutex_destroy(&scheduler.mutex);
+        return -1;
+    }
 
-        // Execute phase.
-        int result = phase->execute();
-        if (result != 0)
+    // Wait for workers in a runtime, falling back to polling without one.
+    Runtime runtime;
+    int has_runtime = open_command_runtime(&runtime) == 0;
+    if (has_runtime && watch_runtime_descriptor(&runtime, scheduler.wake_fd) != 0)
+    {
+        close_runtime(&runtime);
+        has_runtime = 0;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int reported = 0;
+    int failed_index = -1;
+    while (reported < INSTALL_PHASE_COUNT)
+    {
+        // Report finished phases, joining their worker threads.
+        int reported_before = reported;
+        for (int i = 0; i < INSTALL_PHASE_COUNT; i++)
         {
-            write_install_log("Phase failed with error code: %d", result);
-            NOTIFY(INSTALL_STEP_FAIL, i, result);
-            cleanup_mounts();
-            return -(i + 1);
+            pthread_mutex_lock(&scheduler.mutex);
+            int finished = scheduler.states[i] == PHASE_FINISHED;
+            pthread_mutex_unlock(&scheduler.mutex);
+            if (!finished)
+            {
+                continue;
+            }
+
+            pthread_join(scheduler.threads[i], NULL);
+            scheduler.states[i] = PHASE_REPORTED;
+            scheduler.running--;
+            reported++;
+
+            int result = scheduler.results[i];
+            if (result != 0)
+            {
+                write_install_log("Phase %s failed with error code: %d", install_phases[i].display_name, result);
+                NOTIFY(INSTALL_STEP_FAIL, i, result);
+                if (failed_index < 0)
+                {
+                    failed_index = i;
+                }
+                continue;
+            }
+            write_install_log("Phase %s completed successfully", install_phases[i].display_name);
+            NOTIFY(INSTALL_STEP_OK, i, 0);
         }
 
-        // Notify phase success.
-        write_install_log("Phase completed successfully");
-        NOTIFY(INSTALL_STEP_OK, i, 0);
+        // Write the log out at phase boundaries, so a failure leaves it complete.
+        if (reported > reported_before)
+        {
+            flush_install_log();
+        }
+
+        // Start ready phases while workers are free, unless a phase failed.
+        for (int i = 0; i < INSTALL_PHASE_COUNT && failed_index < 0; i++)
+        {
+            if (scheduler.running >= PHASE_MAX_WORKERS)
+            {
+                break;
+            }
+            if (scheduler.states[i] != PHASE_WAITING || !is_phase_ready(&scheduler, i))
+            {
+                continue;
+            }
+
+            // Write phase header to install log.
+            const Phase *phase = &install_phases[i];
+            write_install_log_header(phase->log_header);
+            write_install_log("Starting phase %d/%d: %s", i + 1, INSTALL_PHASE_COUNT, phase->display_name);
+
+            // Notify phase start, then hand the phase to a worker.
+            NOTIFY(INSTALL_STEP_BEGIN, i, 0);
+            if (start_phase(&scheduler, i) != 0)
+            {
+                write_install_log("Phase %s could not be started", phase->display_name);
+                NOTIFY(INSTALL_STEP_FAIL, i, -1);
+                scheduler.states[i] = PHASE_REPORTED;
+                scheduler.results[i] = -1;
+                reported++;
+                failed_index = i;
+                flush_install_log();
+            }
+        }
+
+        // Stop once nothing is running, which after a failure leaves phases unstarted.
+        if (scheduler.running == 0)
+        {
+            break;
+        }
+
+        // Keep the interface responsive while phases run.
+        wait_phase_change(&scheduler, has_runtime ? &runtime : NULL);
+    }
+
+    if (has_runtime)
+    {
+        close_runtime(&runtime);
+    }
+    close(scheduler.wake_fd);
+    pthread_mutex_destroy(&scheduler.mutex);
+
+    if (failed_index >= 0)
+    {
+        return -(failed_index + 1);
+    }
+
+    // Report the time saved compared to running the phases in order.
+    double serial_seconds = 0;
+    for (int i = 0; i < INSTALL_PHASE_COUNT; i++)
+    {
+        serial_seconds += scheduler.seconds[i];
+    }
+    double wall_seconds = get_elapsed_seconds(&start);
+    write_install_log(
+        "Phases took %.1f s, saving %.1f s over running them in order",
+        wall_seconds, serial_seconds > wall_seconds ? serial_seconds - wall_seconds : 0.0
+    );
+
+    return 0;
+}
+
+static void finish_install_trace(void)
+{
+    Store *store = get_store();
+    if (!store->trace_path)
+    {
+        return;
+    }
+
+    // Write the timeline of the installation out, noting failures in the log.
+    int result = write_trace(store->trace_path);
+    if (result != 0)
+    {
+        write_install_log("Failed to write trace to %s (error %d)", store->trace_path, result);
+    }
+    stop_trace();
+}
+
+int run_install(install_progress_cb progress_cb, void *context)
+{
+    Store *store = get_store();
+
+    // Initialize install log file.
+    init_install_log();
+
+    // Record phases and commands as spans when a trace was requested.
+    if (store->trace_path)
+    {
+        start_trace();
+    }
+
+    // Enable periodic tick updates during command execution.
+    set_install_tick_modal(context);
+    set_command_tick_callback(tick_install);
+
+    NOTIFY(INSTALL_START, 0, 0);
+
+    // Execute the installation phases in dependency order.
+    int result = run_phases(progress_cb, context);
+    if (result != 0)
+    {
+        cleanup_mounts();
+        finish_install_trace();
+        flush_install_log();
+        return result;
     }
 
     // Clean up mounts.
@@ -67,9 +347,17 @@ int run_install(install_progress_cb progress_cb, void *context)
     // Disable tick updates before reboot.
     set_command_tick_callback(NULL);
 
-    // Reboot the system.
-    run_install_command("reboot >>" CONFIG_INSTALL_LOG_PATH " 2>&1");
-    
+    // Write the trace and the log out in full before rebooting.
+    finish_install_trace();
+    flush_install_log();
+
+    // Reboot the system, unless a harness is measuring the installation.
+    if (!store->skip_reboot)
+    {
+        run_install_command("reboot");
+    }
+
+    close_install_log();
     close_dry_run_log();
 
     return 0;
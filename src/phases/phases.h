@@ -17,11 +17,18 @@ typedef struct {
     const char *display_name;
     const char *log_header;
     PhaseFunction execute;
+    unsigned int dependencies;
 } Phase;
 
 /** The number of installation phases. */
 #define INSTALL_PHASE_COUNT 7
 
+/** The most installation phases run at the same time. */
+#define PHASE_MAX_WORKERS 3
+
+/** Declares that a phase runs only after the phase at an index succeeds. */
+#define PHASE_DEPENDS_ON(phase_index) (1u << (phase_index))
+
 /** The registry of all installation phases. */
 extern const Phase install_phases[INSTALL_PHASE_COUNT];
 
@@ -43,6 +50,12 @@ typedef void (*install_progress_cb)(
 /**
  * Runs the full installation process using settings from the global store.
  *
+ * Each phase starts as soon as the phases it depends on have succeeded, so
+ * independent phases run at the same time on up to PHASE_MAX_WORKERS
+ * threads. Progress events are always delivered from the calling thread.
+ * After a failure no further phases start, and the phases still running
+ * are allowed to finish before mounts are cleaned up.
+ *
  * @param progress_cb Callback for progress updates (can be NULL for silent
  *                    mode).
  * @param context User data passed to callback.
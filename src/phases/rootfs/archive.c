@@ -0,0 +1,1102 @@
+/**
+ * This code is responsible for parsing the tar stream produced by the rootfs
+ * stream reader and writing each entry directly into the target directory,
+ * restoring ownership, permissions and timestamps along the way.
+ */
+
+#include "../../all.h"
+
+/** A type representing the on-disk layout of a ustar header block. */
+typedef struct {
+    char name[100];
+    char mode[8];
+    char uid[8];
+    char gid[8];
+    char size[12];
+    char mtime[12];
+    char checksum[8];
+    char type;
+    char link_name[100];
+    char magic[6];
+    char version[2];
+    char user_name[32];
+    char group_name[32];
+    char device_major[8];
+    char device_minor[8];
+    char prefix[155];
+    char padding[12];
+} ArchiveHeader;
+
+/** A type representing a fully resolved tar entry. */
+typedef struct {
+    char path[PATH_MAX];
+    char link_target[PATH_MAX];
+    char type;
+    mode_t mode;
+    uid_t uid;
+    gid_t gid;
+    time_t mtime;
+    unsigned long long size;
+    unsigned int device_major;
+    unsigned int device_minor;
+} ArchiveEntry;
+
+/** A type representing extended header values for the next entry. */
+typedef struct {
+    char path[PATH_MAX];
+    char link_target[PATH_MAX];
+    int has_size;
+    unsigned long long size;
+    int has_uid;
+    uid_t uid;
+    int has_gid;
+    gid_t gid;
+    int has_mtime;
+    time_t mtime;
+} ArchiveOverrides;
+
+/** A type representing a directory whose metadata is applied last. */
+typedef struct {
+    char *path;
+    mode_t mode;
+    uid_t uid;
+    gid_t gid;
+    time_t mtime;
+} ArchiveDirectory;
+
+/** A type representing the state of an extraction in progress. */
+typedef struct {
+    RootfsStream stream;
+    const char *target_directory;
+    unsigned char *buffer;
+    ArchiveOverrides overrides;
+    ArchiveDirectory *directories;
+    int directory_count;
+    int directory_capacity;
+    int restore_ownership;
+    int metadata_errors;
+    unsigned long long position;
+    RootfsManifest manifest;
+    WriterPool writers;
+    int has_writers;
+    UringWriter uring;
+    int has_uring;
+} ArchiveExtraction;
+
+static unsigned long long parse_tar_number(const char *field, size_t length)
+{
+    // Decode the GNU base-256 encoding used for values too large for octal.
+    if ((unsigned char)field[0] & 0x80)
+    {
+        unsigned long long value = (unsigned char)field[0] & 0x3f;
+        for (size_t i = 1; i < length; i++)
+        {
+            value = (value << 8) | (unsigned char)field[i];
+        }
+        return value;
+    }
+
+    // Decode octal digits, skipping leading padding.
+    unsigned long long value = 0;
+    size_t i = 0;
+    while (i < length && field[i] == ' ')
+    {
+        i++;
+    }
+    while (i < length && field[i] >= '0' && field[i] <= '7')
+    {
+        value = (value << 3) | (unsigned long long)(field[i] - '0');
+        i++;
+    }
+
+    return value;
+}
+
+static int is_zero_block(const unsigned char *block)
+{
+    for (int i = 0; i < ARCHIVE_BLOCK_BYTES; i++)
+    {
+        if (block[i] != 0)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int verify_header_checksum(const ArchiveHeader *header)
+{
+    const unsigned char *bytes = (const unsigned char *)header;
+    const size_t checksum_offset = offsetof(ArchiveHeader, checksum);
+
+    // Sum all bytes, treating the checksum field itself as spaces.
+    unsigned long long unsigned_sum = 0;
+    long long signed_sum = 0;
+    for (size_t i = 0; i < ARCHIVE_BLOCK_BYTES; i++)
+    {
+        int is_checksum_field = i >= checksum_offset &&
+            i < checksum_offset + sizeof(header->checksum);
+        unsigned char byte = is_checksum_field ? ' ' : bytes[i];
+        unsigned_sum += byte;
+        signed_sum += (signed char)byte;
+    }
+
+    // Accept both unsigned (POSIX) and signed (historic) checksums.
+    unsigned long long expected = parse_tar_number(
+        header->checksum, sizeof(header->checksum)
+    );
+    return expected == unsigned_sum || (long long)expected == signed_sum;
+}
+
+static int read_exact(ArchiveExtraction *extraction, void *buffer, size_t length)
+{
+    // Read decompressed bytes, treating a short read as a truncated archive.
+    long count = read_rootfs_stream(&extraction->stream, buffer, length);
+    if (count < 0)
+    {
+        return -2;
+    }
+    if ((size_t)count != length)
+    {
+        return -3;
+    }
+    extraction->position += length;
+    return 0;
+}
+
+static int skip_bytes(ArchiveExtraction *extraction, unsigned long long count)
+{
+    // Discard data in buffer-sized chunks.
+    while (count > 0)
+    {
+        size_t chunk = count < ARCHIVE_COPY_BUFFER_BYTES
+            ? (size_t)count : ARCHIVE_COPY_BUFFER_BYTES;
+        int result = read_exact(extraction, extraction->buffer, chunk);
+        if (result != 0)
+        {
+            return result;
+        }
+        count -= chunk;
+    }
+    return 0;
+}
+
+static unsigned long long padding_for(unsigned long long size)
+{
+    return (ARCHIVE_BLOCK_BYTES - size % ARCHIVE_BLOCK_BYTES) % ARCHIVE_BLOCK_BYTES;
+}
+
+static int write_all(int fd, const unsigned char *data, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t written = write(fd, data, length);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+    return 0;
+}
+
+static int read_extended_data(
+    ArchiveExtraction *extraction, unsigned long long size, char **out_data
+)
+{
+    // Reject implausibly large extended headers.
+    if (size > ARCHIVE_COPY_BUFFER_BYTES)
+    {
+        return -3;
+    }
+
+    // Read the data and its padding into a NUL-terminated buffer.
+    char *data = malloc((size_t)size + 1);
+    if (!data)
+    {
+        return -4;
+    }
+    int result = read_exact(extraction, data, (size_t)size);
+    if (result == 0)
+    {
+        result = skip_bytes(extraction, padding_for(size));
+    }
+    if (result != 0)
+    {
+        free(data);
+        return result;
+    }
+    data[size] = '\0';
+
+    *out_data = data;
+    return 0;
+}
+
+static void parse_pax_records(
+    const char *data, size_t size, ArchiveOverrides *overrides
+)
+{
+    // Walk records of the form "<length> <key>=<value>\n".
+    size_t offset = 0;
+    while (offset < size)
+    {
+        char *end = NULL;
+        unsigned long record_length = strtoul(data + offset, &end, 10);
+        if (record_length == 0 || end == NULL || *end != ' ' ||
+            offset + record_length > size)
+        {
+            return;
+        }
+
+        // Split the record into key and value.
+        const char *key = end + 1;
+        const char *record_end = data + offset + record_length - 1;
+        const char *equals = memchr(key, '=', (size_t)(record_end - key));
+        if (equals != NULL)
+        {
+            size_t key_length = (size_t)(equals - key);
+            const char *value = equals + 1;
+            int value_length = (int)(record_end - value);
+
+            // Apply the keys that affect how the entry is extracted.
+            if (key_length == 4 && strncmp(key, "path", 4) == 0)
+            {
+                snprintf(overrides->path, sizeof(overrides->path), "%.*s", value_length, value);
+            }
+            else if (key_length == 8 && strncmp(key, "linkpath", 8) == 0)
+            {
+                snprintf(overrides->link_target, sizeof(overrides->link_target), "%.*s", value_length, value);
+            }
+            else if (key_length == 4 && strncmp(key, "size", 4) == 0)
+            {
+                overrides->has_size = 1;
+                overrides->size = strtoull(value, NULL, 10);
+            }
+            else if (key_length == 3 && strncmp(key, "uid", 3) == 0)
+            {
+                overrides->has_uid = 1;
+                overrides->uid = (uid_t)strtoul(value, NULL, 10);
+            }
+            else if (key_length == 3 && strncmp(key, "gid", 3) == 0)
+            {
+                overrides->has_gid = 1;
+                overrides->gid = (gid_t)strtoul(value, NULL, 10);
+            }
+            else if (key_length == 5 && strncmp(key, "mtime", 5) == 0)
+            {
+                overrides->has_mtime = 1;
+                overrides->mtime = (time_t)strtoll(value, NULL, 10);
+            }
+        }
+
+        offset += record_length;
+    }
+}
+
+static int sanitize_entry_path(const char *name, char *out_path, size_t size)
+{
+    // Strip leading slashes and "./" components.
+    while (name[0] == '/' || (name[0] == '.' && name[1] == '/'))
+    {
+        name += (name[0] == '/') ? 1 : 2;
+    }
+
+    // Map the archive root itself to ".".
+    if (name[0] == '\0' || strcmp(name, ".") == 0)
+    {
+        snprintf(out_path, size, ".");
+        return 0;
+    }
+
+    // Reject any ".." component so entries cannot escape the target.
+    const char *component = name;
+    while (component != NULL)
+    {
+        if (strncmp(component, "..", 2) == 0 &&
+            (component[2] == '/' || component[2] == '\0'))
+        {
+            return -1;
+        }
+        component = strchr(component, '/');
+        if (component != NULL)
+        {
+            component++;
+        }
+    }
+
+    // Copy the path without a trailing slash.
+    if (snprintf(out_path, size, "%s", name) >= (int)size)
+    {
+        return -1;
+    }
+    size_t length = strlen(out_path);
+    while (length > 1 && out_path[length - 1] == '/')
+    {
+        out_path[--length] = '\0';
+    }
+
+    return 0;
+}
+
+static int read_next_entry(ArchiveExtraction *extraction, ArchiveEntry *out_entry)
+{
+    ArchiveOverrides *overrides = &extraction->overrides;
+    memset(overrides, 0, sizeof(*overrides));
+
+    while (1)
+    {
+        // Read the next header block and stop at the end-of-archive marker
+        // (or at end of data, for archives written without one).
+        ArchiveHeader header;
+        long count = read_rootfs_stream(&extraction->stream, &header, sizeof(header));
+        if (count < 0)
+        {
+            return -2;
+        }
+        if (count == 0 || is_zero_block((const unsigned char *)&header))
+        {
+            return 1;
+        }
+        if ((size_t)count != sizeof(header))
+        {
+            return -3;
+        }
+        extraction->position += sizeof(header);
+        if (!verify_header_checksum(&header))
+        {
+            write_install_log("Archive header checksum mismatch");
+            return -3;
+        }
+
+        unsigned long long size = parse_tar_number(header.size, sizeof(header.size));
+        char *data = NULL;
+        int result;
+
+        // Collect GNU long names and pax headers for the following entry.
+        if (header.type == 'L' || header.type == 'K' || header.type == 'x')
+        {
+            result = read_extended_data(extraction, size, &data);
+            if (result != 0)
+            {
+                return result;
+            }
+            if (header.type == 'L')
+            {
+                snprintf(overrides->path, sizeof(overrides->path), "%s", data);
+            }
+            else if (header.type == 'K')
+            {
+                snprintf(overrides->link_target, sizeof(overrides->link_target), "%s", data);
+            }
+            else
+            {
+                parse_pax_records(data, (size_t)size, overrides);
+            }
+            free(data);
+            continue;
+        }
+
+        // Skip global pax headers and volume labels entirely.
+        if (header.type == 'g' || header.type == 'V')
+        {
+            result = skip_bytes(extraction, size + padding_for(size));
+            if (result != 0)
+            {
+                return result;
+            }
+            continue;
+        }
+
+        // Resolve the entry name, joining the ustar prefix when present.
+        char name[PATH_MAX];
+        if (overrides->path[0] != '\0')
+        {
+            snprintf(name, sizeof(name), "%s", overrides->path);
+        }
+        else if (memcmp(header.magic, "ustar\0", 6) == 0 && header.prefix[0] != '\0')
+        {
+            snprintf(
+                name, sizeof(name), "%.*s/%.*s",
+                (int)strnlen(header.prefix, sizeof(header.prefix)), header.prefix,
+                (int)strnlen(header.name, sizeof(header.name)), header.name
+            );
+        }
+        else
+        {
+            snprintf(
+                name, sizeof(name), "%.*s",
+                (int)strnlen(header.name, sizeof(header.name)), header.name
+            );
+        }
+        if (sanitize_entry_path(name, out_entry->path, sizeof(out_entry->path)) != 0)
+        {
+            write_install_log("Rejected unsafe archive path: %s", name);
+            return -3;
+        }
+
+        // Resolve the link target.
+        if (overrides->link_target[0] != '\0')
+        {
+            snprintf(out_entry->link_target, sizeof(out_entry->link_target), "%s", overrides->link_target);
+        }
+        else
+        {
+            snprintf(
+                out_entry->link_target, sizeof(out_entry->link_target), "%.*s",
+                (int)strnlen(header.link_name, sizeof(header.link_name)), header.link_name
+            );
+        }
+
+        // Decode the remaining header fields, preferring pax overrides.
+        out_entry->type = header.type;
+        out_entry->mode = (mode_t)parse_tar_number(header.mode, sizeof(header.mode));
+        out_entry->uid = overrides->has_uid ? overrides->uid
+            : (uid_t)parse_tar_number(header.uid, sizeof(header.uid));
+        out_entry->gid = overrides->has_gid ? overrides->gid
+            : (gid_t)parse_tar_number(header.gid, sizeof(header.gid));
+        out_entry->mtime = overrides->has_mtime ? overrides->mtime
+            : (time_t)parse_tar_number(header.mtime, sizeof(header.mtime));
+        out_entry->size = overrides->has_size ? overrides->size : size;
+        out_entry->device_major = (unsigned int)parse_tar_number(
+            header.device_major, sizeof(header.device_major)
+        );
+        out_entry->device_minor = (unsigned int)parse_tar_number(
+            header.device_minor, sizeof(header.device_minor)
+        );
+
+        return 0;
+    }
+}
+
+static void apply_path_metadata(
+    ArchiveExtraction *extraction, const char *path, const ArchiveEntry *entry,
+    int is_symlink
+)
+{
+    // Restore ownership first, since chown clears setuid and setgid bits.
+    if (extraction->restore_ownership &&
+        lchown(path, entry->uid, entry->gid) != 0)
+    {
+        extraction->metadata_errors++;
+    }
+
+    // Restore permissions (symlinks have none of their own).
+    if (!is_symlink && chmod(path, entry->mode & 07777) != 0)
+    {
+        extraction->metadata_errors++;
+    }
+
+    // Restore the modification time without following symlinks.
+    struct timespec times[2] = {
+        { .tv_sec = 0, .tv_nsec = UTIME_NOW },
+        { .tv_sec = entry->mtime, .tv_nsec = 0 }
+    };
+    if (utimensat(AT_FDCWD, path, times, AT_SYMLINK_NOFOLLOW) != 0)
+    {
+        extraction->metadata_errors++;
+    }
+}
+
+static int queue_regular_file(
+    ArchiveExtraction *extraction, const ArchiveEntry *entry, const char *path
+)
+{
+    // Read the whole file into memory for a writer thread.
+    WriterJob *job = calloc(1, sizeof(WriterJob));
+    if (!job)
+    {
+        return -4;
+    }
+    job->path = strdup(path);
+    job->data = malloc(entry->size > 0 ? (size_t)entry->size : 1);
+    if (!job->path || !job->data)
+    {
+        free(job->path);
+        free(job->data);
+        free(job);
+        return -4;
+    }
+    int result = read_exact(extraction, job->data, (size_t)entry->size);
+    if (result == 0)
+    {
+        result = skip_bytes(extraction, padding_for(entry->size));
+    }
+    if (result != 0)
+    {
+        free(job->path);
+        free(job->data);
+        free(job);
+        return result;
+    }
+
+    // Hand the file to the pool, which takes ownership of the job.
+    job->size = (size_t)entry->size;
+    job->mode = entry->mode;
+    job->uid = entry->uid;
+    job->gid = entry->gid;
+    job->mtime = entry->mtime;
+    return submit_writer_job(&extraction->writers, job);
+}
+
+static int is_queueable_file(ArchiveExtraction *extraction, const ArchiveEntry *entry)
+{
+    if (!extraction->has_writers || entry->size > WRITER_MAX_FILE_BYTES)
+    {
+        return 0;
+    }
+
+    // Only queue files the manifest lists at this position, whose parent
+    // directories were therefore created up front.
+    const ManifestEntry *manifest_entry = find_manifest_entry(
+        &extraction->manifest, extraction->position
+    );
+    return manifest_entry && manifest_entry->type == 'f' &&
+        manifest_entry->size == entry->size;
+}
+
+static int submit_uring_file(
+    ArchiveExtraction *extraction, const ArchiveEntry *entry, const char *path
+)
+{
+    // Read the file straight into a registered ring buffer.
+    WriterJob *job;
+    int result = acquire_uring_job(&extraction->uring, path, &job);
+    if (result == 0)
+    {
+        result = read_exact(extraction, job->data, (size_t)entry->size);
+    }
+    if (result == 0)
+    {
+        result = skip_bytes(extraction, padding_for(entry->size));
+    }
+    if (result != 0)
+    {
+        return result;
+    }
+
+    // Queue the open, write and close of the file.
+    job->size = (size_t)entry->size;
+    job->mode = entry->mode;
+    job->uid = entry->uid;
+    job->gid = entry->gid;
+    job->mtime = entry->mtime;
+    submit_uring_job(&extraction->uring, job);
+    return 0;
+}
+
+static int extract_regular_file(
+    ArchiveExtraction *extraction, const ArchiveEntry *entry, const char *path
+)
+{
+    // Batch small files through io_uring.
+    if (extraction->has_uring && entry->size <= URING_SLOT_BYTES)
+    {
+        return submit_uring_file(extraction, entry, path);
+    }
+
+    // Queue the other files listed in the manifest for the writer threads,
+    // once the ring is done with any earlier write to the same path.
+    if (is_queueable_file(extraction, entry))
+    {
+        int result = extraction->has_uring ? wait_uring_path(&extraction->uring, path) : 0;
+        return result != 0 ? result : queue_regular_file(extraction, entry, path);
+    }
+
+    // Otherwise let files queued on the ring finish before writing inline.
+    if (extraction->has_uring)
+    {
+        int result = flush_uring_writer(&extraction->uring);
+        if (result != 0)
+        {
+            return result;
+        }
+    }
+
+    // Create the file, creating missing ancestors or replacing an existing
+    // entry only when needed so the common case costs a single open().
+    const int flags = O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC | O_NOFOLLOW;
+    int fd = open(path, flags, 0600);
+    if (fd < 0 && errno == ENOENT)
+    {
+        create_parent_directories(path);
+        fd = open(path, flags, 0600);
+    }
+    else if (fd < 0 && errno == EEXIST)
+    {
+        unlink(path);
+        fd = open(path, flags, 0600);
+    }
+    if (fd < 0)
+    {
+        write_install_log("Failed to create %s: %s", path, strerror(errno));
+        return -4;
+    }
+
+    // Stream file contents from the archive straight into the new file.
+    unsigned long long remaining = entry->size;
+    while (remaining > 0)
+    {
+        size_t chunk = remaining < ARCHIVE_COPY_BUFFER_BYTES
+            ? (size_t)remaining : ARCHIVE_COPY_BUFFER_BYTES;
+        int result = read_exact(extraction, extraction->buffer, chunk);
+        if (result != 0)
+        {
+            close(fd);
+            return result;
+        }
+        if (write_all(fd, extraction->buffer, chunk) != 0)
+        {
+            write_install_log("Failed to write %s: %s", path, strerror(errno));
+            close(fd);
+            return -4;
+        }
+        remaining -= chunk;
+        invoke_command_tick();
+    }
+
+    // Restore ownership, then permissions, then the modification time.
+    if (extraction->restore_ownership &&
+        fchown(fd, entry->uid, entry->gid) != 0)
+    {
+        extraction->metadata_errors++;
+    }
+    if (fchmod(fd, entry->mode & 07777) != 0)
+    {
+        extraction->metadata_errors++;
+    }
+    struct timespec times[2] = {
+        { .tv_sec = 0, .tv_nsec = UTIME_NOW },
+        { .tv_sec = entry->mtime, .tv_nsec = 0 }
+    };
+    if (futimens(fd, times) != 0)
+    {
+        extraction->metadata_errors++;
+    }
+    if (close(fd) != 0)
+    {
+        write_install_log("Failed to close %s: %s", path, strerror(errno));
+        return -4;
+    }
+
+    return skip_bytes(extraction, padding_for(entry->size));
+}
+
+static int extract_directory(
+    ArchiveExtraction *extraction, const ArchiveEntry *entry, const char *path
+)
+{
+    // Create the directory, including any ancestors missing from the archive.
+    if (mkdir(path, 0700) != 0 && errno != EEXIST)
+    {
+        create_parent_directories(path);
+        if (mkdir(path, 0700) != 0 && errno != EEXIST)
+        {
+            write_install_log("Failed to create directory %s: %s", path, strerror(errno));
+            return -4;
+        }
+    }
+
+    // Grow the deferred directory list when full.
+    if (extraction->directory_count == extraction->directory_capacity)
+    {
+        int capacity = extraction->directory_capacity
+            ? extraction->directory_capacity * 2 : 256;
+        ArchiveDirectory *directories = realloc(
+            extraction->directories, (size_t)capacity * sizeof(ArchiveDirectory)
+        );
+        if (!directories)
+        {
+            return -4;
+        }
+        extraction->directories = directories;
+        extraction->directory_capacity = capacity;
+    }
+
+    // Defer metadata so later entries do not change the directory mtime.
+    ArchiveDirectory *directory = &extraction->directories[extraction->directory_count];
+    directory->path = strdup(path);
+    if (!directory->path)
+    {
+        return -4;
+    }
+    directory->mode = entry->mode;
+    directory->uid = entry->uid;
+    directory->gid = entry->gid;
+    directory->mtime = entry->mtime;
+    extraction->directory_count++;
+
+    return skip_bytes(extraction, entry->size + padding_for(entry->size));
+}
+
+static int extract_link(
+    ArchiveExtraction *extraction, const ArchiveEntry *entry, const char *path
+)
+{
+    // Replace any existing entry at the link path.
+    unlink(path);
+    create_parent_directories(path);
+
+    if (entry->type == '2')
+    {
+        // Create the symbolic link with its target verbatim.
+        if (symlink(entry->link_target, path) != 0)
+        {
+            write_install_log("Failed to create symlink %s: %s", path, strerror(errno));
+            return -4;
+        }
+        apply_path_metadata(extraction, path, entry, 1);
+    }
+    else
+    {
+        // Resolve the hard link target inside the target directory.
+        char relative_target[PATH_MAX];
+        char target_path[PATH_MAX];
+        if (sanitize_entry_path(entry->link_target, relative_target, sizeof(relative_target)) != 0 ||
+            snprintf(target_path, sizeof(target_path), "%s/%s",
+                extraction->target_directory, relative_target) >= (int)sizeof(target_path))
+        {
+            write_install_log("Rejected unsafe hard link target: %s", entry->link_target);
+            return -3;
+        }
+        if (link(target_path, path) != 0)
+        {
+            write_install_log("Failed to create hard link %s: %s", path, strerror(errno));
+            return -4;
+        }
+    }
+
+    return skip_bytes(extraction, entry->size + padding_for(entry->size));
+}
+
+static int extract_special_file(
+    ArchiveExtraction *extraction, const ArchiveEntry *entry, const char *path
+)
+{
+    // Map the tar type to a file type.
+    mode_t file_type = S_IFIFO;
+    if (entry->type == '3')
+    {
+        file_type = S_IFCHR;
+    }
+    else if (entry->type == '4')
+    {
+        file_type = S_IFBLK;
+    }
+
+    // Create the device node or FIFO.
+    unlink(path);
+    create_parent_directories(path);
+    dev_t device = makedev(entry->device_major, entry->device_minor);
+    if (mknod(path, file_type | (entry->mode & 07777), device) != 0)
+    {
+        write_install_log("Failed to create special file %s: %s", path, strerror(errno));
+        return -4;
+    }
+    apply_path_metadata(extraction, path, entry, 0);
+
+    return skip_bytes(extraction, entry->size + padding_for(entry->size));
+}
+
+static int extract_entry(ArchiveExtraction *extraction, const ArchiveEntry *entry)
+{
+    // Build the absolute path of the entry under the target directory.
+    char path[PATH_MAX];
+    if (strcmp(entry->path, ".") == 0)
+    {
+        snprintf(path, sizeof(path), "%s", extraction->target_directory);
+    }
+    else if (snprintf(path, sizeof(path), "%s/%s",
+        extraction->target_directory, entry->path) >= (int)sizeof(path))
+    {
+        write_install_log("Archive path too long: %s", entry->path);
+        return -3;
+    }
+
+    // Wait for queued writes this entry depends on: earlier writes to the
+    // same path, and the target of a hard link.
+    if (extraction->has_writers)
+    {
+        int result = wait_writer_path(&extraction->writers, path);
+        if (result == 0 && entry->type == '1')
+        {
+            char target_path[PATH_MAX];
+            char relative_target[PATH_MAX];
+            if (sanitize_entry_path(entry->link_target, relative_target, sizeof(relative_target)) == 0 &&
+                snprintf(target_path, sizeof(target_path), "%s/%s",
+                    extraction->target_directory, relative_target) < (int)sizeof(target_path))
+            {
+                result = wait_writer_path(&extraction->writers, target_path);
+            }
+        }
+        if (result != 0)
+        {
+            return result;
+        }
+    }
+
+    // Let files queued on the ring finish before links and special files,
+    // which may refer to them or replace them.
+    int is_file_or_directory = entry->type == '0' || entry->type == '\0' ||
+        entry->type == '7' || entry->type == '5';
+    if (extraction->has_uring && !is_file_or_directory)
+    {
+        int result = flush_uring_writer(&extraction->uring);
+        if (result != 0)
+        {
+            return result;
+        }
+    }
+
+    // Dispatch on the entry type.
+    switch (entry->type)
+    {
+        case '0':
+        case '\0':
+        case '7':
+            return extract_regular_file(extraction, entry, path);
+        case '5':
+            return extract_directory(extraction, entry, path);
+        case '1':
+        case '2':
+            return extract_link(extraction, entry, path);
+        case '3':
+        case '4':
+        case '6':
+            return extract_special_file(extraction, entry, path);
+        default:
+            write_install_log("Skipping unsupported archive entry type '%c': %s", entry->type, entry->path);
+            return skip_bytes(extraction, entry->size + padding_for(entry->size));
+    }
+}
+
+static void apply_directory_metadata(ArchiveExtraction *extraction)
+{
+    // Apply in reverse order so children are finalized before parents.
+    for (int i = extraction->directory_count - 1; i >= 0; i--)
+    {
+        ArchiveDirectory *directory = &extraction->directories[i];
+        ArchiveEntry entry = {
+            .mode = directory->mode,
+            .uid = directory->uid,
+            .gid = directory->gid,
+            .mtime = directory->mtime
+        };
+        apply_path_metadata(extraction, directory->path, &entry, 0);
+    }
+}
+
+static void create_manifest_directories(ArchiveExtraction *extraction)
+{
+    // Create every directory listed in the manifest before any file is
+    // written, so that writer threads never race to create parents.
+    for (int i = 0; i < extraction->manifest.count; i++)
+    {
+        const ManifestEntry *entry = &extraction->manifest.entries[i];
+        char relative_path[PATH_MAX];
+        char path[PATH_MAX];
+        if (entry->type != 'd' ||
+            sanitize_entry_path(entry->path, relative_path, sizeof(relative_path)) != 0 ||
+            strcmp(relative_path, ".") == 0 ||
+            snprintf(path, sizeof(path), "%s/%s",
+                extraction->target_directory, relative_path) >= (int)sizeof(path))
+        {
+            continue;
+        }
+        if (mkdir(path, 0700) != 0 && errno == ENOENT)
+        {
+            create_parent_directories(path);
+            mkdir(path, 0700);
+        }
+    }
+}
+
+static void start_uring_writer(ArchiveExtraction *extraction, WriteBackend backend, int writer_count)
+{
+    if (backend != WRITE_BACKEND_URING)
+    {
+        return;
+    }
+
+    // Keep a single file in flight where a single writer is wanted, such as
+    // on a rotational disk, so the ring still writes sequentially.
+    int queue_depth = writer_count > 1 ? URING_QUEUE_DEPTH : 1;
+
+    // Fall back to plain system calls when io_uring is unavailable.
+    if (open_uring_writer(&extraction->uring, extraction->restore_ownership, queue_depth) != 0)
+    {
+        write_install_log("io_uring is unavailable, writing files with system calls");
+        return;
+    }
+    extraction->has_uring = 1;
+    write_install_log("Writing files through io_uring, %d in flight", queue_depth);
+}
+
+static int stop_uring_writer(ArchiveExtraction *extraction)
+{
+    if (!extraction->has_uring)
+    {
+        return 0;
+    }
+
+    // Wait for all queued files and collect their metadata failures.
+    int result = flush_uring_writer(&extraction->uring);
+    extraction->metadata_errors += extraction->uring.metadata_errors;
+    close_uring_writer(&extraction->uring);
+    extraction->has_uring = 0;
+    return result;
+}
+
+static void start_manifest_writers(ArchiveExtraction *extraction, const char *archive_path, int writer_count)
+{
+    // A single writer extracts inline, without a manifest.
+    if (writer_count <= 1)
+    {
+        return;
+    }
+
+    // Load the manifest, which is required for concurrent writes.
+    int result = load_rootfs_manifest(archive_path, &extraction->manifest);
+    if (result == -2)
+    {
+        write_install_log("Ignoring invalid manifest for %s", archive_path);
+    }
+    if (result != 0)
+    {
+        return;
+    }
+
+    // Create the directory tree, then start the writer threads.
+    create_manifest_directories(extraction);
+    if (start_writer_pool(&extraction->writers, writer_count, extraction->restore_ownership) != 0)
+    {
+        return;
+    }
+    extraction->has_writers = 1;
+    write_install_log(
+        "Writing %d manifest entries on %d threads",
+        extraction->manifest.count, extraction->writers.thread_count
+    );
+}
+
+static int stop_manifest_writers(ArchiveExtraction *extraction)
+{
+    if (!extraction->has_writers)
+    {
+        return 0;
+    }
+
+    // Wait for all queued files and collect their metadata failures.
+    int result = stop_writer_pool(&extraction->writers);
+    extraction->metadata_errors += extraction->writers.metadata_errors;
+    extraction->has_writers = 0;
+    return result;
+}
+
+static void free_extraction(ArchiveExtraction *extraction)
+{
+    stop_uring_writer(extraction);
+    stop_manifest_writers(extraction);
+    free_rootfs_manifest(&extraction->manifest);
+    for (int i = 0; i < extraction->directory_count; i++)
+    {
+        free(extraction->directories[i].path);
+    }
+    free(extraction->directories);
+    free(extraction->buffer);
+    close_rootfs_stream(&extraction->stream);
+}
+
+int extract_rootfs_archive(
+    const char *archive_path, const char *target_directory, int thread_count,
+    int writer_count, WriteBackend backend, RootfsProgress *progress
+)
+{
+    ArchiveExtraction extraction = {0};
+    extraction.target_directory = target_directory;
+    extraction.restore_ownership = (geteuid() == 0);
+
+    // Open the decompressing stream over the archive.
+    if (open_rootfs_stream(&extraction.stream, archive_path, thread_count, progress) != 0)
+    {
+        return -1;
+    }
+
+    // Allocate the copy buffer shared by all entries.
+    extraction.buffer = malloc(ARCHIVE_COPY_BUFFER_BYTES);
+    if (!extraction.buffer)
+    {
+        free_extraction(&extraction);
+        return -4;
+    }
+
+    // Write small files through io_uring, and larger ones listed in the
+    // archive's manifest concurrently on threads.
+    start_uring_writer(&extraction, backend, writer_count);
+    start_manifest_writers(&extraction, archive_path, writer_count);
+
+    // Extract entries until the end-of-archive marker.
+    int result = 0;
+    ArchiveEntry *entry = malloc(sizeof(ArchiveEntry));
+    if (!entry)
+    {
+        free_extraction(&extraction);
+        return -4;
+    }
+    while ((result = read_next_entry(&extraction, entry)) == 0)
+    {
+        result = extract_entry(&extraction, entry);
+        if (result != 0)
+        {
+            break;
+        }
+        invoke_command_tick();
+    }
+    free(entry);
+
+    // Treat reaching the end-of-archive marker as success, once all queued
+    // files have been written.
+    if (result == 1)
+    {
+        result = stop_uring_writer(&extraction);
+    }
+    if (result == 0)
+    {
+        result = stop_manifest_writers(&extraction);
+    }
+
+    // Verify the archive against its shipped digest, now that every
+    // compressed byte has been read once.
+    if (result == 0)
+    {
+        int verified = verify_rootfs_stream(&extraction.stream);
+        if (verified == 1)
+        {
+            write_install_log("No digest shipped for %s, skipping verification", archive_path);
+        }
+        else if (verified == -1)
+        {
+            result = -2;
+        }
+        else if (verified == -2)
+        {
+            write_install_log("Rootfs archive does not match its digest");
+            result = -5;
+        }
+    }
+    if (result == 0)
+    {
+        apply_directory_metadata(&extraction);
+    }
+    if (extraction.metadata_errors > 0)
+    {
+        write_install_log("Warning: %d metadata updates failed", extraction.metadata_errors);
+    }
+
+    free_extraction(&extraction);
+    return result;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "../../all.h"
+
+/** The size of a tar header and data block. */
+#define ARCHIVE_BLOCK_BYTES 512
+
+/** The size of the buffer used to copy file contents out of the archive. */
+#define ARCHIVE_COPY_BUFFER_BYTES (1024 * 1024)
+
+/**
+ * Extracts a compressed tar archive into a target directory in-process.
+ *
+ * Handles ustar, GNU long names and pax extended headers, and restores
+ * ownership, permissions and modification times the way `tar` does when run
+ * as root. Directory metadata is applied after all entries are written so
+ * that extraction does not disturb directory modification times.
+ *
+ * When a manifest accompanies the archive, its directories are created
+ * first and small files are then written concurrently by writer threads.
+ *
+ * @param archive_path The path to the compressed tar archive.
+ * @param target_directory The directory to extract into.
+ * @param thread_count The number of decompression threads for block-indexed
+ *                     archives, or 0 to choose automatically.
+ * @param writer_count The number of file writer threads to use when the
+ *                     archive has a manifest, where 1 writes inline.
+ * @param backend How small files are written. With WRITE_BACKEND_URING,
+ *                they are batched through io_uring when the kernel supports
+ *                it, with one file in flight when writer_count is 1, and
+ *                the writer threads take the larger ones.
+ * @param progress The progress counters to update during extraction.
+ *
+ * @return - `0` - Indicates success.
+ * @return - `-1` - Indicates the archive could not be opened.
+ * @return - `-2` - Indicates corrupt or truncated compressed data.
+ * @return - `-3` - Indicates a malformed or unsafe tar entry.
+ * @return - `-4` - Indicates a failure writing to the target directory.
+ * @return - `-5` - Indicates the archive does not match its shipped digest.
+ */
+int extract_rootfs_archive(
+    const char *archive_path, const char *target_directory, int thread_count,
+    int writer_count, WriteBackend backend, RootfsProgress *progress
+);
@@ -0,0 +1,184 @@
+/**
+ * This code is responsible for computing SHA-256 digests (FIPS 180-4), used
+ * to verify the rootfs archive in the same pass that extracts it, and for
+ * loading the digest shipped next to the archive.
+ */
+
+#include "../../all.h"
+
+static const unsigned int round_constants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static unsigned int rotate_right(unsigned int value, int count)
+{
+    return (value >> count) | (value << (32 - count));
+}
+
+static void process_digest_block(DigestContext *context, const unsigned char *block)
+{
+    // Expand the block into the message schedule.
+    unsigned int schedule[64];
+    for (int i = 0; i < 16; i++)
+    {
+        schedule[i] = (unsigned int)block[i * 4] << 24 | (unsigned int)block[i * 4 + 1] << 16 |
+            (unsigned int)block[i * 4 + 2] << 8 | (unsigned int)block[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++)
+    {
+        unsigned int s0 = rotate_right(schedule[i - 15], 7) ^
+            rotate_right(schedule[i - 15], 18) ^ (schedule[i - 15] >> 3);
+        unsigned int s1 = rotate_right(schedule[i - 2], 17) ^
+            rotate_right(schedule[i - 2], 19) ^ (schedule[i - 2] >> 10);
+        schedule[i] = schedule[i - 16] + s0 + schedule[i - 7] + s1;
+    }
+
+    // Run the 64 compression rounds.
+    unsigned int a = context->state[0], b = context->state[1];
+    unsigned int c = context->state[2], d = context->state[3];
+    unsigned int e = context->state[4], f = context->state[5];
+    unsigned int g = context->state[6], h = context->state[7];
+    for (int i = 0; i < 64; i++)
+    {
+        unsigned int s1 = rotate_right(e, 6) ^ rotate_right(e, 11) ^ rotate_right(e, 25);
+        unsigned int choice = (e & f) ^ (~e & g);
+        unsigned int temp1 = h + s1 + choice + round_constants[i] + schedule[i];
+        unsigned int s0 = rotate_right(a, 2) ^ rotate_right(a, 13) ^ rotate_right(a, 22);
+        unsigned int majority = (a & b) ^ (a & c) ^ (b & c);
+        unsigned int temp2 = s0 + majority;
+        h = g;
+        g = f;
+        f = e;
+        e = d + temp1;
+        d = c;
+        c = b;
+        b = a;
+        a = temp1 + temp2;
+    }
+
+    // Add the compressed block to the running state.
+    context->state[0] += a;
+    context->state[1] += b;
+    context->state[2] += c;
+    context->state[3] += d;
+    context->state[4] += e;
+    context->state[5] += f;
+    context->state[6] += g;
+    context->state[7] += h;
+}
+
+void start_digest(DigestContext *context)
+{
+    static const unsigned int initial_state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(context->state, initial_state, sizeof(initial_state));
+    context->length = 0;
+    context->block_length = 0;
+}
+
+void update_digest(DigestContext *context, const void *data, size_t length)
+{
+    const unsigned char *bytes = data;
+    context->length += length;
+
+    // Complete a partially filled block first.
+    if (context->block_length > 0)
+    {
+        size_t chunk = DIGEST_BLOCK_BYTES - context->block_length;
+        if (chunk > length)
+        {
+            chunk = length;
+        }
+        memcpy(context->block + context->block_length, bytes, chunk);
+        context->block_length += chunk;
+        bytes += chunk;
+        length -= chunk;
+        if (context->block_length < DIGEST_BLOCK_BYTES)
+        {
+            return;
+        }
+        process_digest_block(context, context->block);
+        context->block_length = 0;
+    }
+
+    // Process whole blocks straight from the input, keeping the remainder.
+    while (length >= DIGEST_BLOCK_BYTES)
+    {
+        process_digest_block(context, bytes);
+        bytes += DIGEST_BLOCK_BYTES;
+        length -= DIGEST_BLOCK_BYTES;
+    }
+    memcpy(context->block, bytes, length);
+    context->block_length = length;
+}
+
+void finish_digest(DigestContext *context, unsigned char out_digest[DIGEST_BYTES])
+{
+    // Pad with a one bit, zeros and the message length in bits.
+    unsigned long long bit_length = context->length * 8;
+    unsigned char padding[DIGEST_BLOCK_BYTES * 2] = { 0x80 };
+    size_t padding_length = (context->block_length < 56 ? 56 : 120) - context->block_length;
+    for (int i = 0; i < 8; i++)
+    {
+        padding[padding_length + (size_t)i] = (unsigned char)(bit_length >> (56 - i * 8));
+    }
+    update_digest(context, padding, padding_length + 8);
+
+    // Write the state out in big-endian order.
+    for (int i = 0; i < 8; i++)
+    {
+        out_digest[i * 4] = (unsigned char)(context->state[i] >> 24);
+        out_digest[i * 4 + 1] = (unsigned char)(context->state[i] >> 16);
+        out_digest[i * 4 + 2] = (unsigned char)(context->state[i] >> 8);
+        out_digest[i * 4 + 3] = (unsigned char)context->state[i];
+    }
+}
+
+int load_rootfs_digest(const char *archive_path, unsigned char out_digest[DIGEST_BYTES])
+{
+    // Open the digest next to the archive.
+    char digest_path[PATH_MAX];
+    snprintf(digest_path, sizeof(digest_path), "%s%s", archive_path, CONFIG_ROOTFS_DIGEST_SUFFIX);
+    FILE *file = fopen(digest_path, "r");
+    if (!file)
+    {
+        return -1;
+    }
+
+    // Read the leading hexadecimal digits.
+    char line[256];
+    int has_line = fgets(line, sizeof(line), file) != NULL;
+    fclose(file);
+    if (!has_line)
+    {
+        return -2;
+    }
+
+    // Decode two digits per byte, requiring whitespace or the end after them.
+    for (int i = 0; i < DIGEST_BYTES; i++)
+    {
+        unsigned int byte;
+        if (!isxdigit((unsigned char)line[i * 2]) || !isxdigit((unsigned char)line[i * 2 + 1]) ||
+            sscanf(line + i * 2, "%2x", &byte) != 1)
+        {
+            return -2;
+        }
+        out_digest[i] = (unsigned char)byte;
+    }
+    char terminator = line[DIGEST_BYTES * 2];
+    if (terminator != '\0' && !isspace((unsigned char)terminator))
+    {
+        return -2;
+    }
+
+    return 0;
+}
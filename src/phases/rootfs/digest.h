@@ -0,0 +1,56 @@
+#pragma once
+#include "../../all.h"
+
+/** The size of a SHA-256 digest in bytes. */
+#define DIGEST_BYTES 32
+
+/** The size of the blocks SHA-256 processes at a time. */
+#define DIGEST_BLOCK_BYTES 64
+
+/** A type representing a SHA-256 computation in progress. */
+typedef struct {
+    unsigned int state[8];
+    unsigned long long length;
+    unsigned char block[DIGEST_BLOCK_BYTES];
+    size_t block_length;
+} DigestContext;
+
+/**
+ * Starts a new SHA-256 computation.
+ *
+ * @param context The context to initialize.
+ */
+void start_digest(DigestContext *context);
+
+/**
+ * Adds bytes to a SHA-256 computation.
+ *
+ * @param context The computation to update.
+ * @param data The bytes to add.
+ * @param length The number of bytes to add.
+ */
+void update_digest(DigestContext *context, const void *data, size_t length);
+
+/**
+ * Completes a SHA-256 computation.
+ *
+ * @param context The computation to complete.
+ * @param out_digest Output: the digest of all bytes added.
+ */
+void finish_digest(DigestContext *context, unsigned char out_digest[DIGEST_BYTES]);
+
+/**
+ * Loads the SHA-256 digest shipped next to a rootfs archive.
+ *
+ * The digest lives next to the archive with CONFIG_ROOTFS_DIGEST_SUFFIX
+ * appended, in the format written by `sha256sum`: 64 hexadecimal digits,
+ * optionally followed by the file name.
+ *
+ * @param archive_path The path to the compressed archive.
+ * @param out_digest Output: the expected digest.
+ *
+ * @return - `0` - Indicates the digest was loaded.
+ * @return - `-1` - Indicates no digest exists.
+ * @return - `-2` - Indicates the digest is malformed.
+ */
+int load_rootfs_digest(const char *archive_path, unsigned char out_digest[DIGEST_BYTES]);
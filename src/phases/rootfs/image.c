@@ -0,0 +1,387 @@
+/**
+ * This code is responsible for deploying the root filesystem from a
+ * pre-built ext4 image, writing only the blocks the image actually uses
+ * onto the root partition with large sequential writes.
+ */
+
+#include "../../all.h"
+
+static unsigned int read_le16(const unsigned char *data)
+{
+    return (unsigned int)data[0] | (unsigned int)data[1] << 8;
+}
+
+static unsigned int read_le32(const unsigned char *data)
+{
+    return (unsigned int)data[0] | (unsigned int)data[1] << 8 |
+        (unsigned int)data[2] << 16 | (unsigned int)data[3] << 24;
+}
+
+static int read_image_bytes(int fd, void *buffer, size_t length, unsigned long long offset)
+{
+    // Read the full range, retrying on short reads and interrupts.
+    size_t done = 0;
+    while (done < length)
+    {
+        ssize_t count = pread(fd, (unsigned char *)buffer + done, length - done, (off_t)(offset + done));
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (count <= 0)
+        {
+            return -1;
+        }
+        done += (size_t)count;
+    }
+    return 0;
+}
+
+int use_rootfs_image(void)
+{
+    Store *store = get_store();
+
+    // Image mode requires a shipped image.
+    if (!store->rootfs_image)
+    {
+        return 0;
+    }
+
+    // The image holds an ext4 filesystem, so the root must be ext4 too.
+    int root_index = find_root_partition_index(store);
+    return root_index >= 0 && store->partitions[root_index].filesystem == FS_EXT4;
+}
+
+int read_image_geometry(int fd, ImageGeometry *out_geometry)
+{
+    // Read the primary superblock.
+    unsigned char superblock[IMAGE_SUPERBLOCK_BYTES];
+    if (read_image_bytes(fd, superblock, sizeof(superblock), IMAGE_SUPERBLOCK_OFFSET) != 0)
+    {
+        return -1;
+    }
+    if (read_le16(superblock + 0x38) != IMAGE_EXT4_MAGIC)
+    {
+        return -2;
+    }
+
+    // Decode the fields that determine the block layout.
+    ImageGeometry geometry = {0};
+    unsigned int log_block_size = read_le32(superblock + 0x18);
+    if (log_block_size > 6)
+    {
+        return -2;
+    }
+    geometry.block_size = 1024U << log_block_size;
+    geometry.feature_compat = read_le32(superblock + 0x5C);
+    geometry.feature_incompat = read_le32(superblock + 0x60);
+    geometry.feature_ro_compat = read_le32(superblock + 0x64);
+    geometry.block_count = read_le32(superblock + 0x04);
+    if (geometry.feature_incompat & IMAGE_FEATURE_INCOMPAT_64BIT)
+    {
+        geometry.block_count |= (unsigned long long)read_le32(superblock + 0x150) << 32;
+    }
+    geometry.first_data_block = read_le32(superblock + 0x14);
+    geometry.blocks_per_group = read_le32(superblock + 0x20);
+    geometry.inodes_per_group = read_le32(superblock + 0x28);
+    geometry.inode_size = read_le32(superblock + 0x4C) == 0 ? 128 : read_le16(superblock + 0x58);
+    geometry.reserved_descriptor_blocks = read_le16(superblock + 0xCE);
+    geometry.backup_groups[0] = read_le32(superblock + 0x24C);
+    geometry.backup_groups[1] = read_le32(superblock + 0x250);
+    geometry.descriptor_size = 32;
+    if (geometry.feature_incompat & IMAGE_FEATURE_INCOMPAT_64BIT)
+    {
+        geometry.descriptor_size = read_le16(superblock + 0xFE);
+    }
+
+    // Reject layouts whose metadata placement is not handled here.
+    if (geometry.blocks_per_group == 0 ||
+        geometry.blocks_per_group > geometry.block_size * 8 ||
+        geometry.block_count <= geometry.first_data_block ||
+        geometry.descriptor_size < 32 ||
+        (geometry.feature_incompat & IMAGE_FEATURE_INCOMPAT_META_BG) ||
+        (geometry.feature_ro_compat & IMAGE_FEATURE_RO_COMPAT_BIGALLOC))
+    {
+        return -2;
+    }
+
+    // Derive the group count and the size of the descriptor table.
+    unsigned long long data_blocks = geometry.block_count - geometry.first_data_block;
+    geometry.group_count = (unsigned int)(
+        (data_blocks + geometry.blocks_per_group - 1) / geometry.blocks_per_group
+    );
+    geometry.descriptor_blocks =
+        (geometry.group_count * geometry.descriptor_size + geometry.block_size - 1) /
+        geometry.block_size;
+
+    *out_geometry = geometry;
+    return 0;
+}
+
+static int is_power_of(unsigned int value, unsigned int base)
+{
+    while (value > 1 && value % base == 0)
+    {
+        value /= base;
+    }
+    return value == 1;
+}
+
+static int has_superblock_backup(const ImageGeometry *geometry, unsigned int group)
+{
+    // The primary superblock always lives in group 0.
+    if (group == 0)
+    {
+        return 1;
+    }
+
+    // With sparse_super2, backups live only in the two recorded groups.
+    if (geometry->feature_compat & IMAGE_FEATURE_COMPAT_SPARSE_SUPER2)
+    {
+        return group == geometry->backup_groups[0] || group == geometry->backup_groups[1];
+    }
+
+    // Without sparse_super, every group has a backup; with it, only group 1
+    // and powers of 3, 5 and 7 do.
+    if (!(geometry->feature_ro_compat & IMAGE_FEATURE_RO_COMPAT_SPARSE_SUPER) || group == 1)
+    {
+        return 1;
+    }
+    return is_power_of(group, 3) || is_power_of(group, 5) || is_power_of(group, 7);
+}
+
+static unsigned long long mark_used_blocks(
+    unsigned char *used, unsigned long long block_count,
+    unsigned long long start, unsigned long long count
+)
+{
+    // Set each block's bit, counting only newly marked blocks.
+    unsigned long long marked = 0;
+    for (unsigned long long block = start; block < start + count && block < block_count; block++)
+    {
+        if (!(used[block / 8] & (1U << (block % 8))))
+        {
+            used[block / 8] |= (unsigned char)(1U << (block % 8));
+            marked++;
+        }
+    }
+    return marked;
+}
+
+int build_image_block_map(
+    int fd, const ImageGeometry *geometry,
+    unsigned char **out_used, unsigned long long *out_used_blocks
+)
+{
+    // Read the primary group descriptor table, which follows the superblock.
+    size_t table_bytes = (size_t)geometry->group_count * geometry->descriptor_size;
+    unsigned char *table = malloc(table_bytes);
+    unsigned char *bitmap = malloc(geometry->block_size);
+    unsigned char *used = calloc((size_t)(geometry->block_count + 7) / 8, 1);
+    if (!table || !bitmap || !used ||
+        read_image_bytes(fd, table, table_bytes,
+            (unsigned long long)(geometry->first_data_block + 1) * geometry->block_size) != 0)
+    {
+        free(table);
+        free(bitmap);
+        free(used);
+        return -1;
+    }
+
+    // Mark the boot block, which precedes the first data block.
+    unsigned long long used_blocks = mark_used_blocks(used, geometry->block_count, 0, geometry->first_data_block + 1);
+
+    // Mark the block bitmap, inode bitmap and inode table of each group.
+    int checksummed = (geometry->feature_ro_compat &
+        (IMAGE_FEATURE_RO_COMPAT_GDT_CSUM | IMAGE_FEATURE_RO_COMPAT_METADATA_CSUM)) != 0;
+    unsigned long long inode_table_blocks =
+        ((unsigned long long)geometry->inodes_per_group * geometry->inode_size + geometry->block_size - 1) / geometry->block_size;
+    for (unsigned int group = 0; group < geometry->group_count; group++)
+    {
+        const unsigned char *descriptor = table + (size_t)group * geometry->descriptor_size;
+        unsigned long long block_bitmap = read_le32(descriptor + 0x00);
+        unsigned long long inode_bitmap = read_le32(descriptor + 0x04);
+        unsigned long long inode_table = read_le32(descriptor + 0x08);
+        if (geometry->descriptor_size >= 64)
+        {
+            block_bitmap |= (unsigned long long)read_le32(descriptor + 0x20) << 32;
+            inode_bitmap |= (unsigned long long)read_le32(descriptor + 0x24) << 32;
+            inode_table |= (unsigned long long)read_le32(descriptor + 0x28) << 32;
+        }
+        used_blocks += mark_used_blocks(used, geometry->block_count, block_bitmap, 1);
+        used_blocks += mark_used_blocks(used, geometry->block_count, inode_bitmap, 1);
+        used_blocks += mark_used_blocks(used, geometry->block_count, inode_table, inode_table_blocks);
+
+        // Mark the superblock and descriptor table backups of the group.
+        unsigned long long group_start = geometry->first_data_block + (unsigned long long)group * geometry->blocks_per_group;
+        if (has_superblock_backup(geometry, group))
+        {
+            used_blocks += mark_used_blocks(
+                used, geometry->block_count, group_start,
+                1 + geometry->descriptor_blocks + geometry->reserved_descriptor_blocks
+            );
+        }
+
+        // Merge the on-disk block bitmap, unless it was never initialized.
+        unsigned int flags = read_le16(descriptor + 0x12);
+        if (checksummed && (flags & IMAGE_GROUP_BLOCK_UNINIT))
+        {
+            continue;
+        }
+        if (read_image_bytes(fd, bitmap, geometry->block_size, block_bitmap * geometry->block_size) != 0)
+        {
+            free(table);
+            free(bitmap);
+            free(used);
+            return -1;
+        }
+        for (unsigned int bit = 0; bit < geometry->blocks_per_group; bit++)
+        {
+            if (bitmap[bit / 8] & (1U << (bit % 8)))
+            {
+                used_blocks += mark_used_blocks(used, geometry->block_count, group_start + bit, 1);
+            }
+        }
+    }
+
+    free(table);
+    free(bitmap);
+    *out_used = used;
+    *out_used_blocks = used_blocks;
+    return 0;
+}
+
+static int open_image_device(const char *device_path, int use_direct_io)
+{
+    // Bypass the page cache when possible, falling back to buffered writes.
+    if (use_direct_io)
+    {
+        int fd = open(device_path, O_WRONLY | O_CLOEXEC | O_DIRECT);
+        if (fd >= 0)
+        {
+            return fd;
+        }
+    }
+    return open(device_path, O_WRONLY | O_CLOEXEC);
+}
+
+static int write_image_bytes(int fd, const void *buffer, size_t length, unsigned long long offset)
+{
+    size_t done = 0;
+    while (done < length)
+    {
+        ssize_t count = pwrite(fd, (const unsigned char *)buffer + done, length - done, (off_t)(offset + done));
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        // Drop O_DIRECT if the device rejects it, and retry buffered.
+        if (count < 0 && errno == EINVAL && (fcntl(fd, F_GETFL) & O_DIRECT))
+        {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+            continue;
+        }
+        if (count <= 0)
+        {
+            return -1;
+        }
+        done += (size_t)count;
+    }
+    return 0;
+}
+
+int write_rootfs_image(
+    const char *image_path, const char *device_path, RootfsProgress *progress
+)
+{
+    // Open the image and read its layout.
+    int image_fd = open(image_path, O_RDONLY | O_CLOEXEC);
+    if (image_fd < 0)
+    {
+        return -1;
+    }
+    ImageGeometry geometry;
+    unsigned char *used = NULL;
+    unsigned long long used_blocks = 0;
+    int result = read_image_geometry(image_fd, &geometry);
+    if (result != 0 || build_image_block_map(image_fd, &geometry, &used, &used_blocks) != 0)
+    {
+        close(image_fd);
+        return result == -1 ? -1 : -2;
+    }
+    posix_fadvise(image_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    // Open the device and ensure the image fits on it.
+    unsigned long long image_bytes = geometry.block_count * geometry.block_size;
+    int device_fd = open_image_device(device_path, geometry.block_size % IMAGE_DIRECT_ALIGNMENT == 0);
+    if (device_fd < 0 || get_open_disk_size(device_fd) < image_bytes)
+    {
+        if (device_fd >= 0)
+        {
+            close(device_fd);
+        }
+        free(used);
+        close(image_fd);
+        return -3;
+    }
+    write_install_log(
+        "Writing %llu of %llu image blocks (%u bytes each) to %s",
+        used_blocks, geometry.block_count, geometry.block_size, device_path
+    );
+    progress->compressed_total = used_blocks * geometry.block_size;
+
+    // Allocate an aligned buffer so the writes can bypass the page cache.
+    void *buffer = NULL;
+    if (posix_memalign(&buffer, IMAGE_DIRECT_ALIGNMENT, IMAGE_WRITE_BYTES) != 0)
+    {
+        close(device_fd);
+        free(used);
+        close(image_fd);
+        return -4;
+    }
+
+    // Copy each run of used blocks, in chunks of at most IMAGE_WRITE_BYTES.
+    unsigned long long run_limit = IMAGE_WRITE_BYTES / geometry.block_size;
+    unsigned long long block = 0;
+    result = 0;
+    while (block < geometry.block_count && result == 0)
+    {
+        if (!(used[block / 8] & (1U << (block % 8))))
+        {
+            block++;
+            continue;
+        }
+        unsigned long long run = 1;
+        while (run < run_limit && block + run < geometry.block_count &&
+            (used[(block + run) / 8] & (1U << ((block + run) % 8))))
+        {
+            run++;
+        }
+
+        size_t length = (size_t)(run * geometry.block_size);
+        unsigned long long offset = block * geometry.block_size;
+        if (read_image_bytes(image_fd, buffer, length, offset) != 0 ||
+            write_image_bytes(device_fd, buffer, length, offset) != 0)
+        {
+            result = -4;
+        }
+
+        progress->compressed_bytes += length;
+        progress->uncompressed_bytes += length;
+        invoke_command_tick();
+        block += run;
+    }
+
+    // Flush the written blocks to the device.
+    if (result == 0 && fsync(device_fd) != 0)
+    {
+        result = -4;
+    }
+
+    free(buffer);
+    close(device_fd);
+    free(used);
+    close(image_fd);
+    return result;
+}
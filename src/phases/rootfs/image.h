@@ -0,0 +1,123 @@
+#pragma once
+#include "../../all.h"
+
+/** The byte offset of the ext4 superblock within the filesystem. */
+#define IMAGE_SUPERBLOCK_OFFSET 1024
+
+/** The size of the ext4 superblock. */
+#define IMAGE_SUPERBLOCK_BYTES 1024
+
+/** The magic number identifying an ext2/3/4 superblock. */
+#define IMAGE_EXT4_MAGIC 0xEF53
+
+/** The compatible feature flag for sparse_super2 backup placement. */
+#define IMAGE_FEATURE_COMPAT_SPARSE_SUPER2 0x0200
+
+/** The incompatible feature flag for meta block groups. */
+#define IMAGE_FEATURE_INCOMPAT_META_BG 0x0010
+
+/** The incompatible feature flag for 64-bit block numbers. */
+#define IMAGE_FEATURE_INCOMPAT_64BIT 0x0080
+
+/** The read-only compatible feature flag for sparse superblock backups. */
+#define IMAGE_FEATURE_RO_COMPAT_SPARSE_SUPER 0x0001
+
+/** The read-only compatible feature flag for group descriptor checksums. */
+#define IMAGE_FEATURE_RO_COMPAT_GDT_CSUM 0x0010
+
+/** The read-only compatible feature flag for cluster allocation. */
+#define IMAGE_FEATURE_RO_COMPAT_BIGALLOC 0x0200
+
+/** The read-only compatible feature flag for metadata checksums. */
+#define IMAGE_FEATURE_RO_COMPAT_METADATA_CSUM 0x0400
+
+/** The group descriptor flag marking a never-initialized block bitmap. */
+#define IMAGE_GROUP_BLOCK_UNINIT 0x0002
+
+/** The size of each sequential write to the root partition. */
+#define IMAGE_WRITE_BYTES (8 * 1024 * 1024)
+
+/** The buffer alignment required for O_DIRECT writes. */
+#define IMAGE_DIRECT_ALIGNMENT 4096
+
+/** A type representing the block layout of an ext4 filesystem image. */
+typedef struct {
+    unsigned int block_size;
+    unsigned long long block_count;
+    unsigned int first_data_block;
+    unsigned int blocks_per_group;
+    unsigned int inodes_per_group;
+    unsigned int inode_size;
+    unsigned int group_count;
+    unsigned int descriptor_size;
+    unsigned int descriptor_blocks;
+    unsigned int reserved_descriptor_blocks;
+    unsigned int feature_compat;
+    unsigned int feature_incompat;
+    unsigned int feature_ro_compat;
+    unsigned int backup_groups[2];
+} ImageGeometry;
+
+/**
+ * Checks whether the root filesystem is deployed from a block image.
+ *
+ * Image mode applies when the live system ships CONFIG_ROOTFS_IMAGE_PATH
+ * and the root partition is formatted as ext4.
+ *
+ * @return - `1` - The root filesystem is written from the image.
+ * @return - `0` - The root filesystem is formatted and extracted.
+ */
+int use_rootfs_image(void);
+
+/**
+ * Reads the block layout of an ext4 filesystem image.
+ *
+ * @param fd The open image file descriptor.
+ * @param out_geometry Output: the layout of the filesystem.
+ *
+ * @return - `0` - Indicates success.
+ * @return - `-1` - Indicates the superblock could not be read.
+ * @return - `-2` - Indicates the image is not a supported ext4 filesystem.
+ */
+int read_image_geometry(int fd, ImageGeometry *out_geometry);
+
+/**
+ * Builds a bitmap of the blocks in use in an ext4 filesystem image.
+ *
+ * Combines the on-disk block bitmaps with the location of every superblock,
+ * group descriptor table, bitmap and inode table, so that groups whose
+ * bitmaps were never initialized are still handled correctly.
+ *
+ * @param fd The open image file descriptor.
+ * @param geometry The layout of the filesystem.
+ * @param out_used Output: the allocated bitmap, one bit per block.
+ * @param out_used_blocks Output: the number of blocks in use.
+ *
+ * @return - `0` - Indicates success.
+ * @return - `-1` - Indicates the group descriptors or bitmaps could not be read.
+ */
+int build_image_block_map(
+    int fd, const ImageGeometry *geometry,
+    unsigned char **out_used, unsigned long long *out_used_blocks
+);
+
+/**
+ * Writes an ext4 filesystem image onto a partition.
+ *
+ * Only blocks marked as used in the image are written, in large sequential
+ * runs, bypassing the page cache when the block size allows it. The
+ * filesystem keeps the size of the image and must be grown afterwards.
+ *
+ * @param image_path The path to the ext4 filesystem image.
+ * @param device_path The partition device to write to.
+ * @param progress The progress counters to update while writing.
+ *
+ * @return - `0` - Indicates success.
+ * @return - `-1` - Indicates the image could not be opened.
+ * @return - `-2` - Indicates the image is not a supported ext4 filesystem.
+ * @return - `-3` - Indicates the device could not be opened or is too small.
+ * @return - `-4` - Indicates a read or write failure while copying.
+ */
+int write_rootfs_image(
+    const char *image_path, const char *device_path, RootfsProgress *progress
+);
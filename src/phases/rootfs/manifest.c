@@ -0,0 +1,123 @@
+/**
+ * This code is responsible for loading the rootfs manifest, which lists the
+ * directories and files of the archive ahead of time so that extraction can
+ * create the directory tree first and hand file writes to worker threads.
+ */
+
+#include "../../all.h"
+
+static int parse_manifest_line(char *line, ManifestEntry *out_entry)
+{
+    // Split off the fixed fields, leaving the path (which may hold spaces).
+    char type;
+    unsigned int mode;
+    int path_start = 0;
+    if (sscanf(line, "%c %o %llu %llu %n", &type, &mode,
+            &out_entry->size, &out_entry->offset, &path_start) != 4 ||
+        path_start == 0 || (type != 'd' && type != 'f'))
+    {
+        return -1;
+    }
+
+    // Strip the trailing newline from the path.
+    char *path = line + path_start;
+    size_t length = strcspn(path, "\n");
+    if (length == 0)
+    {
+        return -1;
+    }
+    path[length] = '\0';
+
+    out_entry->type = type;
+    out_entry->mode = (mode_t)mode;
+    out_entry->path = strdup(path);
+    return out_entry->path ? 0 : -1;
+}
+
+int load_rootfs_manifest(const char *archive_path, RootfsManifest *out_manifest)
+{
+    memset(out_manifest, 0, sizeof(*out_manifest));
+
+    // Open the manifest next to the archive.
+    char manifest_path[PATH_MAX];
+    snprintf(manifest_path, sizeof(manifest_path), "%s%s", archive_path, CONFIG_ROOTFS_MANIFEST_SUFFIX);
+    FILE *file = fopen(manifest_path, "r");
+    if (!file)
+    {
+        return -1;
+    }
+
+    // Read one entry per line, skipping comment lines.
+    int capacity = 0;
+    char line[PATH_MAX + 128];
+    while (fgets(line, sizeof(line), file))
+    {
+        if (line[0] == '#' || line[0] == '\n')
+        {
+            continue;
+        }
+
+        // Grow the entry array when full.
+        if (out_manifest->count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 1024;
+            ManifestEntry *grown = realloc(
+                out_manifest->entries, (size_t)capacity * sizeof(ManifestEntry)
+            );
+            if (!grown)
+            {
+                fclose(file);
+                free_rootfs_manifest(out_manifest);
+                return -2;
+            }
+            out_manifest->entries = grown;
+        }
+
+        // Parse the entry and ensure entries follow archive order.
+        ManifestEntry *entry = &out_manifest->entries[out_manifest->count];
+        if (parse_manifest_line(line, entry) != 0)
+        {
+            fclose(file);
+            free_rootfs_manifest(out_manifest);
+            return -2;
+        }
+        out_manifest->count++;
+        if (out_manifest->count > 1 && entry->offset <= entry[-1].offset)
+        {
+            fclose(file);
+            free_rootfs_manifest(out_manifest);
+            return -2;
+        }
+    }
+    fclose(file);
+
+    return 0;
+}
+
+const ManifestEntry *find_manifest_entry(RootfsManifest *manifest, unsigned long long offset)
+{
+    // Advance past entries that precede the offset.
+    while (manifest->cursor < manifest->count &&
+        manifest->entries[manifest->cursor].offset < offset)
+    {
+        manifest->cursor++;
+    }
+
+    // Match only an entry that starts exactly at the offset.
+    if (manifest->cursor < manifest->count &&
+        manifest->entries[manifest->cursor].offset == offset)
+    {
+        return &manifest->entries[manifest->cursor];
+    }
+    return NULL;
+}
+
+void free_rootfs_manifest(RootfsManifest *manifest)
+{
+    for (int i = 0; i < manifest->count; i++)
+    {
+        free(manifest->entries[i].path);
+    }
+    free(manifest->entries);
+    memset(manifest, 0, sizeof(*manifest));
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "../../all.h"
+
+/** A type representing one entry of the rootfs manifest. */
+typedef struct {
+    char type;
+    mode_t mode;
+    unsigned long long size;
+    unsigned long long offset;
+    char *path;
+} ManifestEntry;
+
+/** A type representing the manifest that accompanies the rootfs archive. */
+typedef struct {
+    ManifestEntry *entries;
+    int count;
+    int cursor;
+} RootfsManifest;
+
+/**
+ * Loads the manifest that accompanies a rootfs archive.
+ *
+ * The manifest lives next to the archive with CONFIG_ROOTFS_MANIFEST_SUFFIX
+ * appended. Each line describes one archive entry as its type (`d` for a
+ * directory, `f` for a regular file), octal mode, size, the offset of its
+ * data in the uncompressed tar stream, and its path. Entries are ordered by
+ * offset, as in the archive.
+ *
+ * @param archive_path The path to the compressed archive.
+ * @param out_manifest Output: the loaded manifest.
+ *
+ * @return - `0` - Indicates the manifest was loaded.
+ * @return - `-1` - Indicates no manifest exists.
+ * @return - `-2` - Indicates the manifest is malformed.
+ */
+int load_rootfs_manifest(const char *archive_path, RootfsManifest *out_manifest);
+
+/**
+ * Finds the manifest entry whose data starts at an offset.
+ *
+ * Lookups must be made in increasing offset order, as the archive is read,
+ * so that each lookup only advances a cursor.
+ *
+ * @param manifest The manifest to search.
+ * @param offset The offset of the entry data in the uncompressed tar stream.
+ *
+ * @return The matching entry, or NULL if the manifest has none.
+ */
+const ManifestEntry *find_manifest_entry(RootfsManifest *manifest, unsigned long long offset);
+
+/** Releases the entries of a manifest. */
+void free_rootfs_manifest(RootfsManifest *manifest);
@@ -0,0 +1,398 @@
+/**
+ * This code is responsible for decompressing block-parallel rootfs archives
+ * on a pool of worker threads. Workers decode independent blocks into a
+ * bounded window of slots, while the caller consumes them in archive order.
+ */
+
+#include "../../all.h"
+
+int load_rootfs_block_index(
+    const char *archive_path, unsigned long long archive_size,
+    RootfsBlock **out_blocks, int *out_count
+)
+{
+    // Open the index next to the archive.
+    char index_path[PATH_MAX];
+    snprintf(index_path, sizeof(index_path), "%s%s", archive_path, CONFIG_ROOTFS_INDEX_SUFFIX);
+    FILE *file = fopen(index_path, "r");
+    if (!file)
+    {
+        return -1;
+    }
+
+    // Read one block per line, skipping comment lines.
+    RootfsBlock *blocks = NULL;
+    int count = 0;
+    int capacity = 0;
+    unsigned long long expected_offset = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), file))
+    {
+        if (line[0] == '#' || line[0] == '\n')
+        {
+            continue;
+        }
+
+        // Parse the block and ensure blocks are contiguous and bounded.
+        RootfsBlock block;
+        if (sscanf(line, "%llu %llu %llu", &block.compressed_offset,
+                &block.compressed_size, &block.uncompressed_size) != 3 ||
+            block.compressed_offset != expected_offset ||
+            block.compressed_size == 0 ||
+            block.uncompressed_size > PARALLEL_MAX_BLOCK_BYTES)
+        {
+            free(blocks);
+            fclose(file);
+            return -2;
+        }
+        expected_offset += block.compressed_size;
+
+        // Grow the block array when full.
+        if (count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 256;
+            RootfsBlock *grown = realloc(blocks, (size_t)capacity * sizeof(RootfsBlock));
+            if (!grown)
+            {
+                free(blocks);
+                fclose(file);
+                return -2;
+            }
+            blocks = grown;
+        }
+        blocks[count++] = block;
+    }
+    fclose(file);
+
+    // Ensure the blocks cover the whole archive.
+    if (count == 0 || expected_offset != archive_size)
+    {
+        free(blocks);
+        return -2;
+    }
+
+    *out_blocks = blocks;
+    *out_count = count;
+    return 0;
+}
+
+int get_rootfs_thread_count(unsigned long long block_bytes)
+{
+    // Start from the number of online CPUs.
+    long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned long long thread_count = cpu_count > 0 ? (unsigned long long)cpu_count : 1;
+
+    // Limit threads so that every decode slot fits in a quarter of RAM.
+    unsigned long long ram = get_system_ram();
+    if (ram > 0 && block_bytes > 0)
+    {
+        unsigned long long limit = (ram / 4) / (block_bytes * PARALLEL_SLOTS_PER_THREAD);
+        if (limit < thread_count)
+        {
+            thread_count = limit;
+        }
+    }
+
+    // Clamp to the supported range.
+    if (thread_count < 1)
+    {
+        thread_count = 1;
+    }
+    if (thread_count > PARALLEL_MAX_THREADS)
+    {
+        thread_count = PARALLEL_MAX_THREADS;
+    }
+
+    return (int)thread_count;
+}
+
+static int read_block(int fd, const RootfsBlock *block, unsigned char *buffer)
+{
+    // Read the whole compressed block, tolerating short reads.
+    size_t done = 0;
+    while (done < block->compressed_size)
+    {
+        ssize_t count = pread(
+            fd, buffer + done, (size_t)block->compressed_size - done,
+            (off_t)(block->compressed_offset + done)
+        );
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (count <= 0)
+        {
+            return -1;
+        }
+        done += (size_t)count;
+    }
+    return 0;
+}
+
+static int decode_gzip_block(
+    const unsigned char *input, size_t input_length,
+    unsigned char *output, size_t output_length
+)
+{
+    // Inflate the complete gzip member in a single call.
+    z_stream zlib = {0};
+    if (inflateInit2(&zlib, 15 + 32) != Z_OK)
+    {
+        return -2;
+    }
+    zlib.next_in = (unsigned char *)input;
+    zlib.avail_in = (uInt)input_length;
+    zlib.next_out = output;
+    zlib.avail_out = (uInt)output_length;
+    int status = inflate(&zlib, Z_FINISH);
+    unsigned long produced = zlib.total_out;
+    inflateEnd(&zlib);
+
+    // Ensure the member ended exactly where the index says it does.
+    if (status != Z_STREAM_END || produced != output_length)
+    {
+        return -2;
+    }
+    return 0;
+}
+
+static int decode_zstd_block(
+    const unsigned char *input, size_t input_length,
+    unsigned char *output, size_t output_length
+)
+{
+    // Decompress the complete zstd frame in a single call. The output
+    // buffer has one spare byte, so oversized frames are detected.
+    size_t produced = ZSTD_decompress(output, output_length + 1, input, input_length);
+
+    // Ensure the frame expanded to exactly the size the index says.
+    if (ZSTD_isError(produced) || produced != output_length)
+    {
+        return -2;
+    }
+    return 0;
+}
+
+static int ensure_capacity(unsigned char **buffer, size_t *capacity, size_t size)
+{
+    if (*capacity >= size)
+    {
+        return 0;
+    }
+    unsigned char *grown = realloc(*buffer, size);
+    if (!grown)
+    {
+        return -1;
+    }
+    *buffer = grown;
+    *capacity = size;
+    return 0;
+}
+
+static void *run_decoder_worker(void *argument)
+{
+    ParallelDecoder *decoder = argument;
+
+    pthread_mutex_lock(&decoder->mutex);
+    while (!decoder->stopping && decoder->error == 0)
+    {
+        // Wait until a block is pending and its slot has been consumed.
+        int block_index = decoder->next_block;
+        if (block_index >= decoder->block_count ||
+            block_index >= decoder->current_block + decoder->slot_count)
+        {
+            pthread_cond_wait(&decoder->changed, &decoder->mutex);
+            continue;
+        }
+        decoder->next_block++;
+        pthread_mutex_unlock(&decoder->mutex);
+
+        // Read and decode the block into its slot without holding the lock.
+        const RootfsBlock *block = &decoder->blocks[block_index];
+        ParallelSlot *slot = &decoder->slots[block_index % decoder->slot_count];
+        int result = 0;
+        if (ensure_capacity(&slot->input, &slot->input_capacity, (size_t)block->compressed_size) != 0 ||
+            ensure_capacity(&slot->output, &slot->output_capacity, (size_t)block->uncompressed_size + 1) != 0 ||
+            read_block(decoder->fd, block, slot->input) != 0)
+        {
+            result = -1;
+        }
+        else
+        {
+            result = decoder->format == ROOTFS_FORMAT_ZSTD
+                ? decode_zstd_block(
+                    slot->input, (size_t)block->compressed_size,
+                    slot->output, (size_t)block->uncompressed_size)
+                : decode_gzip_block(
+                    slot->input, (size_t)block->compressed_size,
+                    slot->output, (size_t)block->uncompressed_size);
+        }
+
+        // Publish the decoded block, or the failure, to the consumer.
+        pthread_mutex_lock(&decoder->mutex);
+        if (result != 0)
+        {
+            decoder->error = result;
+        }
+        else
+        {
+            slot->output_length = (size_t)block->uncompressed_size;
+            slot->output_position = 0;
+            slot->ready_block = block_index;
+        }
+        pthread_cond_broadcast(&decoder->changed);
+    }
+    pthread_mutex_unlock(&decoder->mutex);
+
+    return NULL;
+}
+
+int start_parallel_decoder(
+    ParallelDecoder *decoder, int fd, RootfsFormat format,
+    RootfsBlock *blocks, int block_count, int thread_count,
+    RootfsProgress *progress
+)
+{
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->fd = fd;
+    decoder->format = format;
+    decoder->blocks = blocks;
+    decoder->block_count = block_count;
+    decoder->progress = progress;
+
+    // Allocate the window of decode slots.
+    decoder->slot_count = thread_count * PARALLEL_SLOTS_PER_THREAD;
+    decoder->slots = calloc((size_t)decoder->slot_count, sizeof(ParallelSlot));
+    if (!decoder->slots)
+    {
+        free(blocks);
+        decoder->blocks = NULL;
+        return -1;
+    }
+    for (int i = 0; i < decoder->slot_count; i++)
+    {
+        decoder->slots[i].ready_block = -1;
+    }
+    pthread_mutex_init(&decoder->mutex, NULL);
+    pthread_cond_init(&decoder->changed, NULL);
+
+    // Start the worker threads.
+    for (int i = 0; i < thread_count; i++)
+    {
+        if (pthread_create(&decoder->threads[i], NULL, run_decoder_worker, decoder) != 0)
+        {
+            break;
+        }
+        decoder->thread_count++;
+    }
+    if (decoder->thread_count == 0)
+    {
+        stop_parallel_decoder(decoder);
+        return -1;
+    }
+
+    return 0;
+}
+
+long read_parallel_decoder(ParallelDecoder *decoder, void *buffer, size_t length)
+{
+    unsigned char *output = buffer;
+    size_t produced = 0;
+
+    while (produced < length && decoder->current_block < decoder->block_count)
+    {
+        int block_index = decoder->current_block;
+        ParallelSlot *slot = &decoder->slots[block_index % decoder->slot_count];
+
+        // Wait for the next block in archive order, ticking the UI meanwhile.
+        pthread_mutex_lock(&decoder->mutex);
+        while (slot->ready_block != block_index && decoder->error == 0)
+        {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += COMMAND_TICK_INTERVAL_MS * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L)
+            {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&decoder->changed, &decoder->mutex, &deadline);
+            pthread_mutex_unlock(&decoder->mutex);
+            invoke_command_tick();
+            pthread_mutex_lock(&decoder->mutex);
+        }
+        int is_ready = slot->ready_block == block_index;
+        int error = decoder->error;
+        pthread_mutex_unlock(&decoder->mutex);
+        if (!is_ready)
+        {
+            return error;
+        }
+
+        // Count and hash the compressed bytes once a block starts being
+        // consumed, which happens in archive order.
+        if (slot->output_position == 0)
+        {
+            decoder->progress->compressed_bytes += decoder->blocks[block_index].compressed_size;
+            if (decoder->digest)
+            {
+                update_digest(
+                    decoder->digest, slot->input,
+                    (size_t)decoder->blocks[block_index].compressed_size
+                );
+            }
+        }
+
+        // Copy as much of the block as the caller asked for.
+        size_t available = slot->output_length - slot->output_position;
+        size_t chunk = available < length - produced ? available : length - produced;
+        memcpy(output + produced, slot->output + slot->output_position, chunk);
+        slot->output_position += chunk;
+        produced += chunk;
+
+        // Release the slot to the workers once it is drained.
+        if (slot->output_position == slot->output_length)
+        {
+            pthread_mutex_lock(&decoder->mutex);
+            slot->ready_block = -1;
+            slot->output_position = 0;
+            decoder->current_block++;
+            pthread_cond_broadcast(&decoder->changed);
+            pthread_mutex_unlock(&decoder->mutex);
+        }
+    }
+
+    decoder->progress->uncompressed_bytes += produced;
+    return (long)produced;
+}
+
+void stop_parallel_decoder(ParallelDecoder *decoder)
+{
+    if (!decoder->slots)
+    {
+        return;
+    }
+
+    // Signal the workers to stop and wait for them to exit.
+    pthread_mutex_lock(&decoder->mutex);
+    decoder->stopping = 1;
+    pthread_cond_broadcast(&decoder->changed);
+    pthread_mutex_unlock(&decoder->mutex);
+    for (int i = 0; i < decoder->thread_count; i++)
+    {
+        pthread_join(decoder->threads[i], NULL);
+    }
+
+    // Release the slot buffers and the block index.
+    for (int i = 0; i < decoder->slot_count; i++)
+    {
+        free(decoder->slots[i].input);
+        free(decoder->slots[i].output);
+    }
+    free(decoder->slots);
+    decoder->slots = NULL;
+    free(decoder->blocks);
+    decoder->blocks = NULL;
+    pthread_mutex_destroy(&decoder->mutex);
+    pthread_cond_destroy(&decoder->changed);
+}
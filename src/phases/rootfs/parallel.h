@@ -0,0 +1,119 @@
+#pragma once
+#include "../../all.h"
+
+/** The maximum number of decompression threads. */
+#define PARALLEL_MAX_THREADS 16
+
+/** The number of decode slots allocated per decompression thread. */
+#define PARALLEL_SLOTS_PER_THREAD 2
+
+/** The largest uncompressed block the parallel decoder will buffer. */
+#define PARALLEL_MAX_BLOCK_BYTES (64ULL * 1024 * 1024)
+
+/** A type representing one independently compressed block of the archive. */
+typedef struct {
+    unsigned long long compressed_offset;
+    unsigned long long compressed_size;
+    unsigned long long uncompressed_size;
+} RootfsBlock;
+
+/** A type representing a buffer holding one block being decoded. */
+typedef struct {
+    unsigned char *input;
+    size_t input_capacity;
+    unsigned char *output;
+    size_t output_capacity;
+    size_t output_length;
+    size_t output_position;
+    int ready_block;
+} ParallelSlot;
+
+/** A type representing a pool of threads decoding blocks in parallel. */
+typedef struct ParallelDecoder {
+    int fd;
+    RootfsFormat format;
+    RootfsBlock *blocks;
+    int block_count;
+    ParallelSlot *slots;
+    int slot_count;
+    pthread_t threads[PARALLEL_MAX_THREADS];
+    int thread_count;
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+    int next_block;
+    int current_block;
+    int error;
+    int stopping;
+    DigestContext *digest;
+    RootfsProgress *progress;
+} ParallelDecoder;
+
+/**
+ * Loads the block index that accompanies a block-parallel archive.
+ *
+ * The index lives next to the archive with CONFIG_ROOTFS_INDEX_SUFFIX
+ * appended, and holds one line per block with its compressed offset,
+ * compressed size and uncompressed size. Each block is a complete gzip
+ * member or zstd frame, so blocks can be decoded independently.
+ *
+ * @param archive_path The path to the compressed archive.
+ * @param archive_size The size of the compressed archive in bytes.
+ * @param out_blocks Output: the allocated array of blocks.
+ * @param out_count Output: the number of blocks.
+ *
+ * @return - `0` - Indicates the index was loaded.
+ * @return - `-1` - Indicates no index exists.
+ * @return - `-2` - Indicates the index is malformed or does not match.
+ */
+int load_rootfs_block_index(
+    const char *archive_path, unsigned long long archive_size,
+    RootfsBlock **out_blocks, int *out_count
+);
+
+/**
+ * Calculates how many decompression threads to use.
+ *
+ * Starts from the number of online CPUs and lowers it so that all decode
+ * slots fit within a quarter of the system RAM.
+ *
+ * @param block_bytes The largest compressed plus uncompressed block size.
+ *
+ * @return The thread count, between 1 and PARALLEL_MAX_THREADS.
+ */
+int get_rootfs_thread_count(unsigned long long block_bytes);
+
+/**
+ * Starts decoding blocks on a pool of worker threads.
+ *
+ * @param decoder The decoder to initialize.
+ * @param fd The open archive file descriptor.
+ * @param format The compression format of the archive.
+ * @param blocks The block index of the archive, owned by the decoder.
+ * @param block_count The number of blocks.
+ * @param thread_count The number of worker threads to start.
+ * @param progress The progress counters to update while reading.
+ *
+ * @return - `0` - Indicates success.
+ * @return - `-1` - Indicates the decoder could not be started.
+ */
+int start_parallel_decoder(
+    ParallelDecoder *decoder, int fd, RootfsFormat format,
+    RootfsBlock *blocks, int block_count, int thread_count,
+    RootfsProgress *progress
+);
+
+/**
+ * Reads decoded bytes in archive order.
+ *
+ * @param decoder The decoder to read from.
+ * @param buffer The buffer to fill.
+ * @param length The number of bytes to read.
+ *
+ * @return - `>=0` - The number of bytes read (less than `length` at the end).
+ * @return - `-1` - Indicates a read error on the archive.
+ * @return - `-2` - Indicates corrupt compressed data.
+ */
+long read_parallel_decoder(ParallelDecoder *decoder, void *buffer, size_t length);
+
+/** Stops the worker threads and releases the decoder's buffers and index. */
+void stop_parallel_decoder(ParallelDecoder *decoder);
@@ -5,30 +5,225 @@
 
 #include "../../all.h"
 
-int extract_rootfs(void)
+/** The byte-level progress of the current or most recent extraction. */
+static RootfsProgress rootfs_progress;
+
+const RootfsProgress *get_rootfs_progress(void)
+{
+    return &rootfs_progress;
+}
+
+static void start_rootfs_progress(void)
+{
+    // Record the start before announcing the progress to the UI thread.
+    clock_gettime(CLOCK_MONOTONIC, &rootfs_progress.start_time);
+    atomic_store_explicit(&rootfs_progress.active, 1, memory_order_release);
+}
+
+static void stop_rootfs_progress(void)
+{
+    atomic_store_explicit(&rootfs_progress.active, 0, memory_order_release);
+}
+
+static const char *find_rootfs_archive(void)
+{
+    // Prefer the zstd archive, which is smaller and faster to decompress.
+    if (access(CONFIG_ROOTFS_ZSTD_TARBALL_PATH, F_OK) == 0)
+    {
+        return CONFIG_ROOTFS_ZSTD_TARBALL_PATH;
+    }
+    return CONFIG_ROOTFS_TARBALL_PATH;
+}
+
+unsigned long long get_rootfs_size(void)
+{
+    // An image writes only its allocated blocks. The partitions may not be
+    // chosen yet, so any shipped image is assumed to be used.
+    struct stat file_stat;
+    if (get_store()->rootfs_image)
+    {
+        return stat(CONFIG_ROOTFS_IMAGE_PATH, &file_stat) == 0
+            ? (unsigned long long)file_stat.st_blocks * 512 : 0;
+    }
+
+    // Sum the blocks of the index, when the archive has one.
+    const char *archive_path = find_rootfs_archive();
+    if (stat(archive_path, &file_stat) != 0)
+    {
+        return 0;
+    }
+    RootfsBlock *blocks = NULL;
+    int block_count = 0;
+    if (load_rootfs_block_index(archive_path, (unsigned long long)file_stat.st_size, &blocks, &block_count) == 0)
+    {
+        unsigned long long size = 0;
+        for (int i = 0; i < block_count; i++)
+        {
+            size += blocks[i].uncompressed_size;
+        }
+        free(blocks);
+        return size;
+    }
+
+    // Otherwise take the end of the last file in the manifest.
+    RootfsManifest manifest;
+    if (load_rootfs_manifest(archive_path, &manifest) != 0)
+    {
+        return 0;
+    }
+    unsigned long long size = 0;
+    for (int i = 0; i < manifest.count; i++)
+    {
+        unsigned long long end = manifest.entries[i].offset + manifest.entries[i].size;
+        if (end > size)
+        {
+            size = end;
+        }
+    }
+    free_rootfs_manifest(&manifest);
+    return size;
+}
+
+int get_rootfs_entry_count(void)
+{
+    RootfsManifest manifest;
+    if (load_rootfs_manifest(find_rootfs_archive(), &manifest) != 0)
+    {
+        return 0;
+    }
+    int count = manifest.count;
+    free_rootfs_manifest(&manifest);
+    return count;
+}
+
+static int grow_root_filesystem(const char *root_device)
+{
+    // Check the filesystem first, as resize2fs requires it. Exit code 1
+    // only means that e2fsck corrected something.
+    const char *const check_argv[] = { "e2fsck", "-fy", root_device, NULL };
+    int result = run_install_argv(check_argv, &COMMAND_TO_INSTALL_LOG);
+    if (result != 0 && result != 1)
+    {
+        return -2;
+    }
+
+    // Grow the filesystem to fill the partition.
+    const char *const resize_argv[] = { "resize2fs", root_device, NULL };
+    return run_install_argv(resize_argv, &COMMAND_TO_INSTALL_LOG) == 0 ? 0 : -3;
+}
+
+static int deploy_rootfs_image(void)
 {
     Store *store = get_store();
 
-    // In non-dry-run mode, ensure the rootfs archive exists.
-    if (!store->dry_run)
+    // Get root partition device path.
+    char root_device[128];
+    int root_index = find_root_partition_index(store);
+    get_partition_device(store->disk, root_index + 1, root_device, sizeof(root_device));
+
+    // Write the used blocks of the image onto the root partition.
+    if (store->dry_run)
     {
-        write_install_log("Checking for rootfs archive at %s", CONFIG_ROOTFS_TARBALL_PATH);
-        if (access(CONFIG_ROOTFS_TARBALL_PATH, F_OK) != 0)
+        write_dry_run_log("write-image " CONFIG_ROOTFS_IMAGE_PATH " %s", root_device);
+    }
+    else
+    {
+        write_install_log("Writing rootfs image " CONFIG_ROOTFS_IMAGE_PATH " to %s", root_device);
+        start_rootfs_progress();
+        int result = write_rootfs_image(CONFIG_ROOTFS_IMAGE_PATH, root_device, &rootfs_progress);
+        stop_rootfs_progress();
+        if (result != 0)
         {
-            write_install_log("Rootfs archive not found");
-            return -1;
+            write_install_log("Rootfs image write failed with error code: %d", result);
+            return -3;
         }
     }
 
-    // Extract the rootfs archive to /mnt.
+    // Grow the filesystem from the image size to the partition size.
+    write_install_log("Growing root filesystem on %s", root_device);
+    if (grow_root_filesystem(root_device) != 0)
+    {
+        write_install_log("Failed to grow root filesystem");
+        return -4;
+    }
+
+    // Mount the partitions now that the root filesystem exists.
+    if (mount_partitions() != 0)
+    {
+        return -5;
+    }
+
+    write_install_log("Rootfs image deployment complete");
+    return 0;
+}
+
+int extract_rootfs(void)
+{
+    Store *store = get_store();
+    const char *archive_path = find_rootfs_archive();
+
+    // Reset the progress counters for this extraction, while the UI thread
+    // ignores them.
+    stop_rootfs_progress();
+    atomic_store(&rootfs_progress.compressed_bytes, 0);
+    atomic_store(&rootfs_progress.compressed_total, 0);
+    atomic_store(&rootfs_progress.uncompressed_bytes, 0);
+
+    // Deploy a block image instead of extracting files, when one is shipped.
+    if (use_rootfs_image())
+    {
+        return deploy_rootfs_image();
+    }
+
+    // In dry-run mode, record the extraction instead of performing it.
+    if (store->dry_run)
+    {
+        write_dry_run_log("extract %s -C " CONFIG_TARGET_MOUNT_POINT, archive_path);
+        return 0;
+    }
+
+    // Ensure the rootfs archive exists. Its compression format is detected
+    // from its contents, not its name.
+    write_install_log("Checking for rootfs archive at %s", archive_path);
+    if (access(archive_path, F_OK) != 0)
+    {
+        write_install_log("Rootfs archive not found");
+        return -1;
+    }
+
+    // Extract the rootfs archive to /mnt in-process.
     // Note: Root partition is already mounted by create_partitions().
-    write_install_log("Extracting rootfs to /mnt");
-    if (run_install_command("tar -xzf " CONFIG_ROOTFS_TARBALL_PATH " -C /mnt >>" CONFIG_INSTALL_LOG_PATH " 2>&1") != 0)
+    write_install_log("Extracting rootfs to " CONFIG_TARGET_MOUNT_POINT);
+    start_rootfs_progress();
+    int result = extract_rootfs_archive(
+        archive_path, CONFIG_TARGET_MOUNT_POINT, 0,
+        get_writer_thread_count(store->disk), store->write_backend, &rootfs_progress
+    );
+    stop_rootfs_progress();
+    if (result == -5)
+    {
+        write_install_log("Rootfs archive failed integrity verification");
+        return -6;
+    }
+    if (result != 0)
     {
-        write_install_log("Rootfs extraction failed");
+        write_install_log("Rootfs extraction failed with error code: %d", result);
         return -2;
     }
 
+    // Log the amount of data processed and the achieved throughput.
+    struct timespec end_time;
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    double elapsed_seconds =
+        (double)(end_time.tv_sec - rootfs_progress.start_time.tv_sec) +
+        (double)(end_time.tv_nsec - rootfs_progress.start_time.tv_nsec) / 1e9;
+    write_install_log(
+        "Extracted %llu bytes from %llu compressed bytes in %.1f s (%.1f MB/s)",
+        rootfs_progress.uncompressed_bytes, rootfs_progress.compressed_bytes,
+        elapsed_seconds,
+        elapsed_seconds > 0 ? rootfs_progress.uncompressed_bytes / 1e6 / elapsed_seconds : 0.0
+    );
+
     write_install_log("Rootfs extraction complete");
     return 0;
 }
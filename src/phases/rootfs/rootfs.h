@@ -4,9 +4,49 @@
 /**
  * Extracts the root filesystem archive to the target mount point.
  *
+ * In image mode, the ext4 image is instead written onto the root partition,
+ * grown to the partition size, and the partitions are then mounted.
+ *
+ * When a SHA-256 digest is shipped next to the archive, the archive is
+ * verified in the same pass that extracts it.
+ *
  * @return - `0` - on success.
  * @return - `-1` - if the rootfs archive does not exist.
  * @return - `-2` - if extraction fails.
- * @return - `-3` - if chroot mount setup fails.
+ * @return - `-3` - if writing the rootfs image fails.
+ * @return - `-4` - if growing the root filesystem fails.
+ * @return - `-5` - if mounting the partitions fails.
+ * @return - `-6` - if the rootfs archive does not match its shipped digest.
  */
 int extract_rootfs(void);
+
+/**
+ * Retrieves the byte-level progress of the rootfs extraction.
+ *
+ * Lets the progress screen show completion and throughput while the
+ * extraction runs in-process.
+ *
+ * @return Pointer to the progress counters of the current or last extraction.
+ */
+const RootfsProgress *get_rootfs_progress(void);
+
+/**
+ * Gets the uncompressed size of the root filesystem, without reading the
+ * archive itself.
+ *
+ * The size is taken from the allocated blocks of the image when one is
+ * shipped, and otherwise from the block index or the manifest of the archive.
+ *
+ * @return - `>0` - The size in bytes.
+ * @return - `0` - The size is unavailable.
+ */
+unsigned long long get_rootfs_size(void);
+
+/**
+ * Gets the number of files and directories in the root filesystem, from the
+ * manifest shipped next to the archive.
+ *
+ * @return - `>0` - The number of entries.
+ * @return - `0` - The number is unavailable.
+ */
+int get_rootfs_entry_count(void);
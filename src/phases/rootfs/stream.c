@@ -0,0 +1,411 @@
+/**
+ * This code is responsible for reading the compressed rootfs archive in
+ * large blocks and decompressing it in-process, while keeping byte counters
+ * that the progress screen uses to show throughput and completion.
+ */
+
+#include "../../all.h"
+
+static int open_parallel_stream(
+    RootfsStream *stream, const char *path, int thread_count
+)
+{
+    // Load the block index, if the archive has one.
+    RootfsBlock *blocks = NULL;
+    int block_count = 0;
+    int result = load_rootfs_block_index(
+        path, stream->progress->compressed_total, &blocks, &block_count
+    );
+    if (result == -2)
+    {
+        write_install_log("Ignoring invalid block index for %s", path);
+    }
+    if (result != 0)
+    {
+        return -1;
+    }
+
+    // Derive the thread count from the largest block when not specified.
+    if (thread_count <= 0)
+    {
+        unsigned long long block_bytes = 0;
+        for (int i = 0; i < block_count; i++)
+        {
+            unsigned long long size = blocks[i].compressed_size + blocks[i].uncompressed_size;
+            if (size > block_bytes)
+            {
+                block_bytes = size;
+            }
+        }
+        thread_count = get_rootfs_thread_count(block_bytes);
+    }
+    if (thread_count > PARALLEL_MAX_THREADS)
+    {
+        thread_count = PARALLEL_MAX_THREADS;
+    }
+
+    // Start the decoder, which takes ownership of the block index.
+    stream->decoder = malloc(sizeof(ParallelDecoder));
+    if (!stream->decoder)
+    {
+        free(blocks);
+        return -1;
+    }
+    if (start_parallel_decoder(stream->decoder, stream->fd, stream->format,
+            blocks, block_count, thread_count, stream->progress) != 0)
+    {
+        free(stream->decoder);
+        stream->decoder = NULL;
+        return -1;
+    }
+    stream->decoder->digest = stream->digest;
+
+    write_install_log(
+        "Decompressing %d blocks on %d threads",
+        block_count, stream->decoder->thread_count
+    );
+    return 0;
+}
+
+RootfsFormat detect_rootfs_format(int fd)
+{
+    // Read the leading magic bytes without moving the file offset.
+    unsigned char magic[4] = {0};
+    ssize_t count = pread(fd, magic, sizeof(magic), 0);
+
+    // Match the magic against the supported formats.
+    if (count >= 2 && memcmp(magic, ROOTFS_GZIP_MAGIC, 2) == 0)
+    {
+        return ROOTFS_FORMAT_GZIP;
+    }
+    if (count >= 4 && memcmp(magic, ROOTFS_ZSTD_MAGIC, 4) == 0)
+    {
+        return ROOTFS_FORMAT_ZSTD;
+    }
+    return ROOTFS_FORMAT_UNKNOWN;
+}
+
+int open_rootfs_stream(
+    RootfsStream *stream, const char *path, int thread_count,
+    RootfsProgress *progress
+)
+{
+    memset(stream, 0, sizeof(*stream));
+    stream->progress = progress;
+
+    // Open the archive and hint the kernel that it is read sequentially.
+    stream->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (stream->fd < 0)
+    {
+        return -1;
+    }
+    posix_fadvise(stream->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    // Record the compressed size so completion can be expressed in percent.
+    struct stat archive_stat;
+    if (fstat(stream->fd, &archive_stat) == 0)
+    {
+        progress->compressed_total = (unsigned long long)archive_stat.st_size;
+    }
+
+    // Hash the archive as it is read when a digest is shipped with it.
+    int digest_result = load_rootfs_digest(path, stream->expected_digest);
+    if (digest_result == 0)
+    {
+        stream->digest = malloc(sizeof(DigestContext));
+        if (!stream->digest)
+        {
+            close(stream->fd);
+            stream->fd = -1;
+            return -2;
+        }
+        start_digest(stream->digest);
+    }
+    else if (digest_result == -2)
+    {
+        write_install_log("Invalid digest for %s", path);
+        stream->invalid_digest = 1;
+    }
+
+    // Detect the compression format; unknown data is reported as corrupt
+    // on the first read.
+    stream->format = detect_rootfs_format(stream->fd);
+    if (stream->format == ROOTFS_FORMAT_UNKNOWN)
+    {
+        return 0;
+    }
+    write_install_log(
+        "Detected %s compressed rootfs archive",
+        stream->format == ROOTFS_FORMAT_ZSTD ? "zstd" : "gzip"
+    );
+
+    // Prefer parallel decompression when the archive is block-indexed.
+    if (open_parallel_stream(stream, path, thread_count) == 0)
+    {
+        return 0;
+    }
+
+    // Allocate the compressed input block.
+    stream->input = malloc(ROOTFS_STREAM_BLOCK_BYTES);
+    if (!stream->input)
+    {
+        free(stream->digest);
+        stream->digest = NULL;
+        close(stream->fd);
+        stream->fd = -1;
+        return -2;
+    }
+
+    // Initialize the decompressor for the detected format. For gzip, zlib
+    // is told to expect a gzip header (15 + 32).
+    int initialized;
+    if (stream->format == ROOTFS_FORMAT_ZSTD)
+    {
+        stream->zstd = ZSTD_createDStream();
+        initialized = stream->zstd && !ZSTD_isError(ZSTD_initDStream(stream->zstd));
+    }
+    else
+    {
+        initialized = inflateInit2(&stream->zlib, 15 + 32) == Z_OK;
+    }
+    if (!initialized)
+    {
+        ZSTD_freeDStream(stream->zstd);
+        stream->zstd = NULL;
+        free(stream->input);
+        stream->input = NULL;
+        free(stream->digest);
+        stream->digest = NULL;
+        close(stream->fd);
+        stream->fd = -1;
+        return -2;
+    }
+
+    return 0;
+}
+
+static size_t get_pending_input(const RootfsStream *stream)
+{
+    if (stream->format == ROOTFS_FORMAT_ZSTD)
+    {
+        return stream->zstd_input.size - stream->zstd_input.pos;
+    }
+    return stream->zlib.avail_in;
+}
+
+static int fill_input_block(RootfsStream *stream)
+{
+    // Read the next compressed block, retrying on interrupts.
+    ssize_t count;
+    do
+    {
+        count = read(stream->fd, stream->input, ROOTFS_STREAM_BLOCK_BYTES);
+    } while (count < 0 && errno == EINTR);
+    if (count < 0)
+    {
+        return -1;
+    }
+
+    // Mark end of file or hand the block to the decompressor.
+    if (count == 0)
+    {
+        stream->end_of_file = 1;
+        return 0;
+    }
+    if (stream->format == ROOTFS_FORMAT_ZSTD)
+    {
+        stream->zstd_input.src = stream->input;
+        stream->zstd_input.size = (size_t)count;
+        stream->zstd_input.pos = 0;
+    }
+    else
+    {
+        stream->zlib.next_in = stream->input;
+        stream->zlib.avail_in = (uInt)count;
+    }
+    stream->progress->compressed_bytes += (unsigned long long)count;
+    if (stream->digest)
+    {
+        update_digest(stream->digest, stream->input, (size_t)count);
+    }
+
+    return 0;
+}
+
+static int decompress_gzip_input(RootfsStream *stream, ZSTD_outBuffer *output)
+{
+    // Start a new member when gzip members are concatenated.
+    if (stream->member_complete)
+    {
+        if (inflateReset(&stream->zlib) != Z_OK)
+        {
+            return -2;
+        }
+        stream->member_complete = 0;
+    }
+
+    // Decompress as much as fits in the remaining output space.
+    stream->zlib.next_out = (unsigned char *)output->dst + output->pos;
+    stream->zlib.avail_out = (uInt)(output->size - output->pos);
+    int status = inflate(&stream->zlib, Z_NO_FLUSH);
+    output->pos = output->size - stream->zlib.avail_out;
+    if (status == Z_STREAM_END)
+    {
+        stream->member_complete = 1;
+    }
+    else if (status != Z_OK && status != Z_BUF_ERROR)
+    {
+        return -2;
+    }
+    return 0;
+}
+
+static int decompress_zstd_input(RootfsStream *stream, ZSTD_outBuffer *output)
+{
+    // Decompress as much as fits; zstd moves on to the next frame itself,
+    // and reports 0 once the current frame is complete and flushed.
+    size_t status = ZSTD_decompressStream(stream->zstd, output, &stream->zstd_input);
+    if (ZSTD_isError(status))
+    {
+        return -2;
+    }
+    stream->member_complete = status == 0;
+    return 0;
+}
+
+long read_rootfs_stream(RootfsStream *stream, void *buffer, size_t length)
+{
+    // Delegate to the parallel decoder for block-indexed archives.
+    if (stream->decoder)
+    {
+        return read_parallel_decoder(stream->decoder, buffer, length);
+    }
+
+    // Reject data in a format that could not be recognized.
+    if (stream->format == ROOTFS_FORMAT_UNKNOWN)
+    {
+        return -2;
+    }
+
+    // Decompress directly into the caller's buffer to avoid a copy.
+    ZSTD_outBuffer output = { buffer, length, 0 };
+    while (output.pos < output.size)
+    {
+        // Refill the input block once the decompressor has consumed it.
+        if (get_pending_input(stream) == 0 && !stream->end_of_file)
+        {
+            if (fill_input_block(stream) != 0)
+            {
+                return -1;
+            }
+        }
+
+        // Stop at end of file, which is only valid after a complete member.
+        if (get_pending_input(stream) == 0 && stream->end_of_file)
+        {
+            if (!stream->member_complete)
+            {
+                return -2;
+            }
+            break;
+        }
+
+        // Decompress with the decoder for the detected format.
+        int result = stream->format == ROOTFS_FORMAT_ZSTD
+            ? decompress_zstd_input(stream, &output)
+            : decompress_gzip_input(stream, &output);
+        if (result != 0)
+        {
+            return result;
+        }
+    }
+
+    // Account for the bytes produced in this call.
+    stream->progress->uncompressed_bytes += output.pos;
+
+    return (long)output.pos;
+}
+
+int verify_rootfs_stream(RootfsStream *stream)
+{
+    if (stream->invalid_digest)
+    {
+        return -2;
+    }
+    if (!stream->digest)
+    {
+        return 1;
+    }
+
+    // Hash the rest of the archive, continuing where reading stopped.
+    unsigned char *buffer = malloc(ROOTFS_STREAM_BLOCK_BYTES);
+    if (!buffer)
+    {
+        return -1;
+    }
+    while (1)
+    {
+        ssize_t count = pread(
+            stream->fd, buffer, ROOTFS_STREAM_BLOCK_BYTES, (off_t)stream->digest->length
+        );
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (count < 0)
+        {
+            free(buffer);
+            return -1;
+        }
+        if (count == 0)
+        {
+            break;
+        }
+        update_digest(stream->digest, buffer, (size_t)count);
+        stream->progress->compressed_bytes += (unsigned long long)count;
+    }
+    free(buffer);
+
+    // Compare the digest of the whole archive with the shipped one.
+    unsigned char digest[DIGEST_BYTES];
+    finish_digest(stream->digest, digest);
+    return memcmp(digest, stream->expected_digest, DIGEST_BYTES) == 0 ? 0 : -2;
+}
+
+void close_rootfs_stream(RootfsStream *stream)
+{
+    // Stop the parallel decoder, if one is running.
+    if (stream->decoder)
+    {
+        stop_parallel_decoder(stream->decoder);
+        free(stream->decoder);
+        stream->decoder = NULL;
+    }
+
+    // Release the decompressor state and the input block.
+    if (stream->input)
+    {
+        if (stream->format == ROOTFS_FORMAT_ZSTD)
+        {
+            ZSTD_freeDStream(stream->zstd);
+            stream->zstd = NULL;
+        }
+        else
+        {
+            inflateEnd(&stream->zlib);
+        }
+        free(stream->input);
+        stream->input = NULL;
+    }
+
+    // Release the digest state.
+    free(stream->digest);
+    stream->digest = NULL;
+
+    // Close the archive file.
+    if (stream->fd >= 0)
+    {
+        close(stream->fd);
+        stream->fd = -1;
+    }
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include "../../all.h"
+
+/** The size of each block read from the compressed rootfs archive. */
+#define ROOTFS_STREAM_BLOCK_BYTES (1024 * 1024)
+
+/** The magic bytes that start a gzip member. */
+#define ROOTFS_GZIP_MAGIC "\x1f\x8b"
+
+/** The magic bytes that start a zstd frame. */
+#define ROOTFS_ZSTD_MAGIC "\x28\xb5\x2f\xfd"
+
+/** A type representing the compression format of a rootfs archive. */
+typedef enum {
+    ROOTFS_FORMAT_UNKNOWN,
+    ROOTFS_FORMAT_GZIP,
+    ROOTFS_FORMAT_ZSTD
+} RootfsFormat;
+
+/**
+ * A type representing the byte-level progress of a rootfs extraction.
+ *
+ * The counters are updated by the installing thread and read by the UI
+ * thread. The start time is written before active is set with release
+ * ordering, so a reader that sees active with acquire ordering also sees it.
+ */
+typedef struct {
+    _Atomic unsigned long long compressed_bytes;
+    _Atomic unsigned long long compressed_total;
+    _Atomic unsigned long long uncompressed_bytes;
+    struct timespec start_time;
+    _Atomic int active;
+} RootfsProgress;
+
+/** A type representing a decompressing reader over the rootfs archive. */
+typedef struct {
+    int fd;
+    RootfsFormat format;
+    z_stream zlib;
+    ZSTD_DStream *zstd;
+    ZSTD_inBuffer zstd_input;
+    unsigned char *input;
+    int end_of_file;
+    int member_complete;
+    struct ParallelDecoder *decoder;
+    DigestContext *digest;
+    unsigned char expected_digest[DIGEST_BYTES];
+    int invalid_digest;
+    RootfsProgress *progress;
+} RootfsStream;
+
+/**
+ * Detects the compression format of a rootfs archive from its magic bytes.
+ *
+ * @param fd The open archive file descriptor.
+ *
+ * @return The detected format, or ROOTFS_FORMAT_UNKNOWN.
+ */
+RootfsFormat detect_rootfs_format(int fd);
+
+/**
+ * Opens a compressed rootfs archive for streaming decompression.
+ *
+ * The archive may be gzip or zstd compressed; the format is detected from
+ * its magic bytes rather than its file name. When a block index
+ * accompanies the archive, blocks are decompressed on a pool of worker
+ * threads. Otherwise the archive is read sequentially in
+ * ROOTFS_STREAM_BLOCK_BYTES blocks. Either way, the byte counters in
+ * `progress` are updated as data is consumed and produced, and when a
+ * digest is shipped with the archive, the compressed bytes are hashed as
+ * they are read.
+ *
+ * @param stream The stream to initialize.
+ * @param path The path to the compressed archive.
+ * @param thread_count The number of decompression threads, or 0 to derive
+ *                     it from the CPU count and system RAM.
+ * @param progress The progress counters to update while reading.
+ *
+ * @return - `0` - Indicates success.
+ * @return - `-1` - Indicates the archive could not be opened.
+ * @return - `-2` - Indicates the decompressor could not be initialized.
+ */
+int open_rootfs_stream(
+    RootfsStream *stream, const char *path, int thread_count,
+    RootfsProgress *progress
+);
+
+/**
+ * Reads decompressed bytes from a rootfs stream.
+ *
+ * Fills the buffer completely unless the end of the archive is reached.
+ * Concatenated gzip members and zstd frames are decompressed as one
+ * continuous stream.
+ *
+ * @param stream The stream to read from.
+ * @param buffer The buffer to fill with decompressed bytes.
+ * @param length The number of bytes to read.
+ *
+ * @return - `>=0` - The number of bytes read (less than `length` at the end).
+ * @return - `-1` - Indicates a read error on the archive.
+ * @return - `-2` - Indicates corrupt or truncated compressed data.
+ */
+long read_rootfs_stream(RootfsStream *stream, void *buffer, size_t length);
+
+/**
+ * Verifies the archive against the digest shipped next to it.
+ *
+ * Hashes whatever compressed bytes extraction did not need to read, such as
+ * the padding after the end-of-archive marker, then compares the digest of
+ * the whole archive. Call this once extraction has finished.
+ *
+ * @param stream The stream to verify.
+ *
+ * @return - `0` - Indicates the archive matches its digest.
+ * @return - `1` - Indicates no digest is shipped with the archive.
+ * @return - `-1` - Indicates a read error on the archive.
+ * @return - `-2` - Indicates a mismatch or a malformed digest.
+ */
+int verify_rootfs_stream(RootfsStream *stream);
+
+/** Closes a rootfs stream and releases its buffers. */
+void close_rootfs_stream(RootfsStream *stream);
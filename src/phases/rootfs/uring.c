@@ -0,0 +1,442 @@
+/**
+ * This code is responsible for writing extracted files through io_uring.
+ * Each file becomes a linked open, write and close submission on a direct
+ * descriptor, so that a batch of small files costs one system call instead
+ * of three per file.
+ */
+
+#include "../../all.h"
+
+static int enter_ring(int ring_fd, unsigned int to_submit, unsigned int min_complete)
+{
+    // Retry when interrupted, since submissions may still be pending.
+    int result;
+    do
+    {
+        result = (int)syscall(
+            __NR_io_uring_enter, ring_fd, to_submit, min_complete,
+            min_complete > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0
+        );
+    } while (result < 0 && errno == EINTR);
+    return result;
+}
+
+static int map_ring(UringWriter *writer, const struct io_uring_params *params)
+{
+    // Size both rings; newer kernels map them with a single mmap().
+    writer->sq_entries = params->sq_entries;
+    writer->sq_ring_bytes = params->sq_off.array + params->sq_entries * sizeof(unsigned int);
+    writer->cq_ring_bytes = params->cq_off.cqes + params->cq_entries * sizeof(struct io_uring_cqe);
+    int single_mmap = (params->features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap && writer->cq_ring_bytes > writer->sq_ring_bytes)
+    {
+        writer->sq_ring_bytes = writer->cq_ring_bytes;
+    }
+
+    // Map the submission ring, the completion ring and the submission entries.
+    writer->sq_ring = mmap(
+        NULL, writer->sq_ring_bytes, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, writer->ring_fd, IORING_OFF_SQ_RING
+    );
+    if (writer->sq_ring == MAP_FAILED)
+    {
+        writer->sq_ring = NULL;
+        return -1;
+    }
+    if (single_mmap)
+    {
+        writer->cq_ring = writer->sq_ring;
+    }
+    else
+    {
+        writer->cq_ring = mmap(
+            NULL, writer->cq_ring_bytes, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, writer->ring_fd, IORING_OFF_CQ_RING
+        );
+        if (writer->cq_ring == MAP_FAILED)
+        {
+            writer->cq_ring = NULL;
+            return -1;
+        }
+    }
+    writer->sqes = mmap(
+        NULL, params->sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, writer->ring_fd, IORING_OFF_SQES
+    );
+    if (writer->sqes == MAP_FAILED)
+    {
+        writer->sqes = NULL;
+        return -1;
+    }
+
+    // Locate the ring fields shared with the kernel.
+    unsigned char *sq_ring = writer->sq_ring;
+    unsigned char *cq_ring = writer->cq_ring;
+    writer->sq_head = (unsigned int *)(sq_ring + params->sq_off.head);
+    writer->sq_tail = (unsigned int *)(sq_ring + params->sq_off.tail);
+    writer->sq_mask = (unsigned int *)(sq_ring + params->sq_off.ring_mask);
+    writer->sq_array = (unsigned int *)(sq_ring + params->sq_off.array);
+    writer->cq_head = (unsigned int *)(cq_ring + params->cq_off.head);
+    writer->cq_tail = (unsigned int *)(cq_ring + params->cq_off.tail);
+    writer->cq_mask = (unsigned int *)(cq_ring + params->cq_off.ring_mask);
+    writer->cqes = (struct io_uring_cqe *)(cq_ring + params->cq_off.cqes);
+
+    return 0;
+}
+
+static struct io_uring_sqe *get_submission(UringWriter *writer)
+{
+    // Claim the next free entry; it becomes visible to the kernel once the
+    // tail is published.
+    unsigned int tail = *writer->sq_tail + writer->pending_submissions;
+    unsigned int index = tail & *writer->sq_mask;
+    struct io_uring_sqe *sqe = &writer->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    writer->sq_array[index] = index;
+    writer->pending_submissions++;
+    return sqe;
+}
+
+static int submit_pending(UringWriter *writer, unsigned int min_complete)
+{
+    // Publish the new entries, then hand them to the kernel.
+    unsigned int count = writer->pending_submissions;
+    __atomic_store_n(writer->sq_tail, *writer->sq_tail + count, __ATOMIC_RELEASE);
+    writer->pending_submissions = 0;
+    int result = enter_ring(writer->ring_fd, count, min_complete);
+    return result < 0 ? -1 : 0;
+}
+
+static void queue_file_submissions(UringWriter *writer, int slot_index)
+{
+    UringSlot *slot = &writer->slots[slot_index];
+    unsigned long long user_data = (unsigned long long)slot_index << 2;
+
+    // Open the file into the slot's direct descriptor, which is never
+    // inherited by child processes (and rejects O_CLOEXEC).
+    struct io_uring_sqe *sqe = get_submission(writer);
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->flags = IOSQE_IO_LINK;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (unsigned long long)(uintptr_t)slot->path;
+    sqe->len = slot->job.mode & 07777;
+    sqe->open_flags = O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW;
+    sqe->file_index = (unsigned int)slot_index + 1;
+    sqe->user_data = user_data;
+
+    // Write the contents from the slot's registered buffer.
+    sqe = get_submission(writer);
+    sqe->opcode = IORING_OP_WRITE_FIXED;
+    sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_LINK;
+    sqe->fd = slot_index;
+    sqe->addr = (unsigned long long)(uintptr_t)slot->job.data;
+    sqe->len = (unsigned int)slot->job.size;
+    sqe->buf_index = (unsigned short)slot_index;
+    sqe->user_data = user_data | 1;
+
+    // Close the direct descriptor, freeing the slot for the next file.
+    sqe = get_submission(writer);
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->file_index = (unsigned int)slot_index + 1;
+    sqe->user_data = user_data | 2;
+
+    slot->remaining = 3;
+    slot->failed = 0;
+}
+
+static void apply_slot_metadata(UringWriter *writer, UringSlot *slot)
+{
+    const WriterJob *job = &slot->job;
+
+    // Restore ownership first, since chown clears setuid and setgid bits.
+    if (writer->restore_ownership &&
+        fchownat(AT_FDCWD, slot->path, job->uid, job->gid, AT_SYMLINK_NOFOLLOW) != 0)
+    {
+        writer->metadata_errors++;
+    }
+
+    // Restore permissions only when the umask or chown changed them, since
+    // the file was created with its final mode.
+    int mode_changed = (job->mode & 07777 & writer->umask) != 0 ||
+        (writer->restore_ownership && (job->mode & 06000) != 0);
+    if (mode_changed && chmod(slot->path, job->mode & 07777) != 0)
+    {
+        writer->metadata_errors++;
+    }
+
+    // Restore the modification time.
+    struct timespec times[2] = {
+        { .tv_sec = 0, .tv_nsec = UTIME_NOW },
+        { .tv_sec = job->mtime, .tv_nsec = 0 }
+    };
+    if (utimensat(AT_FDCWD, slot->path, times, AT_SYMLINK_NOFOLLOW) != 0)
+    {
+        writer->metadata_errors++;
+    }
+}
+
+static void finish_slot(UringWriter *writer, UringSlot *slot)
+{
+    // Retry failed files with plain system calls, which create missing
+    // parents, replace existing entries and report real errors.
+    if (slot->failed)
+    {
+        if (writer->error == 0 &&
+            write_job_file(&slot->job, writer->restore_ownership, &writer->metadata_errors) != 0)
+        {
+            writer->error = -4;
+        }
+    }
+    else
+    {
+        apply_slot_metadata(writer, slot);
+    }
+
+    slot->busy = 0;
+    writer->in_flight--;
+}
+
+static void reap_completions(UringWriter *writer)
+{
+    unsigned int head = *writer->cq_head;
+    unsigned int tail = __atomic_load_n(writer->cq_tail, __ATOMIC_ACQUIRE);
+
+    // Record the outcome of each step, finishing files whose chain is done.
+    while (head != tail)
+    {
+        const struct io_uring_cqe *cqe = &writer->cqes[head & *writer->cq_mask];
+        UringSlot *slot = &writer->slots[cqe->user_data >> 2];
+        int is_write = (cqe->user_data & 3) == 1;
+        if (cqe->res < 0 || (is_write && (size_t)cqe->res != slot->job.size))
+        {
+            slot->failed = 1;
+        }
+        head++;
+        if (--slot->remaining == 0)
+        {
+            finish_slot(writer, slot);
+        }
+    }
+
+    __atomic_store_n(writer->cq_head, head, __ATOMIC_RELEASE);
+}
+
+static int wait_completions(UringWriter *writer)
+{
+    // Submit anything queued and wait for at least one step to complete.
+    if (submit_pending(writer, 1) != 0)
+    {
+        return -1;
+    }
+    reap_completions(writer);
+    invoke_command_tick();
+    return 0;
+}
+
+static int probe_direct_descriptors(UringWriter *writer)
+{
+    // Open and close the root directory through a direct descriptor, which
+    // requires a kernel that supports installing files into fixed slots.
+    struct io_uring_sqe *sqe = get_submission(writer);
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->flags = IOSQE_IO_LINK;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (unsigned long long)(uintptr_t)"/";
+    sqe->open_flags = O_RDONLY | O_DIRECTORY;
+    sqe->file_index = 1;
+    sqe = get_submission(writer);
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->file_index = 1;
+    if (submit_pending(writer, 2) != 0)
+    {
+        return -1;
+    }
+
+    // Both steps must succeed.
+    int result = 0;
+    unsigned int head = *writer->cq_head;
+    unsigned int tail = __atomic_load_n(writer->cq_tail, __ATOMIC_ACQUIRE);
+    if (tail - head != 2)
+    {
+        result = -1;
+    }
+    while (head != tail)
+    {
+        if (writer->cqes[head & *writer->cq_mask].res < 0)
+        {
+            result = -1;
+        }
+        head++;
+    }
+    __atomic_store_n(writer->cq_head, head, __ATOMIC_RELEASE);
+
+    return result;
+}
+
+static int register_resources(UringWriter *writer)
+{
+    // Register one buffer per slot so writes skip page pinning per call.
+    struct iovec buffers[URING_QUEUE_DEPTH];
+    for (int i = 0; i < URING_QUEUE_DEPTH; i++)
+    {
+        buffers[i].iov_base = writer->buffers + (size_t)i * URING_SLOT_BYTES;
+        buffers[i].iov_len = URING_SLOT_BYTES;
+    }
+    if (syscall(__NR_io_uring_register, writer->ring_fd, IORING_REGISTER_BUFFERS,
+            buffers, URING_QUEUE_DEPTH) != 0)
+    {
+        return -1;
+    }
+
+    // Register an empty file table that the open steps fill in.
+    int files[URING_QUEUE_DEPTH];
+    for (int i = 0; i < URING_QUEUE_DEPTH; i++)
+    {
+        files[i] = -1;
+    }
+    if (syscall(__NR_io_uring_register, writer->ring_fd, IORING_REGISTER_FILES,
+            files, URING_QUEUE_DEPTH) != 0)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+static void release_ring(UringWriter *writer)
+{
+    if (writer->sqes)
+    {
+        munmap(writer->sqes, writer->sq_entries * sizeof(struct io_uring_sqe));
+    }
+    if (writer->cq_ring && writer->cq_ring != writer->sq_ring)
+    {
+        munmap(writer->cq_ring, writer->cq_ring_bytes);
+    }
+    if (writer->sq_ring)
+    {
+        munmap(writer->sq_ring, writer->sq_ring_bytes);
+    }
+    if (writer->ring_fd >= 0)
+    {
+        close(writer->ring_fd);
+    }
+    free(writer->buffers);
+    memset(writer, 0, sizeof(*writer));
+    writer->ring_fd = -1;
+}
+
+int open_uring_writer(UringWriter *writer, int restore_ownership, int queue_depth)
+{
+    memset(writer, 0, sizeof(*writer));
+    writer->restore_ownership = restore_ownership;
+    writer->queue_depth = queue_depth < 1 ? 1 :
+        queue_depth > URING_QUEUE_DEPTH ? URING_QUEUE_DEPTH : queue_depth;
+
+    // Record the umask, which applies to files created by the ring.
+    writer->umask = umask(0);
+    umask(writer->umask);
+
+    // Create the ring, which fails on kernels without io_uring or where it
+    // is disabled.
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    writer->ring_fd = (int)syscall(__NR_io_uring_setup, URING_RING_ENTRIES, &params);
+    if (writer->ring_fd < 0)
+    {
+        writer->ring_fd = -1;
+        return -1;
+    }
+
+    // Map the rings, register the buffers and files, and check that the
+    // kernel supports direct descriptors.
+    writer->buffers = aligned_alloc(4096, (size_t)URING_QUEUE_DEPTH * URING_SLOT_BYTES);
+    if (!writer->buffers || map_ring(writer, &params) != 0 ||
+        register_resources(writer) != 0 || probe_direct_descriptors(writer) != 0)
+    {
+        release_ring(writer);
+        return -1;
+    }
+
+    return 0;
+}
+
+int acquire_uring_job(UringWriter *writer, const char *path, WriterJob **out_job)
+{
+    // Finish earlier writes to the same path first, so they stay in order.
+    wait_uring_path(writer, path);
+
+    // Wait for a free slot when the queue is full.
+    while (writer->error == 0 && writer->in_flight >= writer->queue_depth)
+    {
+        if (wait_completions(writer) != 0)
+        {
+            write_install_log("io_uring submission failed: %s", strerror(errno));
+            writer->error = -4;
+        }
+    }
+    if (writer->error != 0)
+    {
+        return writer->error;
+    }
+
+    // Reserve the first free slot and point its job at the slot buffer.
+    for (int i = 0; i < URING_QUEUE_DEPTH; i++)
+    {
+        UringSlot *slot = &writer->slots[i];
+        if (slot->busy)
+        {
+            continue;
+        }
+        snprintf(slot->path, sizeof(slot->path), "%s", path);
+        memset(&slot->job, 0, sizeof(slot->job));
+        slot->job.path = slot->path;
+        slot->job.data = writer->buffers + (size_t)i * URING_SLOT_BYTES;
+        *out_job = &slot->job;
+        return 0;
+    }
+
+    return -4;
+}
+
+void submit_uring_job(UringWriter *writer, WriterJob *job)
+{
+    // Find the slot holding the job and queue its steps.
+    int slot_index = (int)(((unsigned char *)job - (unsigned char *)writer->slots) / sizeof(UringSlot));
+    writer->slots[slot_index].busy = 1;
+    writer->in_flight++;
+    queue_file_submissions(writer, slot_index);
+}
+
+int wait_uring_path(UringWriter *writer, const char *path)
+{
+    for (int i = 0; i < URING_QUEUE_DEPTH; i++)
+    {
+        if (writer->slots[i].busy && strcmp(writer->slots[i].path, path) == 0)
+        {
+            return flush_uring_writer(writer);
+        }
+    }
+    return writer->error;
+}
+
+int flush_uring_writer(UringWriter *writer)
+{
+    // Submit queued files and wait until every one has been written.
+    while (writer->error == 0 && writer->in_flight > 0)
+    {
+        if (wait_completions(writer) != 0)
+        {
+            write_install_log("io_uring submission failed: %s", strerror(errno));
+            writer->error = -4;
+        }
+    }
+    return writer->error;
+}
+
+int close_uring_writer(UringWriter *writer)
+{
+    int result = flush_uring_writer(writer);
+    release_ring(writer);
+    return result;
+}
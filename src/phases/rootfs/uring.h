@@ -0,0 +1,122 @@
+#pragma once
+#include "../../all.h"
+
+/** The most files the io_uring writer keeps in flight. */
+#define URING_QUEUE_DEPTH 32
+
+/** The largest file written through io_uring; larger files are written inline. */
+#define URING_SLOT_BYTES (64 * 1024)
+
+/** The number of submission queue entries: open, write and close per file. */
+#define URING_RING_ENTRIES (URING_QUEUE_DEPTH * 4)
+
+/** A type representing one in-flight file and its registered buffer. */
+typedef struct {
+    WriterJob job;
+    char path[PATH_MAX];
+    int busy;
+    int remaining;
+    int failed;
+} UringSlot;
+
+/** A type representing an io_uring instance that writes whole files. */
+typedef struct {
+    int ring_fd;
+    void *sq_ring;
+    size_t sq_ring_bytes;
+    void *cq_ring;
+    size_t cq_ring_bytes;
+    struct io_uring_sqe *sqes;
+    unsigned int sq_entries;
+    unsigned int *sq_head;
+    unsigned int *sq_tail;
+    unsigned int *sq_mask;
+    unsigned int *sq_array;
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int *cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned int pending_submissions;
+    unsigned char *buffers;
+    UringSlot slots[URING_QUEUE_DEPTH];
+    int queue_depth;
+    int in_flight;
+    mode_t umask;
+    int restore_ownership;
+    int metadata_errors;
+    int error;
+} UringWriter;
+
+/**
+ * Opens an io_uring instance for writing extracted files.
+ *
+ * Each file is written by a linked open, write and close submission using
+ * a direct descriptor and a registered buffer, so that a batch of small
+ * files costs a single system call.
+ *
+ * @param writer The writer to initialize.
+ * @param restore_ownership Whether file ownership is restored.
+ * @param queue_depth The most files kept in flight, up to URING_QUEUE_DEPTH,
+ *                    where 1 writes files one after another.
+ *
+ * @return - `0` - Indicates success.
+ * @return - `-1` - Indicates io_uring, or a feature it needs, is unavailable.
+ */
+int open_uring_writer(UringWriter *writer, int restore_ownership, int queue_depth);
+
+/**
+ * Reserves a slot for the next file, waiting for one to free up if needed.
+ *
+ * The returned job's data points at a registered buffer of URING_SLOT_BYTES,
+ * which the caller fills before calling submit_uring_job().
+ *
+ * @param writer The writer to reserve from.
+ * @param path The path the file will be written to.
+ * @param out_job Output: the job to fill in.
+ *
+ * @return - `0` - Indicates success.
+ * @return - `-4` - Indicates an earlier write failed.
+ */
+int acquire_uring_job(UringWriter *writer, const char *path, WriterJob **out_job);
+
+/**
+ * Queues a job reserved with acquire_uring_job().
+ *
+ * @param writer The writer that owns the job.
+ * @param job The filled-in job.
+ */
+void submit_uring_job(UringWriter *writer, WriterJob *job);
+
+/**
+ * Waits for an in-flight write to a path, if there is one.
+ *
+ * @param writer The writer to wait on.
+ * @param path The path about to be written by something else.
+ *
+ * @return - `0` - Indicates all writes succeeded.
+ * @return - `-4` - Indicates a write failed.
+ */
+int wait_uring_path(UringWriter *writer, const char *path);
+
+/**
+ * Submits all queued files and waits for them to be written.
+ *
+ * Files the ring could not write (for example because a parent directory
+ * is missing) are retried with plain system calls.
+ *
+ * @param writer The writer to flush.
+ *
+ * @return - `0` - Indicates all writes succeeded.
+ * @return - `-4` - Indicates a write failed.
+ */
+int flush_uring_writer(UringWriter *writer);
+
+/**
+ * Flushes the writer, then releases the ring and its buffers.
+ *
+ * @param writer The writer to close.
+ *
+ * @return - `0` - Indicates all writes succeeded.
+ * @return - `-4` - Indicates a write failed.
+ */
+int close_uring_writer(UringWriter *writer);
@@ -0,0 +1,309 @@
+/**
+ * This code is responsible for writing extracted files on a pool of worker
+ * threads, so that many small files keep the target disk's queue busy while
+ * the archive is still being decompressed.
+ */
+
+#include "../../all.h"
+
+void create_parent_directories(const char *path)
+{
+    char partial[PATH_MAX];
+    snprintf(partial, sizeof(partial), "%s", path);
+
+    // Create each missing ancestor, ignoring ones that already exist.
+    for (char *slash = strchr(partial + 1, '/'); slash != NULL; slash = strchr(slash + 1, '/'))
+    {
+        *slash = '\0';
+        mkdir(partial, 0755);
+        *slash = '/';
+    }
+}
+
+int write_job_file(const WriterJob *job, int restore_ownership, int *out_metadata_errors)
+{
+    // Create the file, creating missing ancestors or replacing an existing
+    // entry only when needed so the common case costs a single open().
+    const int flags = O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC | O_NOFOLLOW;
+    int fd = open(job->path, flags, 0600);
+    if (fd < 0 && errno == ENOENT)
+    {
+        create_parent_directories(job->path);
+        fd = open(job->path, flags, 0600);
+    }
+    else if (fd < 0 && errno == EEXIST)
+    {
+        unlink(job->path);
+        fd = open(job->path, flags, 0600);
+    }
+    if (fd < 0)
+    {
+        write_install_log("Failed to create %s: %s", job->path, strerror(errno));
+        return -4;
+    }
+
+    // Write the whole file.
+    size_t done = 0;
+    while (done < job->size)
+    {
+        ssize_t written = write(fd, job->data + done, job->size - done);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written < 0)
+        {
+            write_install_log("Failed to write %s: %s", job->path, strerror(errno));
+            close(fd);
+            return -4;
+        }
+        done += (size_t)written;
+    }
+
+    // Restore ownership, then permissions, then the modification time.
+    if (restore_ownership && fchown(fd, job->uid, job->gid) != 0)
+    {
+        (*out_metadata_errors)++;
+    }
+    if (fchmod(fd, job->mode & 07777) != 0)
+    {
+        (*out_metadata_errors)++;
+    }
+    struct timespec times[2] = {
+        { .tv_sec = 0, .tv_nsec = UTIME_NOW },
+        { .tv_sec = job->mtime, .tv_nsec = 0 }
+    };
+    if (futimens(fd, times) != 0)
+    {
+        (*out_metadata_errors)++;
+    }
+    if (close(fd) != 0)
+    {
+        write_install_log("Failed to close %s: %s", job->path, strerror(errno));
+        return -4;
+    }
+
+    return 0;
+}
+
+int get_writer_thread_count(const char *disk)
+{
+    // Keep a single sequential writer unless the disk is known to be solid-state.
+    if (is_disk_rotational(disk) != 0)
+    {
+        return 1;
+    }
+
+    // Use one writer per CPU, within the supported range.
+    long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpu_count < 2)
+    {
+        return 2;
+    }
+    return cpu_count > WRITER_MAX_THREADS ? WRITER_MAX_THREADS : (int)cpu_count;
+}
+
+static WriterShard *get_path_shard(WriterPool *pool, const char *path)
+{
+    // Hash the path (FNV-1a) so each path always maps to the same shard.
+    unsigned int hash = 2166136261u;
+    for (const char *character = path; *character != '\0'; character++)
+    {
+        hash = (hash ^ (unsigned char)*character) * 16777619u;
+    }
+    return &pool->shards[hash % (unsigned int)pool->thread_count];
+}
+
+static void free_writer_job(WriterJob *job)
+{
+    free(job->path);
+    free(job->data);
+    free(job);
+}
+
+static void *run_writer_worker(void *argument)
+{
+    WriterShard *shard = argument;
+    WriterPool *pool = shard->pool;
+
+    pthread_mutex_lock(&pool->mutex);
+    while (1)
+    {
+        // Wait for a job, exiting once the pool stops and the queue is empty.
+        if (!shard->head)
+        {
+            if (pool->stopping)
+            {
+                break;
+            }
+            pthread_cond_wait(&pool->changed, &pool->mutex);
+            continue;
+        }
+        WriterJob *job = shard->head;
+        shard->head = job->next;
+        if (!shard->head)
+        {
+            shard->tail = NULL;
+        }
+        shard->busy = 1;
+        pthread_mutex_unlock(&pool->mutex);
+
+        // Write the file without holding the lock, skipping it after a failure.
+        int metadata_errors = 0;
+        int result = pool->error == 0
+            ? write_job_file(job, pool->restore_ownership, &metadata_errors) : 0;
+
+        // Record the outcome and release the job's share of pending memory.
+        pthread_mutex_lock(&pool->mutex);
+        shard->busy = 0;
+        pool->pending_bytes -= job->size;
+        pool->metadata_errors += metadata_errors;
+        if (result != 0)
+        {
+            pool->error = result;
+        }
+        free_writer_job(job);
+        pthread_cond_broadcast(&pool->changed);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+int start_writer_pool(WriterPool *pool, int thread_count, int restore_ownership)
+{
+    memset(pool, 0, sizeof(*pool));
+    pool->restore_ownership = restore_ownership;
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->changed, NULL);
+
+    // Start one writer thread per shard.
+    if (thread_count > WRITER_MAX_THREADS)
+    {
+        thread_count = WRITER_MAX_THREADS;
+    }
+    for (int i = 0; i < thread_count; i++)
+    {
+        pool->shards[i].pool = pool;
+        if (pthread_create(&pool->shards[i].thread, NULL, run_writer_worker, &pool->shards[i]) != 0)
+        {
+            break;
+        }
+        pool->thread_count++;
+    }
+    if (pool->thread_count == 0)
+    {
+        pthread_mutex_destroy(&pool->mutex);
+        pthread_cond_destroy(&pool->changed);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void wait_writer_change(WriterPool *pool)
+{
+    // Wait briefly for a worker to make progress, ticking the UI meanwhile.
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += COMMAND_TICK_INTERVAL_MS * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(&pool->changed, &pool->mutex, &deadline);
+    pthread_mutex_unlock(&pool->mutex);
+    invoke_command_tick();
+    pthread_mutex_lock(&pool->mutex);
+}
+
+int submit_writer_job(WriterPool *pool, WriterJob *job)
+{
+    pthread_mutex_lock(&pool->mutex);
+
+    // Wait while too much file data is pending, unless the pool is idle.
+    while (pool->error == 0 && pool->pending_bytes > 0 &&
+        pool->pending_bytes + job->size > WRITER_MAX_PENDING_BYTES)
+    {
+        wait_writer_change(pool);
+    }
+
+    // Refuse new work once a write has failed.
+    if (pool->error != 0)
+    {
+        int error = pool->error;
+        pthread_mutex_unlock(&pool->mutex);
+        free_writer_job(job);
+        return error;
+    }
+
+    // Append the job to the queue of its path's shard.
+    WriterShard *shard = get_path_shard(pool, job->path);
+    job->next = NULL;
+    if (shard->tail)
+    {
+        shard->tail->next = job;
+    }
+    else
+    {
+        shard->head = job;
+    }
+    shard->tail = job;
+    pool->pending_bytes += job->size;
+    pthread_cond_broadcast(&pool->changed);
+
+    pthread_mutex_unlock(&pool->mutex);
+    return 0;
+}
+
+int wait_writer_path(WriterPool *pool, const char *path)
+{
+    pthread_mutex_lock(&pool->mutex);
+
+    // Wait until the path's shard has written everything queued so far.
+    WriterShard *shard = get_path_shard(pool, path);
+    while (shard->head || shard->busy)
+    {
+        wait_writer_change(pool);
+    }
+    int error = pool->error;
+
+    pthread_mutex_unlock(&pool->mutex);
+    return error;
+}
+
+static int has_pending_writes(const WriterPool *pool)
+{
+    for (int i = 0; i < pool->thread_count; i++)
+    {
+        if (pool->shards[i].head || pool->shards[i].busy)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int stop_writer_pool(WriterPool *pool)
+{
+    // Let the workers finish their queues while ticking the UI.
+    pthread_mutex_lock(&pool->mutex);
+    while (has_pending_writes(pool))
+    {
+        wait_writer_change(pool);
+    }
+
+    // Signal the idle workers to exit and wait for them.
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->changed);
+    pthread_mutex_unlock(&pool->mutex);
+    for (int i = 0; i < pool->thread_count; i++)
+    {
+        pthread_join(pool->shards[i].thread, NULL);
+    }
+
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->changed);
+    return pool->error;
+}
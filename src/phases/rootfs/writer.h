@@ -0,0 +1,128 @@
+#pragma once
+#include "../../all.h"
+
+/** The maximum number of file writer threads. */
+#define WRITER_MAX_THREADS 8
+
+/** The largest file handed to the writer threads; larger files are written inline. */
+#define WRITER_MAX_FILE_BYTES (4 * 1024 * 1024)
+
+/** The most file data held in memory while waiting to be written. */
+#define WRITER_MAX_PENDING_BYTES (64 * 1024 * 1024)
+
+/** A type representing a file whose contents are waiting to be written. */
+typedef struct WriterJob {
+    char *path;
+    unsigned char *data;
+    size_t size;
+    mode_t mode;
+    uid_t uid;
+    gid_t gid;
+    time_t mtime;
+    struct WriterJob *next;
+} WriterJob;
+
+/** A type representing the queue of one writer thread. */
+typedef struct {
+    struct WriterPool *pool;
+    WriterJob *head;
+    WriterJob *tail;
+    int busy;
+    pthread_t thread;
+} WriterShard;
+
+/** A type representing a pool of threads writing files concurrently. */
+typedef struct WriterPool {
+    WriterShard shards[WRITER_MAX_THREADS];
+    int thread_count;
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+    size_t pending_bytes;
+    int restore_ownership;
+    int metadata_errors;
+    int error;
+    int stopping;
+} WriterPool;
+
+/**
+ * Creates the missing ancestor directories of a path.
+ *
+ * @param path The path whose ancestors are created.
+ */
+void create_parent_directories(const char *path);
+
+/**
+ * Writes a file with plain system calls, restoring its metadata.
+ *
+ * Missing ancestor directories are created, and an existing entry at the
+ * path is replaced.
+ *
+ * @param job The file to write.
+ * @param restore_ownership Whether file ownership is restored.
+ * @param out_metadata_errors Output: incremented for each metadata update
+ *                            that failed.
+ *
+ * @return - `0` - Indicates success.
+ * @return - `-4` - Indicates the file could not be created or written.
+ */
+int write_job_file(const WriterJob *job, int restore_ownership, int *out_metadata_errors);
+
+/**
+ * Calculates how many file writer threads suit the target disk.
+ *
+ * Rotating disks, and disks whose type cannot be determined, keep a single
+ * sequential writer. Solid-state disks get one writer per CPU, up to
+ * WRITER_MAX_THREADS, to keep their queues busy.
+ *
+ * @param disk The target disk device path.
+ *
+ * @return The writer thread count, where 1 means writing inline.
+ */
+int get_writer_thread_count(const char *disk);
+
+/**
+ * Starts a pool of file writer threads.
+ *
+ * @param pool The pool to initialize.
+ * @param thread_count The number of writer threads to start.
+ * @param restore_ownership Whether file ownership is restored.
+ *
+ * @return - `0` - Indicates success.
+ * @return - `-1` - Indicates no writer thread could be started.
+ */
+int start_writer_pool(WriterPool *pool, int thread_count, int restore_ownership);
+
+/**
+ * Queues a file to be written by the pool, taking ownership of the job.
+ *
+ * Jobs are sharded by path, so writes to the same path stay in order. Blocks
+ * while too much file data is pending.
+ *
+ * @param pool The pool to submit to.
+ * @param job The file to write.
+ *
+ * @return - `0` - Indicates the job was queued.
+ * @return - `-4` - Indicates an earlier write failed.
+ */
+int submit_writer_job(WriterPool *pool, WriterJob *job);
+
+/**
+ * Waits until all queued writes to a path have completed.
+ *
+ * @param pool The pool to wait on.
+ * @param path The path whose writes must be complete.
+ *
+ * @return - `0` - Indicates the writes completed.
+ * @return - `-4` - Indicates a write failed.
+ */
+int wait_writer_path(WriterPool *pool, const char *path);
+
+/**
+ * Waits for all queued writes, then stops the writer threads.
+ *
+ * @param pool The pool to stop.
+ *
+ * @return - `0` - Indicates all writes succeeded.
+ * @return - `-4` - Indicates a write failed.
+ */
+int stop_writer_pool(WriterPool *pool);
@@ -25,7 +25,7 @@ static int set_hostname(const char *hostname)
     return run_install_command(command) == 0 ? 0 : -2;
 }
 
-static int create_user(const User *user)
+static int create_user(ChrootSession *session, const User *user)
 {
     // Escape username for shell safety.
     char escaped_username[COMMON_MAX_QUOTED_LENGTH];
@@ -38,14 +38,14 @@ static int create_user(const User *user)
     char command[COMMON_MAX_COMMAND_LENGTH];
     snprintf(
         command, sizeof(command),
-        "chroot /mnt useradd -m -s /bin/bash %s >>" CONFIG_INSTALL_LOG_PATH " 2>&1",
+        "useradd -m -s /bin/bash %s",
         escaped_username
     );
 
-    return run_install_command(command) == 0 ? 0 : -2;
+    return run_chroot_command(session, "useradd", command) == 0 ? 0 : -2;
 }
 
-static int set_password(const User *user)
+static int set_password(ChrootSession *session, const User *user)
 {
     // Escape username for shell safety.
     char escaped_username[COMMON_MAX_QUOTED_LENGTH];
@@ -65,14 +65,14 @@ static int set_password(const User *user)
     char command[COMMON_MAX_COMMAND_LENGTH];
     snprintf(
         command, sizeof(command),
-        "chroot /mnt sh -c 'echo %s:%s | chpasswd' >>" CONFIG_INSTALL_LOG_PATH " 2>&1",
+        "echo %s:%s | chpasswd",
         escaped_username, escaped_password
     );
 
-    return run_install_command(command) == 0 ? 0 : -3;
+    return run_chroot_command(session, "chpasswd", command) == 0 ? 0 : -3;
 }
 
-static int add_to_admin_group(const User *user)
+static int add_to_admin_group(ChrootSession *session, const User *user)
 {
     // Escape username for shell safety.
     char escaped_username[COMMON_MAX_QUOTED_LENGTH];
@@ -85,11 +85,43 @@ static int add_to_admin_group(const User *user)
     char command[COMMON_MAX_COMMAND_LENGTH];
     snprintf(
         command, sizeof(command),
-        "chroot /mnt usermod -aG sudo %s >>" CONFIG_INSTALL_LOG_PATH " 2>&1",
+        "usermod -aG sudo %s",
         escaped_username
     );
 
-    return run_install_command(command) == 0 ? 0 : -2;
+    return run_chroot_command(session, "usermod", command) == 0 ? 0 : -2;
+}
+
+static int configure_user(ChrootSession *session, const User *user)
+{
+    // Create user account.
+    write_install_log("Creating user account: %s", user->username);
+    if (create_user(session, user) != 0)
+    {
+        write_install_log("Failed to create user: %s", user->username);
+        return -3;
+    }
+
+    // Set user password.
+    write_install_log("Setting password for: %s", user->username);
+    if (set_password(session, user) != 0)
+    {
+        write_install_log("Failed to set password for: %s", user->username);
+        return -4;
+    }
+
+    // Add to sudo group if admin.
+    if (user->is_admin)
+    {
+        write_install_log("Adding %s to sudo group", user->username);
+        if (add_to_admin_group(session, user) != 0)
+        {
+            write_install_log("Failed to add %s to sudo group", user->username);
+            return -5;
+        }
+    }
+
+    return 0;
 }
 
 int configure_users(void)
@@ -113,6 +145,14 @@ int configure_users(void)
         return -2;
     }
 
+    // Run all account commands in one chroot session.
+    ChrootSession session;
+    if (open_chroot_session(&session) != 0)
+    {
+        write_install_log("Failed to open chroot session");
+        return -6;
+    }
+
     // Configure each user account.
     for (int i = 0; i < store->user_count; i++)
     {
@@ -121,35 +161,17 @@ int configure_users(void)
         write_install_log("Configuring user %d/%d: %s (admin=%d)",
             i + 1, store->user_count, user->username, user->is_admin);
 
-        // Create user account.
-        write_install_log("Creating user account: %s", user->username);
-        if (create_user(user) != 0)
-        {
-            write_install_log("Failed to create user: %s", user->username);
-            return -3;
-        }
-
-        // Set user password.
-        write_install_log("Setting password for: %s", user->username);
-        if (set_password(user) != 0)
+        int result = configure_user(&session, user);
+        if (result != 0)
         {
-            write_install_log("Failed to set password for: %s", user->username);
-            return -4;
-        }
-
-        // Add to sudo group if admin.
-        if (user->is_admin)
-        {
-            write_install_log("Adding %s to sudo group", user->username);
-            if (add_to_admin_group(user) != 0)
-            {
-                write_install_log("Failed to add %s to sudo group", user->username);
-                return -5;
-            }
+            close_chroot_session(&session);
+            return result;
         }
     }
 
+    close_chroot_session(&session);
+
     write_install_log("User configuration complete");
-    
+
     return 0;
 }
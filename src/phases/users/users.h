@@ -4,10 +4,14 @@
 /**
  * Configures user accounts and hostname on the target system.
  *
+ * Account commands run through a single chroot session.
+ *
  * @return - `0` - on success.
- * @return - `-1` - if hostname configuration fails.
- * @return - `-2` - if user creation fails.
- * @return - `-3` - if password setting fails.
- * @return - `-4` - if admin group addition fails.
+ * @return - `-1` - if no users are configured.
+ * @return - `-2` - if hostname configuration fails.
+ * @return - `-3` - if user creation fails.
+ * @return - `-4` - if password setting fails.
+ * @return - `-5` - if admin group addition fails.
+ * @return - `-6` - if the chroot session cannot be opened.
  */
 int configure_users(void);
@@ -241,7 +241,13 @@ static void render_config_summary(WINDOW *modal, Store *store)
         modal, 6, 3, "  User: %s (%s, %d total)",
         store->users[0].username, store->hostname, store->user_count
     );
-    mvwprintw(modal, 7, 3, "  Disk: %s", store->disk);
+
+    // Display the disk with the boundary its partitions are aligned to.
+    unsigned long long alignment = store->disk_alignment ? store->disk_alignment : PARTITION_ALIGNMENT_BYTES;
+    mvwprintw(
+        modal, 7, 3, "  Disk: %s (%llu MiB aligned)",
+        store->disk, alignment / PARTITION_ALIGNMENT_BYTES
+    );
 
     // Display partition summary using cached disk size.
     unsigned long long disk_size = store->disk_size;
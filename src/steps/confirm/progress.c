@@ -5,6 +5,9 @@
 
 #include "../../all.h"
 
+/** The modal row used for the active phase's detail line. */
+#define PROGRESS_DETAIL_ROW 10
+
 /** A type representing the status of an installation step. */
 typedef enum {
     PROGRESS_PENDING,
@@ -31,6 +34,9 @@ static int animation_frame = 0;
 /** Tick counter for animation timing. */
 static int animation_tick = 0;
 
+/** The newest install log lines, kept between renders of the log viewer. */
+static LogTail log_tail;
+
 void set_logs_visible(int visible)
 {
     logs_visible = visible;
@@ -56,20 +62,30 @@ static void render_background_logs(WINDOW *modal)
     int screen_height, screen_width;
     getmaxyx(stdscr, screen_height, screen_width);
 
-    int line_count = 0;
-    char **lines = read_install_log_lines(screen_height, &line_count);
+    // Keep one line per screen row, reopening the tail when the screen resizes.
+    int has_tail = log_tail.lines != NULL;
+    if (has_tail && log_tail.capacity != screen_height)
+    {
+        close_install_log_tail(&log_tail);
+        has_tail = 0;
+    }
+    if (!has_tail && screen_height > 0)
+    {
+        has_tail = open_install_log_tail(&log_tail, screen_height) == 0;
+    }
 
-    // Clear stdscr and render log lines with dim attribute.
+    // Clear stdscr and render the lines added since the last render along
+    // with the ones kept from before, with dim attribute.
     werase(stdscr);
-    if (lines)
+    if (has_tail)
     {
+        update_install_log_tail(&log_tail);
         wattron(stdscr, A_DIM);
-        for (int i = 0; i < line_count; i++)
+        for (int i = 0; i < log_tail.count; i++)
         {
-            mvwaddnstr(stdscr, i, 0, lines[i], screen_width);
+            mvwaddnstr(stdscr, i, 0, get_install_log_tail_line(&log_tail, i), screen_width);
         }
         wattroff(stdscr, A_DIM);
-        free_install_log_lines(lines, line_count);
     }
 
     // Refresh stdscr first, then touch and refresh modal to keep it on top.
@@ -108,6 +124,47 @@ static void check_toggle_input(WINDOW *modal)
     }
 }
 
+static void render_phase_detail(WINDOW *modal)
+{
+    // Clear the previous detail line.
+    mvwprintw(modal, PROGRESS_DETAIL_ROW, 3, "%*s", MODAL_WIDTH - 6, "");
+
+    // Show detail only while the rootfs is being extracted.
+    const RootfsProgress *progress = get_rootfs_progress();
+    if (!atomic_load_explicit(&progress->active, memory_order_acquire))
+    {
+        return;
+    }
+    unsigned long long compressed_total = progress->compressed_total;
+    unsigned long long compressed_bytes = progress->compressed_bytes;
+    unsigned long long uncompressed_bytes = progress->uncompressed_bytes;
+    if (compressed_total == 0)
+    {
+        return;
+    }
+
+    // Calculate completion from compressed bytes and throughput from
+    // uncompressed bytes, since that is what is written to disk.
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed_seconds =
+        (double)(now.tv_sec - progress->start_time.tv_sec) +
+        (double)(now.tv_nsec - progress->start_time.tv_nsec) / 1e9;
+    double megabytes_per_second = elapsed_seconds > 0
+        ? uncompressed_bytes / 1e6 / elapsed_seconds : 0.0;
+    int percent = (int)(compressed_bytes * 100 / compressed_total);
+    char written[32];
+    format_disk_size(uncompressed_bytes, written, sizeof(written));
+
+    // Render the detail line.
+    wattron(modal, COLOR_PAIR(COLOR_PAIR_MAIN));
+    mvwprintw(
+        modal, PROGRESS_DETAIL_ROW, 3, "Extracting: %d%%, %s written, %.1f MB/s",
+        percent, written, megabytes_per_second
+    );
+    wattroff(modal, COLOR_PAIR(COLOR_PAIR_MAIN));
+}
+
 static void render_all_phases(WINDOW *modal)
 {
     const int col1 = 3;
@@ -146,6 +203,9 @@ static void render_all_phases(WINDOW *modal)
         wattroff(modal, COLOR_PAIR(COLOR_PAIR_MAIN));
     }
 
+    // Render byte-level progress of the active phase, if any.
+    render_phase_detail(modal);
+
     wrefresh(modal);
 }
 
@@ -117,6 +117,59 @@ int populate_disk_options(StepOption *out_options, int max_count)
     return count;
 }
 
+/** A type representing the disk options whose labels show install estimates. */
+typedef struct {
+    StepOption *options;
+    int count;
+    int marked;
+    unsigned long long rootfs_bytes;
+} DiskLabels;
+
+static void format_install_estimate(
+    const DiskProbe *probe, unsigned long long rootfs_bytes, char *out_buffer, size_t buffer_size
+)
+{
+    // Show progress until the probe finishes, and nothing if it failed.
+    DiskProbeState state = probe->state;
+    if (state == DISK_PROBE_NONE || state == DISK_PROBE_PENDING)
+    {
+        snprintf(out_buffer, buffer_size, " - measuring");
+        return;
+    }
+    double seconds = estimate_install_seconds(probe, rootfs_bytes);
+    if (state == DISK_PROBE_FAILED || seconds < 0)
+    {
+        out_buffer[0] = '\0';
+        return;
+    }
+
+    // Round up to whole minutes.
+    int minutes = (int)((seconds + 59) / 60);
+    snprintf(out_buffer, buffer_size, " - ~%d min", minutes > 0 ? minutes : 1);
+}
+
+static int refresh_disk_labels(void *context)
+{
+    Store *store = get_store();
+    DiskLabels *labels = context;
+
+    // Check before rebuilding, so the last results are always shown.
+    int probing = is_probing_disks();
+
+    // Rebuild each label from the detected disk, its estimate and the marker.
+    for (int i = 0; i < labels->count; i++)
+    {
+        char estimate[32];
+        format_install_estimate(&store->disk_probes[i], labels->rootfs_bytes, estimate, sizeof(estimate));
+        snprintf(
+            labels->options[i].label, sizeof(labels->options[i].label),
+            "%.200s%s%s", store->disks[i].label, estimate, i == labels->marked ? " *" : ""
+        );
+    }
+
+    return probing;
+}
+
 int run_disk_step(WINDOW *modal, int step_index)
 {
     Store *store = get_store();
@@ -127,6 +180,7 @@ int run_disk_step(WINDOW *modal, int step_index)
 
     // Mark previously selected disk if any.
     int selected = 0;
+    int marked = -1;
     if (store->disk[0] != '\0')
     {
         for (int i = 0; i < count; i++)
@@ -134,17 +188,17 @@ int run_disk_step(WINDOW *modal, int step_index)
             if (strcmp(options[i].value, store->disk) == 0)
             {
                 selected = i;
-                // Append "*" to the label.
-                size_t len = strlen(options[i].label);
-                if (len + 3 < sizeof(options[i].label))
-                {
-                    strcat(options[i].label, " *");
-                }
+                marked = i;
                 break;
             }
         }
     }
 
+    // Measure the disks in the background, showing an estimated install
+    // time for each as its results arrive.
+    DiskLabels labels = { options, count, marked, get_rootfs_size() };
+    start_disk_probes();
+
     // Run selection step for disk choice.
     int result = run_selection_step(
         modal,                                      // Modal window.
@@ -154,14 +208,21 @@ int run_disk_step(WINDOW *modal, int step_index)
         options,                                    // Options array.
         count,                                      // Number of options.
         &selected,                                  // Selected index pointer.
-        1                                           // Allow back navigation.
+        1,                                          // Allow back navigation.
+        refresh_disk_labels,                        // Update the estimates.
+        &labels                                     // Refresh context.
     );
+
+    // Keep the probes from competing with the installation.
+    stop_disk_probes();
+
     if (result)
     {
         // Store the selected disk in global store.
         snprintf(store->disk, sizeof(store->disk), "%s", options[selected].value);
-        // Cache the disk size.
+        // Cache the disk size and the alignment its partitions need.
         store->disk_size = get_disk_size(store->disk);
+        store->disk_alignment = get_partition_alignment(get_disk_io_alignment(store->disk));
     }
 
     return result;
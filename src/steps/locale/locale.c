@@ -34,7 +34,7 @@ static int get_locale_priority(const char *locale)
     return 4;
 }
 
-static int compare_locales(const void *a, const void *b)
+semistatic int compare_locales(const void *a, const void *b)
 {
     const StepOption *option_a = (const StepOption *)a;
     const StepOption *option_b = (const StepOption *)b;
@@ -213,7 +213,9 @@ int run_locale_step(WINDOW *modal, int step_index)
         options,                                  // Options array.
         count,                                    // Number of options.
         &selected,                                // Selected index pointer.
-        0                                         // Allow back navigation.
+        0,                                        // Allow back navigation.
+        NULL,                                     // No option updates.
+        NULL                                      // Refresh context.
     );
     if (result)
     {
@@ -9,11 +9,13 @@
 #define MOUNT_COUNT 7
 #define FLAG_COUNT 4
 #define TYPE_COUNT 2
+#define FORMAT_COUNT 2
 #define FIELD_SIZE   0
 #define FIELD_MOUNT  1
 #define FIELD_TYPE   2
 #define FIELD_FLAGS  3
-#define FIELD_COUNT  4
+#define FIELD_FORMAT 4
+#define FIELD_COUNT  5
 #define DEFAULT_SIZE_INDEX 12
 #define MIN_PARTITION_SIZE (1ULL * 1000000)
 
@@ -49,6 +51,7 @@ semistatic const char *size_labels[] =
 semistatic const char *mount_options[] = { "/", "/boot", "/boot/efi", "/home", "/var", "swap", "none" };
 static const char *flag_options[] = { "none", "boot", "esp", "bios_grub" };
 static const char *type_options[] = { "primary", "logical" };
+static const char *format_options[] = { "fast", "full" };
 
 semistatic int find_closest_size_index(unsigned long long size)
 {
@@ -146,7 +149,7 @@ static int run_partition_form(
     WINDOW *modal, const char *title, const char *free_string,
     unsigned long long free_space,
     int *size_index, int *mount_index, int *type_index, int *flag_index,
-    const char *footer_action, Store *store, int edit_index
+    int *format_index, const char *footer_action, Store *store, int edit_index
 )
 {
     int focused = FIELD_SIZE;
@@ -184,7 +187,10 @@ static int run_partition_form(
               "Use logical partitions inside extended partitions.", 0, 0 },
             { "Flags",      flag_options,  FLAG_COUNT,  *flag_index,  0,
               "Special flags for bootloader configuration.\n"
-              "'esp' for UEFI, 'bios_grub' for BIOS+GPT.", 0, 0 }
+              "'esp' for UEFI, 'bios_grub' for BIOS+GPT.", 0, 0 },
+            { "Format",     format_options, FORMAT_COUNT, *format_index, 0,
+              "'fast' initializes ext4 tables in the background.\n"
+              "'full' initializes them all while formatting.", 0, 0 }
         };
 
         // Clear modal and render dialog title.
@@ -217,6 +223,7 @@ static int run_partition_form(
         *mount_index = fields[FIELD_MOUNT].current;
         *type_index = fields[FIELD_TYPE].current;
         *flag_index = fields[FIELD_FLAGS].current;
+        *format_index = fields[FIELD_FORMAT].current;
 
         if (result == FORM_SUBMIT)
         {
@@ -365,11 +372,12 @@ int add_partition_dialog(
     int mount_index = 0;
     int type_index = 0;
     int flag_index = 0;
+    int format_index = 0;
 
     // Run the partition form.
     if (run_partition_form(
         modal, "Add Partition", free_string, free_space, &size_index,
-        &mount_index, &type_index, &flag_index, "Add", store, -1
+        &mount_index, &type_index, &flag_index, &format_index, "Add", store, -1
     ) != 0)
     {
         return -3;
@@ -415,8 +423,9 @@ int add_partition_dialog(
         new_partition.filesystem = FS_EXT4;
     }
 
-    // Set partition type and flags.
+    // Set partition type, format profile and flags.
     new_partition.type = (type_index == 0) ? PART_PRIMARY : PART_LOGICAL;
+    new_partition.format_profile = (format_index == 0) ? FORMAT_PROFILE_FAST : FORMAT_PROFILE_FULL;
     new_partition.flag_boot = (flag_index == 1);
     new_partition.flag_esp = (flag_index == 2);
     new_partition.flag_bios_grub = (flag_index == 3);
@@ -474,6 +483,7 @@ int edit_partition_dialog(
     int mount_index = find_mount_index(p->mount_point);
     int type_index = (p->type == PART_PRIMARY) ? 0 : 1;
     int flag_index = find_flag_index(p->flag_boot, p->flag_esp, p->flag_bios_grub);
+    int format_index = (p->format_profile == FORMAT_PROFILE_FAST) ? 0 : 1;
 
     // Build title with partition number.
     char title[32];
@@ -482,8 +492,8 @@ int edit_partition_dialog(
     // Run the partition form.
     if (run_partition_form(
         modal, title, free_string, free_space,
-        &size_index, &mount_index, &type_index, &flag_index, "Save",
-        store, selected
+        &size_index, &mount_index, &type_index, &flag_index, &format_index,
+        "Save", store, selected
     ) != 0)
     {
         return -3;
@@ -521,8 +531,9 @@ int edit_partition_dialog(
         p->filesystem = FS_EXT4;
     }
 
-    // Update partition type and flags.
+    // Update partition type, format profile and flags.
     p->type = (type_index == 0) ? PART_PRIMARY : PART_LOGICAL;
+    p->format_profile = (format_index == 0) ? FORMAT_PROFILE_FAST : FORMAT_PROFILE_FULL;
     p->flag_boot = (flag_index == 1);
     p->flag_esp = (flag_index == 2);
     p->flag_bios_grub = (flag_index == 3);
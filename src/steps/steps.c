@@ -131,7 +131,7 @@ void render_step_options(
 int run_selection_step(
     WINDOW *modal, const char *title, int step_number,
     const char *description, const StepOption *options, int count,
-    int *out_selected, int allow_back
+    int *out_selected, int allow_back, step_refresh_cb refresh_cb, void *context
 )
 {
     // Initialize selection state from input parameter.
@@ -146,8 +146,16 @@ int run_selection_step(
     }
 
     // Run main input loop.
+    int refreshing = refresh_cb != NULL;
     while (1)
     {
+        // Update the options, waking periodically for input while they change.
+        if (refreshing)
+        {
+            refreshing = refresh_cb(context);
+            timeout(refreshing ? STEPS_REFRESH_INTERVAL_MS : -1);
+        }
+
         // Clear modal and render step header.
         clear_modal(modal);
         wattron(modal, A_BOLD | COLOR_PAIR(COLOR_PAIR_MAIN));
@@ -213,12 +221,14 @@ int run_selection_step(
             case '\n':
                 // Store selection and return success when user confirms.
                 *out_selected = current;
+                timeout(-1);
                 return 1;
 
             case 27:
                 // Return 0 when user presses Escape to go back.
                 if (allow_back)
                 {
+                    timeout(-1);
                     return 0;
                 }
                 break;
@@ -4,6 +4,18 @@
 /** Maximum number of options in a selection list. */
 #define STEPS_MAX_OPTIONS MAX_OPTIONS
 
+/** How often a selection step refreshes its options while they change, in milliseconds. */
+#define STEPS_REFRESH_INTERVAL_MS 250
+
+/**
+ * A type representing a function that updates the options of a selection
+ * step while it waits for input.
+ *
+ * @return - `1` - Indicates further updates are expected.
+ * @return - `0` - Indicates the options are final.
+ */
+typedef int (*step_refresh_cb)(void *context);
+
 /** A type representing a step execution function. */
 typedef int (*StepFunction)(WINDOW *modal, int step_index);
 
@@ -78,11 +90,15 @@ void render_step_options(
  * @param count Number of options in the array.
  * @param out_selected Pointer to store selected index, also used as initial.
  * @param allow_back Whether to allow the back option (Escape key).
+ * @param refresh_cb Optional function updating the options in place, called
+ *                   every STEPS_REFRESH_INTERVAL_MS until it returns 0.
+ * @param context Passed to the refresh function.
  *
  * @return - `1` - Indicates user confirmed selection.
  * @return - `0` - Indicates user went back.
  */
 int run_selection_step(
     WINDOW *modal, const char *title, int step_number, const char *description,
-    const StepOption *options, int count, int *out_selected, int allow_back
+    const StepOption *options, int count, int *out_selected, int allow_back,
+    step_refresh_cb refresh_cb, void *context
 );
@@ -7,6 +7,9 @@
 
 static Store store = {
     .dry_run = 0,
+    .rootfs_image = 0,
+    .trace_path = NULL,
+    .skip_reboot = 0,
     .disk_label = DISK_LABEL_GPT,
     .locale = "",
     .hostname = "",
@@ -14,12 +17,14 @@ static Store store = {
     .user_count = 0,
     .disk = "",
     .disk_size = 0,
+    .disk_alignment = 0,
     .partitions = {{0}},
     .partition_count = 0,
     .locales = {{0}},
     .locale_count = -1,
     .disks = {{0}},
     .disk_count = -1,
+    .disk_probes = {{0}},
     .firmware = FIRMWARE_UNKNOWN
 };
 
@@ -32,12 +37,17 @@ void reset_store(void)
 {
     // Reset mode state.
     store.dry_run = 0;
+    store.rootfs_image = 0;
+    store.write_backend = WRITE_BACKEND_URING;
+    store.trace_path = NULL;
+    store.skip_reboot = 0;
     store.disk_label = DISK_LABEL_GPT;
 
     // Clear user selection strings.
     store.locale[0] = '\0';
     store.disk[0] = '\0';
     store.disk_size = 0;
+    store.disk_alignment = 0;
 
     // Initialize default hostname based on chassis type.
     snprintf(
@@ -59,5 +69,6 @@ void reset_store(void)
     // Reset detected system info (will be repopulated on next access).
     store.locale_count = -1;
     store.disk_count = -1;
+    memset(store.disk_probes, 0, sizeof(store.disk_probes));
     store.firmware = FIRMWARE_UNKNOWN;
 }
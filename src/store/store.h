@@ -21,6 +21,18 @@ typedef enum {
     DISK_LABEL_MBR
 } DiskLabel;
 
+/** Profiles for creating ext4 filesystems. */
+typedef enum {
+    FORMAT_PROFILE_FAST,
+    FORMAT_PROFILE_FULL
+} FormatProfile;
+
+/** Backends for writing extracted files. */
+typedef enum {
+    WRITE_BACKEND_URING,
+    WRITE_BACKEND_SYNC
+} WriteBackend;
+
 /** Firmware types. */
 typedef enum {
     FIRMWARE_UNKNOWN = -1,
@@ -34,11 +46,27 @@ typedef struct Partition {
     char mount_point[MAX_MOUNT_LEN];
     PartitionFS filesystem;
     PartitionType type;
+    FormatProfile format_profile;
     int flag_boot;
     int flag_esp;
     int flag_bios_grub;
 } Partition;
 
+/** States of a disk throughput probe. */
+typedef enum {
+    DISK_PROBE_NONE,
+    DISK_PROBE_PENDING,
+    DISK_PROBE_DONE,
+    DISK_PROBE_FAILED
+} DiskProbeState;
+
+/** A type representing the measured read performance of a disk. */
+typedef struct {
+    _Atomic DiskProbeState state;
+    double sequential_bytes_per_second;
+    double random_read_seconds;
+} DiskProbe;
+
 /** A type representing a user account configuration. */
 typedef struct User
 {
@@ -56,6 +84,10 @@ typedef struct {
 /** Global store containing user selections and installation settings. */
 typedef struct {
     int dry_run;
+    int rootfs_image;
+    WriteBackend write_backend;
+    const char *trace_path;
+    int skip_reboot;
     DiskLabel disk_label;
     char locale[MAX_LOCALE_LEN];
     char hostname[MAX_HOSTNAME_LEN];
@@ -63,6 +95,7 @@ typedef struct {
     int user_count;
     char disk[MAX_DISK_LEN];
     unsigned long long disk_size;
+    unsigned long long disk_alignment;  // 0 = PARTITION_ALIGNMENT_BYTES
     Partition partitions[MAX_PARTITIONS];
     int partition_count;
 
@@ -71,6 +104,7 @@ typedef struct {
     int locale_count;         // -1 = not yet populated
     StoreOption disks[MAX_OPTIONS];
     int disk_count;           // -1 = not yet populated
+    DiskProbe disk_probes[MAX_OPTIONS];
     FirmwareType firmware;    // FIRMWARE_UNKNOWN = not yet detected
 } Store;
 
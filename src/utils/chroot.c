@@ -0,0 +1,286 @@
+/**
+ * This code is responsible for running commands inside the target system
+ * through a long-lived chrooted helper shell, instead of starting a new
+ * chroot for every command.
+ */
+
+#include "../all.h"
+
+static pthread_mutex_t system_dirs_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int mount_system_dir(const char *source, const char *target, const char *type, unsigned long flags)
+{
+    // Keep a directory mounted by an earlier session.
+    if (is_mount_registered(target))
+    {
+        return 0;
+    }
+    return mount_filesystem(source, target, type, flags, NULL);
+}
+
+static int mount_system_dirs(void)
+{
+    // Bind mount /dev for device access inside chroot.
+    if (mount_system_dir("/dev", CONFIG_TARGET_MOUNT_POINT "/dev", NULL, MS_BIND) != 0)
+    {
+        return -1;
+    }
+
+    // Mount proc filesystem for process information.
+    if (mount_system_dir("proc", CONFIG_TARGET_MOUNT_POINT "/proc", "proc", 0) != 0)
+    {
+        return -1;
+    }
+
+    // Mount sysfs for kernel and device information.
+    if (mount_system_dir("sys", CONFIG_TARGET_MOUNT_POINT "/sys", "sysfs", 0) != 0)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+static int start_helper(ChrootSession *session)
+{
+    // Create the command, status and output pipes.
+    int command_pipe[2];
+    int status_pipe[2];
+    int output_pipe[2];
+    if (pipe2(command_pipe, O_CLOEXEC) != 0)
+    {
+        return -1;
+    }
+    if (pipe2(status_pipe, O_CLOEXEC) != 0)
+    {
+        close(command_pipe[0]);
+        close(command_pipe[1]);
+        return -1;
+    }
+    if (pipe2(output_pipe, O_CLOEXEC) != 0)
+    {
+        close(command_pipe[0]);
+        close(command_pipe[1]);
+        close(status_pipe[0]);
+        close(status_pipe[1]);
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        // Move the pipe ends clear of the descriptors they are duplicated to.
+        int command_fd = fcntl(command_pipe[0], F_DUPFD_CLOEXEC, 10);
+        int status_fd = fcntl(status_pipe[1], F_DUPFD_CLOEXEC, 10);
+        int null_fd = open("/dev/null", O_RDWR | O_CLOEXEC);
+        int output_fd = output_pipe[1];
+        if (command_fd < 0 || status_fd < 0 || null_fd < 0 ||
+            dup2(null_fd, STDIN_FILENO) < 0 || dup2(output_fd, STDOUT_FILENO) < 0 ||
+            dup2(output_fd, STDERR_FILENO) < 0 || dup2(command_fd, 3) < 0 || dup2(status_fd, 4) < 0)
+        {
+            _exit(127);
+        }
+
+        // Enter the target and run the helper loop.
+        if (chroot(CONFIG_TARGET_MOUNT_POINT) != 0 || chdir("/") != 0)
+        {
+            _exit(127);
+        }
+        execl("/bin/sh", "sh", "-c", CHROOT_HELPER_SCRIPT, (char *)NULL);
+        _exit(127);
+    }
+
+    // Keep only the parent's ends of the pipes.
+    close(command_pipe[0]);
+    close(status_pipe[1]);
+    close(output_pipe[1]);
+    if (pid < 0)
+    {
+        close(command_pipe[1]);
+        close(status_pipe[0]);
+        close(output_pipe[0]);
+        return -1;
+    }
+
+    // Read output without blocking, so it is drained while waiting on statuses.
+    int flags = fcntl(output_pipe[0], F_GETFL);
+    fcntl(output_pipe[0], F_SETFL, flags | O_NONBLOCK);
+
+    session->pid = pid;
+    session->command_fd = command_pipe[1];
+    session->status_fd = status_pipe[0];
+    session->output_fd = output_pipe[0];
+    start_install_log_capture(&session->capture);
+    return 0;
+}
+
+int open_chroot_session(ChrootSession *session)
+{
+    Store *store = get_store();
+    session->pid = -1;
+    session->command_fd = -1;
+    session->status_fd = -1;
+    session->output_fd = -1;
+
+    // Mount the system directories unless an earlier session already has.
+    // They stay mounted for later sessions until cleanup unmounts them.
+    pthread_mutex_lock(&system_dirs_mutex);
+    int mounted = mount_system_dirs();
+    pthread_mutex_unlock(&system_dirs_mutex);
+    if (mounted != 0)
+    {
+        return -1;
+    }
+
+    // Commands are only logged in dry run mode, so no helper is needed.
+    if (store->dry_run)
+    {
+        return 0;
+    }
+
+    // Start the helper shell inside the target.
+    if (start_helper(session) != 0)
+    {
+        return -2;
+    }
+
+    return 0;
+}
+
+static int read_command_status(ChrootSession *session)
+{
+    char status[16];
+    size_t length = 0;
+    while (length < sizeof(status) - 1)
+    {
+        // Wait for the status, capturing output and ticking so the
+        // interface stays responsive.
+        struct pollfd poll_fds[2] = {
+            { .fd = session->status_fd, .events = POLLIN },
+            { .fd = session->output_fd, .events = POLLIN },
+        };
+        int ready = poll(poll_fds, 2, COMMAND_TICK_INTERVAL_MS);
+        if (ready < 0 && errno != EINTR)
+        {
+            return -2;
+        }
+        if (ready > 0 && poll_fds[1].revents &&
+            drain_install_log_capture(&session->capture, session->output_fd) != 0)
+        {
+            // The helper closed its output, so stop polling it.
+            close(session->output_fd);
+            session->output_fd = -1;
+        }
+        if (!(ready > 0 && poll_fds[0].revents))
+        {
+            invoke_command_tick();
+            continue;
+        }
+
+        // Read one character at a time up to the end of the status line.
+        ssize_t count = read(session->status_fd, status + length, 1);
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (count <= 0)
+        {
+            return -2;
+        }
+        if (status[length] == '\n')
+        {
+            status[length] = '\0';
+            return atoi(status);
+        }
+        length++;
+    }
+
+    return -2;
+}
+
+int run_chroot_command(ChrootSession *session, const char *label, const char *command)
+{
+    Store *store = get_store();
+
+    // The helper reads one command per line.
+    if (strchr(command, '\n') != NULL)
+    {
+        return -1;
+    }
+
+    // Log the equivalent chroot invocation in dry run mode.
+    if (store->dry_run)
+    {
+        write_dry_run_log("chroot " CONFIG_TARGET_MOUNT_POINT " %s", command);
+        return 0;
+    }
+    if (session->pid < 0)
+    {
+        return -2;
+    }
+
+    // Time the command for the installation trace. It runs in the helper's
+    // subshell, which is not our child, so only wall time is recorded.
+    TraceSpan span;
+    begin_trace_span(&span, "chroot", label);
+
+    // Send the command line to the helper.
+    char line[COMMON_MAX_COMMAND_LENGTH + 1];
+    int length = snprintf(line, sizeof(line), "%s\n", command);
+    if (length < 0 || (size_t)length >= sizeof(line))
+    {
+        end_trace_span(&span, -1, NULL);
+        return -1;
+    }
+    for (int offset = 0; offset < length; )
+    {
+        ssize_t written = write(session->command_fd, line + offset, (size_t)(length - offset));
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            end_trace_span(&span, -2, NULL);
+            return -2;
+        }
+        offset += (int)written;
+    }
+
+    int result = read_command_status(session);
+
+    // Collect output written just before the command exited, ending its
+    // last line so the next command's output starts on a new one.
+    if (session->output_fd >= 0)
+    {
+        drain_install_log_capture(&session->capture, session->output_fd);
+    }
+    finish_install_log_capture(&session->capture);
+
+    end_trace_span(&span, result, NULL);
+    return result;
+}
+
+void close_chroot_session(ChrootSession *session)
+{
+    // Closing the command pipe ends the helper loop.
+    if (session->pid > 0)
+    {
+        close(session->command_fd);
+        int status;
+        while (waitpid(session->pid, &status, 0) < 0 && errno == EINTR)
+        {
+        }
+        close(session->status_fd);
+        if (session->output_fd >= 0)
+        {
+            drain_install_log_capture(&session->capture, session->output_fd);
+            finish_install_log_capture(&session->capture);
+            close(session->output_fd);
+        }
+    }
+    session->pid = -1;
+    session->command_fd = -1;
+    session->status_fd = -1;
+    session->output_fd = -1;
+}
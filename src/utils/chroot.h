@@ -0,0 +1,65 @@
+#pragma once
+#include "../all.h"
+
+/**
+ * The script run by the helper shell inside the target. Each line read from
+ * descriptor 3 is evaluated in a subshell, and its exit status is written to
+ * descriptor 4.
+ */
+#define CHROOT_HELPER_SCRIPT \
+    "while IFS= read -r command <&3; do (eval \"$command\") </dev/null; echo $? >&4; done"
+
+/** A type representing a shell kept running inside the target system. */
+typedef struct {
+    pid_t pid;
+    int command_fd;
+    int status_fd;
+    int output_fd;
+    LogCapture capture;
+} ChrootSession;
+
+/**
+ * Opens a session for running commands inside the target system.
+ *
+ * The first open session mounts /dev, /proc and /sys into the target, and
+ * they stay mounted for every later session until cleanup_mounts() unmounts
+ * them with the rest of the mount registry. Each session keeps one helper
+ * shell chrooted into the target, whose output is captured into the install
+ * log, so phases running side by side each have their own. In dry run mode
+ * no helper is started.
+ *
+ * @param session The session to initialize.
+ *
+ * @return - `0` - Indicates success.
+ * @return - `-1` - Indicates the system directories could not be mounted.
+ * @return - `-2` - Indicates the helper shell could not be started.
+ */
+int open_chroot_session(ChrootSession *session);
+
+/**
+ * Runs a shell command inside the target system through a session.
+ *
+ * The command is evaluated by the helper shell, so pipes and globs expand
+ * inside the target. Its output is captured into the install log while it
+ * runs, and its input is empty. In dry run mode the command is written to the dry run log as
+ * `chroot <target> <command>` instead.
+ *
+ * The command is traced under its label rather than its text, since the
+ * text may carry secrets such as a password piped to chpasswd.
+ *
+ * @param session The session to run the command in.
+ * @param label The name the command is traced under, such as its program.
+ * @param command The single-line shell command to run.
+ *
+ * @return - `>=0` - The exit status of the command.
+ * @return - `-1` - Indicates the command spans multiple lines or is too long.
+ * @return - `-2` - Indicates the helper shell exited or could not be reached.
+ */
+int run_chroot_command(ChrootSession *session, const char *label, const char *command);
+
+/**
+ * Stops the helper shell of a session. The system directories stay mounted.
+ *
+ * @param session The session to close.
+ */
+void close_chroot_session(ChrootSession *session);
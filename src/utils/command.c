@@ -1,69 +1,163 @@
 /**
- * This code is responsible for executing shell commands and managing
- * dry run logging functionality.
+ * This code is responsible for executing shell commands, capturing their
+ * output into the install log, and managing dry run logging functionality.
  */
 
 #include "../all.h"
 
 static FILE *dry_run_log = NULL;
+static pthread_mutex_t dry_run_log_mutex = PTHREAD_MUTEX_INITIALIZER;
 static CommandTickCallback tick_callback = NULL;
+static pthread_t tick_thread;
+static struct timespec last_tick_time = {0, 0};
 
 void set_command_tick_callback(CommandTickCallback callback)
 {
     tick_callback = callback;
+    tick_thread = pthread_self();
 }
 
-int run_install_command(const char *command)
+static int is_tick_thread(void)
 {
-    Store *store = get_store();
+    return tick_callback && pthread_equal(pthread_self(), tick_thread);
+}
 
-    // Log command to file instead of executing in dry run mode.
-    if (store->dry_run)
+void invoke_command_tick(void)
+{
+    // Only tick on the thread that registered the callback.
+    if (!is_tick_thread())
     {
-        // Open log file if not already open.
-        if (!dry_run_log)
-        {
-            dry_run_log = fopen(CONFIG_DRY_RUN_LOG_PATH, "w");
-        }
+        return;
+    }
 
-        // Write command to log file.
-        if (dry_run_log)
-        {
-            fprintf(dry_run_log, "%s\n", command);
-            fflush(dry_run_log);
-        }
-        return 0;
+    // Throttle ticks to the same interval used while waiting on commands.
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long long elapsed_ms =
+        (now.tv_sec - last_tick_time.tv_sec) * 1000LL +
+        (now.tv_nsec - last_tick_time.tv_nsec) / 1000000LL;
+    if (elapsed_ms < COMMAND_TICK_INTERVAL_MS)
+    {
+        return;
     }
+    last_tick_time = now;
+
+    tick_callback();
+}
+
+void write_dry_run_log(const char *format, ...)
+{
+    pthread_mutex_lock(&dry_run_log_mutex);
 
-    // If no tick callback, delegate directly to core-lib.
-    if (!tick_callback)
+    // Open log file if not already open.
+    if (!dry_run_log)
     {
-        return common.run_command(command);
+        dry_run_log = fopen(CONFIG_DRY_RUN_LOG_PATH, "w");
     }
 
-    // Fork and exec to allow periodic updates during execution.
-    pid_t pid = fork();
-    if (pid < 0)
+    // Write the formatted entry to the log file.
+    if (dry_run_log)
     {
-        // Fork failed, fall back to core-lib.
-        return common.run_command(command);
+        va_list arguments;
+        va_start(arguments, format);
+        vfprintf(dry_run_log, format, arguments);
+        va_end(arguments);
+        fprintf(dry_run_log, "\n");
+        fflush(dry_run_log);
     }
 
-    if (pid == 0)
+    pthread_mutex_unlock(&dry_run_log_mutex);
+}
+
+const CommandOptions COMMAND_TO_INSTALL_LOG = {
+    .append = 1,
+    .capture = 1
+};
+
+const CommandOptions COMMAND_TO_INSTALL_LOG_BLOCK = {
+    .append = 1,
+    .capture = 1,
+    .hold = 1
+};
+
+const CommandOptions COMMAND_QUIET = {
+    .stdout_path = "/dev/null",
+    .stderr_path = "/dev/null"
+};
+
+static void run_timed_tick(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &last_tick_time);
+    tick_callback();
+}
+
+int open_command_runtime(Runtime *runtime)
+{
+    if (!is_tick_thread())
+    {
+        return open_runtime(runtime, NULL, 0);
+    }
+
+    // Schedule the first tick one interval after the previous one.
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long long elapsed_ms =
+        (now.tv_sec - last_tick_time.tv_sec) * 1000LL +
+        (now.tv_nsec - last_tick_time.tv_nsec) / 1000000LL;
+    long long delay_ms = COMMAND_TICK_INTERVAL_MS - elapsed_ms;
+    if (delay_ms < 0)
+    {
+        delay_ms = 0;
+    }
+
+    return open_runtime(runtime, run_timed_tick, (int)delay_ms);
+}
+
+static int open_output_pipe(int out_fds[2])
+{
+    if (pipe2(out_fds, O_CLOEXEC) != 0)
     {
-        // Child process: execute the command.
-        execl("/bin/sh", "sh", "-c", command, (char *)NULL);
-        _exit(127); // exec failed
+        return -1;
     }
 
-    // Parent process: wait for completion while invoking tick callback.
+    // Read without blocking, so output is drained between other events.
+    int flags = fcntl(out_fds[0], F_GETFL);
+    fcntl(out_fds[0], F_SETFL, flags | O_NONBLOCK);
+    return 0;
+}
+
+static void store_cpu_usage(const struct rusage *rusage, ProcessUsage *out_usage)
+{
+    out_usage->user_us = rusage->ru_utime.tv_sec * 1000000LL + rusage->ru_utime.tv_usec;
+    out_usage->system_us = rusage->ru_stime.tv_sec * 1000000LL + rusage->ru_stime.tv_usec;
+}
+
+static int poll_for_command(pid_t pid, int output_fd, LogCapture *capture, ProcessUsage *out_usage)
+{
     int status;
+    struct rusage rusage;
+
+    // Block without ticks when there is neither output nor a UI to serve.
+    if (output_fd < 0 && !is_tick_thread())
+    {
+        while (wait4(pid, &status, 0, &rusage) < 0)
+        {
+            if (errno != EINTR)
+            {
+                return -2; // waitpid error
+            }
+        }
+        store_cpu_usage(&rusage, out_usage);
+        return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    }
+
     while (1)
     {
-        pid_t result = waitpid(pid, &status, WNOHANG);
+        pid_t result = wait4(pid, &status, WNOHANG, &rusage);
         if (result == pid)
         {
             // Child finished.
+            store_cpu_usage(&rusage, out_usage);
             if (WIFEXITED(status))
             {
                 return WEXITSTATUS(status);
@@ -75,23 +169,293 @@ int run_install_command(const char *command)
             return -2; // waitpid error
         }
 
+        // Wait for output or the next tick, draining the output until its end.
+        struct pollfd poll_fd = { .fd = output_fd, .events = POLLIN };
+        if (poll(&poll_fd, 1, COMMAND_TICK_INTERVAL_MS) > 0 &&
+            drain_install_log_capture(capture, output_fd) != 0)
+        {
+            output_fd = -1;
+        }
+
         // Child still running, invoke tick callback.
-        if (tick_callback)
+        invoke_command_tick();
+    }
+}
+
+static int wait_for_command(pid_t pid, int output_fd, int hold, ProcessUsage *out_usage)
+{
+    LogCapture capture;
+    start_install_log_capture(&capture);
+    if (hold)
+    {
+        hold_install_log_capture(&capture);
+    }
+    memset(out_usage, 0, sizeof(*out_usage));
+
+    // Observe completion through a pidfd and output through its pipe, while
+    // ticks follow the timer on the UI thread.
+    int result = -2;
+    int supervised = 0;
+    Runtime runtime;
+    if (open_command_runtime(&runtime) == 0)
+    {
+        runtime.collect_io = is_tracing();
+        if (add_runtime_process(&runtime, pid) == 0 &&
+            (output_fd < 0 || watch_runtime_descriptor(&runtime, output_fd) == 0))
+        {
+            supervised = 1;
+            int output_open = output_fd >= 0;
+            while (take_runtime_process(&runtime, pid, &result, out_usage) == 0)
+            {
+                if (run_runtime(&runtime, -1) < 0)
+                {
+                    result = -2;
+                    break;
+                }
+
+                // Stop watching the output at its end, where it stays readable.
+                if (output_open && drain_install_log_capture(&capture, output_fd) != 0)
+                {
+                    unwatch_runtime_descriptor(&runtime, output_fd);
+                    output_open = 0;
+                }
+            }
+        }
+        close_runtime(&runtime);
+    }
+
+    // Without pidfd support, poll for completion.
+    if (!supervised)
+    {
+        result = poll_for_command(pid, output_fd, &capture, out_usage);
+    }
+
+    // Collect output written just before the command exited.
+    if (output_fd >= 0)
+    {
+        drain_install_log_capture(&capture, output_fd);
+        finish_install_log_capture(&capture);
+        close(output_fd);
+    }
+
+    return result;
+}
+
+int run_install_command(const char *command)
+{
+    Store *store = get_store();
+
+    // Log command to file instead of executing in dry run mode.
+    if (store->dry_run)
+    {
+        write_dry_run_log("%s", command);
+        return 0;
+    }
+
+    // Time the command for the installation trace.
+    TraceSpan span;
+    begin_trace_span(&span, "command", command);
+
+    // Capture output through a pipe, sending both streams into it.
+    int output_fds[2];
+    if (open_output_pipe(output_fds) != 0)
+    {
+        int result = common.run_command(command);
+        end_trace_span(&span, result, NULL);
+        return result;
+    }
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, output_fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, output_fds[1], STDERR_FILENO);
+
+    // Spawn the shell to allow periodic updates during execution.
+    const char *const argv[] = { "sh", "-c", command, NULL };
+    pid_t pid;
+    int error = posix_spawn(&pid, "/bin/sh", &actions, NULL, (char *const *)argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(output_fds[1]);
+    if (error != 0)
+    {
+        // Spawn failed, fall back to core-lib.
+        close(output_fds[0]);
+        int result = common.run_command(command);
+        end_trace_span(&span, result, NULL);
+        return result;
+    }
+
+    ProcessUsage usage;
+    int result = wait_for_command(pid, output_fds[0], 0, &usage);
+    end_trace_span(&span, result, &usage);
+    return result;
+}
+
+static int is_shell_safe(const char *argument)
+{
+    if (argument[0] == '\0')
+    {
+        return 0;
+    }
+    for (const char *c = argument; *c; c++)
+    {
+        if (!isalnum((unsigned char)*c) && !strchr("_-./=:,+@%", *c))
         {
-            tick_callback();
+            return 0;
         }
+    }
+    return 1;
+}
 
-        // Small delay to avoid busy-waiting.
-        usleep(50000); // 50ms
+static void format_command_line(
+    const char *const argv[], const CommandOptions *options,
+    char *out_line, size_t line_size
+)
+{
+    size_t length = 0;
+    out_line[0] = '\0';
+
+    // Join the arguments, quoting those the shell would split or expand.
+    for (int i = 0; argv[i] && length < line_size; i++)
+    {
+        char quoted[COMMON_MAX_QUOTED_LENGTH];
+        const char *argument = argv[i];
+        if (!is_shell_safe(argument) && common.shell_escape(argument, quoted, sizeof(quoted)) == 0)
+        {
+            argument = quoted;
+        }
+        length += (size_t)snprintf(out_line + length, line_size - length, "%s%s", i ? " " : "", argument);
+    }
+    if (!options || length >= line_size)
+    {
+        return;
+    }
+
+    // Show captured output as appended to the install log.
+    if (options->capture && !options->stdout_path && !options->stderr_path)
+    {
+        snprintf(out_line + length, line_size - length, " >>%s 2>&1", CONFIG_INSTALL_LOG_PATH);
+        return;
     }
+
+    // Append the redirections in shell syntax.
+    const char *arrow = options->append ? ">>" : ">";
+    if (options->stdout_path)
+    {
+        length += (size_t)snprintf(out_line + length, line_size - length, " %s%s", arrow, options->stdout_path);
+    }
+    if (options->stderr_path && length < line_size)
+    {
+        if (options->stdout_path && strcmp(options->stderr_path, options->stdout_path) == 0)
+        {
+            snprintf(out_line + length, line_size - length, " 2>&1");
+        }
+        else
+        {
+            snprintf(out_line + length, line_size - length, " 2%s%s", arrow, options->stderr_path);
+        }
+    }
+}
+
+int run_install_argv(const char *const argv[], const CommandOptions *options)
+{
+    Store *store = get_store();
+
+    // Log the equivalent command line instead of executing in dry run mode.
+    if (store->dry_run)
+    {
+        char line[COMMON_MAX_COMMAND_LENGTH];
+        format_command_line(argv, options, line, sizeof(line));
+        write_dry_run_log("%s", line);
+        return 0;
+    }
+
+    // Time the program for the installation trace, naming it by its command line.
+    TraceSpan span;
+    char name[TRACE_NAME_BYTES] = "";
+    if (is_tracing())
+    {
+        format_command_line(argv, NULL, name, sizeof(name));
+    }
+    begin_trace_span(&span, "command", name);
+
+    // Open the output paths in the child, and a pipe for captured streams.
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    char *const *environment = environ;
+    int output_fds[2] = { -1, -1 };
+    if (options && options->capture && (!options->stdout_path || !options->stderr_path))
+    {
+        if (open_output_pipe(output_fds) != 0)
+        {
+            posix_spawn_file_actions_destroy(&actions);
+            end_trace_span(&span, -3, NULL);
+            return -3;
+        }
+        if (!options->stdout_path)
+        {
+            posix_spawn_file_actions_adddup2(&actions, output_fds[1], STDOUT_FILENO);
+        }
+        if (!options->stderr_path)
+        {
+            posix_spawn_file_actions_adddup2(&actions, output_fds[1], STDERR_FILENO);
+        }
+    }
+    if (options)
+    {
+        int flags = O_WRONLY | O_CREAT | (options->append ? O_APPEND : O_TRUNC);
+        if (options->stdout_path)
+        {
+            posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, options->stdout_path, flags, 0644);
+        }
+        if (options->stderr_path)
+        {
+            if (options->stdout_path && strcmp(options->stderr_path, options->stdout_path) == 0)
+            {
+                posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+            }
+            else
+            {
+                posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, options->stderr_path, flags, 0644);
+            }
+        }
+        if (options->environment)
+        {
+            environment = options->environment;
+        }
+    }
+
+    // Start the program without a shell.
+    pid_t pid;
+    int error = posix_spawnp(&pid, argv[0], &actions, NULL, (char *const *)argv, environment);
+    posix_spawn_file_actions_destroy(&actions);
+    if (output_fds[1] >= 0)
+    {
+        close(output_fds[1]);
+    }
+    if (error != 0)
+    {
+        if (output_fds[0] >= 0)
+        {
+            close(output_fds[0]);
+        }
+        end_trace_span(&span, -3, NULL);
+        return -3;
+    }
+
+    ProcessUsage usage;
+    int result = wait_for_command(pid, output_fds[0], options && options->hold, &usage);
+    end_trace_span(&span, result, &usage);
+    return result;
 }
 
 void close_dry_run_log(void)
 {
     // Close and reset log file handle if open.
+    pthread_mutex_lock(&dry_run_log_mutex);
     if (dry_run_log)
     {
         fclose(dry_run_log);
         dry_run_log = NULL;
     }
+    pthread_mutex_unlock(&dry_run_log_mutex);
 }
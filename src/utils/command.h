@@ -1,11 +1,15 @@
 #pragma once
 #include "../all.h"
 
+/** The interval between tick callbacks during long-running work. */
+#define COMMAND_TICK_INTERVAL_MS 50
+
 /**
  * Executes a shell command, or logs it if dry run mode is enabled.
  *
  * Wraps common lib's `run_command()` with dry-run logging and periodic tick
- * callback support for UI updates during long-running commands.
+ * callback support for UI updates during long-running commands. Output the
+ * command does not redirect itself is captured into the install log.
  *
  * In dry run mode, commands are written to CONFIG_DRY_RUN_LOG_PATH instead of
  * being executed, and the function returns 0 (success).
@@ -18,6 +22,67 @@
  */
 int run_install_command(const char *command);
 
+/**
+ * A type representing where a spawned command's output goes, and its
+ * environment. With capture set, streams without a path are read through a
+ * pipe into the install log; with hold also set, the captured lines are
+ * published as one block once the command exits.
+ */
+typedef struct {
+    const char *stdout_path;
+    const char *stderr_path;
+    int append;
+    char *const *environment;
+    int capture;
+    int hold;
+} CommandOptions;
+
+/** Options capturing both output streams into the install log. */
+extern const CommandOptions COMMAND_TO_INSTALL_LOG;
+
+/**
+ * Options capturing both output streams into the install log as one block,
+ * for commands run alongside others.
+ */
+extern const CommandOptions COMMAND_TO_INSTALL_LOG_BLOCK;
+
+/** Options discarding both output streams. */
+extern const CommandOptions COMMAND_QUIET;
+
+/**
+ * Executes a program with an argument vector, or logs it if dry run mode is
+ * enabled.
+ *
+ * The program is started with posix_spawn and searched for on the PATH, so
+ * no shell is involved and arguments need no escaping. Output paths are
+ * opened in the child; when stderr_path equals stdout_path, both streams
+ * share one descriptor. A NULL environment inherits the caller's.
+ *
+ * In dry run mode the equivalent shell command line, with arguments quoted
+ * only where needed, is written to CONFIG_DRY_RUN_LOG_PATH. Captured output
+ * is shown as appended to CONFIG_INSTALL_LOG_PATH.
+ *
+ * @param argv The NULL-terminated program name and arguments.
+ * @param options The redirections and environment, or NULL for none.
+ *
+ * @return - `>=0` - The exit status of the program (or `0` in dry run mode).
+ * @return - `-1` - Program terminated abnormally.
+ * @return - `-2` - Failed to wait for program.
+ * @return - `-3` - Failed to start program.
+ */
+int run_install_argv(const char *const argv[], const CommandOptions *options);
+
+/**
+ * Writes an entry to the dry run log.
+ *
+ * Used by phases that perform work in-process rather than through a shell
+ * command, so that dry runs still record every action that would be taken.
+ *
+ * @param format Printf-style format string.
+ * @param ... Format arguments.
+ */
+void write_dry_run_log(const char *format, ...);
+
 /**
  * Closes the dry run log file if open.
  *
@@ -34,7 +99,31 @@ typedef void (*CommandTickCallback)(void);
  * The callback can handle input checking, animation updates, and other
  * periodic tasks.
  *
+ * The callback is only invoked on the calling thread; commands and work run
+ * from other threads proceed without ticks.
+ *
  * @param callback Function to call on each tick, or NULL to disable.
  */
 void set_command_tick_callback(CommandTickCallback callback);
 
+/**
+ * Opens a runtime that invokes the tick callback on its timer, continuing
+ * the cadence of earlier ticks.
+ *
+ * On threads other than the one that set the callback, the runtime has no
+ * timer and never ticks.
+ *
+ * @param runtime The runtime to initialize.
+ *
+ * @return - `0` - Indicates success.
+ * @return - `-1` - Indicates the runtime could not be opened.
+ */
+int open_command_runtime(Runtime *runtime);
+
+/**
+ * Invokes the tick callback from long-running in-process work.
+ *
+ * Calls are throttled to COMMAND_TICK_INTERVAL_MS, so callers may invoke this
+ * as often as convenient without speeding up UI animations.
+ */
+void invoke_command_tick(void);
@@ -115,6 +115,134 @@ int is_disk_removable(const char *device)
     return removable;
 }
 
+int is_disk_rotational(const char *disk_path)
+{
+    // Extract device name if full path provided (e.g., "/dev/sda" -> "sda").
+    const char *device = strrchr(disk_path, '/');
+    device = device ? device + 1 : disk_path;
+
+    // Validate device name to prevent path traversal.
+    if (!is_valid_device_name(device))
+    {
+        return -1;
+    }
+
+    // Prepare path to rotational flag file in `/sys/block`.
+    char path[256];
+    snprintf(path, sizeof(path), "/sys/block/%s/queue/rotational", device);
+
+    // Open the file and read the rotational flag.
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return -1;
+    }
+    int rotational = -1;
+    if (fscanf(file, "%d", &rotational) != 1)
+    {
+        rotational = -1;
+    }
+    fclose(file);
+
+    return rotational;
+}
+
+int is_disk_discardable(const char *disk_path)
+{
+    // Extract device name if full path provided (e.g., "/dev/sda" -> "sda").
+    const char *device = strrchr(disk_path, '/');
+    device = device ? device + 1 : disk_path;
+
+    // Validate device name to prevent path traversal.
+    if (!is_valid_device_name(device))
+    {
+        return -1;
+    }
+
+    // Prepare path to the discard limit file in `/sys/block`.
+    char path[256];
+    snprintf(path, sizeof(path), "/sys/block/%s/queue/discard_max_bytes", device);
+
+    // Open the file and read the limit, where zero means no discard.
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return -1;
+    }
+    unsigned long long max_bytes = 0;
+    int result = fscanf(file, "%llu", &max_bytes) == 1 ? (max_bytes > 0) : -1;
+    fclose(file);
+
+    return result;
+}
+
+static unsigned long long get_greatest_common_divisor(unsigned long long a, unsigned long long b)
+{
+    while (b != 0)
+    {
+        unsigned long long remainder = a % b;
+        a = b;
+        b = remainder;
+    }
+    return a;
+}
+
+unsigned long long get_least_common_multiple(unsigned long long a, unsigned long long b)
+{
+    return a / get_greatest_common_divisor(a, b) * b;
+}
+
+unsigned long long get_disk_io_alignment(const char *disk_path)
+{
+    // Extract device name if full path provided (e.g., "/dev/sda" -> "sda").
+    const char *device = strrchr(disk_path, '/');
+    device = device ? device + 1 : disk_path;
+
+    // Validate device name to prevent path traversal.
+    if (!is_valid_device_name(device))
+    {
+        return 0;
+    }
+
+    // Combine every I/O size the queue reports, where zero means none.
+    static const char *names[] = { "physical_block_size", "minimum_io_size", "optimal_io_size" };
+    unsigned long long alignment = 0;
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        char path[256];
+        snprintf(path, sizeof(path), "/sys/block/%s/queue/%s", device, names[i]);
+        FILE *file = fopen(path, "r");
+        if (file == NULL)
+        {
+            continue;
+        }
+        unsigned long long size = 0;
+        if (fscanf(file, "%llu", &size) == 1 && size > 0)
+        {
+            alignment = alignment == 0 ? size : get_least_common_multiple(alignment, size);
+        }
+        fclose(file);
+    }
+
+    return alignment;
+}
+
+unsigned long long get_open_disk_size(int fd)
+{
+    // Block devices report their size through an ioctl, files through stat.
+    struct stat device_stat;
+    if (fstat(fd, &device_stat) != 0)
+    {
+        return 0;
+    }
+    if (S_ISBLK(device_stat.st_mode))
+    {
+        unsigned long long size = 0;
+        return ioctl(fd, BLKGETSIZE64, &size) == 0 ? size : 0;
+    }
+    return (unsigned long long)device_stat.st_size;
+}
+
 unsigned long long sum_partition_sizes(const struct Partition *partitions, int count)
 {
     unsigned long long total = 0;
@@ -129,9 +257,9 @@ void get_partition_device(
     const char *disk, int partition_number, char *out_buffer, size_t buffer_size
 )
 {
-    // Use 'p' separator for NVMe and MMC devices
-    // (e.g., `/dev/nvme0n1p1`, `/dev/mmcblk0p1`).
-    if (strstr(disk, "nvme") || strstr(disk, "mmcblk"))
+    // Use 'p' separator for NVMe, MMC and loop devices
+    // (e.g., `/dev/nvme0n1p1`, `/dev/mmcblk0p1`, `/dev/loop0p1`).
+    if (strstr(disk, "nvme") || strstr(disk, "mmcblk") || strstr(disk, "loop"))
     {
         snprintf(out_buffer, buffer_size, "%sp%d", disk, partition_number);
     }
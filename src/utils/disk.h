@@ -23,6 +23,16 @@ void format_disk_size(
  */
 unsigned long long get_disk_size(const char *disk_path);
 
+/**
+ * Gets the size of an open disk, or of a file standing in for one.
+ *
+ * @param fd The open disk or file.
+ *
+ * @return - `>0` - Size in bytes.
+ * @return - `0` - Size unavailable.
+ */
+unsigned long long get_open_disk_size(int fd);
+
 /**
  * Checks if a block device is removable.
  *
@@ -33,6 +43,52 @@ unsigned long long get_disk_size(const char *disk_path);
  */
 int is_disk_removable(const char *device);
 
+/**
+ * Checks if a disk uses rotating media, by reading its queue information
+ * from /sys/block. Accepts either a device name or full path.
+ *
+ * @param disk_path Device name or full path to the disk.
+ *
+ * @return - `1` - The disk is rotational.
+ * @return - `0` - The disk is solid-state.
+ * @return - `-1` - The disk type is unavailable.
+ */
+int is_disk_rotational(const char *disk_path);
+
+/**
+ * Checks if a disk accepts discard requests, by reading the largest discard
+ * it allows from /sys/block. Accepts either a device name or full path.
+ *
+ * @param disk_path Device name or full path to the disk.
+ *
+ * @return - `1` - The disk supports discard.
+ * @return - `0` - The disk does not support discard.
+ * @return - `-1` - The discard support is unavailable.
+ */
+int is_disk_discardable(const char *disk_path);
+
+/**
+ * Computes the least common multiple of two sizes.
+ *
+ * @param a The first size, greater than zero.
+ * @param b The second size, greater than zero.
+ *
+ * @return The smallest size both divide.
+ */
+unsigned long long get_least_common_multiple(unsigned long long a, unsigned long long b);
+
+/**
+ * Gets the boundary I/O to a disk should be aligned to, by reading the
+ * physical block size and the minimum and optimal I/O sizes of its queue
+ * from /sys/block. Accepts either a device name or full path.
+ *
+ * @param disk_path Device name or full path to the disk.
+ *
+ * @return - `>0` - The least common multiple of the reported sizes.
+ * @return - `0` - The sizes are unavailable.
+ */
+unsigned long long get_disk_io_alignment(const char *disk_path);
+
 /**
  * Sums the sizes of all partitions in an array.
  *
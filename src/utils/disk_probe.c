@@ -0,0 +1,220 @@
+/**
+ * This code is responsible for measuring the read throughput and latency of
+ * the detected disks in the background, so the disk step can estimate how
+ * long an installation onto each of them takes.
+ */
+
+#include "../all.h"
+
+static pthread_t probe_thread;
+static int has_probe_thread = 0;
+static atomic_int probe_running = 0;
+static atomic_int probe_stopping = 0;
+
+static double get_elapsed_seconds(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static int read_probe_bytes(int fd, void *buffer, size_t length, unsigned long long offset)
+{
+    ssize_t count;
+    do
+    {
+        count = pread(fd, buffer, length, (off_t)offset);
+    } while (count < 0 && errno == EINTR);
+    return count > 0 ? 0 : -1;
+}
+
+int probe_disk(const char *device_path, DiskProbe *out_probe)
+{
+    // Bypass the page cache, so cached data does not inflate the results.
+    int fd = open(device_path, O_RDONLY | O_CLOEXEC | O_DIRECT);
+    if (fd < 0 && errno == EINVAL)
+    {
+        fd = open(device_path, O_RDONLY | O_CLOEXEC);
+    }
+    if (fd < 0)
+    {
+        return -1;
+    }
+    unsigned long long device_bytes = get_open_disk_size(fd);
+    void *buffer = NULL;
+    if (device_bytes < DISK_PROBE_SEQUENTIAL_BYTES ||
+        posix_memalign(&buffer, 4096, DISK_PROBE_SEQUENTIAL_BYTES) != 0)
+    {
+        close(fd);
+        return -2;
+    }
+
+    // Read from the start of the disk for the throughput.
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    unsigned long long sequential_bytes = 0;
+    double seconds = 0;
+    while (sequential_bytes < DISK_PROBE_SEQUENTIAL_LIMIT &&
+        sequential_bytes + DISK_PROBE_SEQUENTIAL_BYTES <= device_bytes &&
+        seconds < DISK_PROBE_SECONDS && !probe_stopping)
+    {
+        if (read_probe_bytes(fd, buffer, DISK_PROBE_SEQUENTIAL_BYTES, sequential_bytes) != 0)
+        {
+            free(buffer);
+            close(fd);
+            return -2;
+        }
+        sequential_bytes += DISK_PROBE_SEQUENTIAL_BYTES;
+        seconds = get_elapsed_seconds(&start);
+    }
+    double sequential_seconds = seconds;
+
+    // Read small blocks spread over the disk for the latency.
+    unsigned long long blocks = device_bytes / DISK_PROBE_RANDOM_BYTES;
+    unsigned long long seed = (unsigned long long)start.tv_nsec | 1;
+    int random_count = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    seconds = 0;
+    while (random_count < DISK_PROBE_RANDOM_COUNT && seconds < DISK_PROBE_SECONDS && !probe_stopping)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        unsigned long long offset = (seed % blocks) * DISK_PROBE_RANDOM_BYTES;
+        if (read_probe_bytes(fd, buffer, DISK_PROBE_RANDOM_BYTES, offset) != 0)
+        {
+            free(buffer);
+            close(fd);
+            return -2;
+        }
+        random_count++;
+        seconds = get_elapsed_seconds(&start);
+    }
+
+    free(buffer);
+    close(fd);
+    if (sequential_bytes == 0 || random_count == 0)
+    {
+        return -2;
+    }
+
+    out_probe->sequential_bytes_per_second = sequential_seconds > 0 ? sequential_bytes / sequential_seconds : 0;
+    out_probe->random_read_seconds = seconds / random_count;
+    return 0;
+}
+
+static void *run_disk_probes(void *argument)
+{
+    (void)argument;
+    Store *store = get_store();
+
+    for (int i = 0; i < store->disk_count && !probe_stopping; i++)
+    {
+        DiskProbe *probe = &store->disk_probes[i];
+        if (probe->state != DISK_PROBE_PENDING)
+        {
+            continue;
+        }
+
+        // Publish the measurements before the state that announces them.
+        DiskProbe result = { 0 };
+        int status = probe_disk(store->disks[i].value, &result);
+        if (probe_stopping)
+        {
+            break;
+        }
+        if (status != 0)
+        {
+            probe->state = DISK_PROBE_FAILED;
+            continue;
+        }
+        probe->sequential_bytes_per_second = result.sequential_bytes_per_second;
+        probe->random_read_seconds = result.random_read_seconds;
+        probe->state = DISK_PROBE_DONE;
+    }
+
+    probe_running = 0;
+    return NULL;
+}
+
+int start_disk_probes(void)
+{
+    Store *store = get_store();
+
+    // Leave a running thread to finish its queue, joining a finished one.
+    if (has_probe_thread && probe_running)
+    {
+        return 0;
+    }
+    stop_disk_probes();
+
+    // Queue every disk that has not been measured yet.
+    int pending = 0;
+    for (int i = 0; i < store->disk_count; i++)
+    {
+        if (store->disk_probes[i].state == DISK_PROBE_NONE)
+        {
+            store->disk_probes[i].state = DISK_PROBE_PENDING;
+            pending++;
+        }
+    }
+    if (pending == 0)
+    {
+        return 0;
+    }
+
+    probe_stopping = 0;
+    probe_running = 1;
+    if (pthread_create(&probe_thread, NULL, run_disk_probes, NULL) != 0)
+    {
+        probe_running = 0;
+        for (int i = 0; i < store->disk_count; i++)
+        {
+            if (store->disk_probes[i].state == DISK_PROBE_PENDING)
+            {
+                store->disk_probes[i].state = DISK_PROBE_NONE;
+            }
+        }
+        return -1;
+    }
+    has_probe_thread = 1;
+    return 0;
+}
+
+void stop_disk_probes(void)
+{
+    Store *store = get_store();
+    if (!has_probe_thread)
+    {
+        return;
+    }
+
+    // Interrupt the current probe and wait for the thread to exit.
+    probe_stopping = 1;
+    pthread_join(probe_thread, NULL);
+    has_probe_thread = 0;
+
+    // Let a later start measure the disks that were not reached.
+    for (int i = 0; i < store->disk_count; i++)
+    {
+        if (store->disk_probes[i].state == DISK_PROBE_PENDING)
+        {
+            store->disk_probes[i].state = DISK_PROBE_NONE;
+        }
+    }
+}
+
+int is_probing_disks(void)
+{
+    return probe_running;
+}
+
+double estimate_install_seconds(const DiskProbe *probe, unsigned long long rootfs_bytes)
+{
+    if (probe->state != DISK_PROBE_DONE || probe->sequential_bytes_per_second <= 0 || rootfs_bytes == 0)
+    {
+        return -1;
+    }
+    double seeks = (double)rootfs_bytes / DISK_PROBE_BYTES_PER_SEEK;
+    return rootfs_bytes / probe->sequential_bytes_per_second + seeks * probe->random_read_seconds;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include "../all.h"
+
+/** The size of each sequential read of a probe. */
+#define DISK_PROBE_SEQUENTIAL_BYTES (1024 * 1024)
+
+/** The most data a probe reads sequentially. */
+#define DISK_PROBE_SEQUENTIAL_LIMIT (64 * 1024 * 1024)
+
+/** The size of each random read of a probe. */
+#define DISK_PROBE_RANDOM_BYTES 4096
+
+/** The most random reads a probe makes. */
+#define DISK_PROBE_RANDOM_COUNT 64
+
+/** The longest each half of a probe runs, in seconds. */
+#define DISK_PROBE_SECONDS 0.4
+
+/**
+ * The average amount of rootfs data written per seek, which charges a random
+ * access for the metadata and scattered small files of each chunk.
+ */
+#define DISK_PROBE_BYTES_PER_SEEK (256 * 1024)
+
+/**
+ * Measures the read performance of a disk without writing to it.
+ *
+ * Reads sequentially from the start of the disk, then at random offsets
+ * across it, bypassing the page cache with O_DIRECT. Each half stops after
+ * DISK_PROBE_SECONDS.
+ *
+ * @param device_path The disk device, or a file for testing.
+ * @param out_probe Output: the measured throughput and latency.
+ *
+ * @return - `0` - Indicates the disk was measured.
+ * @return - `-1` - Indicates the disk could not be opened.
+ * @return - `-2` - Indicates a read failed.
+ */
+int probe_disk(const char *device_path, DiskProbe *out_probe);
+
+/**
+ * Starts probing the detected disks on a background thread.
+ *
+ * Disks are probed one at a time, in the order of store->disks, and each
+ * result is stored in the matching store->disk_probes entry. Disks probed
+ * before are not measured again.
+ *
+ * @return - `0` - Indicates probing started or nothing was left to probe.
+ * @return - `-1` - Indicates the probe thread could not be started.
+ */
+int start_disk_probes(void);
+
+/**
+ * Stops the background probes and waits for the thread to exit.
+ *
+ * Disks that were not probed yet are left to be probed by a later start.
+ */
+void stop_disk_probes(void);
+
+/**
+ * Checks whether background probes are still running.
+ *
+ * @return - `1` - Some disks are still being probed.
+ * @return - `0` - All probing has finished or was stopped.
+ */
+int is_probing_disks(void);
+
+/**
+ * Estimates how long installing a root filesystem onto a disk takes.
+ *
+ * Charges the sequential throughput for the data, and a random read
+ * latency for every DISK_PROBE_BYTES_PER_SEEK of it.
+ *
+ * @param probe The measured performance of the disk.
+ * @param rootfs_bytes The uncompressed size of the root filesystem.
+ *
+ * @return - `>=0` - The estimated install time in seconds.
+ * @return - `-1` - The disk or rootfs size has not been measured.
+ */
+double estimate_install_seconds(const DiskProbe *probe, unsigned long long rootfs_bytes);
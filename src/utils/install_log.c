@@ -1,45 +1,442 @@
 /**
- * This code is responsible for handling all installation log file operations
- * including initialization, writing step headers, and reading log lines.
+ * This code is responsible for handling all installation log operations
+ * including initialization, writing step headers, capturing command output,
+ * and reading log lines. Lines are published to the output ring, from which
+ * the log file and the log viewer read independently. A background writer
+ * appends new lines to the log file through one descriptor, in batches.
  */
 
 #include "../all.h"
 
+/** The size of the buffer lines are gathered in before each write. */
+#define LOG_BUFFER_BYTES (64 * 1024)
+
+/** The longest time published lines wait before the writer flushes them. */
+#define LOG_FLUSH_INTERVAL_MS 200
+
+/** The number of unwritten lines at which the writer is woken early. */
+#define LOG_WAKE_LINES (OUTPUT_RING_LINES / 4)
+
+/** The number of unwritten lines at which producers flush themselves. */
+#define LOG_SYNC_FLUSH_LINES (OUTPUT_RING_LINES * 3 / 4)
+
+/**
+ * The most output read by one drain, about one pipe buffer, before it
+ * returns to the caller's event loop.
+ */
+#define LOG_DRAIN_MAX_BYTES (64 * 1024)
+
+static pthread_mutex_t log_file_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int log_fd = -1;
+static char log_buffer[LOG_BUFFER_BYTES];
+static OutputCursor log_file_cursor = {0, 0};
+static _Atomic unsigned long long log_written_position = 0;
+static unsigned long long log_start = 0;
+
+static pthread_mutex_t log_block_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_mutex_t log_writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_writer_wake = PTHREAD_COND_INITIALIZER;
+static pthread_t log_writer_thread;
+static _Atomic int log_writer_running = 0;
+static int log_writer_stopping = 0;
+
+static void write_log_buffer(size_t length)
+{
+    for (size_t offset = 0; offset < length; )
+    {
+        ssize_t written = write(log_fd, log_buffer + offset, length - offset);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            return;
+        }
+        offset += (size_t)written;
+    }
+}
+
+static void write_pending_lines(void)
+{
+    // Open the log on first use when no installation initialized it.
+    if (log_fd < 0)
+    {
+        log_fd = open(CONFIG_INSTALL_LOG_PATH, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+        if (log_fd < 0)
+        {
+            return;
+        }
+    }
+
+    // Gather lines into the buffer, writing it out whenever it fills up.
+    char line[OUTPUT_LINE_BYTES + 32];
+    size_t length = 0;
+    unsigned long long dropped = log_file_cursor.dropped;
+    while (read_output_line(&log_file_cursor, line, OUTPUT_LINE_BYTES))
+    {
+        size_t line_length = strlen(line);
+        line[line_length++] = '\n';
+
+        // Note lines overwritten before they could be written.
+        char note[48];
+        size_t note_length = 0;
+        if (log_file_cursor.dropped != dropped)
+        {
+            note_length = (size_t)snprintf(
+                note, sizeof(note), "[%llu lines lost]\n", log_file_cursor.dropped - dropped
+            );
+            dropped = log_file_cursor.dropped;
+        }
+
+        if (length + note_length + line_length > sizeof(log_buffer))
+        {
+            write_log_buffer(length);
+            length = 0;
+        }
+        memcpy(log_buffer + length, note, note_length);
+        length += note_length;
+        memcpy(log_buffer + length, line, line_length);
+        length += line_length;
+    }
+    write_log_buffer(length);
+
+    atomic_store(&log_written_position, log_file_cursor.position);
+}
+
+void flush_install_log(void)
+{
+    pthread_mutex_lock(&log_file_mutex);
+    if (log_file_cursor.position != get_output_head())
+    {
+        write_pending_lines();
+    }
+    pthread_mutex_unlock(&log_file_mutex);
+}
+
+static void *run_log_writer(void *argument)
+{
+    (void)argument;
+
+    pthread_mutex_lock(&log_writer_mutex);
+    while (!log_writer_stopping)
+    {
+        // Sleep until woken early or the flush interval passes.
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += LOG_FLUSH_INTERVAL_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&log_writer_wake, &log_writer_mutex, &deadline);
+
+        // Write without holding the wake lock, so producers never wait on I/O.
+        pthread_mutex_unlock(&log_writer_mutex);
+        flush_install_log();
+        pthread_mutex_lock(&log_writer_mutex);
+    }
+    pthread_mutex_unlock(&log_writer_mutex);
+
+    return NULL;
+}
+
+static void start_log_writer(void)
+{
+    pthread_mutex_lock(&log_writer_mutex);
+    if (!log_writer_running)
+    {
+        log_writer_stopping = 0;
+        log_writer_running = pthread_create(&log_writer_thread, NULL, run_log_writer, NULL) == 0;
+    }
+    pthread_mutex_unlock(&log_writer_mutex);
+}
+
+static void publish_log_line(const char *text, size_t length)
+{
+    // Flush here once the writer has fallen far behind, checking after every
+    // line so a long burst cannot overwrite lines before they are written.
+    publish_output_line(text, length);
+    if (get_output_head() - atomic_load(&log_written_position) >= LOG_SYNC_FLUSH_LINES)
+    {
+        flush_install_log();
+    }
+}
+
+static void notify_log_writer(void)
+{
+    // Without a writer, flush straight away as each line is published.
+    if (!log_writer_running)
+    {
+        flush_install_log();
+        return;
+    }
+
+    // Wake the writer when it lags.
+    unsigned long long unwritten = get_output_head() - atomic_load(&log_written_position);
+    if (unwritten >= LOG_WAKE_LINES)
+    {
+        pthread_mutex_lock(&log_writer_mutex);
+        pthread_cond_signal(&log_writer_wake);
+        pthread_mutex_unlock(&log_writer_mutex);
+    }
+}
+
 void init_install_log(void)
 {
-    FILE *log_file = fopen(CONFIG_INSTALL_LOG_PATH, "w");
-    if (log_file)
+    pthread_mutex_lock(&log_file_mutex);
+
+    // Clear the log file and skip lines from any earlier installation.
+    if (log_fd >= 0)
     {
-        fclose(log_file);
+        close(log_fd);
     }
+    log_fd = open(CONFIG_INSTALL_LOG_PATH, O_WRONLY | O_APPEND | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    log_start = get_output_head();
+    log_file_cursor.position = log_start;
+    log_file_cursor.dropped = 0;
+    atomic_store(&log_written_position, log_start);
+
+    pthread_mutex_unlock(&log_file_mutex);
+
+    // Write published lines from the background from now on.
+    start_log_writer();
+}
+
+void close_install_log(void)
+{
+    // Stop the writer, which no longer flushes once it has been joined.
+    pthread_mutex_lock(&log_writer_mutex);
+    int running = log_writer_running;
+    log_writer_stopping = 1;
+    pthread_cond_signal(&log_writer_wake);
+    pthread_mutex_unlock(&log_writer_mutex);
+    if (running)
+    {
+        pthread_join(log_writer_thread, NULL);
+        pthread_mutex_lock(&log_writer_mutex);
+        log_writer_running = 0;
+        pthread_mutex_unlock(&log_writer_mutex);
+    }
+
+    // Write the remaining lines and release the descriptor.
+    pthread_mutex_lock(&log_file_mutex);
+    if (log_file_cursor.position != get_output_head())
+    {
+        write_pending_lines();
+    }
+    if (log_fd >= 0)
+    {
+        close(log_fd);
+        log_fd = -1;
+    }
+    pthread_mutex_unlock(&log_file_mutex);
+}
+
+void start_install_log_capture(LogCapture *capture)
+{
+    capture->length = 0;
+    capture->returned = 0;
+    capture->hold = 0;
+    capture->held = NULL;
+    capture->held_length = 0;
+    capture->held_capacity = 0;
+}
+
+void hold_install_log_capture(LogCapture *capture)
+{
+    capture->hold = 1;
+}
+
+static int hold_capture_line(LogCapture *capture)
+{
+    // Grow the held text to fit the line and its newline.
+    size_t needed = capture->held_length + capture->length + 1;
+    if (needed > capture->held_capacity)
+    {
+        size_t capacity = capture->held_capacity ? capture->held_capacity * 2 : 4096;
+        while (capacity < needed)
+        {
+            capacity *= 2;
+        }
+        char *held = realloc(capture->held, capacity);
+        if (!held)
+        {
+            return -1;
+        }
+        capture->held = held;
+        capture->held_capacity = capacity;
+    }
+
+    memcpy(capture->held + capture->held_length, capture->partial, capture->length);
+    capture->held_length += capture->length;
+    capture->held[capture->held_length++] = '\n';
+    return 0;
+}
+
+static void publish_capture_line(LogCapture *capture)
+{
+    // Keep the line of a held capture, publishing it straight away only
+    // when it cannot be kept.
+    if (!capture->hold || hold_capture_line(capture) != 0)
+    {
+        publish_log_line(capture->partial, capture->length);
+    }
+    capture->length = 0;
+    capture->returned = 0;
+}
+
+static void publish_held_lines(LogCapture *capture)
+{
+    // Publish the held lines together, apart from other blocks, flushing
+    // as they go so a block longer than the ring keeps its start.
+    pthread_mutex_lock(&log_block_mutex);
+    size_t start = 0;
+    for (size_t i = 0; i < capture->held_length; i++)
+    {
+        if (capture->held[i] == '\n')
+        {
+            publish_log_line(capture->held + start, i - start);
+            start = i + 1;
+        }
+    }
+    pthread_mutex_unlock(&log_block_mutex);
+
+    free(capture->held);
+    capture->held = NULL;
+    capture->held_length = 0;
+    capture->held_capacity = 0;
+}
+
+static void append_install_log_capture(LogCapture *capture, const char *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        char c = data[i];
+
+        // End the line on a newline.
+        if (c == '\n')
+        {
+            publish_capture_line(capture);
+            continue;
+        }
+
+        // Let text after a carriage return replace the line, as on a
+        // terminal, so progress counters keep only their latest value.
+        if (c == '\r')
+        {
+            capture->returned = 1;
+            continue;
+        }
+        if (capture->returned)
+        {
+            capture->length = 0;
+            capture->returned = 0;
+        }
+
+        // Wrap lines too long for the ring.
+        if (capture->length == OUTPUT_LINE_BYTES - 1)
+        {
+            publish_capture_line(capture);
+        }
+        capture->partial[capture->length++] = c;
+    }
+}
+
+int drain_install_log_capture(LogCapture *capture, int fd)
+{
+    char buffer[1024];
+    int result = 0;
+    size_t total = 0;
+    while (total < LOG_DRAIN_MAX_BYTES)
+    {
+        ssize_t count = read(fd, buffer, sizeof(buffer));
+        if (count > 0)
+        {
+            append_install_log_capture(capture, buffer, (size_t)count);
+            notify_log_writer();
+            total += (size_t)count;
+            continue;
+        }
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        // Stop at the end of the output, or once the pipe is empty.
+        if (count == 0)
+        {
+            result = 1;
+        }
+        else if (errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            result = -1;
+        }
+        break;
+    }
+
+    return result;
+}
+
+void finish_install_log_capture(LogCapture *capture)
+{
+    // Publish output that did not end with a newline.
+    if (capture->length > 0)
+    {
+        publish_capture_line(capture);
+    }
+    if (capture->held)
+    {
+        publish_held_lines(capture);
+    }
+    notify_log_writer();
 }
 
 void write_install_log_header(const char *step_name)
 {
-    FILE *log_file = fopen(CONFIG_INSTALL_LOG_PATH, "a");
-    if (log_file)
+    char title[OUTPUT_LINE_BYTES];
+    int length = snprintf(title, sizeof(title), "  %s", step_name);
+    if (length >= (int)sizeof(title))
     {
-        fprintf(log_file, "\n");
-        fprintf(log_file, "--------------------------------------------------------------\n");
-        fprintf(log_file, "  %s\n", step_name);
-        fprintf(log_file, "--------------------------------------------------------------\n");
-        fprintf(log_file, "\n");
-        fclose(log_file);
+        length = sizeof(title) - 1;
     }
+
+    // Publish the header as one block of lines.
+    const char *rule = "--------------------------------------------------------------";
+    pthread_mutex_lock(&log_block_mutex);
+    publish_output_line("", 0);
+    publish_output_line(rule, strlen(rule));
+    publish_output_line(title, (size_t)length);
+    publish_output_line(rule, strlen(rule));
+    publish_output_line("", 0);
+    pthread_mutex_unlock(&log_block_mutex);
+
+    notify_log_writer();
 }
 
 void write_install_log(const char *format, ...)
 {
-    FILE *log_file = fopen(CONFIG_INSTALL_LOG_PATH, "a");
-    if (log_file)
+    char message[COMMON_MAX_COMMAND_LENGTH];
+    va_list arguments;
+    va_start(arguments, format);
+    int length = vsnprintf(message, sizeof(message), format, arguments);
+    va_end(arguments);
+    if (length < 0)
+    {
+        return;
+    }
+    if (length >= (int)sizeof(message))
     {
-        va_list arguments;
-        va_start(arguments, format);
-        vfprintf(log_file, format, arguments);
-        va_end(arguments);
-        fprintf(log_file, "\n");
-        fclose(log_file);
+        length = sizeof(message) - 1;
     }
+
+    // Split the message into lines as if a command had printed it.
+    LogCapture capture;
+    start_install_log_capture(&capture);
+    append_install_log_capture(&capture, message, (size_t)length);
+    finish_install_log_capture(&capture);
 }
 
 char **read_install_log_lines(int max_lines, int *out_count)
@@ -47,54 +444,105 @@ char **read_install_log_lines(int max_lines, int *out_count)
     // Initialize output count to zero.
     *out_count = 0;
 
-    // Open log file for reading.
-    FILE *log_file = fopen(CONFIG_INSTALL_LOG_PATH, "r");
-    if (!log_file)
-    {
-        return NULL;
-    }
-
     // Allocate array to hold line pointers.
     char **lines = calloc(max_lines, sizeof(char *));
     if (!lines)
     {
-        fclose(log_file);
         return NULL;
     }
 
-    // Initialize line buffer and counter.
-    char line_buffer[512];
-    int line_count = 0;
-
-    // Read lines into circular buffer, keeping only the last max_lines.
-    while (fgets(line_buffer, sizeof(line_buffer), log_file))
+    // Start max_lines back from the newest line, but not before this installation.
+    OutputCursor cursor = { get_output_head(), 0 };
+    cursor.position = cursor.position > (unsigned long long)max_lines
+        ? cursor.position - (unsigned long long)max_lines : 0;
+    if (cursor.position < log_start)
     {
-        // Remove trailing newline.
-        size_t length = strlen(line_buffer);
-        if (length > 0 && line_buffer[length - 1] == '\n')
-        {
-            line_buffer[length - 1] = '\0';
-        }
+        cursor.position = log_start;
+    }
 
-        // Shift buffer and free oldest line if full.
-        if (line_count >= max_lines)
+    // Copy lines out of the ring, stopping at the newest.
+    char line_buffer[OUTPUT_LINE_BYTES];
+    int line_count = 0;
+    while (line_count < max_lines && read_output_line(&cursor, line_buffer, sizeof(line_buffer)))
+    {
+        lines[line_count] = strdup(line_buffer);
+        if (!lines[line_count])
         {
-            free(lines[0]);
-            memmove(lines, lines + 1, (max_lines - 1) * sizeof(char *));
-            line_count = max_lines - 1;
+            break;
         }
-
-        // Store duplicate of current line.
-        lines[line_count] = strdup(line_buffer);
         line_count++;
     }
 
-    // Close file and return results.
-    fclose(log_file);
     *out_count = line_count;
     return lines;
 }
 
+int open_install_log_tail(LogTail *tail, int capacity)
+{
+    memset(tail, 0, sizeof(*tail));
+    tail->lines = malloc((size_t)capacity * sizeof(*tail->lines));
+    if (!tail->lines)
+    {
+        return -1;
+    }
+    tail->capacity = capacity;
+    tail->start = log_start;
+    tail->cursor.position = log_start;
+    return 0;
+}
+
+int update_install_log_tail(LogTail *tail)
+{
+    // Start over when a new installation has begun since the last update.
+    if (tail->start != log_start)
+    {
+        tail->start = log_start;
+        tail->cursor.position = log_start;
+        tail->first = 0;
+        tail->count = 0;
+    }
+
+    // Skip lines that would be pushed out of the tail before being shown.
+    unsigned long long head = get_output_head();
+    if (head - tail->cursor.position > (unsigned long long)tail->capacity)
+    {
+        tail->cursor.position = head - (unsigned long long)tail->capacity;
+    }
+
+    // Copy new lines in, overwriting the oldest once the tail is full.
+    int added = 0;
+    char line[OUTPUT_LINE_BYTES];
+    while (read_output_line(&tail->cursor, line, sizeof(line)))
+    {
+        if (tail->count == tail->capacity)
+        {
+            memcpy(tail->lines[tail->first], line, strlen(line) + 1);
+            tail->first = (tail->first + 1) % tail->capacity;
+        }
+        else
+        {
+            memcpy(tail->lines[(tail->first + tail->count) % tail->capacity], line, strlen(line) + 1);
+            tail->count++;
+        }
+        added++;
+    }
+
+    return added;
+}
+
+const char *get_install_log_tail_line(const LogTail *tail, int index)
+{
+    return tail->lines[(tail->first + index) % tail->capacity];
+}
+
+void close_install_log_tail(LogTail *tail)
+{
+    free(tail->lines);
+    tail->lines = NULL;
+    tail->capacity = 0;
+    tail->count = 0;
+}
+
 void free_install_log_lines(char **lines, int count)
 {
     if (!lines) return;
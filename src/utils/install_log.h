@@ -1,20 +1,58 @@
 #pragma once
+#include "../all.h"
+
+/**
+ * A type representing a partial line of command output being captured, and
+ * when held, the complete lines waiting to be published together.
+ */
+typedef struct {
+    char partial[OUTPUT_LINE_BYTES];
+    size_t length;
+    int returned;
+    int hold;
+    char *held;
+    size_t held_length;
+    size_t held_capacity;
+} LogCapture;
+
+/**
+ * A type representing a persistent view of the newest lines of the
+ * installation log, kept in a circular buffer that is reused between reads.
+ */
+typedef struct {
+    OutputCursor cursor;
+    unsigned long long start;
+    char (*lines)[OUTPUT_LINE_BYTES];
+    int capacity;
+    int first;
+    int count;
+} LogTail;
 
 /**
  * Initializes the installation log file by clearing any existing content.
  * Should be called at the start of installation before any commands are run.
+ *
+ * From then on, lines are appended to the file by a background writer,
+ * which flushes every LOG_FLUSH_INTERVAL_MS or sooner when many lines are
+ * waiting. Before initialization, every write is flushed straight away.
  */
 void init_install_log(void);
 
 /**
- * Writes a step header to the installation log file.
+ * Stops the background writer, writes the remaining lines and closes the
+ * log file. Later writes are flushed straight away.
+ */
+void close_install_log(void);
+
+/**
+ * Writes a step header to the installation log.
  *
  * @param step_name The name of the step to write.
  */
 void write_install_log_header(const char *step_name);
 
 /**
- * Writes a message to the installation log file.
+ * Writes a message to the installation log.
  *
  * @param format Printf-style format string.
  * @param ... Format arguments.
@@ -22,8 +60,63 @@ void write_install_log_header(const char *step_name);
 void write_install_log(const char *format, ...);
 
 /**
- * Reads the last N lines from the install log file.
- * Caller must free the result using free_install_log_lines().
+ * Appends lines published since the last flush to the install log file
+ * before returning.
+ *
+ * Used at phase boundaries, on failure paths and before rebooting, so the
+ * file is complete whenever the installation may stop.
+ */
+void flush_install_log(void);
+
+/**
+ * Starts capturing command output into the installation log.
+ *
+ * @param capture The capture to initialize.
+ */
+void start_install_log_capture(LogCapture *capture);
+
+/**
+ * Makes a capture keep its lines until it is finished, then publish them as
+ * one block, so output of commands running side by side is not interleaved.
+ *
+ * @param capture The capture to hold, before any output is drained into it.
+ */
+void hold_install_log_capture(LogCapture *capture);
+
+/**
+ * Reads what is available from a non-blocking descriptor into the
+ * installation log, publishing each complete line.
+ *
+ * At most LOG_DRAIN_MAX_BYTES are read per call, about one pipe buffer, so
+ * a command that keeps writing cannot hold up the caller's event loop; the
+ * descriptor then stays readable for the next call.
+ *
+ * A carriage return lets the text after it replace the line, so progress
+ * counters are logged once with their final value.
+ *
+ * @param capture The capture the output belongs to.
+ * @param fd The descriptor to read.
+ *
+ * @return - `1` - Indicates the end of the output was reached.
+ * @return - `0` - Indicates no more output is available yet.
+ * @return - `-1` - Indicates the descriptor could not be read.
+ */
+int drain_install_log_capture(LogCapture *capture, int fd);
+
+/**
+ * Publishes the last line of captured output if it lacked a newline, and
+ * the lines of a held capture.
+ *
+ * @param capture The capture to finish.
+ */
+void finish_install_log_capture(LogCapture *capture);
+
+/**
+ * Reads the last N lines of the installation log.
+ *
+ * Lines come from the in-memory output ring rather than the log file, so
+ * this does no file I/O. Caller must free the result using
+ * free_install_log_lines().
  *
  * @param max_lines Maximum number of lines to return.
  * @param out_count Output: actual number of lines returned.
@@ -31,6 +124,47 @@ void write_install_log(const char *format, ...);
  */
 char **read_install_log_lines(int max_lines, int *out_count);
 
+/**
+ * Opens a tail of the installation log holding up to capacity lines.
+ *
+ * @param tail The tail to initialize.
+ * @param capacity The number of newest lines to keep.
+ *
+ * @return - `0` - Indicates success.
+ * @return - `-1` - Indicates the line buffer could not be allocated.
+ */
+int open_install_log_tail(LogTail *tail, int capacity);
+
+/**
+ * Brings a tail up to date with the installation log.
+ *
+ * Only lines published since the previous update are copied, and only as
+ * many as fit, so the cost depends on new output rather than the size of
+ * the log.
+ *
+ * @param tail The tail to update.
+ *
+ * @return The number of lines added to the tail.
+ */
+int update_install_log_tail(LogTail *tail);
+
+/**
+ * Gets a line of a tail.
+ *
+ * @param tail The tail to read.
+ * @param index The line's index, from 0 for the oldest up to the tail's count.
+ *
+ * @return The line, valid until the next update.
+ */
+const char *get_install_log_tail_line(const LogTail *tail, int index);
+
+/**
+ * Releases a tail's line buffer.
+ *
+ * @param tail The tail to close.
+ */
+void close_install_log_tail(LogTail *tail);
+
 /**
  * Frees a lines array returned by read_install_log_lines().
  *
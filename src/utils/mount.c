@@ -0,0 +1,385 @@
+/**
+ * This code is responsible for mounting and unmounting filesystems and
+ * creating mount points through system calls, instead of starting mount(8),
+ * umount(8) and mkdir(1) for each of them, and for keeping a registry of
+ * what was mounted so cleanup unmounts exactly that.
+ */
+
+#include "../all.h"
+
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static char registry[MOUNT_REGISTRY_SIZE][MOUNT_MAX_TARGET_LEN];
+static int registry_count = 0;
+
+static void register_mount(const char *target)
+{
+    pthread_mutex_lock(&registry_mutex);
+
+    // Keep one entry per target, in the order they were first mounted.
+    for (int i = 0; i < registry_count; i++)
+    {
+        if (strcmp(registry[i], target) == 0)
+        {
+            pthread_mutex_unlock(&registry_mutex);
+            return;
+        }
+    }
+    if (registry_count < MOUNT_REGISTRY_SIZE && strlen(target) < MOUNT_MAX_TARGET_LEN)
+    {
+        snprintf(registry[registry_count++], MOUNT_MAX_TARGET_LEN, "%s", target);
+    }
+    else
+    {
+        write_install_log("Warning: cannot track the mount at %s", target);
+    }
+
+    pthread_mutex_unlock(&registry_mutex);
+}
+
+static void unregister_mount(const char *target)
+{
+    pthread_mutex_lock(&registry_mutex);
+    for (int i = 0; i < registry_count; i++)
+    {
+        if (strcmp(registry[i], target) == 0)
+        {
+            // Close the gap, keeping the mount order of the others.
+            memmove(registry[i], registry[i + 1], (size_t)(registry_count - i - 1) * MOUNT_MAX_TARGET_LEN);
+            registry_count--;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&registry_mutex);
+}
+
+int is_mount_registered(const char *target)
+{
+    pthread_mutex_lock(&registry_mutex);
+    int registered = 0;
+    for (int i = 0; i < registry_count && !registered; i++)
+    {
+        registered = strcmp(registry[i], target) == 0;
+    }
+    pthread_mutex_unlock(&registry_mutex);
+    return registered;
+}
+
+static void format_mount_options(unsigned long flags, const char *options, char *out_list, size_t list_size)
+{
+    // Collect the flags and data options into one comma-separated list.
+    size_t length = 0;
+    out_list[0] = '\0';
+    if (flags & MS_REMOUNT)
+    {
+        length += (size_t)snprintf(out_list + length, list_size - length, ",remount");
+    }
+    if ((flags & MS_NOATIME) && length < list_size)
+    {
+        length += (size_t)snprintf(out_list + length, list_size - length, ",noatime");
+    }
+    if ((flags & MS_RELATIME) && length < list_size)
+    {
+        length += (size_t)snprintf(out_list + length, list_size - length, ",relatime");
+    }
+    if (options && options[0] && length < list_size)
+    {
+        snprintf(out_list + length, list_size - length, ",%s", options);
+    }
+}
+
+int mount_filesystem(
+    const char *source, const char *target, const char *type,
+    unsigned long flags, const char *options
+)
+{
+    Store *store = get_store();
+    char option_list[256];
+    format_mount_options(flags, options, option_list, sizeof(option_list));
+    const char *shown_options = option_list[0] ? option_list + 1 : "";
+
+    // In dry-run mode, only record the command mount(8) would be given,
+    // which takes no source for a remount.
+    if (store->dry_run)
+    {
+        write_dry_run_log(
+            "mount%s%s%s%s%s %s%s%s",
+            (flags & MS_BIND) ? " --bind" : "",
+            type ? " -t " : "", type ? type : "",
+            shown_options[0] ? " -o " : "", shown_options,
+            source ? source : "", source ? " " : "", target
+        );
+        if (!(flags & MS_REMOUNT))
+        {
+            register_mount(target);
+        }
+        return 0;
+    }
+
+    if (mount(source, target, type, flags, options) != 0)
+    {
+        write_install_log(
+            "Failed to mount %s%s%s (%s): %s", source ? source : "", source ? " at " : "",
+            target, shown_options, strerror(errno)
+        );
+        return -1;
+    }
+    write_install_log(
+        "Mounted %s%s%s (%s)", source ? source : "", source ? " at " : "", target, shown_options
+    );
+    if (!(flags & MS_REMOUNT))
+    {
+        register_mount(target);
+    }
+    return 0;
+}
+
+int unmount_filesystem(const char *target)
+{
+    Store *store = get_store();
+
+    // In dry-run mode, only record the unmount.
+    if (store->dry_run)
+    {
+        write_dry_run_log("umount %s", target);
+        unregister_mount(target);
+        return 0;
+    }
+
+    if (umount2(target, 0) != 0)
+    {
+        return -1;
+    }
+    write_install_log("Unmounted %s", target);
+    unregister_mount(target);
+    return 0;
+}
+
+static void unescape_mountinfo_path(char *path)
+{
+    // Spaces, tabs, newlines and backslashes are written as octal escapes.
+    char *out = path;
+    for (char *in = path; *in; in++)
+    {
+        if (in[0] == '\\' && in[1] >= '0' && in[1] <= '3' &&
+            in[2] >= '0' && in[2] <= '7' && in[3] >= '0' && in[3] <= '7')
+        {
+            *out++ = (char)((in[1] - '0') * 64 + (in[2] - '0') * 8 + (in[3] - '0'));
+            in += 3;
+        }
+        else
+        {
+            *out++ = *in;
+        }
+    }
+    *out = '\0';
+}
+
+static void find_mounted_targets(UnmountPlan *plan)
+{
+    // Without the mount table, try every target.
+    FILE *file = fopen(MOUNT_INFO_PATH, "r");
+    if (file == NULL)
+    {
+        for (int i = 0; i < plan->count; i++)
+        {
+            plan->pending[i] = 1;
+        }
+        return;
+    }
+
+    // The mount point is the fifth field of each line.
+    char line[PATH_MAX + 512];
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        char mount_point[PATH_MAX];
+        if (sscanf(line, "%*s %*s %*s %*s %4095s", mount_point) != 1)
+        {
+            continue;
+        }
+        unescape_mountinfo_path(mount_point);
+        for (int i = 0; i < plan->count; i++)
+        {
+            if (strcmp(plan->targets[i], mount_point) == 0)
+            {
+                plan->pending[i] = 1;
+            }
+        }
+    }
+    fclose(file);
+}
+
+static int is_below_target(const char *path, const char *target)
+{
+    size_t length = strlen(target);
+    return strncmp(path, target, length) == 0 && path[length] == '/';
+}
+
+static void unmount_planned_target(UnmountPlan *plan, int index)
+{
+    const char *target = plan->targets[index];
+    if (plan->before_unmount)
+    {
+        plan->before_unmount(target, plan->context);
+    }
+    if (unmount_filesystem(target) == 0)
+    {
+        return;
+    }
+
+    // Detach a busy filesystem, so it is released once nothing uses it.
+    int error = errno;
+    write_install_log("Warning: could not unmount %s (%s), detaching it", target, strerror(error));
+    if (umount2(target, MNT_DETACH) == 0)
+    {
+        unregister_mount(target);
+    }
+    else
+    {
+        write_install_log("Failed to detach %s: %s", target, strerror(errno));
+    }
+    pthread_mutex_lock(&plan->mutex);
+    plan->unclean_count++;
+    pthread_mutex_unlock(&plan->mutex);
+}
+
+static void *run_unmount_worker(void *argument)
+{
+    UnmountWorker *worker = argument;
+    unmount_planned_target(worker->plan, worker->index);
+    return NULL;
+}
+
+int unmount_registered_filesystems(MountCallback before_unmount, void *context)
+{
+    Store *store = get_store();
+    UnmountPlan plan;
+    memset(&plan, 0, sizeof(plan));
+    plan.before_unmount = before_unmount;
+    plan.context = context;
+
+    // Take the registered targets, in the order they were mounted.
+    pthread_mutex_lock(&registry_mutex);
+    memcpy(plan.targets, registry, sizeof(registry));
+    plan.count = registry_count;
+    pthread_mutex_unlock(&registry_mutex);
+
+    // Skip targets something else already unmounted, reading the mount
+    // table once. A dry run mounts nothing, so trusts the registry.
+    if (store->dry_run)
+    {
+        for (int i = 0; i < plan.count; i++)
+        {
+            plan.pending[i] = 1;
+        }
+    }
+    else
+    {
+        find_mounted_targets(&plan);
+        for (int i = 0; i < plan.count; i++)
+        {
+            if (!plan.pending[i])
+            {
+                write_install_log("%s is no longer mounted", plan.targets[i]);
+                unregister_mount(plan.targets[i]);
+            }
+        }
+    }
+
+    // Unmount in rounds, each taking every target with nothing still
+    // mounted below it, so sibling subtrees are unmounted together.
+    pthread_mutex_init(&plan.mutex, NULL);
+    while (1)
+    {
+        int round[MOUNT_REGISTRY_SIZE];
+        int round_count = 0;
+        for (int i = plan.count - 1; i >= 0; i--)
+        {
+            int is_leaf = plan.pending[i];
+            for (int j = 0; j < plan.count && is_leaf; j++)
+            {
+                is_leaf = !(j != i && plan.pending[j] && is_below_target(plan.targets[j], plan.targets[i]));
+            }
+            if (is_leaf)
+            {
+                round[round_count++] = i;
+            }
+        }
+        if (round_count == 0)
+        {
+            break;
+        }
+
+        // Unmount the round on the calling thread and one thread for each
+        // other target, or one by one in a dry run to keep the log in order.
+        UnmountWorker workers[MOUNT_REGISTRY_SIZE];
+        pthread_t threads[MOUNT_REGISTRY_SIZE];
+        int started[MOUNT_REGISTRY_SIZE] = {0};
+        for (int i = 1; i < round_count && !store->dry_run; i++)
+        {
+            workers[i].plan = &plan;
+            workers[i].index = round[i];
+            started[i] = pthread_create(&threads[i], NULL, run_unmount_worker, &workers[i]) == 0;
+        }
+        for (int i = 0; i < round_count; i++)
+        {
+            if (!started[i])
+            {
+                unmount_planned_target(&plan, round[i]);
+            }
+        }
+        for (int i = 0; i < round_count; i++)
+        {
+            if (started[i])
+            {
+                pthread_join(threads[i], NULL);
+            }
+            plan.pending[round[i]] = 0;
+        }
+    }
+    pthread_mutex_destroy(&plan.mutex);
+
+    return plan.unclean_count;
+}
+
+int create_mount_point(const char *path)
+{
+    Store *store = get_store();
+
+    // In dry-run mode, only record the directories.
+    if (store->dry_run)
+    {
+        write_dry_run_log("mkdir -p %s", path);
+        return 0;
+    }
+
+    char partial[PATH_MAX];
+    if (path[0] != '/' || (size_t)snprintf(partial, sizeof(partial), "%s", path) >= sizeof(partial))
+    {
+        return -1;
+    }
+
+    // Walk down from the root, creating each missing directory relative to
+    // its parent, so every step resolves a single name.
+    int dir_fd = open("/", O_PATH | O_DIRECTORY | O_CLOEXEC);
+    char *save = NULL;
+    for (char *name = strtok_r(partial, "/", &save); name != NULL && dir_fd >= 0; name = strtok_r(NULL, "/", &save))
+    {
+        if (mkdirat(dir_fd, name, 0755) != 0 && errno != EEXIST)
+        {
+            write_install_log("Failed to create %s: %s", path, strerror(errno));
+            close(dir_fd);
+            return -2;
+        }
+        int child_fd = openat(dir_fd, name, O_PATH | O_DIRECTORY | O_CLOEXEC);
+        close(dir_fd);
+        dir_fd = child_fd;
+    }
+    if (dir_fd < 0)
+    {
+        write_install_log("Failed to create %s: %s", path, strerror(errno));
+        return -2;
+    }
+    close(dir_fd);
+
+    return 0;
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include "../all.h"
+
+/** The mount table of the installer's mount namespace. */
+#define MOUNT_INFO_PATH "/proc/self/mountinfo"
+
+/** The number of mounts the registry keeps track of. */
+#define MOUNT_REGISTRY_SIZE (MAX_PARTITIONS + 8)
+
+/** The longest mount target the registry keeps track of. */
+#define MOUNT_MAX_TARGET_LEN 256
+
+/** A type representing a callback run on a mount target before unmounting. */
+typedef void (*MountCallback)(const char *target, void *context);
+
+/** A type representing the registered mounts being unmounted together. */
+typedef struct {
+    char targets[MOUNT_REGISTRY_SIZE][MOUNT_MAX_TARGET_LEN];
+    int pending[MOUNT_REGISTRY_SIZE];
+    int count;
+    MountCallback before_unmount;
+    void *context;
+    pthread_mutex_t mutex;
+    int unclean_count;
+} UnmountPlan;
+
+/** A type representing one mount a thread unmounts for a plan. */
+typedef struct {
+    UnmountPlan *plan;
+    int index;
+} UnmountWorker;
+
+/**
+ * Mounts a filesystem with mount(2).
+ *
+ * The target is added to the mount registry, so it is unmounted by
+ * unmount_registered_filesystems(). In dry-run mode, the equivalent mount(8)
+ * command line is written to the dry-run log instead, with MS_BIND as
+ * `--bind`, and MS_REMOUNT, MS_NOATIME and MS_RELATIME ahead of the data
+ * options in `-o`, and the target is still registered.
+ *
+ * @param source The device or filesystem to mount, or NULL for a remount.
+ * @param target The directory to mount it at.
+ * @param type The filesystem type, or NULL for a bind mount or remount.
+ * @param flags The MS_* mount flags.
+ * @param options The filesystem-specific options, or NULL for none.
+ *
+ * @return - `0` - Indicates the filesystem was mounted.
+ * @return - `-1` - Indicates mount(2) failed.
+ */
+int mount_filesystem(
+    const char *source, const char *target, const char *type,
+    unsigned long flags, const char *options
+);
+
+/**
+ * Unmounts a filesystem with umount2(2), removing it from the registry.
+ *
+ * In dry-run mode, `umount <target>` is written to the dry-run log instead.
+ *
+ * @param target The directory the filesystem is mounted at.
+ *
+ * @return - `0` - Indicates the filesystem was unmounted.
+ * @return - `-1` - Indicates umount2(2) failed.
+ */
+int unmount_filesystem(const char *target);
+
+/**
+ * Checks whether a target is in the mount registry, so it was mounted by
+ * mount_filesystem() and has not been unmounted since.
+ *
+ * @param target The directory to look for.
+ *
+ * @return - `1` - Indicates the target is registered.
+ * @return - `0` - Indicates the target is not registered.
+ */
+int is_mount_registered(const char *target);
+
+/**
+ * Unmounts every registered filesystem that is still mounted.
+ *
+ * The registry is checked against one read of MOUNT_INFO_PATH, and targets
+ * no longer mounted are dropped without being touched. The rest are
+ * unmounted children first, in rounds: each round takes every target with
+ * no registered target still mounted below it, unmounting them concurrently
+ * on their own threads. A target that cannot be unmounted is detached
+ * lazily with a logged warning.
+ *
+ * In dry-run mode, the registry is trusted as is, and each round is logged
+ * one target at a time, latest mounted first.
+ *
+ * @param before_unmount Called with each target just before it is
+ *                       unmounted, possibly on another thread, or NULL.
+ * @param context The context passed to before_unmount.
+ *
+ * @return The number of filesystems that had to be detached or could not
+ *         be unmounted at all.
+ */
+int unmount_registered_filesystems(MountCallback before_unmount, void *context);
+
+/**
+ * Creates a mount point and any missing ancestors, as `mkdir -p` would.
+ *
+ * In dry-run mode, `mkdir -p <path>` is written to the dry-run log instead.
+ *
+ * @param path The absolute path of the mount point.
+ *
+ * @return - `0` - Indicates the directory exists.
+ * @return - `-1` - Indicates the path is not absolute or too long.
+ * @return - `-2` - Indicates a directory could not be created.
+ */
+int create_mount_point(const char *path);
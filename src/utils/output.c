@@ -0,0 +1,87 @@
+/**
+ * This code is responsible for the output ring, a fixed-size broadcast
+ * buffer of log lines. Producers publish without locks, and each consumer,
+ * such as the install log file or the log viewer, reads at its own pace.
+ */
+
+#include "../all.h"
+
+/** A type representing one line of the ring, guarded by a sequence number. */
+typedef struct {
+    _Atomic unsigned long long sequence;
+    char text[OUTPUT_LINE_BYTES];
+} OutputSlot;
+
+static OutputSlot output_ring[OUTPUT_RING_LINES];
+static _Atomic unsigned long long output_head = 0;
+
+void publish_output_line(const char *text, size_t length)
+{
+    // Claim the next position; its slot holds it once the sequence reads
+    // 2 * position + 2, and an odd sequence marks a write in progress.
+    unsigned long long position = atomic_fetch_add(&output_head, 1);
+    OutputSlot *slot = &output_ring[position & (OUTPUT_RING_LINES - 1)];
+    atomic_store_explicit(&slot->sequence, position * 2 + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    // Copy the line, then publish it.
+    if (length > OUTPUT_LINE_BYTES - 1)
+    {
+        length = OUTPUT_LINE_BYTES - 1;
+    }
+    memcpy(slot->text, text, length);
+    slot->text[length] = '\0';
+    atomic_store_explicit(&slot->sequence, position * 2 + 2, memory_order_release);
+}
+
+int read_output_line(OutputCursor *cursor, char *out_text, size_t text_size)
+{
+    while (1)
+    {
+        // Skip lines that have already been overwritten.
+        unsigned long long head = atomic_load_explicit(&output_head, memory_order_acquire);
+        if (cursor->position >= head)
+        {
+            return 0;
+        }
+        if (head - cursor->position > OUTPUT_RING_LINES)
+        {
+            cursor->dropped += head - cursor->position - OUTPUT_RING_LINES;
+            cursor->position = head - OUTPUT_RING_LINES;
+        }
+
+        // Wait for the producer to finish writing the line.
+        OutputSlot *slot = &output_ring[cursor->position & (OUTPUT_RING_LINES - 1)];
+        unsigned long long expected = cursor->position * 2 + 2;
+        unsigned long long before = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        if (before < expected)
+        {
+            return 0;
+        }
+
+        // Copy the line, dropping it if it was overwritten meanwhile.
+        if (before == expected)
+        {
+            size_t length = strnlen(slot->text, OUTPUT_LINE_BYTES - 1);
+            if (length > text_size - 1)
+            {
+                length = text_size - 1;
+            }
+            memcpy(out_text, slot->text, length);
+            out_text[length] = '\0';
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&slot->sequence, memory_order_relaxed) == expected)
+            {
+                cursor->position++;
+                return 1;
+            }
+        }
+        cursor->dropped++;
+        cursor->position++;
+    }
+}
+
+unsigned long long get_output_head(void)
+{
+    return atomic_load_explicit(&output_head, memory_order_acquire);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "../all.h"
+
+/** The number of lines the output ring holds; a power of two. */
+#define OUTPUT_RING_LINES 2048
+
+/** The size of each line in the output ring, including the terminator. */
+#define OUTPUT_LINE_BYTES 256
+
+/** A type representing one consumer's position in the output ring. */
+typedef struct {
+    unsigned long long position;
+    unsigned long long dropped;
+} OutputCursor;
+
+/**
+ * Publishes a line to the output ring, overwriting the oldest line when the
+ * ring is full.
+ *
+ * Safe to call from any number of threads at once without locking. Lines
+ * longer than OUTPUT_LINE_BYTES - 1 are truncated.
+ *
+ * @param text The line, without a trailing newline.
+ * @param length The length of the line in bytes.
+ */
+void publish_output_line(const char *text, size_t length);
+
+/**
+ * Reads the next line after a cursor and advances it.
+ *
+ * Each consumer keeps its own cursor, so every consumer sees every line.
+ * Lines overwritten before the consumer reached them are skipped and counted
+ * in the cursor's dropped field.
+ *
+ * @param cursor The consumer's cursor.
+ * @param out_text Output: the line, NUL-terminated.
+ * @param text_size The size of the output buffer.
+ *
+ * @return - `1` - Indicates a line was read.
+ * @return - `0` - Indicates no newer line has been published.
+ */
+int read_output_line(OutputCursor *cursor, char *out_text, size_t text_size);
+
+/**
+ * Gets the position the next published line will take.
+ *
+ * @return The number of lines ever published.
+ */
+unsigned long long get_output_head(void);
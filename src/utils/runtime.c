@@ -0,0 +1,298 @@
+/**
+ * This code is responsible for the event loop used while waiting on child
+ * processes, so that completions are observed as they happen and interface
+ * ticks follow a timer instead of a polling interval.
+ */
+
+#include "../all.h"
+
+/** The epoll tag of the tick timer. */
+#define RUNTIME_TAG_TIMER 0
+
+/** The epoll tag of terminal input. */
+#define RUNTIME_TAG_INPUT 1
+
+/** The epoll tag of watched descriptors. */
+#define RUNTIME_TAG_WATCH 2
+
+/** The first epoll tag of processes; the process's pid follows it. */
+#define RUNTIME_TAG_PROCESS 3
+
+static int set_input_watch(Runtime *runtime, int enabled)
+{
+    struct epoll_event event = { .events = enabled ? EPOLLIN : 0, .data.u64 = RUNTIME_TAG_INPUT };
+    runtime->input_paused = !enabled;
+    return epoll_ctl(runtime->epoll_fd, EPOLL_CTL_MOD, runtime->input_fd, &event);
+}
+
+int open_runtime(Runtime *runtime, RuntimeTickCallback tick, int first_tick_ms)
+{
+    memset(runtime, 0, sizeof(*runtime));
+    runtime->timer_fd = -1;
+    runtime->input_fd = -1;
+    runtime->tick = tick;
+    runtime->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (runtime->epoll_fd < 0)
+    {
+        return -1;
+    }
+    if (!tick)
+    {
+        return 0;
+    }
+
+    // Arm the tick timer, keeping a zero first delay from disarming it.
+    runtime->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    long first_tick_ns = first_tick_ms > 0 ? first_tick_ms * 1000000L : 1;
+    struct itimerspec interval = {
+        .it_interval = { 0, COMMAND_TICK_INTERVAL_MS * 1000000L },
+        .it_value = { first_tick_ns / 1000000000L, first_tick_ns % 1000000000L },
+    };
+    struct epoll_event event = { .events = EPOLLIN, .data.u64 = RUNTIME_TAG_TIMER };
+    if (runtime->timer_fd < 0 || timerfd_settime(runtime->timer_fd, 0, &interval, NULL) != 0 ||
+        epoll_ctl(runtime->epoll_fd, EPOLL_CTL_ADD, runtime->timer_fd, &event) != 0)
+    {
+        close_runtime(runtime);
+        return -1;
+    }
+
+    // Wake up on key presses when running in a terminal.
+    if (isatty(STDIN_FILENO))
+    {
+        event.data.u64 = RUNTIME_TAG_INPUT;
+        if (epoll_ctl(runtime->epoll_fd, EPOLL_CTL_ADD, STDIN_FILENO, &event) == 0)
+        {
+            runtime->input_fd = STDIN_FILENO;
+        }
+    }
+
+    return 0;
+}
+
+int add_runtime_process(Runtime *runtime, pid_t pid)
+{
+    if (runtime->process_count >= RUNTIME_MAX_PROCESSES)
+    {
+        return -1;
+    }
+
+    // Watch the process through a pidfd, which becomes readable when it exits.
+    int pidfd = (int)syscall(SYS_pidfd_open, pid, 0);
+    if (pidfd < 0)
+    {
+        return -1;
+    }
+    struct epoll_event event = { .events = EPOLLIN, .data.u64 = RUNTIME_TAG_PROCESS + (uint64_t)pid };
+    if (epoll_ctl(runtime->epoll_fd, EPOLL_CTL_ADD, pidfd, &event) != 0)
+    {
+        close(pidfd);
+        return -1;
+    }
+
+    RuntimeProcess *process = &runtime->processes[runtime->process_count++];
+    process->pid = pid;
+    process->pidfd = pidfd;
+    process->finished = 0;
+    process->result = 0;
+    memset(&process->usage, 0, sizeof(process->usage));
+    return 0;
+}
+
+int watch_runtime_descriptor(Runtime *runtime, int fd)
+{
+    struct epoll_event event = { .events = EPOLLIN, .data.u64 = RUNTIME_TAG_WATCH };
+    return epoll_ctl(runtime->epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0 ? 0 : -1;
+}
+
+void unwatch_runtime_descriptor(Runtime *runtime, int fd)
+{
+    epoll_ctl(runtime->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+static RuntimeProcess *find_runtime_process(Runtime *runtime, pid_t pid)
+{
+    for (int i = 0; i < runtime->process_count; i++)
+    {
+        if (runtime->processes[i].pid == pid)
+        {
+            return &runtime->processes[i];
+        }
+    }
+    return NULL;
+}
+
+static void read_process_io(pid_t pid, ProcessUsage *usage)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/io", (int)pid);
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        return;
+    }
+
+    // Pick the storage counters out of the accounting lines.
+    char line[128];
+    while (fgets(line, sizeof(line), file))
+    {
+        sscanf(line, "read_bytes: %llu", &usage->read_bytes);
+        sscanf(line, "write_bytes: %llu", &usage->write_bytes);
+    }
+    fclose(file);
+}
+
+static int reap_runtime_process(Runtime *runtime, pid_t pid)
+{
+    RuntimeProcess *process = find_runtime_process(runtime, pid);
+    if (!process || process->finished)
+    {
+        return 0;
+    }
+
+    // Read the I/O counters while the exited process can still be looked up.
+    if (runtime->collect_io)
+    {
+        read_process_io(pid, &process->usage);
+    }
+
+    // Collect the exit status and CPU time, which are available now that the
+    // pidfd is readable.
+    int status;
+    struct rusage usage;
+    pid_t result = wait4(pid, &status, WNOHANG, &usage);
+    if (result == 0 || (result < 0 && errno == EINTR))
+    {
+        return 0;
+    }
+    if (result < 0)
+    {
+        process->result = -2;
+    }
+    else
+    {
+        process->result = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+        process->usage.user_us = usage.ru_utime.tv_sec * 1000000LL + usage.ru_utime.tv_usec;
+        process->usage.system_us = usage.ru_stime.tv_sec * 1000000LL + usage.ru_stime.tv_usec;
+    }
+
+    // Stop watching the process.
+    process->finished = 1;
+    epoll_ctl(runtime->epoll_fd, EPOLL_CTL_DEL, process->pidfd, NULL);
+    close(process->pidfd);
+    process->pidfd = -1;
+    return 1;
+}
+
+int run_runtime(Runtime *runtime, int timeout_ms)
+{
+    struct epoll_event events[8];
+    int count = epoll_wait(runtime->epoll_fd, events, 8, timeout_ms);
+    if (count < 0)
+    {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    int handled = 0;
+    int ticked = 0;
+    for (int i = 0; i < count; i++)
+    {
+        uint64_t tag = events[i].data.u64;
+        if (tag == RUNTIME_TAG_TIMER)
+        {
+            // Tick once however many intervals have passed, and listen for keys again.
+            uint64_t expirations;
+            if (read(runtime->timer_fd, &expirations, sizeof(expirations)) > 0 && !ticked)
+            {
+                runtime->tick();
+                ticked = 1;
+            }
+            if (runtime->input_paused)
+            {
+                set_input_watch(runtime, 1);
+            }
+        }
+        else if (tag == RUNTIME_TAG_INPUT)
+        {
+            // Handle the key now, then ignore input until the next timer tick
+            // in case the tick leaves it unread.
+            if (!ticked)
+            {
+                runtime->tick();
+                ticked = 1;
+            }
+            set_input_watch(runtime, 0);
+        }
+        else if (tag == RUNTIME_TAG_WATCH)
+        {
+            handled++;
+        }
+        else
+        {
+            handled += reap_runtime_process(runtime, (pid_t)(tag - RUNTIME_TAG_PROCESS));
+        }
+    }
+
+    return handled;
+}
+
+int take_runtime_process(Runtime *runtime, pid_t pid, int *out_result, ProcessUsage *out_usage)
+{
+    RuntimeProcess *process = find_runtime_process(runtime, pid);
+    if (!process)
+    {
+        return -1;
+    }
+    if (!process->finished)
+    {
+        return 0;
+    }
+
+    // Remove the process by moving the last one into its place.
+    *out_result = process->result;
+    if (out_usage)
+    {
+        *out_usage = process->usage;
+    }
+    *process = runtime->processes[--runtime->process_count];
+    return 1;
+}
+
+int wait_runtime_process(Runtime *runtime, pid_t pid)
+{
+    int result;
+    while (1)
+    {
+        int taken = take_runtime_process(runtime, pid, &result, NULL);
+        if (taken != 0)
+        {
+            return taken > 0 ? result : -2;
+        }
+        if (run_runtime(runtime, -1) < 0)
+        {
+            return -2;
+        }
+    }
+}
+
+void close_runtime(Runtime *runtime)
+{
+    for (int i = 0; i < runtime->process_count; i++)
+    {
+        if (runtime->processes[i].pidfd >= 0)
+        {
+            close(runtime->processes[i].pidfd);
+        }
+    }
+    runtime->process_count = 0;
+    if (runtime->timer_fd >= 0)
+    {
+        close(runtime->timer_fd);
+        runtime->timer_fd = -1;
+    }
+    if (runtime->epoll_fd >= 0)
+    {
+        close(runtime->epoll_fd);
+        runtime->epoll_fd = -1;
+    }
+    runtime->input_fd = -1;
+}
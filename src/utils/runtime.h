@@ -0,0 +1,140 @@
+#pragma once
+#include "../all.h"
+
+/** The most child processes a runtime supervises at once. */
+#define RUNTIME_MAX_PROCESSES 16
+
+/** A type representing a function called on every runtime timer tick. */
+typedef void (*RuntimeTickCallback)(void);
+
+/** A type representing the resources a finished child process used. */
+typedef struct {
+    long long user_us;
+    long long system_us;
+    unsigned long long read_bytes;
+    unsigned long long write_bytes;
+} ProcessUsage;
+
+/** A type representing a child process supervised by a runtime. */
+typedef struct {
+    pid_t pid;
+    int pidfd;
+    int finished;
+    int result;
+    ProcessUsage usage;
+} RuntimeProcess;
+
+/**
+ * A type representing an event loop that supervises child processes through
+ * pidfds, ticks on a timerfd and wakes up on terminal input.
+ */
+typedef struct {
+    int epoll_fd;
+    int timer_fd;
+    int input_fd;
+    int input_paused;
+    RuntimeTickCallback tick;
+    RuntimeProcess processes[RUNTIME_MAX_PROCESSES];
+    int process_count;
+    int collect_io;
+} Runtime;
+
+/**
+ * Opens a runtime.
+ *
+ * With a tick callback, a timer invokes it every COMMAND_TICK_INTERVAL_MS,
+ * starting after first_tick_ms, and terminal input on stdin invokes it
+ * straight away. Without one, the runtime only waits for its processes and
+ * descriptors.
+ *
+ * @param runtime The runtime to initialize.
+ * @param tick The function to call on each tick, or NULL for none.
+ * @param first_tick_ms The delay before the first tick.
+ *
+ * @return - `0` - Indicates success.
+ * @return - `-1` - Indicates the epoll instance or timer could not be created.
+ */
+int open_runtime(Runtime *runtime, RuntimeTickCallback tick, int first_tick_ms);
+
+/**
+ * Starts supervising a child process of the caller.
+ *
+ * @param runtime The runtime to supervise with.
+ * @param pid The child process to supervise.
+ *
+ * @return - `0` - Indicates success.
+ * @return - `-1` - Indicates the runtime is full or pidfds are unsupported.
+ */
+int add_runtime_process(Runtime *runtime, pid_t pid);
+
+/**
+ * Wakes the runtime whenever a descriptor becomes readable.
+ *
+ * The caller is responsible for draining the descriptor.
+ *
+ * @param runtime The runtime to watch with.
+ * @param fd The descriptor to watch.
+ *
+ * @return - `0` - Indicates success.
+ * @return - `-1` - Indicates the descriptor could not be watched.
+ */
+int watch_runtime_descriptor(Runtime *runtime, int fd);
+
+/**
+ * Stops watching a descriptor, such as a pipe that reached its end.
+ *
+ * @param runtime The runtime watching the descriptor.
+ * @param fd The descriptor to stop watching.
+ */
+void unwatch_runtime_descriptor(Runtime *runtime, int fd);
+
+/**
+ * Waits for one round of events and handles them.
+ *
+ * Ticks are run and finished processes are reaped as their events arrive,
+ * recording their CPU time, and with collect_io set, the bytes they read
+ * and wrote from storage according to /proc/<pid>/io.
+ *
+ * @param runtime The runtime to run.
+ * @param timeout_ms The longest time to wait, or -1 to wait indefinitely.
+ *
+ * @return - `>0` - The number of processes that finished and watched
+ *                  descriptors that became readable.
+ * @return - `0` - Indicates only ticks happened, or the wait timed out.
+ * @return - `-1` - Indicates the wait failed.
+ */
+int run_runtime(Runtime *runtime, int timeout_ms);
+
+/**
+ * Collects the result of a finished process and stops supervising it.
+ *
+ * @param runtime The runtime supervising the process.
+ * @param pid The process to collect.
+ * @param out_result Output: the exit status, `-1` if the process terminated
+ *                   abnormally, or `-2` if it could not be waited for.
+ * @param out_usage Output: the resources the process used, or NULL.
+ *
+ * @return - `1` - Indicates the process finished and was collected.
+ * @return - `0` - Indicates the process is still running.
+ * @return - `-1` - Indicates the runtime does not supervise the process.
+ */
+int take_runtime_process(Runtime *runtime, pid_t pid, int *out_result, ProcessUsage *out_usage);
+
+/**
+ * Runs the runtime until a process finishes, then collects it.
+ *
+ * @param runtime The runtime supervising the process.
+ * @param pid The process to wait for.
+ *
+ * @return - `>=0` - The exit status of the process.
+ * @return - `-1` - Process terminated abnormally.
+ * @return - `-2` - Failed to wait for process.
+ */
+int wait_runtime_process(Runtime *runtime, pid_t pid);
+
+/**
+ * Releases a runtime's descriptors. Processes still running are left alone.
+ *
+ * @param runtime The runtime to close.
+ */
+void close_runtime(Runtime *runtime);
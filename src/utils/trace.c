@@ -0,0 +1,156 @@
+/**
+ * This code is responsible for recording the phases and commands of an
+ * installation as timed spans, and exporting them as Chrome trace-event
+ * JSON for viewing the installation as a timeline.
+ */
+
+#include "../all.h"
+
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static _Atomic int tracing = 0;
+static long long trace_start_us = 0;
+static TraceSpan *trace_spans = NULL;
+static size_t trace_span_count = 0;
+static size_t trace_span_capacity = 0;
+
+static long long get_monotonic_us(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000LL + now.tv_nsec / 1000;
+}
+
+void start_trace(void)
+{
+    pthread_mutex_lock(&trace_mutex);
+    trace_span_count = 0;
+    trace_start_us = get_monotonic_us();
+    tracing = 1;
+    pthread_mutex_unlock(&trace_mutex);
+}
+
+void stop_trace(void)
+{
+    pthread_mutex_lock(&trace_mutex);
+    tracing = 0;
+    free(trace_spans);
+    trace_spans = NULL;
+    trace_span_count = 0;
+    trace_span_capacity = 0;
+    pthread_mutex_unlock(&trace_mutex);
+}
+
+int is_tracing(void)
+{
+    return tracing;
+}
+
+void begin_trace_span(TraceSpan *span, const char *category, const char *name)
+{
+    memset(span, 0, sizeof(*span));
+    snprintf(span->name, sizeof(span->name), "%s", name);
+    span->category = category;
+    span->thread_id = (int)syscall(SYS_gettid);
+    span->start_us = get_monotonic_us();
+}
+
+void end_trace_span(TraceSpan *span, int status, const ProcessUsage *usage)
+{
+    if (!tracing)
+    {
+        return;
+    }
+    span->end_us = get_monotonic_us();
+    span->status = status;
+    if (usage)
+    {
+        span->has_usage = 1;
+        span->usage = *usage;
+    }
+
+    pthread_mutex_lock(&trace_mutex);
+
+    // Grow the span list geometrically when full.
+    if (trace_span_count == trace_span_capacity)
+    {
+        size_t capacity = trace_span_capacity ? trace_span_capacity * 2 : 256;
+        TraceSpan *spans = realloc(trace_spans, capacity * sizeof(TraceSpan));
+        if (!spans)
+        {
+            pthread_mutex_unlock(&trace_mutex);
+            return;
+        }
+        trace_spans = spans;
+        trace_span_capacity = capacity;
+    }
+    trace_spans[trace_span_count++] = *span;
+
+    pthread_mutex_unlock(&trace_mutex);
+}
+
+static void write_json_string(FILE *file, const char *text)
+{
+    fputc('"', file);
+    for (const unsigned char *c = (const unsigned char *)text; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            fprintf(file, "\\%c", *c);
+        }
+        else if (*c < 0x20)
+        {
+            fprintf(file, "\\u%04x", *c);
+        }
+        else
+        {
+            fputc(*c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+int write_trace(const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        return -1;
+    }
+
+    pthread_mutex_lock(&trace_mutex);
+
+    // Write each span as a complete event, with times relative to the start.
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    int pid = (int)getpid();
+    for (size_t i = 0; i < trace_span_count; i++)
+    {
+        const TraceSpan *span = &trace_spans[i];
+        fprintf(file, "%s{\"name\":", i ? ",\n" : "");
+        write_json_string(file, span->name);
+        fprintf(
+            file, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":%d,\"tid\":%d,"
+            "\"args\":{\"status\":%d",
+            span->category, span->start_us - trace_start_us, span->end_us - span->start_us,
+            pid, span->thread_id, span->status
+        );
+        if (span->has_usage)
+        {
+            fprintf(
+                file, ",\"user_ms\":%.3f,\"system_ms\":%.3f,\"read_bytes\":%llu,\"write_bytes\":%llu",
+                span->usage.user_us / 1000.0, span->usage.system_us / 1000.0,
+                span->usage.read_bytes, span->usage.write_bytes
+            );
+        }
+        fprintf(file, "}}");
+    }
+    fprintf(file, "\n]}\n");
+
+    pthread_mutex_unlock(&trace_mutex);
+
+    int failed = ferror(file);
+    if (fclose(file) != 0 || failed)
+    {
+        return -2;
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "../all.h"
+
+/** The longest span name kept, including the terminator. */
+#define TRACE_NAME_BYTES 160
+
+/** A type representing one timed operation of an installation. */
+typedef struct {
+    char name[TRACE_NAME_BYTES];
+    const char *category;
+    long long start_us;
+    long long end_us;
+    int thread_id;
+    int status;
+    int has_usage;
+    ProcessUsage usage;
+} TraceSpan;
+
+/**
+ * Starts recording spans, discarding any recorded before.
+ */
+void start_trace(void);
+
+/**
+ * Stops recording spans and releases them.
+ */
+void stop_trace(void);
+
+/**
+ * Checks whether spans are being recorded.
+ *
+ * @return - `1` - Indicates spans are recorded.
+ * @return - `0` - Indicates tracing is off.
+ */
+int is_tracing(void);
+
+/**
+ * Starts a span, recording the current time and thread.
+ *
+ * @param span The span to start.
+ * @param category The kind of operation, such as "phase" or "command".
+ * @param name The operation, truncated to TRACE_NAME_BYTES - 1 bytes.
+ */
+void begin_trace_span(TraceSpan *span, const char *category, const char *name);
+
+/**
+ * Ends a span and records it. Safe to call from any thread; does nothing
+ * when tracing is off.
+ *
+ * @param span The span to end.
+ * @param status The result of the operation, such as an exit status.
+ * @param usage The resources the operation's process used, or NULL.
+ */
+void end_trace_span(TraceSpan *span, int status, const ProcessUsage *usage);
+
+/**
+ * Writes the recorded spans as Chrome trace-event JSON, which trace viewers
+ * such as Perfetto and chrome://tracing open as a timeline.
+ *
+ * @param path The file to write.
+ *
+ * @return - `0` - Indicates success.
+ * @return - `-1` - Indicates the file could not be opened.
+ * @return - `-2` - Indicates the file could not be written.
+ */
+int write_trace(const char *path);
@@ -52,3 +52,12 @@ int find_mount_index(const char *mount);
 int find_flag_index(int boot, int esp, int bios_grub);
 int has_duplicate_mount_point(Store *store, int mount_index, int edit_index);
 unsigned long long calculate_ideal_swap_size(unsigned long long ram_bytes);
+
+/* src/steps/locale/locale.c */
+int compare_locales(const void *a, const void *b);
+
+/* src/phases/fstab/fstab.c */
+int write_fstab_entries(FILE *fstab);
+
+/* tests/bench/utils/loop.c */
+#include "bench/utils/loop.h"
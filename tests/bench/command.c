@@ -0,0 +1,79 @@
+/**
+ * This code is responsible for benchmarking the per-command latency of
+ * shell command strings against argument vectors started with posix_spawn,
+ * with and without an interface tick callback installed.
+ */
+
+#include "../all.h"
+
+/** The number of commands run for each measurement. */
+#define BENCH_COMMAND_COUNT 500
+
+static double run_bench_shell(void)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < BENCH_COMMAND_COUNT; i++)
+    {
+        if (run_install_command("true") != 0)
+        {
+            exit(1);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return (double)(end.tv_sec - start.tv_sec) +
+        (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static double run_bench_argv(void)
+{
+    const char *const argv[] = { "true", NULL };
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < BENCH_COMMAND_COUNT; i++)
+    {
+        if (run_install_argv(argv, &COMMAND_TO_INSTALL_LOG) != 0)
+        {
+            exit(1);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return (double)(end.tv_sec - start.tv_sec) +
+        (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static void tick_nothing(void)
+{
+}
+
+int main(void)
+{
+    reset_store();
+    init_install_log();
+
+    // Warm up the page cache for the shell and the program.
+    run_bench_shell();
+
+    double shell_seconds = run_bench_shell();
+    double argv_seconds = run_bench_argv();
+
+    // Repeat while ticking, as during an installation.
+    set_command_tick_callback(tick_nothing);
+    double shell_tick_seconds = run_bench_shell();
+    double argv_tick_seconds = run_bench_argv();
+    set_command_tick_callback(NULL);
+
+    printf("%-10s %12s %12s\n", "api", "no ticks", "ticks");
+    printf(
+        "%-10s %9.0f us %9.0f us\n", "shell",
+        shell_seconds * 1e6 / BENCH_COMMAND_COUNT, shell_tick_seconds * 1e6 / BENCH_COMMAND_COUNT
+    );
+    printf(
+        "%-10s %9.0f us %9.0f us\n", "argv",
+        argv_seconds * 1e6 / BENCH_COMMAND_COUNT, argv_tick_seconds * 1e6 / BENCH_COMMAND_COUNT
+    );
+
+    return 0;
+}
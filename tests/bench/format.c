@@ -0,0 +1,96 @@
+/**
+ * This code is responsible for benchmarking the ext4 format profiles against
+ * a sparse disk image attached as a loop device, reporting the wall time of
+ * each mkfs run and the bytes it wrote as JSON lines.
+ *
+ * The benchmark needs root, loop device support and mkfs.ext4, and reports
+ * itself as skipped when any of these is missing. Each profile formats a
+ * fresh image. Set LIMEOS_BENCH_DISK_GB to change the size of the disk, and
+ * LIMEOS_BENCH_IMAGE to place the disk image elsewhere. The fast profile
+ * sizes its inode tables to the rootfs shipped on the live system, if any.
+ */
+
+#include "../all.h"
+
+/** The default size of the disk image in gigabytes. */
+#define BENCH_DISK_GB 8
+
+/** The default path of the sparse disk image. */
+#define BENCH_IMAGE_PATH "/var/tmp/limeos-bench-format.img"
+
+static int bench_format_profile(
+    const char *profile_name, FormatProfile profile, const char *image_path,
+    unsigned long long disk_bytes, int entry_count
+)
+{
+    // Start each profile from an empty sparse image.
+    int image_fd = open(image_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (image_fd < 0 || ftruncate(image_fd, (off_t)disk_bytes) != 0)
+    {
+        return skip_bench("format", "could not create the disk image");
+    }
+    close(image_fd);
+    char device[MAX_DISK_LEN];
+    if (attach_loop_device(image_path, device, sizeof(device)) != 0)
+    {
+        unlink(image_path);
+        return skip_bench("format", "could not attach a loop device");
+    }
+
+    // Format the whole device as a root partition would be.
+    Partition partition;
+    memset(&partition, 0, sizeof(partition));
+    partition.size_bytes = disk_bytes;
+    partition.filesystem = FS_EXT4;
+    partition.format_profile = profile;
+    FormatJob job;
+    build_format_job(&partition, device, entry_count, 0, &job);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int result = run_install_argv(job.argv, &COMMAND_QUIET);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    // Measure what mkfs wrote through the blocks allocated in the image.
+    detach_loop_device(device);
+    struct stat image_stat;
+    unsigned long long written_bytes = stat(image_path, &image_stat) == 0
+        ? (unsigned long long)image_stat.st_blocks * 512 : 0;
+    unlink(image_path);
+
+    printf(
+        "{\"benchmark\":\"format\",\"profile\":\"%s\",\"disk_bytes\":%llu,\"result\":%d,"
+        "\"seconds\":%.3f,\"written_bytes\":%llu,\"inode_ratio\":\"%s\"}\n",
+        profile_name, disk_bytes, result, get_seconds_between(&start, &end), written_bytes,
+        job.inode_ratio[0] ? job.inode_ratio : "default"
+    );
+    return result == 0 ? 0 : 1;
+}
+
+int main(void)
+{
+    reset_store();
+
+    // Check for everything formatting needs.
+    if (geteuid() != 0)
+    {
+        return skip_bench("format", "needs root");
+    }
+    if (access("/dev/loop-control", R_OK | W_OK) != 0)
+    {
+        return skip_bench("format", "needs loop device support");
+    }
+    if (!common.is_command_available("mkfs.ext4"))
+    {
+        return skip_bench("format", "needs mkfs.ext4");
+    }
+
+    const char *image_path = getenv("LIMEOS_BENCH_IMAGE") ? getenv("LIMEOS_BENCH_IMAGE") : BENCH_IMAGE_PATH;
+    const char *disk_gb = getenv("LIMEOS_BENCH_DISK_GB");
+    unsigned long long disk_bytes = (disk_gb ? strtoull(disk_gb, NULL, 10) : BENCH_DISK_GB) * 1000000000ULL;
+    int entry_count = get_rootfs_entry_count();
+
+    // Time each profile on its own fresh disk.
+    int result = bench_format_profile("full", FORMAT_PROFILE_FULL, image_path, disk_bytes, entry_count);
+    result |= bench_format_profile("fast", FORMAT_PROFILE_FAST, image_path, disk_bytes, entry_count);
+    return result;
+}
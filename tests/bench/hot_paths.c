@@ -0,0 +1,332 @@
+/**
+ * This code is responsible for benchmarking the in-process hot paths of the
+ * wizard: reading the install log, rendering tables and option lists, sorting
+ * locales, escaping shell arguments and generating fstab. Each path is
+ * reported in nanoseconds and heap allocations per operation, counted by
+ * interposing the allocator.
+ *
+ * Set LIMEOS_BENCH_RECORD=1 to record the results as the baseline, and run
+ * again after a change to compare against it. The benchmark fails when a
+ * path exceeds its baseline by more than LIMEOS_BENCH_MARGIN percent (25 by
+ * default). LIMEOS_BENCH_BASELINE overrides where the baseline is kept.
+ */
+
+#include "../all.h"
+
+/** The default path of the recorded baseline. */
+#define BENCH_BASELINE_PATH "bin/bench/hot_paths.baseline"
+
+/** The default margin over the baseline that fails the benchmark, in percent. */
+#define BENCH_MARGIN_PERCENT 25.0
+
+/** The minimum time each path is measured for, in seconds. */
+#define BENCH_MIN_SECONDS 0.2
+
+/** The number of locales sorted, as on a system with all of them generated. */
+#define BENCH_LOCALE_COUNT 400
+
+/** The number of rows in the rendered table. */
+#define BENCH_TABLE_ROWS 32
+
+/** The maximum length of a benchmark name. */
+#define BENCH_NAME_BYTES 32
+
+/** A type representing the measured cost of one hot path. */
+typedef struct {
+    const char *name;
+    void (*run)(void);
+    double nanoseconds;
+    double allocations;
+} BenchPath;
+
+/** The allocations made by the current thread, so background threads do not count. */
+static _Thread_local unsigned long allocation_count;
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *pointer, size_t size);
+extern void __libc_free(void *pointer);
+
+void *malloc(size_t size)
+{
+    allocation_count++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    allocation_count++;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size)
+{
+    allocation_count++;
+    return __libc_realloc(pointer, size);
+}
+
+void free(void *pointer)
+{
+    __libc_free(pointer);
+}
+
+static WINDOW *bench_window;
+static TableColumn bench_columns[] = {
+    { "#", 3, TABLE_ALIGN_RIGHT },
+    { "Device", 16, TABLE_ALIGN_LEFT },
+    { "Size", 10, TABLE_ALIGN_RIGHT },
+    { "Filesystem", 10, TABLE_ALIGN_LEFT },
+    { "Mount", 12, TABLE_ALIGN_LEFT },
+    { "Flags", 10, TABLE_ALIGN_LEFT }
+};
+static TableRow bench_rows[BENCH_TABLE_ROWS];
+static StepOption bench_locales[BENCH_LOCALE_COUNT];
+static StepOption sorted_locales[BENCH_LOCALE_COUNT];
+static FILE *bench_null;
+
+static void run_read_install_log_lines(void)
+{
+    int count;
+    char **lines = read_install_log_lines(50, &count);
+    free_install_log_lines(lines, count);
+}
+
+static void run_render_table(void)
+{
+    render_table(bench_window, 2, 2, bench_columns, 6, bench_rows, BENCH_TABLE_ROWS, 3, 0, 20);
+}
+
+static void run_render_step_options(void)
+{
+    render_step_options(bench_window, sorted_locales, BENCH_LOCALE_COUNT, 10, 6, 0, 30);
+}
+
+static void run_sort_locales(void)
+{
+    memcpy(sorted_locales, bench_locales, sizeof(bench_locales));
+    qsort(sorted_locales, BENCH_LOCALE_COUNT, sizeof(StepOption), compare_locales);
+}
+
+static void run_shell_escape(void)
+{
+    char quoted[COMMON_MAX_QUOTED_LENGTH];
+    if (common.shell_escape("it's a user's p@ss word", quoted, sizeof(quoted)) != 0)
+    {
+        exit(1);
+    }
+}
+
+static void run_write_fstab(void)
+{
+    rewind(bench_null);
+    if (write_fstab_entries(bench_null) != 0)
+    {
+        exit(1);
+    }
+}
+
+static BenchPath bench_paths[] = {
+    { "read_install_log_lines", run_read_install_log_lines, 0, 0 },
+    { "render_table", run_render_table, 0, 0 },
+    { "render_step_options", run_render_step_options, 0, 0 },
+    { "sort_locales", run_sort_locales, 0, 0 },
+    { "shell_escape", run_shell_escape, 0, 0 },
+    { "write_fstab", run_write_fstab, 0, 0 },
+};
+
+static double get_elapsed_seconds(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void measure_bench_path(BenchPath *path)
+{
+    // Warm up, then double the iterations until the run is long enough.
+    path->run();
+    for (long iterations = 16;; iterations *= 2)
+    {
+        unsigned long allocations_before = allocation_count;
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (long i = 0; i < iterations; i++)
+        {
+            path->run();
+        }
+        double seconds = get_elapsed_seconds(&start);
+        if (seconds >= BENCH_MIN_SECONDS)
+        {
+            path->nanoseconds = seconds * 1e9 / iterations;
+            path->allocations = (double)(allocation_count - allocations_before) / iterations;
+            return;
+        }
+    }
+}
+
+static void prepare_bench_inputs(void)
+{
+    // Fill the output ring past what the viewer shows.
+    static const char line[] = "Setting up libexample1:amd64 (1.2.3-4) ...";
+    for (int i = 0; i < 500; i++)
+    {
+        publish_output_line(line, sizeof(line) - 1);
+    }
+
+    // Draw into an off-screen terminal.
+    bench_null = fopen("/dev/null", "w+");
+    if (!bench_null || !newterm("xterm", bench_null, bench_null))
+    {
+        exit(1);
+    }
+    bench_window = newwin(40, 100, 0, 0);
+
+    // Build table rows like the partition step's.
+    for (int i = 0; i < BENCH_TABLE_ROWS; i++)
+    {
+        TableRow *row = &bench_rows[i];
+        row->cell_count = 6;
+        snprintf(row->cells[0], sizeof(row->cells[0]), "%d", i + 1);
+        snprintf(row->cells[1], sizeof(row->cells[1]), "/dev/nvme0n1p%d", i + 1);
+        snprintf(row->cells[2], sizeof(row->cells[2]), "%d GB", (i + 1) * 4);
+        snprintf(row->cells[3], sizeof(row->cells[3]), "ext4");
+        snprintf(row->cells[4], sizeof(row->cells[4]), "/srv/%d", i);
+        snprintf(row->cells[5], sizeof(row->cells[5]), "%s", i == 0 ? "boot" : "");
+    }
+
+    // Build locales in the reverse of their sorted order.
+    static const char *languages[] = { "zh", "pt", "nl", "ja", "it", "fr", "es", "en", "de", "ar" };
+    for (int i = 0; i < BENCH_LOCALE_COUNT; i++)
+    {
+        StepOption *option = &bench_locales[i];
+        snprintf(
+            option->value, sizeof(option->value), "%s_%c%c.UTF-8",
+            languages[i % 10], 'Z' - (i / 10) % 26, 'Z' - i / 260
+        );
+        snprintf(option->label, sizeof(option->label), "%s", option->value);
+    }
+    run_sort_locales();
+
+    // Describe a typical disk layout for fstab.
+    Store *store = get_store();
+    snprintf(store->disk, sizeof(store->disk), "/dev/nvme0n1");
+    store->partition_count = 4;
+    const char *mount_points[] = { "/boot/efi", "/", "/home", "" };
+    const PartitionFS filesystems[] = { FS_FAT32, FS_EXT4, FS_EXT4, FS_SWAP };
+    for (int i = 0; i < store->partition_count; i++)
+    {
+        store->partitions[i].filesystem = filesystems[i];
+        snprintf(store->partitions[i].mount_point, sizeof(store->partitions[i].mount_point), "%s", mount_points[i]);
+    }
+}
+
+static int find_baseline(FILE *file, const char *name, double *out_nanoseconds, double *out_allocations)
+{
+    rewind(file);
+    char baseline_name[BENCH_NAME_BYTES];
+    double nanoseconds, allocations;
+    while (fscanf(file, "%31s %lf %lf", baseline_name, &nanoseconds, &allocations) == 3)
+    {
+        if (strcmp(baseline_name, name) == 0)
+        {
+            *out_nanoseconds = nanoseconds;
+            *out_allocations = allocations;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int record_baseline(const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        fprintf(stderr, "Could not record the baseline to %s\n", path);
+        return 1;
+    }
+    for (size_t i = 0; i < sizeof(bench_paths) / sizeof(bench_paths[0]); i++)
+    {
+        fprintf(file, "%s %.1f %.2f\n", bench_paths[i].name, bench_paths[i].nanoseconds, bench_paths[i].allocations);
+    }
+    fclose(file);
+    printf("\nRecorded the baseline to %s\n", path);
+    return 0;
+}
+
+static int compare_baseline(const char *path, double margin_percent)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        printf("\nNo baseline at %s, set LIMEOS_BENCH_RECORD=1 to record one\n", path);
+        return 0;
+    }
+
+    // Fail on any path slower or allocating more than the margin allows.
+    double factor = 1.0 + margin_percent / 100.0;
+    int regressions = 0;
+    printf("\n");
+    for (size_t i = 0; i < sizeof(bench_paths) / sizeof(bench_paths[0]); i++)
+    {
+        const BenchPath *path_result = &bench_paths[i];
+        double nanoseconds, allocations;
+        if (!find_baseline(file, path_result->name, &nanoseconds, &allocations))
+        {
+            continue;
+        }
+        if (path_result->nanoseconds > nanoseconds * factor)
+        {
+            printf(
+                "%s: %.1f ns/op exceeds the baseline of %.1f ns/op by more than %.0f%%\n",
+                path_result->name, path_result->nanoseconds, nanoseconds, margin_percent
+            );
+            regressions++;
+        }
+        if (path_result->allocations > allocations * factor + 0.005)
+        {
+            printf(
+                "%s: %.2f allocs/op exceeds the baseline of %.2f allocs/op by more than %.0f%%\n",
+                path_result->name, path_result->allocations, allocations, margin_percent
+            );
+            regressions++;
+        }
+    }
+    fclose(file);
+
+    if (regressions == 0)
+    {
+        printf("All paths are within %.0f%% of the baseline\n", margin_percent);
+    }
+    return regressions > 0;
+}
+
+int main(void)
+{
+    reset_store();
+    init_install_log();
+    prepare_bench_inputs();
+
+    for (size_t i = 0; i < sizeof(bench_paths) / sizeof(bench_paths[0]); i++)
+    {
+        measure_bench_path(&bench_paths[i]);
+    }
+    endwin();
+    close_install_log();
+    unlink(CONFIG_INSTALL_LOG_PATH);
+
+    printf("%-24s %12s %14s\n", "path", "ns/op", "allocs/op");
+    for (size_t i = 0; i < sizeof(bench_paths) / sizeof(bench_paths[0]); i++)
+    {
+        printf("%-24s %12.1f %14.2f\n", bench_paths[i].name, bench_paths[i].nanoseconds, bench_paths[i].allocations);
+    }
+
+    // Record the baseline or compare against it.
+    const char *baseline_path = getenv("LIMEOS_BENCH_BASELINE") ? getenv("LIMEOS_BENCH_BASELINE") : BENCH_BASELINE_PATH;
+    if (getenv("LIMEOS_BENCH_RECORD"))
+    {
+        return record_baseline(baseline_path);
+    }
+    const char *margin = getenv("LIMEOS_BENCH_MARGIN");
+    return compare_baseline(baseline_path, margin ? atof(margin) : BENCH_MARGIN_PERCENT);
+}
@@ -0,0 +1,221 @@
+/**
+ * This code is responsible for benchmarking a complete installation against
+ * a sparse disk image attached as a loop device, reporting the wall time of
+ * each phase, the rootfs write throughput and the peak memory use as JSON
+ * lines.
+ *
+ * The benchmark needs root, loop device support, the tools the installation
+ * runs and a rootfs archive. It reports itself as skipped when any of these
+ * is missing. Set LIMEOS_BENCH_ROOTFS to benchmark another archive (or an
+ * ext4 image ending in .img), LIMEOS_BENCH_DISK_GB to change the size of the
+ * disk, and LIMEOS_BENCH_IMAGE to place the disk image elsewhere.
+ */
+
+#include "../all.h"
+
+/** The default size of the disk image in gigabytes. */
+#define BENCH_DISK_GB 8
+
+/** The default path of the sparse disk image. */
+#define BENCH_IMAGE_PATH "/var/tmp/limeos-bench-disk.img"
+
+/** The directory holding the rootfs the installation reads. */
+#define BENCH_ROOTFS_DIR "/usr/share/limeos"
+
+/** The commands the installation runs on the host. */
+static const char *bench_commands[] = { "mkfs.ext4", "e2fsck", "resize2fs", "mount", "umount" };
+
+/** The time each phase began and ended, and its result. */
+static struct timespec phase_begin[INSTALL_PHASE_COUNT];
+static struct timespec phase_end[INSTALL_PHASE_COUNT];
+static int phase_result[INSTALL_PHASE_COUNT];
+static int phase_seen[INSTALL_PHASE_COUNT];
+
+static void record_phase_event(InstallEvent event, int phase_index, int error_code, void *context)
+{
+    (void)context;
+    if (event == INSTALL_STEP_BEGIN)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &phase_begin[phase_index]);
+        phase_seen[phase_index] = 1;
+    }
+    else if (event == INSTALL_STEP_OK || event == INSTALL_STEP_FAIL)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &phase_end[phase_index]);
+        phase_result[phase_index] = error_code;
+    }
+}
+
+static int has_suffix(const char *text, const char *suffix)
+{
+    size_t length = strlen(text);
+    size_t suffix_length = strlen(suffix);
+    return length >= suffix_length && strcmp(text + length - suffix_length, suffix) == 0;
+}
+
+static int provide_rootfs(const char *rootfs_path)
+{
+    // Keep mounts made from here on to this process.
+    if (unshare(CLONE_NEWNS) != 0 || mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) != 0)
+    {
+        return -1;
+    }
+
+    // Cover the live rootfs directory, then link the benchmarked archive and
+    // the files shipped next to it into place.
+    mkdir(BENCH_ROOTFS_DIR, 0755);
+    if (mount("tmpfs", BENCH_ROOTFS_DIR, "tmpfs", 0, "mode=0755") != 0)
+    {
+        return -1;
+    }
+    const char *target = has_suffix(rootfs_path, ".img") ? CONFIG_ROOTFS_IMAGE_PATH
+        : has_suffix(rootfs_path, ".zst") ? CONFIG_ROOTFS_ZSTD_TARBALL_PATH
+        : CONFIG_ROOTFS_TARBALL_PATH;
+    const char *suffixes[] = {
+        "", CONFIG_ROOTFS_DIGEST_SUFFIX, CONFIG_ROOTFS_MANIFEST_SUFFIX, CONFIG_ROOTFS_INDEX_SUFFIX
+    };
+    for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i++)
+    {
+        char source[PATH_MAX];
+        char link_path[PATH_MAX];
+        snprintf(source, sizeof(source), "%s%s", rootfs_path, suffixes[i]);
+        snprintf(link_path, sizeof(link_path), "%s%s", target, suffixes[i]);
+        if (access(source, R_OK) == 0 && symlink(source, link_path) != 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void configure_bench_install(const char *device, unsigned long long disk_bytes, int image_mode)
+{
+    Store *store = get_store();
+    store->dry_run = 0;
+    store->skip_reboot = 1;
+    store->rootfs_image = image_mode;
+    store->firmware = FIRMWARE_BIOS;
+    store->disk_label = DISK_LABEL_MBR;
+    store->disk_size = disk_bytes;
+    snprintf(store->disk, sizeof(store->disk), "%s", device);
+    snprintf(store->locale, sizeof(store->locale), "en_US.UTF-8");
+    snprintf(store->hostname, sizeof(store->hostname), "limeos-bench");
+
+    store->user_count = 1;
+    snprintf(store->users[0].username, sizeof(store->users[0].username), "bench");
+    snprintf(store->users[0].password, sizeof(store->users[0].password), "bench");
+    store->users[0].is_admin = 1;
+
+    // Give the root partition the whole disk, leaving room for the label.
+    store->partition_count = 1;
+    memset(&store->partitions[0], 0, sizeof(store->partitions[0]));
+    store->partitions[0].size_bytes = disk_bytes - 2ULL * 1000000;
+    store->partitions[0].filesystem = FS_EXT4;
+    snprintf(store->partitions[0].mount_point, sizeof(store->partitions[0].mount_point), "/");
+}
+
+static void report_bench_results(int result, double total_seconds)
+{
+    // Report each phase that ran.
+    for (int i = 0; i < INSTALL_PHASE_COUNT; i++)
+    {
+        if (!phase_seen[i])
+        {
+            continue;
+        }
+        printf(
+            "{\"benchmark\":\"install\",\"phase\":\"%s\",\"seconds\":%.3f,\"result\":%d}\n",
+            install_phases[i].display_name, get_seconds_between(&phase_begin[i], &phase_end[i]),
+            phase_result[i]
+        );
+    }
+
+    // Report the rootfs throughput over the System files phase.
+    const RootfsProgress *progress = get_rootfs_progress();
+    double rootfs_seconds = phase_seen[1] ? get_seconds_between(&phase_begin[1], &phase_end[1]) : 0;
+    double megabytes_per_second = rootfs_seconds > 0 ? progress->uncompressed_bytes / 1e6 / rootfs_seconds : 0;
+
+    // Report the peak resident set of the installer and of its commands.
+    struct rusage self_usage;
+    struct rusage children_usage;
+    getrusage(RUSAGE_SELF, &self_usage);
+    getrusage(RUSAGE_CHILDREN, &children_usage);
+
+    printf(
+        "{\"benchmark\":\"install\",\"result\":%d,\"seconds\":%.3f,\"rootfs_bytes\":%llu,"
+        "\"rootfs_mb_per_second\":%.1f,\"peak_rss_kb\":%ld,\"children_peak_rss_kb\":%ld}\n",
+        result, total_seconds, progress->uncompressed_bytes, megabytes_per_second,
+        self_usage.ru_maxrss, children_usage.ru_maxrss
+    );
+}
+
+int main(void)
+{
+    reset_store();
+
+    // Check for everything the installation needs.
+    if (geteuid() != 0)
+    {
+        return skip_bench("install", "needs root");
+    }
+    if (access("/dev/loop-control", R_OK | W_OK) != 0)
+    {
+        return skip_bench("install", "needs loop device support");
+    }
+    for (size_t i = 0; i < sizeof(bench_commands) / sizeof(bench_commands[0]); i++)
+    {
+        if (!common.is_command_available(bench_commands[i]))
+        {
+            return skip_bench("install", "needs the partitioning and filesystem tools");
+        }
+    }
+
+    // Use the requested rootfs, or the one shipped on the live system.
+    const char *rootfs_path = getenv("LIMEOS_BENCH_ROOTFS");
+    char resolved_rootfs[PATH_MAX];
+    if (rootfs_path)
+    {
+        if (!realpath(rootfs_path, resolved_rootfs) || provide_rootfs(resolved_rootfs) != 0)
+        {
+            return skip_bench("install", "could not provide the requested rootfs");
+        }
+        rootfs_path = resolved_rootfs;
+    }
+    int image_mode = access(CONFIG_ROOTFS_IMAGE_PATH, R_OK) == 0;
+    if (!image_mode && access(CONFIG_ROOTFS_ZSTD_TARBALL_PATH, R_OK) != 0 &&
+        access(CONFIG_ROOTFS_TARBALL_PATH, R_OK) != 0)
+    {
+        return skip_bench("install", "needs a rootfs, set LIMEOS_BENCH_ROOTFS");
+    }
+
+    // Create the sparse disk image and attach it.
+    const char *image_path = getenv("LIMEOS_BENCH_IMAGE") ? getenv("LIMEOS_BENCH_IMAGE") : BENCH_IMAGE_PATH;
+    const char *disk_gb = getenv("LIMEOS_BENCH_DISK_GB");
+    unsigned long long disk_bytes = (disk_gb ? strtoull(disk_gb, NULL, 10) : BENCH_DISK_GB) * 1000000000ULL;
+    int image_fd = open(image_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (image_fd < 0 || ftruncate(image_fd, (off_t)disk_bytes) != 0)
+    {
+        return skip_bench("install", "could not create the disk image");
+    }
+    close(image_fd);
+    char device[MAX_DISK_LEN];
+    if (attach_loop_device(image_path, device, sizeof(device)) != 0)
+    {
+        unlink(image_path);
+        return skip_bench("install", "could not attach a loop device");
+    }
+
+    // Install onto the loop device, timing each phase.
+    configure_bench_install(device, disk_bytes, image_mode);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int result = run_install(record_phase_event, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    detach_loop_device(device);
+    unlink(image_path);
+
+    report_bench_results(result, get_seconds_between(&start, &end));
+    return result == 0 ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+/**
+ * This code is responsible for benchmarking the cost of one log viewer
+ * refresh against a 10 MB install log: rescanning the log file as the
+ * viewer once did, copying a snapshot out of the output ring, and
+ * updating a persistent tail.
+ */
+
+#include "../all.h"
+
+/** The size of the install log built before measuring. */
+#define BENCH_LOG_BYTES (10 * 1024 * 1024)
+
+/** The number of lines the viewer shows, as on a 50-row terminal. */
+#define BENCH_SCREEN_LINES 50
+
+/** The number of lines published between refreshes. */
+#define BENCH_LINES_PER_TICK 20
+
+/** The number of refreshes measured for the tail and the snapshot. */
+#define BENCH_TICK_COUNT 2000
+
+/** The number of refreshes measured for the file rescan. */
+#define BENCH_RESCAN_COUNT 10
+
+static const char bench_line[] =
+    "Unpacking libexample-data (1.2.3-4) over (1.2.3-3) into /usr/share/example ...";
+
+static void publish_bench_lines(int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        publish_output_line(bench_line, sizeof(bench_line) - 1);
+    }
+    flush_install_log();
+}
+
+static double get_elapsed_seconds(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void rescan_log_file(void)
+{
+    // Read the whole file, keeping the last lines by shifting an array of
+    // copies, as the viewer did before the output ring.
+    FILE *file = fopen(CONFIG_INSTALL_LOG_PATH, "r");
+    if (!file)
+    {
+        exit(1);
+    }
+    char *lines[BENCH_SCREEN_LINES] = { 0 };
+    char buffer[512];
+    int count = 0;
+    while (fgets(buffer, sizeof(buffer), file))
+    {
+        if (count >= BENCH_SCREEN_LINES)
+        {
+            free(lines[0]);
+            memmove(lines, lines + 1, (BENCH_SCREEN_LINES - 1) * sizeof(char *));
+            count = BENCH_SCREEN_LINES - 1;
+        }
+        lines[count++] = strdup(buffer);
+    }
+    fclose(file);
+    for (int i = 0; i < count; i++)
+    {
+        free(lines[i]);
+    }
+}
+
+static double run_bench_rescan(void)
+{
+    double seconds = 0;
+    for (int i = 0; i < BENCH_RESCAN_COUNT; i++)
+    {
+        publish_bench_lines(BENCH_LINES_PER_TICK);
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        rescan_log_file();
+        seconds += get_elapsed_seconds(&start);
+    }
+    return seconds / BENCH_RESCAN_COUNT;
+}
+
+static double run_bench_snapshot(void)
+{
+    double seconds = 0;
+    for (int i = 0; i < BENCH_TICK_COUNT; i++)
+    {
+        publish_bench_lines(BENCH_LINES_PER_TICK);
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int count;
+        char **lines = read_install_log_lines(BENCH_SCREEN_LINES, &count);
+        free_install_log_lines(lines, count);
+        seconds += get_elapsed_seconds(&start);
+    }
+    return seconds / BENCH_TICK_COUNT;
+}
+
+static double run_bench_tail(void)
+{
+    LogTail tail;
+    if (open_install_log_tail(&tail, BENCH_SCREEN_LINES) != 0)
+    {
+        exit(1);
+    }
+    update_install_log_tail(&tail);
+
+    double seconds = 0;
+    for (int i = 0; i < BENCH_TICK_COUNT; i++)
+    {
+        publish_bench_lines(BENCH_LINES_PER_TICK);
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        update_install_log_tail(&tail);
+        seconds += get_elapsed_seconds(&start);
+    }
+
+    close_install_log_tail(&tail);
+    return seconds / BENCH_TICK_COUNT;
+}
+
+int main(void)
+{
+    init_install_log();
+
+    // Build the log up to its full size.
+    long lines = BENCH_LOG_BYTES / (long)sizeof(bench_line);
+    for (long i = 0; i < lines; i += 1000)
+    {
+        publish_bench_lines(1000);
+    }
+
+    double rescan_seconds = run_bench_rescan();
+    double snapshot_seconds = run_bench_snapshot();
+    double tail_seconds = run_bench_tail();
+
+    printf("%-10s %14s\n", "viewer", "per refresh");
+    printf("%-10s %11.1f us\n", "rescan", rescan_seconds * 1e6);
+    printf("%-10s %11.1f us\n", "snapshot", snapshot_seconds * 1e6);
+    printf("%-10s %11.1f us\n", "tail", tail_seconds * 1e6);
+
+    unlink(CONFIG_INSTALL_LOG_PATH);
+    return 0;
+}
@@ -0,0 +1,308 @@
+/**
+ * This code is responsible for benchmarking rootfs extraction throughput
+ * for gzip and zstd archives built from the same tar stream, using the
+ * sequential decompressor and the block-parallel decompressor across a
+ * range of thread counts. Also compares the io_uring and plain system call
+ * writers on an archive of small files.
+ */
+
+#include "../all.h"
+
+/** The scratch directory used by the benchmark. */
+#define BENCH_ROOT "/tmp/limeos-rootfs-bench"
+
+/** The path of the gzip archive generated by the benchmark. */
+#define BENCH_GZIP_ARCHIVE BENCH_ROOT "/rootfs.tar.gz"
+
+/** The path of the zstd archive generated by the benchmark. */
+#define BENCH_ZSTD_ARCHIVE BENCH_ROOT "/rootfs.tar.zst"
+
+/** The zstd compression level used for the generated archive. */
+#define BENCH_ZSTD_LEVEL 9
+
+/** The directory the benchmark extracts into. */
+#define BENCH_TARGET BENCH_ROOT "/target"
+
+/** The total size of the file data in the generated archive. */
+#define BENCH_DATA_BYTES (256ULL * 1024 * 1024)
+
+/** The size of each file in the generated archive. */
+#define BENCH_FILE_BYTES (256 * 1024)
+
+/** The path of the small-file archive used to compare write backends. */
+#define BENCH_SMALL_ARCHIVE BENCH_ROOT "/small.tar.zst"
+
+/** The size of each file in the small-file archive. */
+#define BENCH_SMALL_FILE_BYTES 4096
+
+/** The number of files in the small-file archive. */
+#define BENCH_SMALL_FILE_COUNT 16384
+
+/** The uncompressed size of each independently compressed block. */
+#define BENCH_BLOCK_BYTES (4 * 1024 * 1024)
+
+/** A type representing a growable in-memory tar stream. */
+typedef struct {
+    unsigned char *data;
+    size_t length;
+    size_t capacity;
+} BenchBuffer;
+
+static void append_bench_bytes(BenchBuffer *buffer, const void *data, size_t length)
+{
+    // Grow the buffer geometrically when full.
+    if (buffer->length + length > buffer->capacity)
+    {
+        size_t capacity = buffer->capacity ? buffer->capacity : 1024 * 1024;
+        while (capacity < buffer->length + length)
+        {
+            capacity *= 2;
+        }
+        buffer->data = realloc(buffer->data, capacity);
+        if (!buffer->data)
+        {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+        buffer->capacity = capacity;
+    }
+
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+}
+
+static void append_bench_file(BenchBuffer *buffer, int index, size_t size, unsigned int *seed)
+{
+    // Build a ustar header for the file.
+    unsigned char header[512] = {0};
+    snprintf((char *)header, 100, "usr/share/bench/%05d.dat", index);
+    snprintf((char *)header + 100, 8, "%07o", 0644);
+    snprintf((char *)header + 108, 8, "%07o", 0);
+    snprintf((char *)header + 116, 8, "%07o", 0);
+    snprintf((char *)header + 124, 12, "%011zo", size);
+    snprintf((char *)header + 136, 12, "%011o", 1700000000);
+    header[156] = '0';
+    memcpy(header + 257, "ustar\0" "00", 8);
+    memset(header + 148, ' ', 8);
+    unsigned int checksum = 0;
+    for (int i = 0; i < 512; i++)
+    {
+        checksum += header[i];
+    }
+    snprintf((char *)header + 148, 8, "%06o", checksum);
+    append_bench_bytes(buffer, header, sizeof(header));
+
+    // Fill the file with words drawn from a small vocabulary, which
+    // compresses at a ratio close to that of typical system files.
+    static const char *words[] = {
+        "lib", "usr", "share", "config", "locale", "debian", "limeos", "x86_64",
+        "linux", "gnu", "so", "bin", "etc", "doc", "man", "include"
+    };
+    char contents[BENCH_FILE_BYTES];
+    size_t length = 0;
+    while (length < size)
+    {
+        *seed = *seed * 1103515245u + 12345u;
+        const char *word = words[(*seed >> 16) % 16];
+        for (size_t i = 0; word[i] && length < size; i++)
+        {
+            contents[length++] = word[i];
+        }
+        if (length < size)
+        {
+            contents[length++] = (*seed >> 8) % 7 == 0 ? '\n' : (char)('!' + (*seed >> 24) % 90);
+        }
+    }
+    append_bench_bytes(buffer, contents, size);
+
+    // Pad the file data to a whole block.
+    unsigned char padding[512] = {0};
+    append_bench_bytes(buffer, padding, (512 - size % 512) % 512);
+}
+
+static size_t compress_bench_block(
+    RootfsFormat format, unsigned char *output, size_t output_capacity,
+    const unsigned char *input, size_t length
+)
+{
+    // Compress the block as a standalone zstd frame.
+    if (format == ROOTFS_FORMAT_ZSTD)
+    {
+        return ZSTD_compress(output, output_capacity, input, length, BENCH_ZSTD_LEVEL);
+    }
+
+    // Compress the block as a standalone gzip member.
+    z_stream zlib = {0};
+    deflateInit2(&zlib, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    zlib.next_in = (unsigned char *)input;
+    zlib.avail_in = (uInt)length;
+    zlib.next_out = output;
+    zlib.avail_out = (uInt)output_capacity;
+    deflate(&zlib, Z_FINISH);
+    size_t size = zlib.total_out;
+    deflateEnd(&zlib);
+    return size;
+}
+
+static unsigned long long write_bench_archive(
+    const BenchBuffer *tar, RootfsFormat format, const char *path
+)
+{
+    char index_path[PATH_MAX];
+    snprintf(index_path, sizeof(index_path), "%s%s", path, CONFIG_ROOTFS_INDEX_SUFFIX);
+    FILE *archive = fopen(path, "wb");
+    FILE *index = fopen(index_path, "w");
+    if (!archive || !index)
+    {
+        fprintf(stderr, "Failed to create %s\n", path);
+        exit(1);
+    }
+
+    // Compress each block independently and index it.
+    size_t output_capacity = ZSTD_compressBound(BENCH_BLOCK_BYTES) + compressBound(BENCH_BLOCK_BYTES);
+    unsigned char *output = malloc(output_capacity);
+    unsigned long long offset = 0;
+    for (size_t position = 0; position < tar->length; position += BENCH_BLOCK_BYTES)
+    {
+        size_t length = tar->length - position;
+        if (length > BENCH_BLOCK_BYTES)
+        {
+            length = BENCH_BLOCK_BYTES;
+        }
+
+        size_t size = compress_bench_block(format, output, output_capacity, tar->data + position, length);
+        fwrite(output, 1, size, archive);
+        fprintf(index, "%llu %zu %zu\n", offset, size, length);
+        offset += size;
+    }
+
+    free(output);
+    fclose(index);
+    fclose(archive);
+    return offset;
+}
+
+static double run_bench_extraction(const char *path, int thread_count, WriteBackend backend)
+{
+    // Start every run from an empty target.
+    if (system("rm -rf " BENCH_TARGET) != 0)
+    {
+        exit(1);
+    }
+    mkdir(BENCH_TARGET, 0755);
+
+    // Time the extraction.
+    RootfsProgress progress = {0};
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int result = extract_rootfs_archive(path, BENCH_TARGET, thread_count, WRITER_MAX_THREADS, backend, &progress);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (result != 0)
+    {
+        fprintf(stderr, "Extraction of %s failed (%d)\n", path, result);
+        exit(1);
+    }
+
+    return (double)(end.tv_sec - start.tv_sec) +
+        (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static double run_bench_sequential(const char *path)
+{
+    // Hide the index so that the sequential decompressor is used.
+    char index_path[PATH_MAX];
+    snprintf(index_path, sizeof(index_path), "%s%s", path, CONFIG_ROOTFS_INDEX_SUFFIX);
+    rename(index_path, BENCH_ROOT "/hidden.idx");
+    double seconds = run_bench_extraction(path, 0, WRITE_BACKEND_SYNC);
+    rename(BENCH_ROOT "/hidden.idx", index_path);
+    return seconds;
+}
+
+static void print_bench_row(const char *label, double gzip_seconds, double zstd_seconds)
+{
+    double megabytes = (double)BENCH_DATA_BYTES / (1024.0 * 1024.0);
+    printf(
+        "%-10s %8.2f s %8.1f MB/s %8.2f s %8.1f MB/s\n", label,
+        gzip_seconds, megabytes / gzip_seconds,
+        zstd_seconds, megabytes / zstd_seconds
+    );
+}
+
+int main(void)
+{
+    // Generate the tar stream in memory.
+    if (system("rm -rf " BENCH_ROOT) != 0)
+    {
+        return 1;
+    }
+    mkdir(BENCH_ROOT, 0755);
+    BenchBuffer tar = {0};
+    unsigned int seed = 1;
+    int file_count = (int)(BENCH_DATA_BYTES / BENCH_FILE_BYTES);
+    for (int i = 0; i < file_count; i++)
+    {
+        append_bench_file(&tar, i, BENCH_FILE_BYTES, &seed);
+    }
+    unsigned char zeros[1024] = {0};
+    append_bench_bytes(&tar, zeros, sizeof(zeros));
+
+    // Compress the same stream into indexed gzip and zstd archives.
+    unsigned long long gzip_size = write_bench_archive(&tar, ROOTFS_FORMAT_GZIP, BENCH_GZIP_ARCHIVE);
+    unsigned long long zstd_size = write_bench_archive(&tar, ROOTFS_FORMAT_ZSTD, BENCH_ZSTD_ARCHIVE);
+    printf("archive    %10s %16s\n", "gzip", "zstd");
+    printf(
+        "size       %7.1f MiB %13.1f MiB\n\n",
+        gzip_size / (1024.0 * 1024.0), zstd_size / (1024.0 * 1024.0)
+    );
+    free(tar.data);
+
+    // Measure sequential extraction of both formats.
+    printf("%-10s %21s %22s\n", "threads", "gzip", "zstd");
+    print_bench_row(
+        "sequential",
+        run_bench_sequential(BENCH_GZIP_ARCHIVE), run_bench_sequential(BENCH_ZSTD_ARCHIVE)
+    );
+
+    // Measure parallel extraction of both formats for 1..N threads.
+    long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = cpu_count > 4 ? (int)cpu_count : 4;
+    if (max_threads > PARALLEL_MAX_THREADS)
+    {
+        max_threads = PARALLEL_MAX_THREADS;
+    }
+    for (int threads = 1; threads <= max_threads; threads++)
+    {
+        char label[16];
+        snprintf(label, sizeof(label), "%d", threads);
+        print_bench_row(
+            label,
+            run_bench_extraction(BENCH_GZIP_ARCHIVE, threads, WRITE_BACKEND_SYNC),
+            run_bench_extraction(BENCH_ZSTD_ARCHIVE, threads, WRITE_BACKEND_SYNC)
+        );
+    }
+    printf("\nauto thread count: %d\n", get_rootfs_thread_count(2ULL * BENCH_BLOCK_BYTES));
+
+    // Compare the write backends on an archive of small files.
+    BenchBuffer small = {0};
+    for (int i = 0; i < BENCH_SMALL_FILE_COUNT; i++)
+    {
+        append_bench_file(&small, i, BENCH_SMALL_FILE_BYTES, &seed);
+    }
+    append_bench_bytes(&small, zeros, sizeof(zeros));
+    write_bench_archive(&small, ROOTFS_FORMAT_ZSTD, BENCH_SMALL_ARCHIVE);
+    free(small.data);
+    printf("\n%-10s %10s %12s\n", "backend", "seconds", "files/s");
+    const WriteBackend backends[] = { WRITE_BACKEND_SYNC, WRITE_BACKEND_URING };
+    const char *backend_names[] = { "sync", "uring" };
+    for (int i = 0; i < 2; i++)
+    {
+        double seconds = run_bench_extraction(BENCH_SMALL_ARCHIVE, 0, backends[i]);
+        printf("%-10s %8.2f s %12.0f\n", backend_names[i], seconds, BENCH_SMALL_FILE_COUNT / seconds);
+    }
+
+    if (system("rm -rf " BENCH_ROOT) != 0)
+    {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+/**
+ * This code is responsible for the helpers shared by the benchmarks that run
+ * against a disk image attached as a loop device.
+ */
+
+#include "../../all.h"
+
+double get_seconds_between(const struct timespec *start, const struct timespec *end)
+{
+    return (double)(end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int skip_bench(const char *benchmark, const char *reason)
+{
+    printf("{\"benchmark\":\"%s\",\"skipped\":\"%s\"}\n", benchmark, reason);
+    return 0;
+}
+
+int attach_loop_device(const char *image_path, char *out_device, size_t device_size)
+{
+    // Find a free loop device.
+    int control_fd = open("/dev/loop-control", O_RDWR | O_CLOEXEC);
+    if (control_fd < 0)
+    {
+        return -1;
+    }
+    int number = ioctl(control_fd, LOOP_CTL_GET_FREE);
+    close(control_fd);
+    if (number < 0)
+    {
+        return -1;
+    }
+    snprintf(out_device, device_size, "/dev/loop%d", number);
+
+    // Back it with the image, scanning for partitions as they are created.
+    int image_fd = open(image_path, O_RDWR | O_CLOEXEC);
+    int loop_fd = open(out_device, O_RDWR | O_CLOEXEC);
+    int result = -1;
+    if (image_fd >= 0 && loop_fd >= 0)
+    {
+        struct loop_info64 info;
+        memset(&info, 0, sizeof(info));
+        info.lo_flags = LO_FLAGS_PARTSCAN;
+        if (ioctl(loop_fd, LOOP_SET_FD, image_fd) == 0)
+        {
+            result = ioctl(loop_fd, LOOP_SET_STATUS64, &info) == 0 ? 0 : -1;
+            if (result != 0)
+            {
+                ioctl(loop_fd, LOOP_CLR_FD, 0);
+            }
+        }
+    }
+    if (image_fd >= 0)
+    {
+        close(image_fd);
+    }
+    if (loop_fd >= 0)
+    {
+        close(loop_fd);
+    }
+    return result;
+}
+
+void detach_loop_device(const char *device)
+{
+    int loop_fd = open(device, O_RDWR | O_CLOEXEC);
+    if (loop_fd >= 0)
+    {
+        ioctl(loop_fd, LOOP_CLR_FD, 0);
+        close(loop_fd);
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "../../all.h"
+
+/**
+ * Returns the time elapsed between two timestamps.
+ *
+ * @param start The earlier timestamp.
+ * @param end The later timestamp.
+ *
+ * @return The elapsed time in seconds.
+ */
+double get_seconds_between(const struct timespec *start, const struct timespec *end);
+
+/**
+ * Reports a benchmark as skipped as a JSON line.
+ *
+ * @param benchmark The name of the benchmark.
+ * @param reason Why the benchmark could not run.
+ *
+ * @return - `0` - Always, so a skipped benchmark does not fail the run.
+ */
+int skip_bench(const char *benchmark, const char *reason);
+
+/**
+ * Attaches a disk image to a free loop device, scanning it for partitions
+ * as they are created.
+ *
+ * @param image_path The path of the disk image.
+ * @param out_device Receives the path of the loop device.
+ * @param device_size The size of the `out_device` buffer.
+ *
+ * @return - `0` - Indicates the image was attached.
+ * @return - `-1` - Indicates no loop device could be attached.
+ */
+int attach_loop_device(const char *image_path, char *out_device, size_t device_size);
+
+/**
+ * Detaches a loop device attached with `attach_loop_device()`.
+ *
+ * @param device The path of the loop device.
+ */
+void detach_loop_device(const char *device);
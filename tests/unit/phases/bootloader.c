@@ -16,6 +16,10 @@ static int setup(void **state)
 static int teardown(void **state)
 {
     (void)state;
+
+    // Forget the mounts recorded in dry-run mode, so each test mounts anew.
+    get_store()->dry_run = 1;
+    unmount_registered_filesystems(NULL, NULL);
     close_dry_run_log();
     unlink(CONFIG_DRY_RUN_LOG_PATH);
     return 0;
@@ -125,13 +129,13 @@ static void test_setup_bootloader_verifies_chroot(void **state)
     int count = read_dry_run_log(lines, 64);
 
     // Should create chroot verification marker.
-    assert_true(log_contains(lines, count, "echo 'limeos' > '/mnt/tmp/.chroot_verify'"));
+    assert_true(log_contains(lines, count, "echo limeos >/mnt/tmp/.chroot_verify"));
 
     // Should verify marker is visible from chroot.
     assert_true(log_contains(lines, count, "chroot /mnt cat /tmp/.chroot_verify"));
 
     // Should clean up marker.
-    assert_true(log_contains(lines, count, "rm -f '/mnt/tmp/.chroot_verify'"));
+    assert_true(log_contains(lines, count, "rm -f /mnt/tmp/.chroot_verify"));
 }
 
 /** Verifies setup_bootloader() copies BIOS packages from apt cache. */
@@ -73,6 +73,42 @@ static int log_find_index(char lines[][512], int count, const char *substring)
     return -1;
 }
 
+/** Helper to find the index of an exact line in the log. */
+static int log_find_line(char lines[][512], int count, const char *line)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (strcmp(lines[i], line) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/** Helper to start the dry-run log afresh. */
+static void reset_test_log(void)
+{
+    close_dry_run_log();
+    unlink(CONFIG_DRY_RUN_LOG_PATH);
+}
+
+/** Helper to mount the chroot system directories, as a chroot session does. */
+static void mount_test_system_dirs(void)
+{
+    assert_int_equal(0, mount_filesystem("/dev", "/mnt/dev", NULL, MS_BIND, NULL));
+    assert_int_equal(0, mount_filesystem("proc", "/mnt/proc", "proc", 0, NULL));
+    assert_int_equal(0, mount_filesystem("sys", "/mnt/sys", "sysfs", 0, NULL));
+    reset_test_log();
+}
+
+/** Helper to mount the configured partitions. */
+static void mount_test_partitions(void)
+{
+    assert_int_equal(0, mount_partitions());
+    reset_test_log();
+}
+
 /** Verifies cleanup_mounts() unmounts /mnt/sys. */
 static void test_cleanup_mounts_unmounts_sys(void **state)
 {
@@ -80,6 +116,7 @@ static void test_cleanup_mounts_unmounts_sys(void **state)
     Store *store = get_store();
     store->dry_run = 1;
     store->partition_count = 0;
+    mount_test_system_dirs();
 
     cleanup_mounts();
     close_dry_run_log();
@@ -97,6 +134,7 @@ static void test_cleanup_mounts_unmounts_proc(void **state)
     Store *store = get_store();
     store->dry_run = 1;
     store->partition_count = 0;
+    mount_test_system_dirs();
 
     cleanup_mounts();
     close_dry_run_log();
@@ -114,6 +152,7 @@ static void test_cleanup_mounts_unmounts_dev(void **state)
     Store *store = get_store();
     store->dry_run = 1;
     store->partition_count = 0;
+    mount_test_system_dirs();
 
     cleanup_mounts();
     close_dry_run_log();
@@ -124,13 +163,25 @@ static void test_cleanup_mounts_unmounts_dev(void **state)
     assert_true(log_contains(lines, count, "umount /mnt/dev"));
 }
 
-/** Verifies cleanup_mounts() attempts to unmount EFI partition. */
+/** Verifies cleanup_mounts() unmounts the EFI partition. */
 static void test_cleanup_mounts_unmounts_efi(void **state)
 {
     (void)state;
     Store *store = get_store();
     store->dry_run = 1;
-    store->partition_count = 0;
+    strncpy(store->disk, "/dev/sda", MAX_DISK_LEN);
+    store->partition_count = 2;
+
+    // Root partition.
+    store->partitions[0].size_bytes = 10ULL * 1000000000;
+    store->partitions[0].filesystem = FS_EXT4;
+    strncpy(store->partitions[0].mount_point, "/", MAX_MOUNT_LEN);
+
+    // EFI partition.
+    store->partitions[1].size_bytes = 512ULL * 1000000;
+    store->partitions[1].filesystem = FS_FAT32;
+    strncpy(store->partitions[1].mount_point, "/boot/efi", MAX_MOUNT_LEN);
+    mount_test_partitions();
 
     cleanup_mounts();
     close_dry_run_log();
@@ -147,7 +198,14 @@ static void test_cleanup_mounts_unmounts_root_last(void **state)
     (void)state;
     Store *store = get_store();
     store->dry_run = 1;
-    store->partition_count = 0;
+    strncpy(store->disk, "/dev/sda", MAX_DISK_LEN);
+    store->partition_count = 1;
+
+    store->partitions[0].size_bytes = 10ULL * 1000000000;
+    store->partitions[0].filesystem = FS_EXT4;
+    strncpy(store->partitions[0].mount_point, "/", MAX_MOUNT_LEN);
+    assert_int_equal(0, mount_partitions());
+    mount_test_system_dirs();
 
     cleanup_mounts();
     close_dry_run_log();
@@ -155,7 +213,7 @@ static void test_cleanup_mounts_unmounts_root_last(void **state)
     char lines[32][512];
     int count = read_dry_run_log(lines, 32);
 
-    int idx_root = log_find_index(lines, count, "umount /mnt >");
+    int idx_root = log_find_line(lines, count, "umount /mnt");
     int idx_sys = log_find_index(lines, count, "umount /mnt/sys");
     int idx_proc = log_find_index(lines, count, "umount /mnt/proc");
     int idx_dev = log_find_index(lines, count, "umount /mnt/dev");
@@ -212,6 +270,7 @@ static void test_cleanup_mounts_unmounts_other_partitions(void **state)
     store->partitions[1].size_bytes = 20ULL * 1000000000;
     store->partitions[1].filesystem = FS_EXT4;
     strncpy(store->partitions[1].mount_point, "/home", MAX_MOUNT_LEN);
+    mount_test_partitions();
 
     cleanup_mounts();
     close_dry_run_log();
@@ -219,7 +278,7 @@ static void test_cleanup_mounts_unmounts_other_partitions(void **state)
     char lines[32][512];
     int count = read_dry_run_log(lines, 32);
 
-    assert_true(log_contains(lines, count, "umount '/mnt/home'"));
+    assert_true(log_contains(lines, count, "umount /mnt/home"));
 }
 
 /** Verifies cleanup_mounts() processes partitions in reverse order. */
@@ -245,6 +304,7 @@ static void test_cleanup_mounts_reverse_order(void **state)
     store->partitions[2].size_bytes = 5ULL * 1000000000;
     store->partitions[2].filesystem = FS_EXT4;
     strncpy(store->partitions[2].mount_point, "/var", MAX_MOUNT_LEN);
+    mount_test_partitions();
 
     cleanup_mounts();
     close_dry_run_log();
@@ -290,6 +350,114 @@ static void test_cleanup_mounts_skips_unmounted(void **state)
     assert_false(log_contains(lines, count, "[none]"));
 }
 
+/** Verifies cleanup_mounts() restores the fstab options before unmounting. */
+static void test_cleanup_mounts_remounts_before_unmount(void **state)
+{
+    (void)state;
+    Store *store = get_store();
+    store->dry_run = 1;
+    strncpy(store->disk, "/dev/sda", MAX_DISK_LEN);
+    store->partition_count = 2;
+
+    // Root partition.
+    store->partitions[0].size_bytes = 10ULL * 1000000000;
+    store->partitions[0].filesystem = FS_EXT4;
+    strncpy(store->partitions[0].mount_point, "/", MAX_MOUNT_LEN);
+
+    // EFI partition.
+    store->partitions[1].size_bytes = 512ULL * 1000000;
+    store->partitions[1].filesystem = FS_FAT32;
+    strncpy(store->partitions[1].mount_point, "/boot/efi", MAX_MOUNT_LEN);
+    mount_test_partitions();
+
+    cleanup_mounts();
+    close_dry_run_log();
+
+    char lines[32][512];
+    int count = read_dry_run_log(lines, 32);
+
+    int idx_root_remount = log_find_line(lines, count, "mount -o remount,relatime,commit=5,errors=remount-ro /mnt");
+    int idx_root = log_find_line(lines, count, "umount /mnt");
+    int idx_efi_remount = log_find_line(lines, count, "mount -o remount,relatime,umask=0077 /mnt/boot/efi");
+    int idx_efi = log_find_line(lines, count, "umount /mnt/boot/efi");
+
+    assert_true(idx_root_remount >= 0);
+    assert_true(idx_root_remount + 1 == idx_root);
+    assert_true(idx_efi_remount >= 0);
+    assert_true(idx_efi_remount + 1 == idx_efi);
+
+    // The EFI partition is unmounted only once.
+    assert_false(log_contains(lines + idx_efi + 1, count - idx_efi - 1, "/mnt/boot/efi"));
+}
+
+/** Verifies cleanup_mounts() leaves alone what was never mounted. */
+static void test_cleanup_mounts_skips_never_mounted(void **state)
+{
+    (void)state;
+    Store *store = get_store();
+    store->dry_run = 1;
+    strncpy(store->disk, "/dev/sda", MAX_DISK_LEN);
+    store->partition_count = 2;
+
+    // Root partition.
+    store->partitions[0].size_bytes = 10ULL * 1000000000;
+    store->partitions[0].filesystem = FS_EXT4;
+    strncpy(store->partitions[0].mount_point, "/", MAX_MOUNT_LEN);
+
+    // Home partition.
+    store->partitions[1].size_bytes = 20ULL * 1000000000;
+    store->partitions[1].filesystem = FS_EXT4;
+    strncpy(store->partitions[1].mount_point, "/home", MAX_MOUNT_LEN);
+
+    cleanup_mounts();
+    close_dry_run_log();
+
+    char lines[32][512];
+    int count = read_dry_run_log(lines, 32);
+
+    assert_false(log_contains(lines, count, "mount"));
+}
+
+/** Verifies cleanup_mounts() unmounts nested partitions before their parents. */
+static void test_cleanup_mounts_unmounts_nested_first(void **state)
+{
+    (void)state;
+    Store *store = get_store();
+    store->dry_run = 1;
+    strncpy(store->disk, "/dev/sda", MAX_DISK_LEN);
+    store->partition_count = 3;
+
+    // EFI partition, listed before the /boot it is mounted in.
+    store->partitions[0].size_bytes = 512ULL * 1000000;
+    store->partitions[0].filesystem = FS_FAT32;
+    strncpy(store->partitions[0].mount_point, "/boot/efi", MAX_MOUNT_LEN);
+
+    // Boot partition.
+    store->partitions[1].size_bytes = 1ULL * 1000000000;
+    store->partitions[1].filesystem = FS_EXT4;
+    strncpy(store->partitions[1].mount_point, "/boot", MAX_MOUNT_LEN);
+
+    // Root partition.
+    store->partitions[2].size_bytes = 10ULL * 1000000000;
+    store->partitions[2].filesystem = FS_EXT4;
+    strncpy(store->partitions[2].mount_point, "/", MAX_MOUNT_LEN);
+    mount_test_partitions();
+
+    cleanup_mounts();
+    close_dry_run_log();
+
+    char lines[32][512];
+    int count = read_dry_run_log(lines, 32);
+
+    int idx_efi = log_find_line(lines, count, "umount /mnt/boot/efi");
+    int idx_boot = log_find_line(lines, count, "umount /mnt/boot");
+    int idx_root = log_find_line(lines, count, "umount /mnt");
+
+    assert_true(idx_efi >= 0);
+    assert_true(idx_efi < idx_boot);
+    assert_true(idx_boot < idx_root);
+}
+
 /** Verifies cleanup_mounts() returns 0 in dry-run mode. */
 static void test_cleanup_mounts_returns_zero_dry_run(void **state)
 {
@@ -345,6 +513,8 @@ static void test_cleanup_mounts_chroot_before_partitions(void **state)
     store->partitions[0].size_bytes = 10ULL * 1000000000;
     store->partitions[0].filesystem = FS_EXT4;
     strncpy(store->partitions[0].mount_point, "/", MAX_MOUNT_LEN);
+    assert_int_equal(0, mount_partitions());
+    mount_test_system_dirs();
 
     cleanup_mounts();
     close_dry_run_log();
@@ -353,7 +523,7 @@ static void test_cleanup_mounts_chroot_before_partitions(void **state)
     int count = read_dry_run_log(lines, 32);
 
     int idx_sys = log_find_index(lines, count, "umount /mnt/sys");
-    int idx_root = log_find_index(lines, count, "umount /mnt >");
+    int idx_root = log_find_line(lines, count, "umount /mnt");
 
     // Chroot mounts should be unmounted before root.
     assert_true(idx_sys < idx_root);
@@ -371,6 +541,9 @@ int main(void)
         cmocka_unit_test_setup_teardown(test_cleanup_mounts_unmounts_other_partitions, setup, teardown),
         cmocka_unit_test_setup_teardown(test_cleanup_mounts_reverse_order, setup, teardown),
         cmocka_unit_test_setup_teardown(test_cleanup_mounts_skips_unmounted, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_cleanup_mounts_remounts_before_unmount, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_cleanup_mounts_skips_never_mounted, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_cleanup_mounts_unmounts_nested_first, setup, teardown),
         cmocka_unit_test_setup_teardown(test_cleanup_mounts_returns_zero_dry_run, setup, teardown),
         cmocka_unit_test_setup_teardown(test_cleanup_mounts_nvme_disk, setup, teardown),
         cmocka_unit_test_setup_teardown(test_cleanup_mounts_chroot_before_partitions, setup, teardown),
@@ -0,0 +1,249 @@
+/**
+ * This code is responsible for testing partition formatting, including the
+ * commands run for each filesystem and format profile, the size of the
+ * worker pool, and the handling of a failed format.
+ */
+
+#include "../../all.h"
+
+#define TEST_BIN_DIR "/tmp/limeos-test-format-bin"
+#define TEST_MARKER_PATH "/tmp/limeos-test-format-marker"
+
+static char *saved_path = NULL;
+
+/** Sets up the test environment before each test. */
+static int setup(void **state)
+{
+    (void)state;
+    reset_store();
+    close_dry_run_log();
+    unlink(CONFIG_DRY_RUN_LOG_PATH);
+    unlink(TEST_MARKER_PATH);
+    const char *path = getenv("PATH");
+    saved_path = strdup(path ? path : "");
+    return 0;
+}
+
+/** Cleans up the test environment after each test. */
+static int teardown(void **state)
+{
+    (void)state;
+    close_dry_run_log();
+    unlink(CONFIG_DRY_RUN_LOG_PATH);
+    unlink(TEST_MARKER_PATH);
+    unlink(TEST_BIN_DIR "/mkfs.ext4");
+    unlink(TEST_BIN_DIR "/mkswap");
+    rmdir(TEST_BIN_DIR);
+    setenv("PATH", saved_path, 1);
+    free(saved_path);
+    saved_path = NULL;
+    return 0;
+}
+
+/** Helper to add a partition to the store. */
+static void add_test_partition(PartitionFS filesystem, const char *mount_point)
+{
+    Store *store = get_store();
+    Partition *partition = &store->partitions[store->partition_count++];
+    partition->size_bytes = 1ULL * 1000000000;
+    partition->type = PART_PRIMARY;
+    partition->filesystem = filesystem;
+    snprintf(partition->mount_point, sizeof(partition->mount_point), "%s", mount_point);
+}
+
+/** Helper to install a fake formatting program found first on the PATH. */
+static void add_fake_program(const char *name, const char *script)
+{
+    mkdir(TEST_BIN_DIR, 0755);
+    char path[256];
+    snprintf(path, sizeof(path), TEST_BIN_DIR "/%s", name);
+    FILE *file = fopen(path, "w");
+    assert_non_null(file);
+    fprintf(file, "#!/bin/sh\n%s\n", script);
+    fclose(file);
+    chmod(path, 0755);
+
+    char search_path[4096];
+    snprintf(search_path, sizeof(search_path), TEST_BIN_DIR ":%s", saved_path);
+    setenv("PATH", search_path, 1);
+}
+
+/** Verifies get_format_worker_count() formats one partition at a time when unsure. */
+static void test_get_format_worker_count_limits_unknown_disks(void **state)
+{
+    (void)state;
+
+    assert_int_equal(1, get_format_worker_count("/dev/limeos-no-such-disk", 4));
+    assert_int_equal(1, get_format_worker_count("/dev/limeos-no-such-disk", 1));
+}
+
+/** Verifies get_format_inode_ratio() keeps the default without room to spare. */
+static void test_get_format_inode_ratio_keeps_default(void **state)
+{
+    (void)state;
+
+    assert_int_equal(0, get_format_inode_ratio(32ULL * 1000000000, 0));
+    assert_int_equal(0, get_format_inode_ratio(4ULL * 1000000000, 100000));
+}
+
+/** Verifies get_format_inode_ratio() sizes inodes to the rootfs within bounds. */
+static void test_get_format_inode_ratio_sizes_to_rootfs(void **state)
+{
+    (void)state;
+
+    // 32 GB for 800,000 inodes leaves 40,000 bytes each.
+    assert_int_equal(32768, get_format_inode_ratio(32ULL * 1000000000, 100000));
+    assert_int_equal(FORMAT_MAX_INODE_RATIO, get_format_inode_ratio(1000ULL * 1000000000, 100000));
+}
+
+/** Verifies build_format_job() leaves initialization to the kernel on a fast format. */
+static void test_build_format_job_fast_profile(void **state)
+{
+    (void)state;
+    add_test_partition(FS_EXT4, "/");
+    Partition *partition = &get_store()->partitions[0];
+    partition->size_bytes = 32ULL * 1000000000;
+    FormatJob job;
+
+    assert_int_equal(0, build_format_job(partition, "/dev/sda1", 100000, 0, &job));
+
+    const char *expected[] = {
+        "mkfs.ext4", "-F", "-E", "lazy_itable_init=1,lazy_journal_init=1,nodiscard",
+        "-i", "32768", "/dev/sda1", NULL
+    };
+    for (int i = 0; expected[i]; i++)
+    {
+        assert_string_equal(expected[i], job.argv[i]);
+    }
+    assert_null(job.argv[7]);
+}
+
+/** Verifies build_format_job() initializes everything on a full format. */
+static void test_build_format_job_full_profile(void **state)
+{
+    (void)state;
+    add_test_partition(FS_EXT4, "/home");
+    Partition *partition = &get_store()->partitions[0];
+    partition->format_profile = FORMAT_PROFILE_FULL;
+    FormatJob job;
+
+    assert_int_equal(0, build_format_job(partition, "/dev/sda2", 100000, 0, &job));
+
+    assert_string_equal("-E", job.argv[2]);
+    assert_string_equal("lazy_itable_init=0,lazy_journal_init=0", job.argv[3]);
+    assert_string_equal("/dev/sda2", job.argv[4]);
+    assert_null(job.argv[5]);
+}
+
+/** Verifies build_format_job() skips the discard of a full format on a discarded disk. */
+static void test_build_format_job_full_profile_after_discard(void **state)
+{
+    (void)state;
+    add_test_partition(FS_EXT4, "/home");
+    Partition *partition = &get_store()->partitions[0];
+    partition->format_profile = FORMAT_PROFILE_FULL;
+    FormatJob job;
+
+    assert_int_equal(0, build_format_job(partition, "/dev/sda2", 0, 1, &job));
+
+    assert_string_equal("lazy_itable_init=0,lazy_journal_init=0,nodiscard", job.argv[3]);
+}
+
+/** Verifies build_format_job() skips partitions without a filesystem. */
+static void test_build_format_job_without_filesystem(void **state)
+{
+    (void)state;
+    add_test_partition(FS_NONE, "");
+    FormatJob job;
+
+    assert_int_equal(-1, build_format_job(&get_store()->partitions[0], "/dev/sda1", 0, 0, &job));
+}
+
+/** Verifies format_partitions() logs each command in partition order in dry-run mode. */
+static void test_format_partitions_dry_run_keeps_order(void **state)
+{
+    (void)state;
+    Store *store = get_store();
+    store->dry_run = 1;
+    add_test_partition(FS_FAT32, "/boot/efi");
+    add_test_partition(FS_SWAP, "");
+    add_test_partition(FS_NONE, "");
+    add_test_partition(FS_EXT4, "/");
+
+    assert_int_equal(0, format_partitions("/dev/sda", store, 0));
+    close_dry_run_log();
+
+    FILE *file = fopen(CONFIG_DRY_RUN_LOG_PATH, "r");
+    assert_non_null(file);
+    char line[256];
+    assert_non_null(fgets(line, sizeof(line), file));
+    assert_string_equal("mkfs.vfat -F 32 /dev/sda1 >>" CONFIG_INSTALL_LOG_PATH " 2>&1\n", line);
+    assert_non_null(fgets(line, sizeof(line), file));
+    assert_string_equal("mkswap /dev/sda2 >>" CONFIG_INSTALL_LOG_PATH " 2>&1\n", line);
+    assert_non_null(fgets(line, sizeof(line), file));
+    assert_string_equal("mkfs.ext4 -F -E lazy_itable_init=1,lazy_journal_init=1,nodiscard /dev/sda4 >>" CONFIG_INSTALL_LOG_PATH " 2>&1\n", line);
+    assert_null(fgets(line, sizeof(line), file));
+    fclose(file);
+}
+
+/** Verifies format_partitions() succeeds without partitions to format. */
+static void test_format_partitions_without_filesystems(void **state)
+{
+    (void)state;
+    add_test_partition(FS_NONE, "");
+
+    assert_int_equal(0, format_partitions("/dev/sda", get_store(), 0));
+}
+
+/** Verifies format_partitions() logs each program's output as one block. */
+static void test_format_partitions_logs_output_blocks(void **state)
+{
+    (void)state;
+    init_install_log();
+    add_fake_program("mkfs.ext4", "for device; do :; done; echo \"ext4 start $device\"; echo \"ext4 done $device\"");
+    add_test_partition(FS_EXT4, "/");
+
+    assert_int_equal(0, format_partitions("/dev/limeos-test", get_store(), 0));
+
+    int count;
+    char **lines = read_install_log_lines(3, &count);
+    assert_int_equal(3, count);
+    assert_string_equal("Formatting /dev/limeos-test1 as ext4", lines[0]);
+    assert_string_equal("ext4 start /dev/limeos-test1", lines[1]);
+    assert_string_equal("ext4 done /dev/limeos-test1", lines[2]);
+    free_install_log_lines(lines, count);
+    unlink(CONFIG_INSTALL_LOG_PATH);
+}
+
+/** Verifies format_partitions() stops starting partitions after a failure. */
+static void test_format_partitions_stops_after_failure(void **state)
+{
+    (void)state;
+    add_fake_program("mkfs.ext4", "exit 1");
+    add_fake_program("mkswap", "touch " TEST_MARKER_PATH);
+    add_test_partition(FS_EXT4, "/");
+    add_test_partition(FS_SWAP, "");
+
+    assert_int_equal(-1, format_partitions("/dev/limeos-test", get_store(), 0));
+
+    assert_int_not_equal(0, access(TEST_MARKER_PATH, F_OK));
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_get_format_worker_count_limits_unknown_disks, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_get_format_inode_ratio_keeps_default, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_get_format_inode_ratio_sizes_to_rootfs, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_build_format_job_fast_profile, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_build_format_job_full_profile, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_build_format_job_full_profile_after_discard, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_build_format_job_without_filesystem, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_format_partitions_dry_run_keeps_order, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_format_partitions_without_filesystems, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_format_partitions_logs_output_blocks, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_format_partitions_stops_after_failure, setup, teardown),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,335 @@
+/**
+ * This code is responsible for testing the partition table writer, including
+ * laying partitions out, encoding GPT and MBR tables, and recording the
+ * table in dry-run mode.
+ */
+
+#include "../../all.h"
+
+#define TEST_DISK_PATH "/tmp/limeos-test-partition-table.img"
+
+/** The size of the test disk, in 512-byte sectors. */
+#define TEST_DISK_SECTORS (64ULL * 1024 * 2)
+
+/** Sets up the test environment before each test. */
+static int setup(void **state)
+{
+    (void)state;
+    reset_store();
+    close_dry_run_log();
+    unlink(CONFIG_DRY_RUN_LOG_PATH);
+
+    // Fill the test disk with a pattern, so cleared sectors can be seen.
+    FILE *file = fopen(TEST_DISK_PATH, "w");
+    assert_non_null(file);
+    unsigned char sector[512];
+    memset(sector, 0xa5, sizeof(sector));
+    for (unsigned long long i = 0; i < TEST_DISK_SECTORS; i++)
+    {
+        assert_int_equal(1, fwrite(sector, sizeof(sector), 1, file));
+    }
+    fclose(file);
+    return 0;
+}
+
+/** Cleans up the test environment after each test. */
+static int teardown(void **state)
+{
+    (void)state;
+    close_dry_run_log();
+    unlink(CONFIG_DRY_RUN_LOG_PATH);
+    unlink(TEST_DISK_PATH);
+    return 0;
+}
+
+/** Helper to add a partition to the store. */
+static void add_test_partition(unsigned long long size_bytes, PartitionFS filesystem, const char *mount_point)
+{
+    Store *store = get_store();
+    Partition *partition = &store->partitions[store->partition_count++];
+    partition->size_bytes = size_bytes;
+    partition->type = PART_PRIMARY;
+    partition->filesystem = filesystem;
+    snprintf(partition->mount_point, sizeof(partition->mount_point), "%s", mount_point);
+}
+
+/** Helper to read sectors of the test disk. */
+static void read_test_sectors(unsigned long long sector, unsigned char *out_buffer, size_t count)
+{
+    int fd = open(TEST_DISK_PATH, O_RDONLY);
+    assert_true(fd >= 0);
+    assert_int_equal((ssize_t)(count * 512), pread(fd, out_buffer, count * 512, (off_t)(sector * 512)));
+    close(fd);
+}
+
+/** Helper to build and write the configured table to the test disk. */
+static void write_test_table(PartitionTable *out_table)
+{
+    assert_int_equal(0, build_partition_table(get_store(), 512, TEST_DISK_SECTORS, out_table));
+    int fd = open(TEST_DISK_PATH, O_RDWR);
+    assert_true(fd >= 0);
+    assert_int_equal(0, write_partition_table(fd, out_table));
+    close(fd);
+}
+
+static unsigned int get_le32(const unsigned char *bytes)
+{
+    return (unsigned int)bytes[0] | (unsigned int)bytes[1] << 8 |
+        (unsigned int)bytes[2] << 16 | (unsigned int)bytes[3] << 24;
+}
+
+static unsigned long long get_le64(const unsigned char *bytes)
+{
+    return (unsigned long long)get_le32(bytes) | (unsigned long long)get_le32(bytes + 4) << 32;
+}
+
+/** Helper to check a GPT header and the entries it points at. */
+static void assert_valid_gpt_header(unsigned long long header_sector, unsigned long long alternate_sector)
+{
+    unsigned char header[512];
+    read_test_sectors(header_sector, header, 1);
+    assert_int_equal(0, memcmp("EFI PART", header, 8));
+    assert_int_equal(header_sector, get_le64(header + 24));
+    assert_int_equal(alternate_sector, get_le64(header + 32));
+
+    // Check the header checksum, computed with the field zeroed.
+    unsigned int checksum = get_le32(header + 16);
+    memset(header + 16, 0, 4);
+    assert_int_equal(checksum, (unsigned int)crc32(0, header, 92));
+
+    // Check the entries checksum.
+    unsigned char entries[GPT_ENTRY_COUNT * GPT_ENTRY_BYTES];
+    read_test_sectors(get_le64(header + 72), entries, sizeof(entries) / 512);
+    assert_int_equal(get_le32(header + 88), (unsigned int)crc32(0, entries, sizeof(entries)));
+}
+
+/** Verifies build_partition_table() aligns partitions to MiB boundaries. */
+static void test_build_partition_table_aligns_partitions(void **state)
+{
+    (void)state;
+    add_test_partition(512ULL * 1000000, FS_FAT32, "/boot/efi");
+    add_test_partition(2ULL * 1000000000, FS_EXT4, "/");
+    PartitionTable table;
+
+    assert_int_equal(0, build_partition_table(get_store(), 512, 0, &table));
+
+    assert_int_equal(2, table.count);
+    assert_int_equal(2048, table.entries[0].first_sector);
+    assert_int_equal(1003519, table.entries[0].last_sector);
+    assert_int_equal(1003520, table.entries[1].first_sector);
+    assert_int_equal(4909055, table.entries[1].last_sector);
+}
+
+/** Verifies build_partition_table() aligns partitions to the disk alignment. */
+static void test_build_partition_table_honors_disk_alignment(void **state)
+{
+    (void)state;
+    Store *store = get_store();
+    store->disk_alignment = 4ULL * 1024 * 1024;
+    add_test_partition(8ULL * 1000000, FS_FAT32, "/boot/efi");
+    add_test_partition(16ULL * 1000000, FS_EXT4, "/");
+    PartitionTable table;
+
+    assert_int_equal(0, build_partition_table(store, 512, 0, &table));
+
+    // Each start and end lands on a 4 MiB (8192-sector) boundary.
+    assert_int_equal(8192, table.entries[0].first_sector);
+    assert_int_equal(24575, table.entries[0].last_sector);
+    assert_int_equal(24576, table.entries[1].first_sector);
+    assert_int_equal(49151, table.entries[1].last_sector);
+}
+
+/** Verifies get_partition_alignment() combines the disk's I/O alignment with 1 MiB. */
+static void test_get_partition_alignment(void **state)
+{
+    (void)state;
+    assert_int_equal(PARTITION_ALIGNMENT_BYTES, get_partition_alignment(0));
+    assert_int_equal(PARTITION_ALIGNMENT_BYTES, get_partition_alignment(4096));
+    assert_int_equal(4ULL * 1024 * 1024, get_partition_alignment(4ULL * 1024 * 1024));
+    assert_int_equal(3ULL * 1024 * 1024, get_partition_alignment(192ULL * 1024));
+
+    // A misreported optimal I/O size falls back to 1 MiB.
+    assert_int_equal(PARTITION_ALIGNMENT_BYTES, get_partition_alignment(33553920));
+}
+
+/** Verifies build_partition_table() uses the partition types of the flags. */
+static void test_build_partition_table_sets_types(void **state)
+{
+    (void)state;
+    Store *store = get_store();
+    add_test_partition(1ULL * 1000000, FS_NONE, "");
+    store->partitions[0].flag_bios_grub = 1;
+    add_test_partition(512ULL * 1000000, FS_FAT32, "/boot/efi");
+    store->partitions[1].flag_esp = 1;
+    add_test_partition(1ULL * 1000000000, FS_SWAP, "");
+    add_test_partition(1ULL * 1000000000, FS_EXT4, "/");
+    store->partitions[3].flag_boot = 1;
+    PartitionTable table;
+
+    assert_int_equal(0, build_partition_table(store, 512, 0, &table));
+
+    assert_string_equal("bios_grub", table.entries[0].type_name);
+    assert_string_equal("esp", table.entries[1].type_name);
+    assert_int_equal(0xef, table.entries[1].mbr_type);
+    assert_string_equal("swap", table.entries[2].type_name);
+    assert_int_equal(0x82, table.entries[2].mbr_type);
+    assert_string_equal("linux", table.entries[3].type_name);
+    assert_true(table.entries[3].bootable);
+}
+
+/** Verifies build_partition_table() gives the last partition the end of the disk. */
+static void test_build_partition_table_fits_last_partition(void **state)
+{
+    (void)state;
+    Store *store = get_store();
+    add_test_partition(66ULL * 1000000, FS_EXT4, "/");
+    PartitionTable table;
+
+    assert_int_equal(0, build_partition_table(store, 512, TEST_DISK_SECTORS, &table));
+
+    assert_int_equal(TEST_DISK_SECTORS - 34, table.entries[0].last_sector);
+}
+
+/** Verifies build_partition_table() rejects partitions larger than the disk. */
+static void test_build_partition_table_rejects_oversized(void **state)
+{
+    (void)state;
+    add_test_partition(TEST_DISK_SECTORS * 512, FS_EXT4, "/");
+    PartitionTable table;
+
+    assert_int_equal(-2, build_partition_table(get_store(), 512, TEST_DISK_SECTORS, &table));
+}
+
+/** Verifies build_partition_table() limits an MBR to four partitions. */
+static void test_build_partition_table_limits_mbr(void **state)
+{
+    (void)state;
+    Store *store = get_store();
+    store->disk_label = DISK_LABEL_MBR;
+    for (int i = 0; i < 5; i++)
+    {
+        add_test_partition(1ULL * 1000000, FS_EXT4, "");
+    }
+    PartitionTable table;
+
+    assert_int_equal(-1, build_partition_table(store, 512, 0, &table));
+}
+
+/** Verifies write_partition_table() writes a GPT with its backup copy. */
+static void test_write_partition_table_writes_gpt(void **state)
+{
+    (void)state;
+    add_test_partition(8ULL * 1000000, FS_FAT32, "/boot/efi");
+    get_store()->partitions[0].flag_esp = 1;
+    add_test_partition(16ULL * 1000000, FS_EXT4, "/");
+    PartitionTable table;
+
+    write_test_table(&table);
+
+    // Check the protective MBR.
+    unsigned char sector[512];
+    read_test_sectors(0, sector, 1);
+    assert_int_equal(0xee, sector[446 + 4]);
+    assert_int_equal(1, get_le32(sector + 446 + 8));
+    assert_int_equal(0x55, sector[510]);
+    assert_int_equal(0xaa, sector[511]);
+
+    // Check both headers, then the first entry.
+    assert_valid_gpt_header(1, TEST_DISK_SECTORS - 1);
+    assert_valid_gpt_header(TEST_DISK_SECTORS - 1, 1);
+    unsigned char entries[GPT_ENTRY_COUNT * GPT_ENTRY_BYTES];
+    read_test_sectors(2, entries, sizeof(entries) / 512);
+    assert_int_equal(0, memcmp(table.entries[0].gpt_type, entries, 16));
+    assert_int_equal(2048, get_le64(entries + 32));
+    assert_int_equal(table.entries[0].last_sector, get_le64(entries + 40));
+    assert_int_equal(table.entries[1].first_sector, get_le64(entries + GPT_ENTRY_BYTES + 32));
+
+    // Check the partition data was left alone.
+    read_test_sectors(2048, sector, 1);
+    assert_int_equal(0xa5, sector[0]);
+}
+
+/** Verifies write_partition_table() writes an MBR and clears old GPT headers. */
+static void test_write_partition_table_writes_mbr(void **state)
+{
+    (void)state;
+    Store *store = get_store();
+    store->disk_label = DISK_LABEL_MBR;
+    add_test_partition(16ULL * 1000000, FS_EXT4, "/");
+    store->partitions[0].flag_boot = 1;
+    add_test_partition(8ULL * 1000000, FS_SWAP, "");
+    PartitionTable table;
+
+    write_test_table(&table);
+
+    unsigned char sector[512];
+    read_test_sectors(0, sector, 1);
+    assert_int_equal(0x80, sector[446]);
+    assert_int_equal(0x83, sector[446 + 4]);
+    assert_int_equal(2048, get_le32(sector + 446 + 8));
+    assert_int_equal(0x00, sector[462]);
+    assert_int_equal(0x82, sector[462 + 4]);
+    assert_int_equal(table.entries[1].first_sector, get_le32(sector + 462 + 8));
+    assert_int_equal(0x55, sector[510]);
+    assert_int_equal(0xaa, sector[511]);
+
+    read_test_sectors(1, sector, 1);
+    assert_int_equal(0, sector[0]);
+    read_test_sectors(TEST_DISK_SECTORS - 1, sector, 1);
+    assert_int_equal(0, sector[0]);
+}
+
+/** Verifies write_partition_table() rejects a table without a disk size. */
+static void test_write_partition_table_needs_disk_size(void **state)
+{
+    (void)state;
+    add_test_partition(16ULL * 1000000, FS_EXT4, "/");
+    PartitionTable table;
+    assert_int_equal(0, build_partition_table(get_store(), 512, 0, &table));
+
+    int fd = open(TEST_DISK_PATH, O_RDWR);
+    assert_true(fd >= 0);
+    assert_int_equal(-1, write_partition_table(fd, &table));
+    close(fd);
+}
+
+/** Verifies create_partition_table() records an MBR in dry-run mode. */
+static void test_create_partition_table_honors_mbr_in_dry_run(void **state)
+{
+    (void)state;
+    Store *store = get_store();
+    store->dry_run = 1;
+    store->disk_label = DISK_LABEL_MBR;
+    add_test_partition(1ULL * 1000000000, FS_EXT4, "/");
+
+    assert_int_equal(0, create_partition_table("/dev/sda"));
+    close_dry_run_log();
+
+    FILE *file = fopen(CONFIG_DRY_RUN_LOG_PATH, "r");
+    assert_non_null(file);
+    char line[256];
+    assert_non_null(fgets(line, sizeof(line), file));
+    assert_string_equal("write-partition-table msdos /dev/sda\n", line);
+    assert_non_null(fgets(line, sizeof(line), file));
+    assert_string_equal("partition /dev/sda1 2048-1955839 linux\n", line);
+    fclose(file);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_build_partition_table_aligns_partitions, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_build_partition_table_honors_disk_alignment, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_get_partition_alignment, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_build_partition_table_sets_types, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_build_partition_table_fits_last_partition, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_build_partition_table_rejects_oversized, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_build_partition_table_limits_mbr, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_write_partition_table_writes_gpt, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_write_partition_table_writes_mbr, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_write_partition_table_needs_disk_size, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_create_partition_table_honors_mbr_in_dry_run, setup, teardown),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
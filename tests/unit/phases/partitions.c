@@ -64,7 +64,7 @@ static int log_contains(char lines[][512], int count, const char *substring)
     return 0;
 }
 
-/** Verifies create_partitions() creates GPT label on the disk. */
+/** Verifies create_partitions() writes a GPT label to the disk. */
 static void test_create_partitions_creates_gpt_label(void **state)
 {
     (void)state;
@@ -87,8 +87,8 @@ static void test_create_partitions_creates_gpt_label(void **state)
     char lines[32][512];
     int count = read_dry_run_log(lines, 32);
 
-    assert_true(count >= 1);
-    assert_string_equal("parted -s '/dev/sda' mklabel gpt >>" CONFIG_INSTALL_LOG_PATH " 2>&1", lines[0]);
+    assert_true(count >= 2);
+    assert_string_equal("write-partition-table gpt /dev/sda", lines[1]);
 }
 
 /** Verifies create_partitions() creates single partition with correct boundaries. */
@@ -114,15 +114,17 @@ static void test_create_partitions_single_partition(void **state)
     char lines[32][512];
     int count = read_dry_run_log(lines, 32);
 
-    assert_true(count >= 4);
+    assert_true(count >= 5);
+    // Old signatures cleared.
+    assert_string_equal("wipe-signatures /dev/sda", lines[0]);
     // GPT label.
-    assert_string_equal("parted -s '/dev/sda' mklabel gpt >>" CONFIG_INSTALL_LOG_PATH " 2>&1", lines[0]);
-    // Verify decimal conversion: 1,000,000,000 / 1,000,000 = 1000MB, not 954MiB.
-    assert_string_equal("parted -s '/dev/sda' mkpart primary 1MB 1001MB >>" CONFIG_INSTALL_LOG_PATH " 2>&1", lines[1]);
+    assert_string_equal("write-partition-table gpt /dev/sda", lines[1]);
+    // Verify decimal conversion: 1MB to 1001MB, not 954MiB, aligned to MiB.
+    assert_string_equal("partition /dev/sda1 2048-1955839 linux", lines[2]);
     // Format as ext4.
-    assert_string_equal("mkfs.ext4 -F '/dev/sda1' >>" CONFIG_INSTALL_LOG_PATH " 2>&1", lines[2]);
+    assert_string_equal("mkfs.ext4 -F -E lazy_itable_init=1,lazy_journal_init=1,nodiscard /dev/sda1 >>" CONFIG_INSTALL_LOG_PATH " 2>&1", lines[3]);
     // Mount root.
-    assert_string_equal("mount '/dev/sda1' /mnt >>" CONFIG_INSTALL_LOG_PATH " 2>&1", lines[3]);
+    assert_string_equal("mount -t ext4 -o noatime,commit=60,errors=remount-ro /dev/sda1 /mnt", lines[4]);
 }
 
 /** Verifies create_partitions() creates multiple partitions with correct boundaries. */
@@ -154,11 +156,11 @@ static void test_create_partitions_multiple_partitions(void **state)
     char lines[32][512];
     int count = read_dry_run_log(lines, 32);
 
-    assert_true(count >= 6);
-    // Partition 1: 1MB to 513MB.
-    assert_string_equal("parted -s '/dev/sda' mkpart primary 1MB 513MB >>" CONFIG_INSTALL_LOG_PATH " 2>&1", lines[1]);
-    // Partition 2: 513MB to 2513MB.
-    assert_string_equal("parted -s '/dev/sda' mkpart primary 513MB 2513MB >>" CONFIG_INSTALL_LOG_PATH " 2>&1", lines[2]);
+    assert_true(count >= 7);
+    // Partition 1: 1MB to 513MB, aligned to MiB.
+    assert_string_equal("partition /dev/sda1 2048-1003519 linux", lines[2]);
+    // Partition 2: 513MB to 2513MB, aligned to MiB.
+    assert_string_equal("partition /dev/sda2 1003520-4909055 linux", lines[3]);
 }
 
 /** Verifies create_partitions() sets boot flag when requested. */
@@ -184,8 +186,8 @@ static void test_create_partitions_sets_boot_flag(void **state)
     char lines[32][512];
     int count = read_dry_run_log(lines, 32);
 
-    // Find boot flag command.
-    assert_true(log_contains(lines, count, "parted -s '/dev/sda' set 1 boot on"));
+    // Find the bootable partition.
+    assert_true(log_contains(lines, count, "partition /dev/sda1 2048-1003519 linux boot"));
 }
 
 /** Verifies create_partitions() sets ESP flag when requested. */
@@ -211,8 +213,8 @@ static void test_create_partitions_sets_esp_flag(void **state)
     char lines[32][512];
     int count = read_dry_run_log(lines, 32);
 
-    // Find ESP flag command.
-    assert_true(log_contains(lines, count, "parted -s '/dev/sda' set 1 esp on"));
+    // Find the ESP partition type.
+    assert_true(log_contains(lines, count, "partition /dev/sda1 2048-1003519 esp"));
 }
 
 /** Verifies create_partitions() sets BIOS boot flag when requested. */
@@ -246,8 +248,8 @@ static void test_create_partitions_sets_bios_grub_flag(void **state)
     char lines[32][512];
     int count = read_dry_run_log(lines, 32);
 
-    // Find bios_grub flag command.
-    assert_true(log_contains(lines, count, "parted -s '/dev/sda' set 1 bios_grub on"));
+    // Find the BIOS boot partition type.
+    assert_true(log_contains(lines, count, "partition /dev/sda1 2048-4095 bios_grub"));
 }
 
 /** Verifies create_partitions() formats swap partitions with mkswap. */
@@ -281,8 +283,8 @@ static void test_create_partitions_formats_swap(void **state)
     int count = read_dry_run_log(lines, 32);
 
     // Find mkswap and swapon commands.
-    assert_true(log_contains(lines, count, "mkswap '/dev/sda2'"));
-    assert_true(log_contains(lines, count, "swapon '/dev/sda2'"));
+    assert_true(log_contains(lines, count, "mkswap /dev/sda2"));
+    assert_true(log_contains(lines, count, "swapon /dev/sda2"));
 }
 
 /** Verifies create_partitions() formats FAT32 partitions correctly. */
@@ -317,7 +319,7 @@ static void test_create_partitions_formats_fat32(void **state)
     int count = read_dry_run_log(lines, 32);
 
     // Find mkfs.vfat command.
-    assert_true(log_contains(lines, count, "mkfs.vfat -F 32 '/dev/sda1'"));
+    assert_true(log_contains(lines, count, "mkfs.vfat -F 32 /dev/sda1"));
 }
 
 /** Verifies create_partitions() handles NVMe device naming. */
@@ -343,7 +345,7 @@ static void test_create_partitions_nvme_naming(void **state)
     int count = read_dry_run_log(lines, 32);
 
     // Find mkfs command with correct NVMe partition naming (p1 suffix).
-    assert_true(log_contains(lines, count, "mkfs.ext4 -F '/dev/nvme0n1p1'"));
+    assert_true(log_contains(lines, count, "mkfs.ext4 -F -E lazy_itable_init=1,lazy_journal_init=1,nodiscard /dev/nvme0n1p1"));
 }
 
 /** Verifies create_partitions() mounts non-root partitions correctly. */
@@ -377,8 +379,75 @@ static void test_create_partitions_mounts_nonroot(void **state)
     int count = read_dry_run_log(lines, 32);
 
     // Find mkdir and mount command for /home.
-    assert_true(log_contains(lines, count, "mkdir -p '/mnt/home'"));
-    assert_true(log_contains(lines, count, "mount '/dev/sda2' '/mnt/home'"));
+    assert_true(log_contains(lines, count, "mkdir -p /mnt/home"));
+    assert_true(log_contains(lines, count, "mount -t ext4 -o noatime,commit=60 /dev/sda2 /mnt/home"));
+}
+
+/** Verifies create_partitions() leaves the root to the image in image mode. */
+static void test_create_partitions_skips_root_format_in_image_mode(void **state)
+{
+    (void)state;
+    Store *store = get_store();
+    store->dry_run = 1;
+    store->rootfs_image = 1;
+    strncpy(store->disk, "/dev/sda", MAX_DISK_LEN);
+
+    store->partition_count = 2;
+
+    // Root partition.
+    store->partitions[0].size_bytes = 1ULL * 1000000000;
+    store->partitions[0].type = PART_PRIMARY;
+    store->partitions[0].filesystem = FS_EXT4;
+    strncpy(store->partitions[0].mount_point, "/", MAX_MOUNT_LEN);
+
+    // Home partition.
+    store->partitions[1].size_bytes = 2ULL * 1000000000;
+    store->partitions[1].type = PART_PRIMARY;
+    store->partitions[1].filesystem = FS_EXT4;
+    strncpy(store->partitions[1].mount_point, "/home", MAX_MOUNT_LEN);
+
+    int result = create_partitions();
+    close_dry_run_log();
+
+    assert_int_equal(0, result);
+
+    char lines[32][512];
+    int count = read_dry_run_log(lines, 32);
+
+    // Only the non-root partition is formatted.
+    assert_false(log_contains(lines, count, "mkfs.ext4 -F -E lazy_itable_init=1,lazy_journal_init=1,nodiscard /dev/sda1"));
+    assert_true(log_contains(lines, count, "mkfs.ext4 -F -E lazy_itable_init=1,lazy_journal_init=1,nodiscard /dev/sda2"));
+
+    // Nothing is mounted until the image has been written.
+    assert_false(log_contains(lines, count, "mount "));
+}
+
+/** Verifies create_partitions() ignores the image for a non-ext4 root. */
+static void test_create_partitions_ignores_image_for_non_ext4_root(void **state)
+{
+    (void)state;
+    Store *store = get_store();
+    store->dry_run = 1;
+    store->rootfs_image = 1;
+    strncpy(store->disk, "/dev/sda", MAX_DISK_LEN);
+
+    store->partition_count = 1;
+    store->partitions[0].size_bytes = 1ULL * 1000000000;
+    store->partitions[0].type = PART_PRIMARY;
+    store->partitions[0].filesystem = FS_FAT32;
+    strncpy(store->partitions[0].mount_point, "/", MAX_MOUNT_LEN);
+
+    int result = create_partitions();
+    close_dry_run_log();
+
+    assert_int_equal(0, result);
+
+    char lines[32][512];
+    int count = read_dry_run_log(lines, 32);
+
+    // The root is formatted and mounted as usual.
+    assert_true(log_contains(lines, count, "mkfs.vfat -F 32 /dev/sda1"));
+    assert_true(log_contains(lines, count, "mount -t vfat -o noatime,umask=0077 /dev/sda1 /mnt"));
 }
 
 /** Verifies create_partitions() fails when no root partition is defined. */
@@ -432,6 +501,8 @@ int main(void)
         cmocka_unit_test_setup_teardown(test_create_partitions_formats_fat32, setup, teardown),
         cmocka_unit_test_setup_teardown(test_create_partitions_nvme_naming, setup, teardown),
         cmocka_unit_test_setup_teardown(test_create_partitions_mounts_nonroot, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_create_partitions_skips_root_format_in_image_mode, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_create_partitions_ignores_image_for_non_ext4_root, setup, teardown),
         cmocka_unit_test_setup_teardown(test_create_partitions_fails_without_root, setup, teardown),
         cmocka_unit_test_setup_teardown(test_create_partitions_empty_fails, setup, teardown),
     };
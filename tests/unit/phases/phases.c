@@ -4,6 +4,7 @@
 
 // Track progress callback invocations.
 static int callback_invocations[32];
+static int callback_phases[32];
 static int callback_count;
 static InstallEvent last_event;
 static int last_phase_index;
@@ -20,6 +21,7 @@ static void test_progress_cb(
     (void)context;
     if (callback_count < 32)
     {
+        callback_phases[callback_count] = phase_index;
         callback_invocations[callback_count++] = (int)event;
     }
     last_event = event;
@@ -37,6 +39,7 @@ static int setup(void **state)
     unlink(CONFIG_INSTALL_LOG_PATH);
     callback_count = 0;
     memset(callback_invocations, 0, sizeof(callback_invocations));
+    memset(callback_phases, 0, sizeof(callback_phases));
     last_event = 0;
     last_phase_index = 0;
     last_error_code = 0;
@@ -264,6 +267,100 @@ static void test_run_install_calls_cleanup_on_success(void **state)
     assert_true(log_contains(lines, count, "umount"));
 }
 
+/** Helper to find the position of an event for a phase, or -1. */
+static int find_event(InstallEvent event, int phase_index)
+{
+    for (int i = 0; i < callback_count; i++)
+    {
+        if (callback_invocations[i] == (int)event && callback_phases[i] == phase_index)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/** Verifies every phase only depends on phases registered before it. */
+static void test_install_phases_depend_on_earlier_phases(void **state)
+{
+    (void)state;
+    for (int i = 0; i < INSTALL_PHASE_COUNT; i++)
+    {
+        assert_int_equal(0, install_phases[i].dependencies >> i);
+    }
+}
+
+/** Verifies run_install() starts each phase after its dependencies succeed. */
+static void test_run_install_respects_phase_dependencies(void **state)
+{
+    (void)state;
+    setup_minimal_config();
+
+    assert_int_equal(0, run_install(test_progress_cb, NULL));
+    close_dry_run_log();
+
+    for (int i = 0; i < INSTALL_PHASE_COUNT; i++)
+    {
+        int begin = find_event(INSTALL_STEP_BEGIN, i);
+        assert_true(begin >= 0);
+        assert_true(find_event(INSTALL_STEP_OK, i) > begin);
+        for (int j = 0; j < INSTALL_PHASE_COUNT; j++)
+        {
+            if (install_phases[i].dependencies & PHASE_DEPENDS_ON(j))
+            {
+                assert_true(find_event(INSTALL_STEP_OK, j) < begin);
+            }
+        }
+    }
+}
+
+/** Verifies run_install() reports the wall time saved in the install log. */
+static void test_run_install_logs_time_saved(void **state)
+{
+    (void)state;
+    setup_minimal_config();
+
+    run_install(test_progress_cb, NULL);
+    close_dry_run_log();
+
+    FILE *f = fopen(CONFIG_INSTALL_LOG_PATH, "r");
+    assert_non_null(f);
+
+    char buffer[8192];
+    size_t len = fread(buffer, 1, sizeof(buffer) - 1, f);
+    buffer[len] = '\0';
+    fclose(f);
+
+    assert_non_null(strstr(buffer, "over running them in order"));
+}
+
+/** Verifies run_install() writes a span for each phase to the requested trace. */
+static void test_run_install_writes_trace(void **state)
+{
+    (void)state;
+    const char *trace_path = "/tmp/limeos-test-phases-trace.json";
+    setup_minimal_config();
+    get_store()->trace_path = trace_path;
+
+    run_install(test_progress_cb, NULL);
+    close_dry_run_log();
+
+    FILE *f = fopen(trace_path, "r");
+    assert_non_null(f);
+    char buffer[8192];
+    size_t len = fread(buffer, 1, sizeof(buffer) - 1, f);
+    buffer[len] = '\0';
+    fclose(f);
+    unlink(trace_path);
+
+    for (int i = 0; i < INSTALL_PHASE_COUNT; i++)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "\"name\":\"%s\",\"cat\":\"phase\"", install_phases[i].display_name);
+        assert_non_null(strstr(buffer, name));
+    }
+}
+
 int main(void)
 {
     const struct CMUnitTest tests[] = {
@@ -276,6 +373,10 @@ int main(void)
         cmocka_unit_test_setup_teardown(test_run_install_initializes_log, setup, teardown),
         cmocka_unit_test_setup_teardown(test_run_install_writes_log_headers, setup, teardown),
         cmocka_unit_test_setup_teardown(test_run_install_calls_cleanup_on_success, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_install_phases_depend_on_earlier_phases, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_run_install_respects_phase_dependencies, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_run_install_logs_time_saved, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_run_install_writes_trace, setup, teardown),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
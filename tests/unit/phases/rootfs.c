@@ -61,8 +61,103 @@ static int log_contains(char lines[][512], int count, const char *substring)
     return 0;
 }
 
-/** Verifies extract_rootfs() generates correct tar command in dry-run mode. */
-static void test_extract_rootfs_generates_tar_command(void **state)
+/** The scratch directory used by extraction tests. */
+#define TEST_ROOT "/tmp/limeos-rootfs-test"
+
+/** The path of the archive written by extraction tests. */
+#define TEST_ARCHIVE TEST_ROOT "/rootfs.tar.gz"
+
+/** The directory extraction tests extract into. */
+#define TEST_TARGET TEST_ROOT "/target"
+
+/** Helper to write one ustar header block into a gzip stream. */
+static void write_tar_header(
+    gzFile file, const char *name, char type, int mode,
+    unsigned long long size, const char *link_name
+)
+{
+    unsigned char header[512] = {0};
+    snprintf((char *)header, 100, "%s", name);
+    snprintf((char *)header + 100, 8, "%07o", mode);
+    snprintf((char *)header + 108, 8, "%07o", 0);
+    snprintf((char *)header + 116, 8, "%07o", 0);
+    snprintf((char *)header + 124, 12, "%011llo", size);
+    snprintf((char *)header + 136, 12, "%011o", 1700000000);
+    header[156] = (unsigned char)type;
+    if (link_name)
+    {
+        snprintf((char *)header + 157, 100, "%s", link_name);
+    }
+    memcpy(header + 257, "ustar\0" "00", 8);
+
+    // Compute the checksum with the checksum field set to spaces.
+    memset(header + 148, ' ', 8);
+    unsigned int checksum = 0;
+    for (int i = 0; i < 512; i++)
+    {
+        checksum += header[i];
+    }
+    snprintf((char *)header + 148, 8, "%06o", checksum);
+
+    gzwrite(file, header, sizeof(header));
+}
+
+/** Helper to write a regular file entry with its padded contents. */
+static void write_tar_file(gzFile file, const char *name, const char *contents)
+{
+    size_t length = strlen(contents);
+    write_tar_header(file, name, '0', 0644, length, NULL);
+    gzwrite(file, contents, (unsigned)length);
+
+    unsigned char padding[512] = {0};
+    size_t padding_length = (512 - length % 512) % 512;
+    if (padding_length > 0)
+    {
+        gzwrite(file, padding, (unsigned)padding_length);
+    }
+}
+
+/** Helper to write the end-of-archive marker. */
+static void write_tar_end(gzFile file)
+{
+    unsigned char zeros[1024] = {0};
+    gzwrite(file, zeros, sizeof(zeros));
+}
+
+/** Helper to read a whole small file into a buffer. */
+static int read_test_file(const char *path, char *buffer, size_t size)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        return -1;
+    }
+    size_t length = fread(buffer, 1, size - 1, file);
+    buffer[length] = '\0';
+    fclose(file);
+    return 0;
+}
+
+/** Sets up a clean scratch directory before each extraction test. */
+static int setup_extraction(void **state)
+{
+    setup(state);
+    assert_int_equal(0, system("rm -rf " TEST_ROOT));
+    mkdir(TEST_ROOT, 0755);
+    mkdir(TEST_TARGET, 0755);
+    return 0;
+}
+
+/** Removes the scratch directory after each extraction test. */
+static int teardown_extraction(void **state)
+{
+    teardown(state);
+    assert_int_equal(0, system("rm -rf " TEST_ROOT));
+    return 0;
+}
+
+/** Verifies extract_rootfs() records the extraction in dry-run mode. */
+static void test_extract_rootfs_logs_extraction_in_dry_run(void **state)
 {
     (void)state;
     Store *store = get_store();
@@ -78,12 +173,12 @@ static void test_extract_rootfs_generates_tar_command(void **state)
 
     assert_true(count >= 1);
 
-    // Should run tar extraction to /mnt.
-    assert_true(log_contains(lines, count, "tar -xzf /usr/share/limeos/rootfs.tar.gz -C /mnt"));
+    // Should record extraction of the tarball into /mnt.
+    assert_true(log_contains(lines, count, "extract /usr/share/limeos/rootfs.tar.gz -C /mnt"));
 }
 
-/** Verifies extract_rootfs() redirects output to install log. */
-static void test_extract_rootfs_redirects_to_log(void **state)
+/** Verifies extract_rootfs() no longer shells out to tar. */
+static void test_extract_rootfs_does_not_run_tar(void **state)
 {
     (void)state;
     Store *store = get_store();
@@ -97,8 +192,8 @@ static void test_extract_rootfs_redirects_to_log(void **state)
     char lines[16][512];
     int count = read_dry_run_log(lines, 16);
 
-    // Should include log redirection.
-    assert_true(log_contains(lines, count, ">>" CONFIG_INSTALL_LOG_PATH " 2>&1"));
+    // Extraction happens in-process, so no tar command is logged.
+    assert_false(log_contains(lines, count, "tar -x"));
 }
 
 /** Verifies extract_rootfs() skips file existence check in dry-run mode. */
@@ -109,7 +204,7 @@ static void test_extract_rootfs_skips_existence_check_in_dry_run(void **state)
     store->dry_run = 1;
 
     // In dry-run mode, the rootfs.tar.gz doesn't need to exist.
-    // The function should succeed and log the command.
+    // The function should succeed and log the extraction.
     int result = extract_rootfs();
     close_dry_run_log();
 
@@ -118,16 +213,21 @@ static void test_extract_rootfs_skips_existence_check_in_dry_run(void **state)
     char lines[16][512];
     int count = read_dry_run_log(lines, 16);
 
-    // Command should still be logged.
+    // Extraction should still be logged.
     assert_true(count >= 1);
 }
 
-/** Verifies extract_rootfs() uses correct tarball path. */
-static void test_extract_rootfs_uses_correct_path(void **state)
+/** Verifies extract_rootfs() writes, grows and mounts the image in image mode. */
+static void test_extract_rootfs_deploys_image_in_dry_run(void **state)
 {
     (void)state;
     Store *store = get_store();
     store->dry_run = 1;
+    store->rootfs_image = 1;
+    strncpy(store->disk, "/dev/sda", MAX_DISK_LEN);
+    store->partition_count = 1;
+    store->partitions[0].filesystem = FS_EXT4;
+    strncpy(store->partitions[0].mount_point, "/", MAX_MOUNT_LEN);
 
     int result = extract_rootfs();
     close_dry_run_log();
@@ -137,57 +237,918 @@ static void test_extract_rootfs_uses_correct_path(void **state)
     char lines[16][512];
     int count = read_dry_run_log(lines, 16);
 
-    // Verify the exact tarball path is used.
-    assert_true(log_contains(lines, count, "/usr/share/limeos/rootfs.tar.gz"));
+    // The image is written, checked, grown and mounted in that order.
+    assert_true(count >= 4);
+    assert_string_equal("write-image " CONFIG_ROOTFS_IMAGE_PATH " /dev/sda1", lines[0]);
+    assert_string_equal("e2fsck -fy /dev/sda1 >>" CONFIG_INSTALL_LOG_PATH " 2>&1", lines[1]);
+    assert_string_equal("resize2fs /dev/sda1 >>" CONFIG_INSTALL_LOG_PATH " 2>&1", lines[2]);
+    assert_string_equal("mount -t ext4 -o noatime,commit=60,errors=remount-ro /dev/sda1 /mnt", lines[3]);
+    assert_false(log_contains(lines, count, "extract "));
 }
 
-/** Verifies extract_rootfs() extracts to /mnt target. */
-static void test_extract_rootfs_extracts_to_mnt(void **state)
+/** The path of the ext4 image written by image tests. */
+#define TEST_IMAGE TEST_ROOT "/rootfs.img"
+
+/** The path of the file standing in for the root partition. */
+#define TEST_DEVICE TEST_ROOT "/device"
+
+/** Verifies write_rootfs_image() writes only used blocks of a valid image. */
+static void test_write_rootfs_image_writes_used_blocks(void **state)
 {
     (void)state;
-    Store *store = get_store();
-    store->dry_run = 1;
 
-    int result = extract_rootfs();
-    close_dry_run_log();
+    // Build a small ext4 image from a populated directory.
+    if (system("command -v mke2fs >/dev/null && command -v debugfs >/dev/null") != 0)
+    {
+        return;
+    }
+    mkdir(TEST_ROOT "/tree", 0755);
+    FILE *file = fopen(TEST_ROOT "/tree/hostname", "w");
+    assert_non_null(file);
+    fputs("limeos\n", file);
+    fclose(file);
+    assert_int_equal(0, system(
+        "mke2fs -q -F -t ext4 -d " TEST_ROOT "/tree " TEST_IMAGE " 32M >/dev/null 2>&1"
+    ));
+
+    // Fill the stand-in partition with garbage, so skipped blocks would show.
+    file = fopen(TEST_DEVICE, "w");
+    assert_non_null(file);
+    static char garbage[1024 * 1024];
+    memset(garbage, 0xAA, sizeof(garbage));
+    for (int i = 0; i < 48; i++)
+    {
+        fwrite(garbage, 1, sizeof(garbage), file);
+    }
+    fclose(file);
+
+    RootfsProgress progress = {0};
+    int result = write_rootfs_image(TEST_IMAGE, TEST_DEVICE, &progress);
 
     assert_int_equal(0, result);
 
-    char lines[16][512];
-    int count = read_dry_run_log(lines, 16);
+    // Only a fraction of the image is written.
+    assert_true(progress.compressed_bytes > 0);
+    assert_true(progress.compressed_bytes < 32ULL * 1024 * 1024 / 2);
+    assert_int_equal(progress.compressed_total, progress.compressed_bytes);
 
-    // Verify extraction target is /mnt.
-    assert_true(log_contains(lines, count, "-C /mnt"));
+    // The written filesystem is consistent and holds the file.
+    assert_int_equal(0, system("e2fsck -fn " TEST_DEVICE " >/dev/null 2>&1"));
+    assert_int_equal(0, system(
+        "debugfs -R 'cat /hostname' " TEST_DEVICE " 2>/dev/null | grep -qx limeos"
+    ));
 }
 
-/** Verifies extract_rootfs() uses gzip decompression flag. */
-static void test_extract_rootfs_uses_gzip(void **state)
+/** Verifies write_rootfs_image() rejects images that are not ext4. */
+static void test_write_rootfs_image_rejects_non_ext4(void **state)
 {
     (void)state;
-    Store *store = get_store();
-    store->dry_run = 1;
 
-    int result = extract_rootfs();
-    close_dry_run_log();
+    FILE *file = fopen(TEST_IMAGE, "w");
+    assert_non_null(file);
+    static char zeros[64 * 1024];
+    fwrite(zeros, 1, sizeof(zeros), file);
+    fclose(file);
+
+    RootfsProgress progress = {0};
+    int result = write_rootfs_image(TEST_IMAGE, TEST_DEVICE, &progress);
+
+    assert_int_equal(-2, result);
+}
+
+/** Verifies write_rootfs_image() refuses devices smaller than the image. */
+static void test_write_rootfs_image_rejects_small_device(void **state)
+{
+    (void)state;
+
+    if (system("command -v mke2fs >/dev/null") != 0)
+    {
+        return;
+    }
+    assert_int_equal(0, system("mke2fs -q -F -t ext4 " TEST_IMAGE " 16M >/dev/null 2>&1"));
+    assert_int_equal(0, system("truncate -s 8M " TEST_DEVICE));
+
+    RootfsProgress progress = {0};
+    int result = write_rootfs_image(TEST_IMAGE, TEST_DEVICE, &progress);
+
+    assert_int_equal(-3, result);
+}
+
+/** Verifies extract_rootfs_archive() writes files, directories and links. */
+static void test_extract_rootfs_archive_writes_entries(void **state)
+{
+    (void)state;
+
+    // Build an archive with a directory, a file, a symlink and a hard link.
+    gzFile file = gzopen(TEST_ARCHIVE, "wb");
+    assert_non_null(file);
+    write_tar_header(file, "./", '5', 0755, 0, NULL);
+    write_tar_header(file, "./etc/", '5', 0750, 0, NULL);
+    write_tar_file(file, "./etc/hostname", "limeos\n");
+    write_tar_header(file, "./etc/name", '2', 0777, 0, "hostname");
+    write_tar_header(file, "./etc/copy", '1', 0644, 0, "./etc/hostname");
+    write_tar_end(file);
+    gzclose(file);
+
+    RootfsProgress progress = {0};
+    int result = extract_rootfs_archive(TEST_ARCHIVE, TEST_TARGET, 0, 1, WRITE_BACKEND_SYNC, &progress);
 
     assert_int_equal(0, result);
 
-    char lines[16][512];
-    int count = read_dry_run_log(lines, 16);
+    // Verify file contents.
+    char buffer[64];
+    assert_int_equal(0, read_test_file(TEST_TARGET "/etc/hostname", buffer, sizeof(buffer)));
+    assert_string_equal("limeos\n", buffer);
+
+    // Verify directory permissions were restored.
+    struct stat directory_stat;
+    assert_int_equal(0, stat(TEST_TARGET "/etc", &directory_stat));
+    assert_int_equal(0750, directory_stat.st_mode & 07777);
+
+    // Verify the symlink target.
+    char link_target[64] = {0};
+    assert_true(readlink(TEST_TARGET "/etc/name", link_target, sizeof(link_target) - 1) > 0);
+    assert_string_equal("hostname", link_target);
+
+    // Verify the hard link shares the original inode.
+    struct stat original_stat, copy_stat;
+    assert_int_equal(0, stat(TEST_TARGET "/etc/hostname", &original_stat));
+    assert_int_equal(0, stat(TEST_TARGET "/etc/copy", &copy_stat));
+    assert_int_equal(original_stat.st_ino, copy_stat.st_ino);
+}
+
+/** Verifies extract_rootfs_archive() reports byte-accurate progress. */
+static void test_extract_rootfs_archive_reports_progress(void **state)
+{
+    (void)state;
+
+    gzFile file = gzopen(TEST_ARCHIVE, "wb");
+    assert_non_null(file);
+    write_tar_file(file, "data", "0123456789");
+    write_tar_end(file);
+    gzclose(file);
+
+    struct stat archive_stat;
+    assert_int_equal(0, stat(TEST_ARCHIVE, &archive_stat));
+
+    RootfsProgress progress = {0};
+    int result = extract_rootfs_archive(TEST_ARCHIVE, TEST_TARGET, 0, 1, WRITE_BACKEND_SYNC, &progress);
+
+    assert_int_equal(0, result);
+
+    // All compressed bytes are consumed, and at least the header, the data
+    // block and one end-of-archive block are produced.
+    assert_int_equal(archive_stat.st_size, progress.compressed_total);
+    assert_int_equal(archive_stat.st_size, progress.compressed_bytes);
+    assert_true(progress.uncompressed_bytes >= 3 * 512);
+}
+
+/** Verifies extract_rootfs_archive() handles concatenated gzip members. */
+static void test_extract_rootfs_archive_handles_multiple_members(void **state)
+{
+    (void)state;
+
+    // Write each entry as a separate gzip member appended to the archive.
+    gzFile file = gzopen(TEST_ARCHIVE, "wb");
+    assert_non_null(file);
+    write_tar_file(file, "first", "one");
+    gzclose(file);
+    file = gzopen(TEST_ARCHIVE, "ab");
+    assert_non_null(file);
+    write_tar_file(file, "second", "two");
+    write_tar_end(file);
+    gzclose(file);
+
+    RootfsProgress progress = {0};
+    int result = extract_rootfs_archive(TEST_ARCHIVE, TEST_TARGET, 0, 1, WRITE_BACKEND_SYNC, &progress);
+
+    assert_int_equal(0, result);
+
+    char buffer[16];
+    assert_int_equal(0, read_test_file(TEST_TARGET "/second", buffer, sizeof(buffer)));
+    assert_string_equal("two", buffer);
+}
+
+/**
+ * Helper to write a block-indexed archive where every file is its own gzip
+ * member, followed by the end-of-archive marker in a final member.
+ */
+static void write_indexed_archive(int file_count)
+{
+    FILE *index = fopen(TEST_ARCHIVE CONFIG_ROOTFS_INDEX_SUFFIX, "w");
+    assert_non_null(index);
+    fputs("# offset compressed uncompressed\n", index);
+
+    unsigned long long offset = 0;
+    for (int i = 0; i <= file_count; i++)
+    {
+        // Append one member holding either a file or the end marker.
+        gzFile file = gzopen(TEST_ARCHIVE, i == 0 ? "wb" : "ab");
+        assert_non_null(file);
+        if (i < file_count)
+        {
+            char name[32], contents[32];
+            snprintf(name, sizeof(name), "file%d", i);
+            snprintf(contents, sizeof(contents), "contents %d", i);
+            write_tar_file(file, name, contents);
+        }
+        else
+        {
+            write_tar_end(file);
+        }
+        gzclose(file);
+
+        // Record where the member starts and how much it expands to.
+        struct stat archive_stat;
+        assert_int_equal(0, stat(TEST_ARCHIVE, &archive_stat));
+        unsigned long long size = (unsigned long long)archive_stat.st_size - offset;
+        fprintf(index, "%llu %llu %d\n", offset, size, 1024);
+        offset += size;
+    }
+    fclose(index);
+}
+
+/** Verifies extract_rootfs_archive() decodes indexed blocks on threads. */
+static void test_extract_rootfs_archive_decodes_blocks_in_parallel(void **state)
+{
+    (void)state;
+
+    write_indexed_archive(12);
+
+    struct stat archive_stat;
+    assert_int_equal(0, stat(TEST_ARCHIVE, &archive_stat));
+
+    RootfsProgress progress = {0};
+    int result = extract_rootfs_archive(TEST_ARCHIVE, TEST_TARGET, 3, 1, WRITE_BACKEND_SYNC, &progress);
+
+    assert_int_equal(0, result);
+
+    // Every file is written in archive order with its own contents.
+    char buffer[32];
+    assert_int_equal(0, read_test_file(TEST_TARGET "/file0", buffer, sizeof(buffer)));
+    assert_string_equal("contents 0", buffer);
+    assert_int_equal(0, read_test_file(TEST_TARGET "/file11", buffer, sizeof(buffer)));
+    assert_string_equal("contents 11", buffer);
+
+    // Progress covers the whole archive.
+    assert_int_equal(archive_stat.st_size, progress.compressed_bytes);
+    assert_true(progress.uncompressed_bytes >= 12 * 1024 + 512);
+}
+
+/** Verifies extract_rootfs_archive() falls back when the index is invalid. */
+static void test_extract_rootfs_archive_ignores_invalid_index(void **state)
+{
+    (void)state;
+
+    gzFile file = gzopen(TEST_ARCHIVE, "wb");
+    assert_non_null(file);
+    write_tar_file(file, "data", "sequential");
+    write_tar_end(file);
+    gzclose(file);
+
+    // The index does not cover the archive, so it must be ignored.
+    FILE *index = fopen(TEST_ARCHIVE CONFIG_ROOTFS_INDEX_SUFFIX, "w");
+    assert_non_null(index);
+    fputs("0 1 1024\n", index);
+    fclose(index);
+
+    RootfsProgress progress = {0};
+    int result = extract_rootfs_archive(TEST_ARCHIVE, TEST_TARGET, 2, 1, WRITE_BACKEND_SYNC, &progress);
+
+    assert_int_equal(0, result);
+
+    char buffer[32];
+    assert_int_equal(0, read_test_file(TEST_TARGET "/data", buffer, sizeof(buffer)));
+    assert_string_equal("sequential", buffer);
+}
+
+/** Helper to write an archive whose entries are described by a manifest. */
+static void write_manifest_archive(const char *manifest)
+{
+    // Lay out entries at known offsets: each header is one block and each
+    // file holds less than one block of data.
+    gzFile file = gzopen(TEST_ARCHIVE, "wb");
+    assert_non_null(file);
+    write_tar_header(file, "./", '5', 0755, 0, NULL);
+    write_tar_header(file, "./etc/", '5', 0755, 0, NULL);
+    write_tar_header(file, "./etc/sub/", '5', 0750, 0, NULL);
+    write_tar_file(file, "./etc/hostname", "limeos\n");
+    write_tar_file(file, "./etc/sub/motd", "welcome\n");
+    write_tar_header(file, "./etc/copy", '1', 0644, 0, "./etc/hostname");
+    write_tar_end(file);
+    gzclose(file);
+
+    FILE *output = fopen(TEST_ARCHIVE CONFIG_ROOTFS_MANIFEST_SUFFIX, "w");
+    assert_non_null(output);
+    fputs(manifest, output);
+    fclose(output);
+}
+
+/** Helper to verify the contents extracted from write_manifest_archive(). */
+static void assert_manifest_archive_extracted(void)
+{
+    char buffer[32];
+    assert_int_equal(0, read_test_file(TEST_TARGET "/etc/hostname", buffer, sizeof(buffer)));
+    assert_string_equal("limeos\n", buffer);
+    assert_int_equal(0, read_test_file(TEST_TARGET "/etc/sub/motd", buffer, sizeof(buffer)));
+    assert_string_equal("welcome\n", buffer);
+
+    // Verify directory permissions and the hard link to a queued file.
+    struct stat directory_stat, original_stat, copy_stat;
+    assert_int_equal(0, stat(TEST_TARGET "/etc/sub", &directory_stat));
+    assert_int_equal(0750, directory_stat.st_mode & 07777);
+    assert_int_equal(0, stat(TEST_TARGET "/etc/hostname", &original_stat));
+    assert_int_equal(0, stat(TEST_TARGET "/etc/copy", &copy_stat));
+    assert_int_equal(original_stat.st_ino, copy_stat.st_ino);
+}
+
+/** Verifies extract_rootfs_archive() writes manifest files on threads. */
+static void test_extract_rootfs_archive_writes_manifest_files_on_threads(void **state)
+{
+    (void)state;
+
+    write_manifest_archive(
+        "d 755 0 512 ./\n"
+        "d 755 0 1024 ./etc/\n"
+        "d 750 0 1536 ./etc/sub/\n"
+        "f 644 7 2048 ./etc/hostname\n"
+        "f 644 8 3072 ./etc/sub/motd\n"
+    );
+
+    RootfsProgress progress = {0};
+    int result = extract_rootfs_archive(TEST_ARCHIVE, TEST_TARGET, 0, 3, WRITE_BACKEND_SYNC, &progress);
+
+    assert_int_equal(0, result);
+    assert_manifest_archive_extracted();
+}
+
+/** Verifies extract_rootfs_archive() writes inline when the manifest disagrees. */
+static void test_extract_rootfs_archive_ignores_mismatched_manifest(void **state)
+{
+    (void)state;
+
+    // The sizes and offsets do not match the archive, so every file must be
+    // written inline.
+    write_manifest_archive(
+        "d 755 0 512 ./\n"
+        "f 644 99 2048 ./etc/hostname\n"
+        "f 644 8 3000 ./etc/sub/motd\n"
+    );
+
+    RootfsProgress progress = {0};
+    int result = extract_rootfs_archive(TEST_ARCHIVE, TEST_TARGET, 0, 3, WRITE_BACKEND_SYNC, &progress);
+
+    assert_int_equal(0, result);
+    assert_manifest_archive_extracted();
+}
+
+/** Verifies load_rootfs_manifest() rejects malformed and unordered entries. */
+static void test_load_rootfs_manifest_rejects_malformed_entries(void **state)
+{
+    (void)state;
+    RootfsManifest manifest;
+
+    assert_int_equal(-1, load_rootfs_manifest(TEST_ARCHIVE, &manifest));
+
+    write_manifest_archive("f 644 7 2048 ./etc/hostname\nd 755 0 1024 ./etc/\n");
+    assert_int_equal(-2, load_rootfs_manifest(TEST_ARCHIVE, &manifest));
+
+    write_manifest_archive("x 644 7 2048 ./etc/hostname\n");
+    assert_int_equal(-2, load_rootfs_manifest(TEST_ARCHIVE, &manifest));
+
+    // A malformed manifest must not prevent extraction.
+    RootfsProgress progress = {0};
+    assert_int_equal(0, extract_rootfs_archive(TEST_ARCHIVE, TEST_TARGET, 0, 3, WRITE_BACKEND_SYNC, &progress));
+    assert_manifest_archive_extracted();
+}
+
+/** Verifies get_writer_thread_count() keeps one writer for unknown disks. */
+static void test_get_writer_thread_count_defaults_to_inline(void **state)
+{
+    (void)state;
+
+    assert_int_equal(1, get_writer_thread_count("/dev/nonexistent"));
+    assert_int_equal(1, get_writer_thread_count("/dev/../etc"));
+}
+
+/** Verifies extract_rootfs_archive() writes files through io_uring. */
+static void test_extract_rootfs_archive_writes_files_through_uring(void **state)
+{
+    (void)state;
+
+    // Build an archive with a file in a directory it never lists, a file
+    // that already exists, a path written twice and a link to a queued file.
+    gzFile file = gzopen(TEST_ARCHIVE, "wb");
+    assert_non_null(file);
+    write_tar_file(file, "./usr/lib/first", "first\n");
+    write_tar_file(file, "./etc/hostname", "limeos\n");
+    write_tar_file(file, "./etc/motd", "old\n");
+    write_tar_file(file, "./etc/motd", "new\n");
+    write_tar_header(file, "./etc/copy", '1', 0644, 0, "./etc/hostname");
+    write_tar_end(file);
+    gzclose(file);
+    mkdir(TEST_TARGET "/etc", 0755);
+    FILE *existing = fopen(TEST_TARGET "/etc/hostname", "w");
+    assert_non_null(existing);
+    fputs("stale contents\n", existing);
+    fclose(existing);
+
+    RootfsProgress progress = {0};
+    int result = extract_rootfs_archive(TEST_ARCHIVE, TEST_TARGET, 0, 1, WRITE_BACKEND_URING, &progress);
+
+    assert_int_equal(0, result);
+
+    // Verify file contents, including the later copy of a repeated path.
+    char buffer[32];
+    assert_int_equal(0, read_test_file(TEST_TARGET "/usr/lib/first", buffer, sizeof(buffer)));
+    assert_string_equal("first\n", buffer);
+    assert_int_equal(0, read_test_file(TEST_TARGET "/etc/hostname", buffer, sizeof(buffer)));
+    assert_string_equal("limeos\n", buffer);
+    assert_int_equal(0, read_test_file(TEST_TARGET "/etc/motd", buffer, sizeof(buffer)));
+    assert_string_equal("new\n", buffer);
+
+    // Verify the metadata and the hard link.
+    struct stat original_stat, copy_stat;
+    assert_int_equal(0, stat(TEST_TARGET "/etc/hostname", &original_stat));
+    assert_int_equal(0644, original_stat.st_mode & 07777);
+    assert_int_equal(1700000000, original_stat.st_mtime);
+    assert_int_equal(0, stat(TEST_TARGET "/etc/copy", &copy_stat));
+    assert_int_equal(original_stat.st_ino, copy_stat.st_ino);
+}
+
+/** Verifies the io_uring writer writes a full queue of files. */
+static void test_uring_writer_writes_queued_files(void **state)
+{
+    (void)state;
+
+    // Nothing can be tested on kernels without io_uring.
+    UringWriter writer;
+    if (open_uring_writer(&writer, 0, URING_QUEUE_DEPTH) != 0)
+    {
+        return;
+    }
+
+    // Queue more files than the ring holds at once.
+    for (int i = 0; i < URING_QUEUE_DEPTH * 2 + 1; i++)
+    {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), TEST_TARGET "/file-%d", i);
+        WriterJob *job;
+        assert_int_equal(0, acquire_uring_job(&writer, path, &job));
+        job->size = (size_t)snprintf((char *)job->data, URING_SLOT_BYTES, "contents %d", i);
+        job->mode = 0600;
+        job->mtime = 1700000000;
+        submit_uring_job(&writer, job);
+    }
+    assert_int_equal(0, close_uring_writer(&writer));
+
+    // Verify every file was written in full.
+    for (int i = 0; i < URING_QUEUE_DEPTH * 2 + 1; i++)
+    {
+        char path[PATH_MAX];
+        char expected[32];
+        char buffer[32];
+        snprintf(path, sizeof(path), TEST_TARGET "/file-%d", i);
+        snprintf(expected, sizeof(expected), "contents %d", i);
+        assert_int_equal(0, read_test_file(path, buffer, sizeof(buffer)));
+        assert_string_equal(expected, buffer);
+    }
+}
+
+/** Verifies the io_uring writer keeps no more files in flight than asked. */
+static void test_uring_writer_limits_queue_depth(void **state)
+{
+    (void)state;
+
+    // Nothing can be tested on kernels without io_uring.
+    UringWriter writer;
+    if (open_uring_writer(&writer, 0, 1) != 0)
+    {
+        return;
+    }
+
+    // Queue several files, one at a time.
+    for (int i = 0; i < 4; i++)
+    {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), TEST_TARGET "/file-%d", i);
+        WriterJob *job;
+        assert_int_equal(0, acquire_uring_job(&writer, path, &job));
+        job->size = (size_t)snprintf((char *)job->data, URING_SLOT_BYTES, "contents %d", i);
+        job->mode = 0600;
+        job->mtime = 1700000000;
+        submit_uring_job(&writer, job);
+        assert_int_equal(1, writer.in_flight);
+    }
+    assert_int_equal(0, close_uring_writer(&writer));
+
+    char buffer[32];
+    assert_int_equal(0, read_test_file(TEST_TARGET "/file-3", buffer, sizeof(buffer)));
+    assert_string_equal("contents 3", buffer);
+}
+
+/** Verifies extract_rootfs_archive() writes through io_uring and threads together. */
+static void test_extract_rootfs_archive_combines_uring_and_threads(void **state)
+{
+    (void)state;
+
+    // Build an archive with a small file for the ring, and a file too
+    // large for it that the manifest lists, followed by a link to it.
+    size_t large_size = URING_SLOT_BYTES + 1000;
+    char *large = malloc(large_size + 1);
+    assert_non_null(large);
+    memset(large, 'x', large_size);
+    large[large_size] = '\0';
+    gzFile file = gzopen(TEST_ARCHIVE, "wb");
+    assert_non_null(file);
+    write_tar_header(file, "./", '5', 0755, 0, NULL);
+    write_tar_header(file, "./etc/", '5', 0755, 0, NULL);
+    write_tar_file(file, "./etc/hostname", "limeos\n");
+    write_tar_file(file, "./etc/large", large);
+    write_tar_header(file, "./etc/copy", '1', 0644, 0, "./etc/large");
+    write_tar_end(file);
+    gzclose(file);
+    free(large);
+
+    FILE *output = fopen(TEST_ARCHIVE CONFIG_ROOTFS_MANIFEST_SUFFIX, "w");
+    assert_non_null(output);
+    fprintf(
+        output,
+        "d 755 0 512 ./\n"
+        "d 755 0 1024 ./etc/\n"
+        "f 644 7 1536 ./etc/hostname\n"
+        "f 644 %zu 2560 ./etc/large\n",
+        large_size
+    );
+    fclose(output);
+
+    RootfsProgress progress = {0};
+    int result = extract_rootfs_archive(TEST_ARCHIVE, TEST_TARGET, 0, 3, WRITE_BACKEND_URING, &progress);
+
+    assert_int_equal(0, result);
+    char buffer[32];
+    assert_int_equal(0, read_test_file(TEST_TARGET "/etc/hostname", buffer, sizeof(buffer)));
+    assert_string_equal("limeos\n", buffer);
+    struct stat original_stat, copy_stat;
+    assert_int_equal(0, stat(TEST_TARGET "/etc/large", &original_stat));
+    assert_int_equal((off_t)large_size, original_stat.st_size);
+    assert_int_equal(0, stat(TEST_TARGET "/etc/copy", &copy_stat));
+    assert_int_equal(original_stat.st_ino, copy_stat.st_ino);
+}
+
+/** Helper to format a digest as lowercase hexadecimal. */
+static void format_test_digest(const unsigned char *digest, char *out_hex)
+{
+    for (int i = 0; i < DIGEST_BYTES; i++)
+    {
+        sprintf(out_hex + i * 2, "%02x", digest[i]);
+    }
+}
+
+/** Verifies the SHA-256 implementation against the FIPS 180-4 examples. */
+static void test_digest_matches_known_vectors(void **state)
+{
+    (void)state;
+    DigestContext context;
+    unsigned char digest[DIGEST_BYTES];
+    char hex[DIGEST_BYTES * 2 + 1];
+
+    start_digest(&context);
+    finish_digest(&context, digest);
+    format_test_digest(digest, hex);
+    assert_string_equal("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855", hex);
+
+    start_digest(&context);
+    update_digest(&context, "abc", 3);
+    finish_digest(&context, digest);
+    format_test_digest(digest, hex);
+    assert_string_equal("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", hex);
+
+    // Feed a million bytes in uneven chunks to cross block boundaries.
+    char chunk[997];
+    memset(chunk, 'a', sizeof(chunk));
+    start_digest(&context);
+    size_t remaining = 1000000;
+    while (remaining > 0)
+    {
+        size_t length = remaining < sizeof(chunk) ? remaining : sizeof(chunk);
+        update_digest(&context, chunk, length);
+        remaining -= length;
+    }
+    finish_digest(&context, digest);
+    format_test_digest(digest, hex);
+    assert_string_equal("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0", hex);
+}
+
+/** Verifies extract_rootfs_archive() accepts an archive matching its digest. */
+static void test_extract_rootfs_archive_verifies_digest(void **state)
+{
+    (void)state;
+
+    // Append a trailing member after the end marker, which extraction never
+    // decodes but the digest still covers.
+    write_indexed_archive(4);
+    struct stat archive_stat;
+    assert_int_equal(0, stat(TEST_ARCHIVE, &archive_stat));
+    gzFile file = gzopen(TEST_ARCHIVE, "ab");
+    assert_non_null(file);
+    write_tar_end(file);
+    gzclose(file);
+    struct stat padded_stat;
+    assert_int_equal(0, stat(TEST_ARCHIVE, &padded_stat));
+    FILE *index = fopen(TEST_ARCHIVE CONFIG_ROOTFS_INDEX_SUFFIX, "a");
+    assert_non_null(index);
+    fprintf(index, "%lld %lld %d\n", (long long)archive_stat.st_size,
+        (long long)(padded_stat.st_size - archive_stat.st_size), 1024);
+    fclose(index);
+    assert_int_equal(0, system(
+        "sha256sum " TEST_ARCHIVE " > " TEST_ARCHIVE CONFIG_ROOTFS_DIGEST_SUFFIX
+    ));
+
+    RootfsProgress progress = {0};
+    int result = extract_rootfs_archive(TEST_ARCHIVE, TEST_TARGET, 2, 1, WRITE_BACKEND_SYNC, &progress);
+
+    assert_int_equal(0, result);
+    assert_int_equal(padded_stat.st_size, progress.compressed_bytes);
+}
+
+/** Verifies extract_rootfs_archive() rejects an archive not matching its digest. */
+static void test_extract_rootfs_archive_detects_digest_mismatch(void **state)
+{
+    (void)state;
+
+    gzFile file = gzopen(TEST_ARCHIVE, "wb");
+    assert_non_null(file);
+    write_tar_file(file, "data", "sequential");
+    write_tar_end(file);
+    gzclose(file);
+
+    // A digest of other data must be reported as a mismatch.
+    FILE *digest = fopen(TEST_ARCHIVE CONFIG_ROOTFS_DIGEST_SUFFIX, "w");
+    assert_non_null(digest);
+    fputs("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855  rootfs.tar.gz\n", digest);
+    fclose(digest);
+
+    RootfsProgress progress = {0};
+    int result = extract_rootfs_archive(TEST_ARCHIVE, TEST_TARGET, 0, 1, WRITE_BACKEND_SYNC, &progress);
+    assert_int_equal(-5, result);
+
+    // A malformed digest must not be mistaken for a missing one.
+    digest = fopen(TEST_ARCHIVE CONFIG_ROOTFS_DIGEST_SUFFIX, "w");
+    assert_non_null(digest);
+    fputs("not a digest\n", digest);
+    fclose(digest);
+
+    result = extract_rootfs_archive(TEST_ARCHIVE, TEST_TARGET, 0, 1, WRITE_BACKEND_SYNC, &progress);
+    assert_int_equal(-5, result);
+}
+
+/** Verifies get_rootfs_thread_count() stays within the supported range. */
+static void test_get_rootfs_thread_count_is_bounded(void **state)
+{
+    (void)state;
+
+    int small = get_rootfs_thread_count(1024);
+    int huge = get_rootfs_thread_count(1ULL << 50);
+
+    assert_in_range(small, 1, PARALLEL_MAX_THREADS);
+    assert_int_equal(1, huge);
+}
+
+/** The path of the zstd archive written by extraction tests. */
+#define TEST_ZSTD_ARCHIVE TEST_ROOT "/rootfs.tar.zst"
+
+/**
+ * Helper to recompress the gzip test archive as zstd, starting a new frame
+ * every `frame_bytes` bytes. When `write_index` is set, a block index is
+ * written next to the zstd archive. Returns the uncompressed size.
+ */
+static size_t convert_archive_to_zstd(size_t frame_bytes, int write_index)
+{
+    // Read the whole uncompressed tar stream.
+    static unsigned char tar[64 * 1024];
+    gzFile source = gzopen(TEST_ARCHIVE, "rb");
+    assert_non_null(source);
+    int length = gzread(source, tar, sizeof(tar));
+    gzclose(source);
+    assert_true(length > 0);
+
+    FILE *archive = fopen(TEST_ZSTD_ARCHIVE, "wb");
+    assert_non_null(archive);
+    FILE *index = write_index ? fopen(TEST_ZSTD_ARCHIVE CONFIG_ROOTFS_INDEX_SUFFIX, "w") : NULL;
+
+    // Compress each frame independently and record it in the index.
+    unsigned long long offset = 0;
+    for (size_t position = 0; position < (size_t)length; position += frame_bytes)
+    {
+        size_t size = (size_t)length - position < frame_bytes ? (size_t)length - position : frame_bytes;
+        unsigned char frame[ZSTD_COMPRESSBOUND(64 * 1024)];
+        size_t compressed = ZSTD_compress(frame, sizeof(frame), tar + position, size, 3);
+        assert_false(ZSTD_isError(compressed));
+        fwrite(frame, 1, compressed, archive);
+        if (index)
+        {
+            fprintf(index, "%llu %zu %zu\n", offset, compressed, size);
+        }
+        offset += compressed;
+    }
+
+    fclose(archive);
+    if (index)
+    {
+        fclose(index);
+    }
+    return (size_t)length;
+}
+
+/** Verifies detect_rootfs_format() recognizes formats by magic bytes. */
+static void test_detect_rootfs_format_uses_magic_bytes(void **state)
+{
+    (void)state;
+
+    gzFile file = gzopen(TEST_ARCHIVE, "wb");
+    assert_non_null(file);
+    write_tar_end(file);
+    gzclose(file);
+    convert_archive_to_zstd(1024, 0);
+
+    // A zstd archive is detected even when named like a gzip archive.
+    assert_int_equal(0, rename(TEST_ZSTD_ARCHIVE, TEST_ROOT "/zstd.tar.gz"));
+
+    int gzip_fd = open(TEST_ARCHIVE, O_RDONLY);
+    int zstd_fd = open(TEST_ROOT "/zstd.tar.gz", O_RDONLY);
+    int other_fd = open("/proc/self/exe", O_RDONLY);
+    assert_true(gzip_fd >= 0 && zstd_fd >= 0 && other_fd >= 0);
+
+    assert_int_equal(ROOTFS_FORMAT_GZIP, detect_rootfs_format(gzip_fd));
+    assert_int_equal(ROOTFS_FORMAT_ZSTD, detect_rootfs_format(zstd_fd));
+    assert_int_equal(ROOTFS_FORMAT_UNKNOWN, detect_rootfs_format(other_fd));
+
+    close(gzip_fd);
+    close(zstd_fd);
+    close(other_fd);
+}
+
+/** Verifies extract_rootfs_archive() extracts multi-frame zstd archives. */
+static void test_extract_rootfs_archive_handles_zstd_frames(void **state)
+{
+    (void)state;
+
+    gzFile file = gzopen(TEST_ARCHIVE, "wb");
+    assert_non_null(file);
+    write_tar_header(file, "./etc/", '5', 0755, 0, NULL);
+    write_tar_file(file, "./etc/hostname", "limeos\n");
+    write_tar_file(file, "./etc/motd", "welcome\n");
+    write_tar_end(file);
+    gzclose(file);
+    convert_archive_to_zstd(700, 0);
+
+    struct stat archive_stat;
+    assert_int_equal(0, stat(TEST_ZSTD_ARCHIVE, &archive_stat));
+
+    RootfsProgress progress = {0};
+    int result = extract_rootfs_archive(TEST_ZSTD_ARCHIVE, TEST_TARGET, 0, 1, WRITE_BACKEND_SYNC, &progress);
+
+    assert_int_equal(0, result);
+
+    char buffer[32];
+    assert_int_equal(0, read_test_file(TEST_TARGET "/etc/hostname", buffer, sizeof(buffer)));
+    assert_string_equal("limeos\n", buffer);
+    assert_int_equal(0, read_test_file(TEST_TARGET "/etc/motd", buffer, sizeof(buffer)));
+    assert_string_equal("welcome\n", buffer);
+    assert_int_equal(archive_stat.st_size, progress.compressed_bytes);
+}
+
+/** Verifies extract_rootfs_archive() decodes indexed zstd frames on threads. */
+static void test_extract_rootfs_archive_decodes_zstd_blocks_in_parallel(void **state)
+{
+    (void)state;
+
+    gzFile file = gzopen(TEST_ARCHIVE, "wb");
+    assert_non_null(file);
+    for (int i = 0; i < 8; i++)
+    {
+        char name[32], contents[32];
+        snprintf(name, sizeof(name), "file%d", i);
+        snprintf(contents, sizeof(contents), "zstd %d", i);
+        write_tar_file(file, name, contents);
+    }
+    write_tar_end(file);
+    gzclose(file);
+    convert_archive_to_zstd(1024, 1);
+
+    RootfsProgress progress = {0};
+    int result = extract_rootfs_archive(TEST_ZSTD_ARCHIVE, TEST_TARGET, 2, 1, WRITE_BACKEND_SYNC, &progress);
+
+    assert_int_equal(0, result);
+
+    char buffer[32];
+    assert_int_equal(0, read_test_file(TEST_TARGET "/file7", buffer, sizeof(buffer)));
+    assert_string_equal("zstd 7", buffer);
+}
+
+/** Verifies extract_rootfs_archive() detects truncated zstd archives. */
+static void test_extract_rootfs_archive_detects_truncated_zstd(void **state)
+{
+    (void)state;
+
+    gzFile file = gzopen(TEST_ARCHIVE, "wb");
+    assert_non_null(file);
+    write_tar_file(file, "data", "truncated");
+    write_tar_end(file);
+    gzclose(file);
+    convert_archive_to_zstd(64 * 1024, 0);
+
+    // Cut the single frame short.
+    struct stat archive_stat;
+    assert_int_equal(0, stat(TEST_ZSTD_ARCHIVE, &archive_stat));
+    assert_int_equal(0, truncate(TEST_ZSTD_ARCHIVE, archive_stat.st_size - 4));
+
+    RootfsProgress progress = {0};
+    int result = extract_rootfs_archive(TEST_ZSTD_ARCHIVE, TEST_TARGET, 0, 1, WRITE_BACKEND_SYNC, &progress);
+
+    assert_int_equal(-2, result);
+}
+
+/** Verifies extract_rootfs_archive() rejects entries escaping the target. */
+static void test_extract_rootfs_archive_rejects_parent_paths(void **state)
+{
+    (void)state;
+
+    gzFile file = gzopen(TEST_ARCHIVE, "wb");
+    assert_non_null(file);
+    write_tar_file(file, "../escaped", "bad");
+    write_tar_end(file);
+    gzclose(file);
+
+    RootfsProgress progress = {0};
+    int result = extract_rootfs_archive(TEST_ARCHIVE, TEST_TARGET, 0, 1, WRITE_BACKEND_SYNC, &progress);
+
+    assert_int_equal(-3, result);
+    assert_int_not_equal(0, access(TEST_ROOT "/escaped", F_OK));
+}
+
+/** Verifies extract_rootfs_archive() detects corrupt compressed data. */
+static void test_extract_rootfs_archive_detects_corruption(void **state)
+{
+    (void)state;
+
+    FILE *file = fopen(TEST_ARCHIVE, "w");
+    assert_non_null(file);
+    fputs("this is not a gzip stream", file);
+    fclose(file);
+
+    RootfsProgress progress = {0};
+    int result = extract_rootfs_archive(TEST_ARCHIVE, TEST_TARGET, 0, 1, WRITE_BACKEND_SYNC, &progress);
+
+    assert_int_equal(-2, result);
+}
+
+/** Verifies extract_rootfs_archive() fails when the archive is missing. */
+static void test_extract_rootfs_archive_fails_when_missing(void **state)
+{
+    (void)state;
+
+    RootfsProgress progress = {0};
+    int result = extract_rootfs_archive(TEST_ROOT "/missing.tar.gz", TEST_TARGET, 0, 1, WRITE_BACKEND_SYNC, &progress);
 
-    // Verify -z flag for gzip decompression is used.
-    assert_true(log_contains(lines, count, "tar -xzf"));
+    assert_int_equal(-1, result);
 }
 
 int main(void)
 {
     const struct CMUnitTest tests[] = {
-        cmocka_unit_test_setup_teardown(test_extract_rootfs_generates_tar_command, setup, teardown),
-        cmocka_unit_test_setup_teardown(test_extract_rootfs_redirects_to_log, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_extract_rootfs_logs_extraction_in_dry_run, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_extract_rootfs_does_not_run_tar, setup, teardown),
         cmocka_unit_test_setup_teardown(test_extract_rootfs_skips_existence_check_in_dry_run, setup, teardown),
-        cmocka_unit_test_setup_teardown(test_extract_rootfs_uses_correct_path, setup, teardown),
-        cmocka_unit_test_setup_teardown(test_extract_rootfs_extracts_to_mnt, setup, teardown),
-        cmocka_unit_test_setup_teardown(test_extract_rootfs_uses_gzip, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_extract_rootfs_deploys_image_in_dry_run, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_write_rootfs_image_writes_used_blocks, setup_extraction, teardown_extraction),
+        cmocka_unit_test_setup_teardown(test_write_rootfs_image_rejects_non_ext4, setup_extraction, teardown_extraction),
+        cmocka_unit_test_setup_teardown(test_write_rootfs_image_rejects_small_device, setup_extraction, teardown_extraction),
+        cmocka_unit_test_setup_teardown(test_extract_rootfs_archive_writes_entries, setup_extraction, teardown_extraction),
+        cmocka_unit_test_setup_teardown(test_extract_rootfs_archive_reports_progress, setup_extraction, teardown_extraction),
+        cmocka_unit_test_setup_teardown(test_extract_rootfs_archive_handles_multiple_members, setup_extraction, teardown_extraction),
+        cmocka_unit_test_setup_teardown(test_extract_rootfs_archive_decodes_blocks_in_parallel, setup_extraction, teardown_extraction),
+        cmocka_unit_test_setup_teardown(test_extract_rootfs_archive_ignores_invalid_index, setup_extraction, teardown_extraction),
+        cmocka_unit_test_setup_teardown(test_extract_rootfs_archive_writes_manifest_files_on_threads, setup_extraction, teardown_extraction),
+        cmocka_unit_test_setup_teardown(test_extract_rootfs_archive_ignores_mismatched_manifest, setup_extraction, teardown_extraction),
+        cmocka_unit_test_setup_teardown(test_load_rootfs_manifest_rejects_malformed_entries, setup_extraction, teardown_extraction),
+        cmocka_unit_test_setup_teardown(test_get_writer_thread_count_defaults_to_inline, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_extract_rootfs_archive_writes_files_through_uring, setup_extraction, teardown_extraction),
+        cmocka_unit_test_setup_teardown(test_uring_writer_writes_queued_files, setup_extraction, teardown_extraction),
+        cmocka_unit_test_setup_teardown(test_uring_writer_limits_queue_depth, setup_extraction, teardown_extraction),
+        cmocka_unit_test_setup_teardown(test_extract_rootfs_archive_combines_uring_and_threads, setup_extraction, teardown_extraction),
+        cmocka_unit_test_setup_teardown(test_digest_matches_known_vectors, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_extract_rootfs_archive_verifies_digest, setup_extraction, teardown_extraction),
+        cmocka_unit_test_setup_teardown(test_extract_rootfs_archive_detects_digest_mismatch, setup_extraction, teardown_extraction),
+        cmocka_unit_test_setup_teardown(test_get_rootfs_thread_count_is_bounded, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_detect_rootfs_format_uses_magic_bytes, setup_extraction, teardown_extraction),
+        cmocka_unit_test_setup_teardown(test_extract_rootfs_archive_handles_zstd_frames, setup_extraction, teardown_extraction),
+        cmocka_unit_test_setup_teardown(test_extract_rootfs_archive_decodes_zstd_blocks_in_parallel, setup_extraction, teardown_extraction),
+        cmocka_unit_test_setup_teardown(test_extract_rootfs_archive_detects_truncated_zstd, setup_extraction, teardown_extraction),
+        cmocka_unit_test_setup_teardown(test_extract_rootfs_archive_rejects_parent_paths, setup_extraction, teardown_extraction),
+        cmocka_unit_test_setup_teardown(test_extract_rootfs_archive_detects_corruption, setup_extraction, teardown_extraction),
+        cmocka_unit_test_setup_teardown(test_extract_rootfs_archive_fails_when_missing, setup_extraction, teardown_extraction),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
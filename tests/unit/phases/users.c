@@ -211,8 +211,7 @@ static void test_configure_users_chpasswd_command_format(void **state)
     int count = read_dry_run_log(lines, 32);
 
     // Verify chpasswd command format.
-    assert_true(log_contains(lines, count, "chroot /mnt sh -c"));
-    assert_true(log_contains(lines, count, "chpasswd"));
+    assert_true(log_contains(lines, count, "chroot /mnt echo 'testuser':'testpass' | chpasswd"));
 }
 
 /** Verifies configure_users() uses correct usermod command format. */
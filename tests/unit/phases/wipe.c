@@ -0,0 +1,158 @@
+/**
+ * This code is responsible for testing the disk wipe before partitioning,
+ * including which regions are zeroed, and recording the wipe in dry-run
+ * mode.
+ */
+
+#include "../../all.h"
+
+#define TEST_DISK_PATH "/tmp/limeos-test-wipe.img"
+#define TEST_MISSING_DISK_PATH "/tmp/limeos-test-wipe-missing.img"
+
+/** The size of the test disk. */
+#define TEST_DISK_BYTES (64ULL * 1024 * 1024)
+
+#define MIB (1024ULL * 1024)
+
+/** Sets up the test environment before each test. */
+static int setup(void **state)
+{
+    (void)state;
+    reset_store();
+    close_dry_run_log();
+    unlink(CONFIG_DRY_RUN_LOG_PATH);
+    unlink(TEST_MISSING_DISK_PATH);
+
+    // Fill the test disk with a pattern standing in for old signatures.
+    FILE *file = fopen(TEST_DISK_PATH, "w");
+    assert_non_null(file);
+    unsigned char block[64 * 1024];
+    memset(block, 0xa5, sizeof(block));
+    for (unsigned long long written = 0; written < TEST_DISK_BYTES; written += sizeof(block))
+    {
+        assert_int_equal(1, fwrite(block, sizeof(block), 1, file));
+    }
+    fclose(file);
+    return 0;
+}
+
+/** Cleans up the test environment after each test. */
+static int teardown(void **state)
+{
+    (void)state;
+    close_dry_run_log();
+    unlink(CONFIG_DRY_RUN_LOG_PATH);
+    unlink(TEST_DISK_PATH);
+    return 0;
+}
+
+/** Helper to add a partition to the store. */
+static void add_test_partition(unsigned long long size_bytes, const char *mount_point)
+{
+    Store *store = get_store();
+    Partition *partition = &store->partitions[store->partition_count++];
+    partition->size_bytes = size_bytes;
+    partition->type = PART_PRIMARY;
+    partition->filesystem = FS_EXT4;
+    snprintf(partition->mount_point, sizeof(partition->mount_point), "%s", mount_point);
+}
+
+/** Helper to read the first and last byte of a MiB of the test disk. */
+static void read_test_mib(unsigned long long mib, unsigned char *out_first, unsigned char *out_last)
+{
+    int fd = open(TEST_DISK_PATH, O_RDONLY);
+    assert_true(fd >= 0);
+    assert_int_equal(1, pread(fd, out_first, 1, (off_t)(mib * MIB)));
+    assert_int_equal(1, pread(fd, out_last, 1, (off_t)((mib + 1) * MIB - 1)));
+    close(fd);
+}
+
+/** Helper to check whether a MiB of the test disk was zeroed. */
+static void assert_mib_zeroed(unsigned long long mib, int zeroed)
+{
+    unsigned char first;
+    unsigned char last;
+    read_test_mib(mib, &first, &last);
+    assert_int_equal(zeroed ? 0x00 : 0xa5, first);
+    assert_int_equal(zeroed ? 0x00 : 0xa5, last);
+}
+
+/** Verifies wipe_disk() zeroes both ends of the disk and of each partition. */
+static void test_wipe_disk_zeroes_signature_regions(void **state)
+{
+    (void)state;
+    add_test_partition(8ULL * 1000000, "/boot");
+    add_test_partition(16ULL * 1000000, "/");
+    int discarded = -1;
+
+    assert_int_equal(0, wipe_disk(TEST_DISK_PATH, &discarded));
+
+    // An image file cannot be discarded.
+    assert_int_equal(0, discarded);
+
+    // The disk, and partition 1 from 1 to 9 MiB, and 2 from 9 to 24 MiB.
+    assert_mib_zeroed(0, 1);
+    assert_mib_zeroed(1, 1);
+    assert_mib_zeroed(4, 0);
+    assert_mib_zeroed(8, 1);
+    assert_mib_zeroed(9, 1);
+    assert_mib_zeroed(16, 0);
+    assert_mib_zeroed(23, 1);
+    assert_mib_zeroed(40, 0);
+    assert_mib_zeroed(63, 1);
+}
+
+/** Verifies wipe_disk() still clears the disk ends when the layout does not fit. */
+static void test_wipe_disk_clears_ends_when_layout_does_not_fit(void **state)
+{
+    (void)state;
+    add_test_partition(TEST_DISK_BYTES, "/");
+    int discarded = -1;
+
+    assert_int_equal(0, wipe_disk(TEST_DISK_PATH, &discarded));
+
+    assert_mib_zeroed(0, 1);
+    assert_mib_zeroed(1, 0);
+    assert_mib_zeroed(63, 1);
+}
+
+/** Verifies wipe_disk() reports a disk that cannot be opened. */
+static void test_wipe_disk_fails_when_missing(void **state)
+{
+    (void)state;
+    int discarded = -1;
+
+    assert_int_equal(-1, wipe_disk(TEST_MISSING_DISK_PATH, &discarded));
+    assert_int_equal(0, discarded);
+}
+
+/** Verifies wipe_disk() records the wipe in dry-run mode. */
+static void test_wipe_disk_dry_run_logs_wipe(void **state)
+{
+    (void)state;
+    get_store()->dry_run = 1;
+    int discarded = -1;
+
+    assert_int_equal(0, wipe_disk("/dev/sda", &discarded));
+    close_dry_run_log();
+
+    assert_int_equal(0, discarded);
+    FILE *file = fopen(CONFIG_DRY_RUN_LOG_PATH, "r");
+    assert_non_null(file);
+    char line[256];
+    assert_non_null(fgets(line, sizeof(line), file));
+    fclose(file);
+    assert_string_equal("wipe-signatures /dev/sda\n", line);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_wipe_disk_zeroes_signature_regions, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_wipe_disk_clears_ends_when_layout_does_not_fit, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_wipe_disk_fails_when_missing, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_wipe_disk_dry_run_logs_wipe, setup, teardown),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
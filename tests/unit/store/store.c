@@ -50,6 +50,16 @@ static void test_reset_store_clears_dry_run(void **state)
     assert_int_equal(0, store->dry_run);
 }
 
+/** Verifies that reset_store() restores the io_uring write backend. */
+static void test_reset_store_defaults_to_uring_backend(void **state)
+{
+    (void)state;
+    Store *store = get_store();
+    store->write_backend = WRITE_BACKEND_SYNC;
+    reset_store();
+    assert_int_equal(WRITE_BACKEND_URING, store->write_backend);
+}
+
 /** Verifies that reset_store() clears the locale string. */
 static void test_reset_store_clears_locale(void **state)
 {
@@ -118,6 +128,7 @@ int main(void)
         cmocka_unit_test_setup_teardown(test_get_store_returns_non_null, setup, teardown),
         cmocka_unit_test_setup_teardown(test_get_store_returns_same_instance, setup, teardown),
         cmocka_unit_test_setup_teardown(test_reset_store_clears_dry_run, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_reset_store_defaults_to_uring_backend, setup, teardown),
         cmocka_unit_test_setup_teardown(test_reset_store_clears_locale, setup, teardown),
         cmocka_unit_test_setup_teardown(test_reset_store_clears_disk, setup, teardown),
         cmocka_unit_test_setup_teardown(test_reset_store_clears_partition_count, setup, teardown),
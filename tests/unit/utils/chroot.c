@@ -0,0 +1,126 @@
+/**
+ * This code is responsible for testing the chroot session utility,
+ * including shared system directory mounts and dry-run logging.
+ */
+
+#include "../../all.h"
+
+/** Sets up the test environment before each test. */
+static int setup(void **state)
+{
+    (void)state;
+    reset_store();
+    get_store()->dry_run = 1;
+    unmount_registered_filesystems(NULL, NULL);
+    close_dry_run_log();
+    unlink(CONFIG_DRY_RUN_LOG_PATH);
+    return 0;
+}
+
+/** Cleans up the test environment after each test. */
+static int teardown(void **state)
+{
+    (void)state;
+    close_dry_run_log();
+    unlink(CONFIG_DRY_RUN_LOG_PATH);
+    return 0;
+}
+
+/** Helper to count the log lines containing a substring. */
+static int count_log_lines(const char *substring)
+{
+    FILE *file = fopen(CONFIG_DRY_RUN_LOG_PATH, "r");
+    if (!file)
+    {
+        return 0;
+    }
+
+    int count = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        if (strstr(line, substring) != NULL)
+        {
+            count++;
+        }
+    }
+    fclose(file);
+    return count;
+}
+
+/** Verifies run_chroot_command() logs the equivalent chroot invocation. */
+static void test_run_chroot_command_dry_run_logs_command(void **state)
+{
+    (void)state;
+    ChrootSession session;
+    assert_int_equal(0, open_chroot_session(&session));
+    assert_int_equal(0, run_chroot_command(&session, "locale-gen", "/usr/sbin/locale-gen"));
+    close_chroot_session(&session);
+    close_dry_run_log();
+
+    assert_int_equal(1, count_log_lines("chroot /mnt /usr/sbin/locale-gen"));
+}
+
+/** Verifies run_chroot_command() rejects commands spanning several lines. */
+static void test_run_chroot_command_rejects_newline(void **state)
+{
+    (void)state;
+    ChrootSession session;
+    assert_int_equal(0, open_chroot_session(&session));
+    assert_int_equal(-1, run_chroot_command(&session, "true", "true\nreboot"));
+    close_chroot_session(&session);
+    close_dry_run_log();
+
+    assert_int_equal(0, count_log_lines("reboot"));
+}
+
+/** Verifies open_chroot_session() mounts system directories before commands. */
+static void test_open_chroot_session_mounts_system_dirs(void **state)
+{
+    (void)state;
+    ChrootSession session;
+    assert_int_equal(0, open_chroot_session(&session));
+    close_chroot_session(&session);
+    close_dry_run_log();
+
+    assert_int_equal(1, count_log_lines("mount --bind /dev /mnt/dev"));
+    assert_int_equal(1, count_log_lines("mount -t proc proc /mnt/proc"));
+    assert_int_equal(1, count_log_lines("mount -t sysfs sys /mnt/sys"));
+}
+
+/** Verifies later sessions reuse the system directory mounts until cleanup. */
+static void test_open_chroot_session_shares_mounts(void **state)
+{
+    (void)state;
+    ChrootSession first;
+    ChrootSession second;
+    assert_int_equal(0, open_chroot_session(&first));
+    close_chroot_session(&first);
+    assert_int_equal(0, open_chroot_session(&second));
+    close_chroot_session(&second);
+
+    // Closing sessions leaves the mounts; the log is flushed per entry.
+    assert_int_equal(1, count_log_lines("mount --bind /dev /mnt/dev"));
+    assert_int_equal(0, count_log_lines("umount"));
+
+    // Cleanup unmounts them, and a later session mounts them again.
+    assert_int_equal(0, unmount_registered_filesystems(NULL, NULL));
+    assert_int_equal(1, count_log_lines("umount /mnt/dev"));
+    assert_int_equal(0, open_chroot_session(&first));
+    close_chroot_session(&first);
+    close_dry_run_log();
+
+    assert_int_equal(2, count_log_lines("mount --bind /dev /mnt/dev"));
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_run_chroot_command_dry_run_logs_command, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_run_chroot_command_rejects_newline, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_open_chroot_session_mounts_system_dirs, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_open_chroot_session_shares_mounts, setup, teardown),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
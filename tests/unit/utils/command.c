@@ -5,6 +5,23 @@
 
 #include "../../all.h"
 
+// Count tick callback invocations.
+static int tick_count;
+
+/** Test tick callback that counts invocations. */
+static void count_tick(void)
+{
+    tick_count++;
+}
+
+/** Invokes the tick callback from a thread other than the one that set it. */
+static void *invoke_tick_thread(void *argument)
+{
+    (void)argument;
+    invoke_command_tick();
+    return NULL;
+}
+
 /** Sets up the test environment before each test. */
 static int setup(void **state)
 {
@@ -195,6 +212,133 @@ static void test_close_dry_run_log_flushes_content(void **state)
     assert_true(strlen(buffer) > 0);
 }
 
+/** Verifies run_install_argv() logs a quoted command line in dry-run mode. */
+static void test_run_install_argv_dry_run_logs_quoted_command(void **state)
+{
+    (void)state;
+    Store *store = get_store();
+    store->dry_run = 1;
+
+    const char *const argv[] = { "mkdir", "-p", "/mnt/my home", NULL };
+    assert_int_equal(0, run_install_argv(argv, &COMMAND_TO_INSTALL_LOG));
+    close_dry_run_log();
+
+    FILE *file = fopen(CONFIG_DRY_RUN_LOG_PATH, "r");
+    assert_non_null(file);
+    char buffer[256];
+    char *line = fgets(buffer, sizeof(buffer), file);
+    fclose(file);
+
+    assert_non_null(line);
+    assert_string_equal("mkdir -p '/mnt/my home' >>" CONFIG_INSTALL_LOG_PATH " 2>&1\n", buffer);
+}
+
+/** Verifies run_install_argv() passes arguments without a shell and redirects output. */
+static void test_run_install_argv_redirects_output(void **state)
+{
+    (void)state;
+    const char *output_path = "/tmp/limeos-test-argv-output";
+    unlink(output_path);
+
+    const char *const argv[] = { "printf", "%s", "a b;$HOME", NULL };
+    const CommandOptions options = { .stdout_path = output_path };
+    assert_int_equal(0, run_install_argv(argv, &options));
+
+    FILE *file = fopen(output_path, "r");
+    assert_non_null(file);
+    char buffer[64] = { 0 };
+    char *line = fgets(buffer, sizeof(buffer), file);
+    fclose(file);
+    unlink(output_path);
+
+    assert_non_null(line);
+    assert_string_equal("a b;$HOME", buffer);
+}
+
+/** Verifies run_install_argv() returns the exit status of the program. */
+static void test_run_install_argv_returns_exit_status(void **state)
+{
+    (void)state;
+    const char *const argv[] = { "sh", "-c", "exit 3", NULL };
+    assert_int_equal(3, run_install_argv(argv, &COMMAND_QUIET));
+}
+
+/** Verifies run_install_argv() passes the given environment. */
+static void test_run_install_argv_uses_environment(void **state)
+{
+    (void)state;
+    char *environment[] = { "LIMEOS_TEST=1", "PATH=/usr/bin:/bin", NULL };
+    const CommandOptions options = { .environment = environment };
+    const char *const argv[] = { "sh", "-c", "test \"$LIMEOS_TEST\" = 1", NULL };
+    assert_int_equal(0, run_install_argv(argv, &options));
+}
+
+/** Verifies run_install_argv() returns -3 when the program does not exist. */
+static void test_run_install_argv_missing_program(void **state)
+{
+    (void)state;
+    const char *const argv[] = { "limeos-no-such-program", NULL };
+    assert_int_equal(-3, run_install_argv(argv, &COMMAND_QUIET));
+}
+
+/** Verifies run_install_command() captures both output streams into the install log. */
+static void test_run_install_command_captures_output(void **state)
+{
+    (void)state;
+    init_install_log();
+
+    assert_int_equal(0, run_install_command("echo out; echo err >&2; printf partial"));
+
+    int count;
+    char **lines = read_install_log_lines(10, &count);
+    assert_int_equal(3, count);
+    assert_string_equal("out", lines[0]);
+    assert_string_equal("err", lines[1]);
+    assert_string_equal("partial", lines[2]);
+    free_install_log_lines(lines, count);
+    unlink(CONFIG_INSTALL_LOG_PATH);
+}
+
+/** Verifies run_install_argv() captures output into the install log. */
+static void test_run_install_argv_captures_output(void **state)
+{
+    (void)state;
+    init_install_log();
+
+    const char *const argv[] = { "sh", "-c", "echo captured; exit 4", NULL };
+    assert_int_equal(4, run_install_argv(argv, &COMMAND_TO_INSTALL_LOG));
+    flush_install_log();
+
+    FILE *file = fopen(CONFIG_INSTALL_LOG_PATH, "r");
+    assert_non_null(file);
+    char buffer[64] = { 0 };
+    char *line = fgets(buffer, sizeof(buffer), file);
+    fclose(file);
+    unlink(CONFIG_INSTALL_LOG_PATH);
+
+    assert_non_null(line);
+    assert_string_equal("captured\n", buffer);
+}
+
+/** Verifies invoke_command_tick() skips threads other than the one that set the callback. */
+static void test_invoke_command_tick_ignores_other_threads(void **state)
+{
+    (void)state;
+    tick_count = 0;
+    set_command_tick_callback(count_tick);
+
+    pthread_t thread;
+    assert_int_equal(0, pthread_create(&thread, NULL, invoke_tick_thread, NULL));
+    pthread_join(thread, NULL);
+    assert_int_equal(0, tick_count);
+
+    // Sleep past the throttle interval so the tick is not skipped.
+    usleep((COMMAND_TICK_INTERVAL_MS + 10) * 1000);
+    invoke_command_tick();
+    set_command_tick_callback(NULL);
+    assert_int_equal(1, tick_count);
+}
+
 int main(void)
 {
     const struct CMUnitTest tests[] = {
@@ -207,6 +351,14 @@ int main(void)
         cmocka_unit_test_setup_teardown(test_run_install_command_not_dry_run_no_log_file, setup, teardown),
         cmocka_unit_test_setup_teardown(test_close_dry_run_log_safe_when_not_open, setup, teardown),
         cmocka_unit_test_setup_teardown(test_close_dry_run_log_flushes_content, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_run_install_argv_dry_run_logs_quoted_command, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_run_install_argv_redirects_output, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_run_install_argv_returns_exit_status, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_run_install_argv_uses_environment, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_run_install_argv_missing_program, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_run_install_command_captures_output, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_run_install_argv_captures_output, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_invoke_command_tick_ignores_other_threads, setup, teardown),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
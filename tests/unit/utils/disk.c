@@ -204,6 +204,17 @@ static void test_get_partition_device_nvme_second(void **state)
     assert_string_equal("/dev/nvme0n1p2", buffer);
 }
 
+/** Verifies get_partition_device() uses 'p' separator for loop devices. */
+static void test_get_partition_device_loop(void **state)
+{
+    (void)state;
+    char buffer[64];
+
+    get_partition_device("/dev/loop0", 1, buffer, sizeof(buffer));
+
+    assert_string_equal("/dev/loop0p1", buffer);
+}
+
 /** Verifies get_partition_device() works with second NVMe controller. */
 static void test_get_partition_device_nvme_high_number(void **state)
 {
@@ -373,6 +384,69 @@ static void test_is_disk_removable_accepts_underscore(void **state)
     assert_int_equal(0, result);
 }
 
+/** Verifies is_disk_rotational() rejects path traversal attempts. */
+static void test_is_disk_rotational_rejects_path_traversal(void **state)
+{
+    (void)state;
+
+    // Path traversal should be rejected.
+    assert_int_equal(-1, is_disk_rotational(".."));
+    assert_int_equal(-1, is_disk_rotational("sda; rm -rf /"));
+}
+
+/** Verifies is_disk_rotational() returns -1 for non-existent device. */
+static void test_is_disk_rotational_nonexistent_device(void **state)
+{
+    (void)state;
+
+    // Unknown devices must not be reported as solid-state.
+    assert_int_equal(-1, is_disk_rotational("/dev/nonexistent_device_xyz"));
+}
+
+/** Verifies is_disk_discardable() rejects path traversal attempts. */
+static void test_is_disk_discardable_rejects_path_traversal(void **state)
+{
+    (void)state;
+
+    // Path traversal should be rejected.
+    assert_int_equal(-1, is_disk_discardable(".."));
+    assert_int_equal(-1, is_disk_discardable("sda; rm -rf /"));
+}
+
+/** Verifies is_disk_discardable() returns -1 for non-existent device. */
+static void test_is_disk_discardable_nonexistent_device(void **state)
+{
+    (void)state;
+
+    // Unknown devices must not be discarded.
+    assert_int_equal(-1, is_disk_discardable("/dev/nonexistent_device_xyz"));
+}
+
+/** Verifies get_least_common_multiple() finds the smallest shared multiple. */
+static void test_get_least_common_multiple(void **state)
+{
+    (void)state;
+    assert_int_equal(1048576, get_least_common_multiple(1048576, 4096));
+    assert_int_equal(3145728, get_least_common_multiple(1048576, 196608));
+    assert_int_equal(4096, get_least_common_multiple(4096, 4096));
+}
+
+/** Verifies get_disk_io_alignment() rejects path traversal attempts. */
+static void test_get_disk_io_alignment_rejects_path_traversal(void **state)
+{
+    (void)state;
+    assert_int_equal(0, get_disk_io_alignment("../sda"));
+    assert_int_equal(0, get_disk_io_alignment(".."));
+    assert_int_equal(0, get_disk_io_alignment("sda; rm -rf /"));
+}
+
+/** Verifies get_disk_io_alignment() returns 0 for non-existent device. */
+static void test_get_disk_io_alignment_nonexistent_device(void **state)
+{
+    (void)state;
+    assert_int_equal(0, get_disk_io_alignment("/dev/nonexistent_device_xyz"));
+}
+
 int main(void)
 {
     const struct CMUnitTest tests[] = {
@@ -391,6 +465,7 @@ int main(void)
         cmocka_unit_test_setup_teardown(test_get_partition_device_sdb, setup, teardown),
         cmocka_unit_test_setup_teardown(test_get_partition_device_nvme, setup, teardown),
         cmocka_unit_test_setup_teardown(test_get_partition_device_nvme_second, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_get_partition_device_loop, setup, teardown),
         cmocka_unit_test_setup_teardown(test_get_partition_device_nvme_high_number, setup, teardown),
         cmocka_unit_test_setup_teardown(test_get_partition_device_mmc, setup, teardown),
         cmocka_unit_test_setup_teardown(test_get_partition_device_mmc_second, setup, teardown),
@@ -407,6 +482,13 @@ int main(void)
         cmocka_unit_test_setup_teardown(test_is_disk_removable_rejects_special_chars, setup, teardown),
         cmocka_unit_test_setup_teardown(test_is_disk_removable_nonexistent_device, setup, teardown),
         cmocka_unit_test_setup_teardown(test_is_disk_removable_accepts_underscore, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_is_disk_rotational_rejects_path_traversal, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_is_disk_rotational_nonexistent_device, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_is_disk_discardable_rejects_path_traversal, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_is_disk_discardable_nonexistent_device, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_get_least_common_multiple, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_get_disk_io_alignment_rejects_path_traversal, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_get_disk_io_alignment_nonexistent_device, setup, teardown),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
@@ -0,0 +1,185 @@
+/**
+ * This code is responsible for testing the disk probe, including measuring
+ * a disk, probing the detected disks in the background, and estimating the
+ * install time from the results.
+ */
+
+#include "../../all.h"
+
+#define TEST_DISK_PATH "/tmp/limeos-test-probe-disk.img"
+#define TEST_SMALL_DISK_PATH "/tmp/limeos-test-probe-small.img"
+#define TEST_MISSING_DISK_PATH "/tmp/limeos-test-probe-missing.img"
+
+/** Helper to create a file of a given size filled with data. */
+static void create_test_disk(const char *path, size_t size)
+{
+    FILE *file = fopen(path, "w");
+    assert_non_null(file);
+    char block[4096];
+    memset(block, 0x5a, sizeof(block));
+    for (size_t written = 0; written < size; written += sizeof(block))
+    {
+        assert_int_equal(1, fwrite(block, sizeof(block), 1, file));
+    }
+    fclose(file);
+}
+
+/** Helper to wait for the background probes to finish. */
+static void wait_for_disk_probes(void)
+{
+    for (int i = 0; i < 500 && is_probing_disks(); i++)
+    {
+        usleep(10000);
+    }
+    assert_false(is_probing_disks());
+}
+
+/** Sets up the test environment before each test. */
+static int setup(void **state)
+{
+    (void)state;
+    reset_store();
+    create_test_disk(TEST_DISK_PATH, 8 * 1024 * 1024);
+    create_test_disk(TEST_SMALL_DISK_PATH, 4096);
+    unlink(TEST_MISSING_DISK_PATH);
+    return 0;
+}
+
+/** Cleans up the test environment after each test. */
+static int teardown(void **state)
+{
+    (void)state;
+    stop_disk_probes();
+    unlink(TEST_DISK_PATH);
+    unlink(TEST_SMALL_DISK_PATH);
+    reset_store();
+    return 0;
+}
+
+/** Verifies probe_disk() measures throughput and latency. */
+static void test_probe_disk_measures_disk(void **state)
+{
+    (void)state;
+    DiskProbe probe = { 0 };
+
+    assert_int_equal(0, probe_disk(TEST_DISK_PATH, &probe));
+
+    assert_true(probe.sequential_bytes_per_second > 0);
+    assert_true(probe.random_read_seconds > 0);
+}
+
+/** Verifies probe_disk() reports a disk that cannot be opened. */
+static void test_probe_disk_fails_when_missing(void **state)
+{
+    (void)state;
+    DiskProbe probe = { 0 };
+
+    assert_int_equal(-1, probe_disk(TEST_MISSING_DISK_PATH, &probe));
+}
+
+/** Verifies probe_disk() rejects a disk smaller than one sequential read. */
+static void test_probe_disk_rejects_small_disk(void **state)
+{
+    (void)state;
+    DiskProbe probe = { 0 };
+
+    assert_int_equal(-2, probe_disk(TEST_SMALL_DISK_PATH, &probe));
+}
+
+/** Verifies start_disk_probes() stores a result for each detected disk. */
+static void test_start_disk_probes_stores_results(void **state)
+{
+    (void)state;
+    Store *store = get_store();
+    store->disk_count = 2;
+    snprintf(store->disks[0].value, sizeof(store->disks[0].value), TEST_DISK_PATH);
+    snprintf(store->disks[1].value, sizeof(store->disks[1].value), TEST_MISSING_DISK_PATH);
+
+    assert_int_equal(0, start_disk_probes());
+    wait_for_disk_probes();
+
+    assert_int_equal(DISK_PROBE_DONE, store->disk_probes[0].state);
+    assert_true(store->disk_probes[0].sequential_bytes_per_second > 0);
+    assert_int_equal(DISK_PROBE_FAILED, store->disk_probes[1].state);
+}
+
+/** Verifies start_disk_probes() does not measure a disk again. */
+static void test_start_disk_probes_skips_probed_disks(void **state)
+{
+    (void)state;
+    Store *store = get_store();
+    store->disk_count = 1;
+    snprintf(store->disks[0].value, sizeof(store->disks[0].value), TEST_DISK_PATH);
+    store->disk_probes[0].state = DISK_PROBE_DONE;
+    store->disk_probes[0].sequential_bytes_per_second = 1.0;
+
+    assert_int_equal(0, start_disk_probes());
+
+    assert_false(is_probing_disks());
+    assert_true(store->disk_probes[0].sequential_bytes_per_second == 1.0);
+}
+
+/** Verifies stop_disk_probes() leaves no disk queued. */
+static void test_stop_disk_probes_requeues_unprobed_disks(void **state)
+{
+    (void)state;
+    Store *store = get_store();
+    store->disk_count = 3;
+    for (int i = 0; i < store->disk_count; i++)
+    {
+        snprintf(store->disks[i].value, sizeof(store->disks[i].value), TEST_DISK_PATH);
+    }
+
+    assert_int_equal(0, start_disk_probes());
+    stop_disk_probes();
+
+    assert_false(is_probing_disks());
+    for (int i = 0; i < store->disk_count; i++)
+    {
+        assert_int_not_equal(DISK_PROBE_PENDING, store->disk_probes[i].state);
+    }
+}
+
+/** Verifies estimate_install_seconds() charges throughput and seeks. */
+static void test_estimate_install_seconds(void **state)
+{
+    (void)state;
+    DiskProbe probe = { 0 };
+    probe.state = DISK_PROBE_DONE;
+    probe.sequential_bytes_per_second = 100e6;
+    probe.random_read_seconds = 0.001;
+    unsigned long long rootfs_bytes = 1024ULL * DISK_PROBE_BYTES_PER_SEEK;
+
+    double seconds = estimate_install_seconds(&probe, rootfs_bytes);
+
+    double difference = seconds - (rootfs_bytes / 100e6 + 1.024);
+    assert_true(difference > -1e-9 && difference < 1e-9);
+}
+
+/** Verifies estimate_install_seconds() needs a measured disk and rootfs. */
+static void test_estimate_install_seconds_needs_measurements(void **state)
+{
+    (void)state;
+    DiskProbe probe = { 0 };
+    probe.sequential_bytes_per_second = 100e6;
+
+    assert_true(estimate_install_seconds(&probe, 1000000) < 0);
+    probe.state = DISK_PROBE_DONE;
+    assert_true(estimate_install_seconds(&probe, 0) < 0);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_probe_disk_measures_disk, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_probe_disk_fails_when_missing, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_probe_disk_rejects_small_disk, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_start_disk_probes_stores_results, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_start_disk_probes_skips_probed_disks, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_stop_disk_probes_requeues_unprobed_disks, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_estimate_install_seconds, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_estimate_install_seconds_needs_measurements, setup, teardown),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,472 @@
+/**
+ * This code is responsible for testing the install log, including writing
+ * to the log file, capturing command output, reading recent lines and
+ * following the log with a tail.
+ */
+
+#include "../../all.h"
+
+/** Helper to read the install log file into a buffer. */
+static void read_log_file(char *buffer, size_t size)
+{
+    flush_install_log();
+    buffer[0] = '\0';
+    FILE *file = fopen(CONFIG_INSTALL_LOG_PATH, "r");
+    assert_non_null(file);
+    size_t length = fread(buffer, 1, size - 1, file);
+    buffer[length] = '\0';
+    fclose(file);
+}
+
+/** Helper to capture bytes written to a pipe into the log. */
+static void capture_bytes(const char *data)
+{
+    int fds[2];
+    assert_int_equal(0, pipe2(fds, O_NONBLOCK));
+    assert_int_equal((ssize_t)strlen(data), write(fds[1], data, strlen(data)));
+    close(fds[1]);
+
+    LogCapture capture;
+    start_install_log_capture(&capture);
+    assert_int_equal(1, drain_install_log_capture(&capture, fds[0]));
+    finish_install_log_capture(&capture);
+    close(fds[0]);
+}
+
+/** Helper to write numbered lines of output to a descriptor. */
+static void write_numbered_output(int fd, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        char line[32];
+        int length = snprintf(line, sizeof(line), "output %d\n", i);
+        assert_int_equal(length, write(fd, line, (size_t)length));
+    }
+}
+
+/** Helper to check the log file holds every numbered line, in order. */
+static void assert_numbered_output_logged(int count)
+{
+    flush_install_log();
+    FILE *file = fopen(CONFIG_INSTALL_LOG_PATH, "r");
+    assert_non_null(file);
+    char buffer[64];
+    int lines = 0;
+    while (fgets(buffer, sizeof(buffer), file))
+    {
+        assert_null(strstr(buffer, "lines lost"));
+        int number;
+        if (sscanf(buffer, "output %d", &number) == 1)
+        {
+            assert_int_equal(lines, number);
+            lines++;
+        }
+    }
+    fclose(file);
+    assert_int_equal(count, lines);
+}
+
+/** Sets up the test environment before each test. */
+static int setup(void **state)
+{
+    (void)state;
+    init_install_log();
+    return 0;
+}
+
+/** Cleans up the test environment after each test. */
+static int teardown(void **state)
+{
+    (void)state;
+    unlink(CONFIG_INSTALL_LOG_PATH);
+    return 0;
+}
+
+/** Verifies write_install_log() appends the message to the log file. */
+static void test_write_install_log_appends_to_file(void **state)
+{
+    (void)state;
+    write_install_log("Step %d done", 3);
+    write_install_log_header("Partitioning");
+
+    char buffer[1024];
+    read_log_file(buffer, sizeof(buffer));
+    assert_non_null(strstr(buffer, "Step 3 done\n"));
+    assert_non_null(strstr(buffer, "\n  Partitioning\n"));
+}
+
+/** Verifies the background writer appends lines without an explicit flush. */
+static void test_write_install_log_flushes_in_background(void **state)
+{
+    (void)state;
+    write_install_log("eventually written");
+
+    // Wait a few flush intervals for the writer.
+    struct stat info = {0};
+    for (int i = 0; i < 50 && info.st_size == 0; i++)
+    {
+        usleep(20000);
+        stat(CONFIG_INSTALL_LOG_PATH, &info);
+    }
+    assert_int_equal(strlen("eventually written\n"), info.st_size);
+}
+
+/** Verifies close_install_log() writes the remaining lines. */
+static void test_close_install_log_writes_remaining_lines(void **state)
+{
+    (void)state;
+    write_install_log("before close");
+    close_install_log();
+
+    FILE *file = fopen(CONFIG_INSTALL_LOG_PATH, "r");
+    assert_non_null(file);
+    char buffer[64] = { 0 };
+    char *line = fgets(buffer, sizeof(buffer), file);
+    fclose(file);
+
+    assert_non_null(line);
+    assert_string_equal("before close\n", buffer);
+}
+
+/** Writes numbered lines to the install log. */
+static void *write_numbered_lines(void *argument)
+{
+    int writer = (int)(intptr_t)argument;
+    for (int i = 0; i < 1000; i++)
+    {
+        write_install_log("writer %d line %d", writer, i);
+    }
+    return NULL;
+}
+
+/** Verifies lines from several threads all reach the log file intact. */
+static void test_write_install_log_from_several_threads(void **state)
+{
+    (void)state;
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++)
+    {
+        assert_int_equal(0, pthread_create(&threads[i], NULL, write_numbered_lines, (void *)(intptr_t)i));
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    flush_install_log();
+
+    FILE *file = fopen(CONFIG_INSTALL_LOG_PATH, "r");
+    assert_non_null(file);
+    char buffer[64];
+    int lines = 0;
+    while (fgets(buffer, sizeof(buffer), file))
+    {
+        int writer;
+        int number;
+        assert_int_equal(2, sscanf(buffer, "writer %d line %d", &writer, &number));
+        lines++;
+    }
+    fclose(file);
+    assert_int_equal(4000, lines);
+}
+
+/** Verifies read_install_log_lines() returns the newest lines of this installation. */
+static void test_read_install_log_lines_returns_newest_lines(void **state)
+{
+    (void)state;
+    write_install_log("one");
+    write_install_log("two");
+    write_install_log("three");
+
+    int count;
+    char **lines = read_install_log_lines(2, &count);
+    assert_non_null(lines);
+    assert_int_equal(2, count);
+    assert_string_equal("two", lines[0]);
+    assert_string_equal("three", lines[1]);
+    free_install_log_lines(lines, count);
+}
+
+/** Verifies read_install_log_lines() skips lines from before init_install_log(). */
+static void test_read_install_log_lines_starts_at_init(void **state)
+{
+    (void)state;
+    write_install_log("earlier");
+    init_install_log();
+    write_install_log("later");
+
+    int count;
+    char **lines = read_install_log_lines(10, &count);
+    assert_int_equal(1, count);
+    assert_string_equal("later", lines[0]);
+    free_install_log_lines(lines, count);
+}
+
+/** Verifies read_install_log_lines() does not read the log file. */
+static void test_read_install_log_lines_does_not_read_file(void **state)
+{
+    (void)state;
+    write_install_log("in memory");
+    unlink(CONFIG_INSTALL_LOG_PATH);
+
+    int count;
+    char **lines = read_install_log_lines(10, &count);
+    assert_int_equal(1, count);
+    assert_string_equal("in memory", lines[0]);
+    free_install_log_lines(lines, count);
+}
+
+/** Verifies captured output is split into lines, keeping a final partial line. */
+static void test_capture_splits_lines(void **state)
+{
+    (void)state;
+    capture_bytes("alpha\nbeta\ngamma");
+
+    int count;
+    char **lines = read_install_log_lines(10, &count);
+    assert_int_equal(3, count);
+    assert_string_equal("alpha", lines[0]);
+    assert_string_equal("beta", lines[1]);
+    assert_string_equal("gamma", lines[2]);
+    free_install_log_lines(lines, count);
+
+    char buffer[256];
+    read_log_file(buffer, sizeof(buffer));
+    assert_string_equal("alpha\nbeta\ngamma\n", buffer);
+}
+
+/** Verifies a carriage return lets later text replace the line. */
+static void test_capture_keeps_latest_progress(void **state)
+{
+    (void)state;
+    capture_bytes("Writing 1/3\rWriting 2/3\rWriting 3/3\r\ndone\n");
+
+    int count;
+    char **lines = read_install_log_lines(10, &count);
+    assert_int_equal(2, count);
+    assert_string_equal("Writing 3/3", lines[0]);
+    assert_string_equal("done", lines[1]);
+    free_install_log_lines(lines, count);
+}
+
+/** Verifies a held capture publishes its lines together once finished. */
+static void test_capture_holds_lines_until_finished(void **state)
+{
+    (void)state;
+    int fds[2];
+    assert_int_equal(0, pipe2(fds, O_NONBLOCK));
+    LogCapture capture;
+    start_install_log_capture(&capture);
+    hold_install_log_capture(&capture);
+
+    // Capture output while another line is written.
+    assert_int_equal(8, write(fds[1], "first\nse", 8));
+    assert_int_equal(0, drain_install_log_capture(&capture, fds[0]));
+    write_install_log("elsewhere");
+    assert_int_equal(8, write(fds[1], "cond\nend", 8));
+    close(fds[1]);
+    assert_int_equal(1, drain_install_log_capture(&capture, fds[0]));
+    finish_install_log_capture(&capture);
+    close(fds[0]);
+
+    int count;
+    char **lines = read_install_log_lines(10, &count);
+    assert_int_equal(4, count);
+    assert_string_equal("elsewhere", lines[0]);
+    assert_string_equal("first", lines[1]);
+    assert_string_equal("second", lines[2]);
+    assert_string_equal("end", lines[3]);
+    free_install_log_lines(lines, count);
+}
+
+/** Verifies a drain publishing more lines than the ring holds loses none. */
+static void test_capture_drain_keeps_lines_beyond_ring(void **state)
+{
+    (void)state;
+    int fds[2];
+    assert_int_equal(0, pipe2(fds, O_NONBLOCK));
+    write_numbered_output(fds[1], OUTPUT_RING_LINES + 1000);
+    close(fds[1]);
+
+    LogCapture capture;
+    start_install_log_capture(&capture);
+    assert_int_equal(1, drain_install_log_capture(&capture, fds[0]));
+    finish_install_log_capture(&capture);
+    close(fds[0]);
+
+    assert_numbered_output_logged(OUTPUT_RING_LINES + 1000);
+}
+
+/** Verifies a held block with more lines than the ring holds loses none. */
+static void test_capture_holds_lines_beyond_ring(void **state)
+{
+    (void)state;
+    int fds[2];
+    assert_int_equal(0, pipe2(fds, O_NONBLOCK));
+    write_numbered_output(fds[1], OUTPUT_RING_LINES + 1000);
+    close(fds[1]);
+
+    LogCapture capture;
+    start_install_log_capture(&capture);
+    hold_install_log_capture(&capture);
+    assert_int_equal(1, drain_install_log_capture(&capture, fds[0]));
+    finish_install_log_capture(&capture);
+    close(fds[0]);
+
+    assert_numbered_output_logged(OUTPUT_RING_LINES + 1000);
+}
+
+/** Verifies a drain returns after about one pipe buffer of output. */
+static void test_capture_drain_stops_after_pipe_buffer(void **state)
+{
+    (void)state;
+    int fds[2];
+    assert_int_equal(0, pipe2(fds, O_NONBLOCK));
+    if (fcntl(fds[1], F_SETPIPE_SZ, 256 * 1024) < 256 * 1024)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        return;
+    }
+    write_numbered_output(fds[1], 10000);
+    close(fds[1]);
+
+    // The output is larger than one drain reads, so it takes several.
+    LogCapture capture;
+    start_install_log_capture(&capture);
+    assert_int_equal(0, drain_install_log_capture(&capture, fds[0]));
+    while (drain_install_log_capture(&capture, fds[0]) == 0)
+    {
+    }
+    finish_install_log_capture(&capture);
+    close(fds[0]);
+
+    assert_numbered_output_logged(10000);
+}
+
+/** Verifies lines longer than a ring slot are wrapped rather than lost. */
+static void test_capture_wraps_long_lines(void **state)
+{
+    (void)state;
+    char data[OUTPUT_LINE_BYTES + 11];
+    memset(data, 'y', sizeof(data) - 1);
+    data[sizeof(data) - 1] = '\0';
+    capture_bytes(data);
+
+    int count;
+    char **lines = read_install_log_lines(10, &count);
+    assert_int_equal(2, count);
+    assert_int_equal(OUTPUT_LINE_BYTES - 1, strlen(lines[0]));
+    assert_int_equal(11, strlen(lines[1]));
+    free_install_log_lines(lines, count);
+}
+
+/** Verifies update_install_log_tail() copies only lines added since the last update. */
+static void test_update_install_log_tail_adds_new_lines(void **state)
+{
+    (void)state;
+    LogTail tail;
+    assert_int_equal(0, open_install_log_tail(&tail, 3));
+
+    write_install_log("one");
+    assert_int_equal(1, update_install_log_tail(&tail));
+    assert_int_equal(0, update_install_log_tail(&tail));
+
+    write_install_log("two");
+    assert_int_equal(1, update_install_log_tail(&tail));
+    assert_int_equal(2, tail.count);
+    assert_string_equal("one", get_install_log_tail_line(&tail, 0));
+    assert_string_equal("two", get_install_log_tail_line(&tail, 1));
+
+    close_install_log_tail(&tail);
+}
+
+/** Verifies a full tail keeps only the newest lines, oldest first. */
+static void test_update_install_log_tail_keeps_newest_lines(void **state)
+{
+    (void)state;
+    LogTail tail;
+    assert_int_equal(0, open_install_log_tail(&tail, 3));
+
+    char text[16];
+    for (int i = 0; i < 5; i++)
+    {
+        snprintf(text, sizeof(text), "line %d", i);
+        write_install_log("%s", text);
+        update_install_log_tail(&tail);
+    }
+    write_install_log("line 5");
+    write_install_log("line 6");
+    assert_int_equal(2, update_install_log_tail(&tail));
+
+    assert_int_equal(3, tail.count);
+    assert_string_equal("line 4", get_install_log_tail_line(&tail, 0));
+    assert_string_equal("line 5", get_install_log_tail_line(&tail, 1));
+    assert_string_equal("line 6", get_install_log_tail_line(&tail, 2));
+
+    close_install_log_tail(&tail);
+}
+
+/** Verifies a tail skips straight to the newest lines after a burst of output. */
+static void test_update_install_log_tail_skips_burst(void **state)
+{
+    (void)state;
+    LogTail tail;
+    assert_int_equal(0, open_install_log_tail(&tail, 2));
+
+    for (int i = 0; i < OUTPUT_RING_LINES * 2; i++)
+    {
+        publish_output_line("burst", 5);
+    }
+    write_install_log("last");
+
+    assert_int_equal(2, update_install_log_tail(&tail));
+    assert_string_equal("burst", get_install_log_tail_line(&tail, 0));
+    assert_string_equal("last", get_install_log_tail_line(&tail, 1));
+
+    close_install_log_tail(&tail);
+}
+
+/** Verifies a tail starts over when a new installation begins. */
+static void test_update_install_log_tail_resets_on_init(void **state)
+{
+    (void)state;
+    LogTail tail;
+    assert_int_equal(0, open_install_log_tail(&tail, 4));
+
+    write_install_log("previous");
+    update_install_log_tail(&tail);
+    init_install_log();
+    write_install_log("current");
+
+    assert_int_equal(1, update_install_log_tail(&tail));
+    assert_int_equal(1, tail.count);
+    assert_string_equal("current", get_install_log_tail_line(&tail, 0));
+
+    close_install_log_tail(&tail);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_write_install_log_appends_to_file, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_write_install_log_flushes_in_background, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_close_install_log_writes_remaining_lines, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_write_install_log_from_several_threads, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_read_install_log_lines_returns_newest_lines, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_read_install_log_lines_starts_at_init, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_read_install_log_lines_does_not_read_file, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_capture_splits_lines, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_capture_keeps_latest_progress, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_capture_holds_lines_until_finished, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_capture_drain_keeps_lines_beyond_ring, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_capture_holds_lines_beyond_ring, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_capture_drain_stops_after_pipe_buffer, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_capture_wraps_long_lines, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_update_install_log_tail_adds_new_lines, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_update_install_log_tail_keeps_newest_lines, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_update_install_log_tail_skips_burst, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_update_install_log_tail_resets_on_init, setup, teardown),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
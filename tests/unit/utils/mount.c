@@ -0,0 +1,254 @@
+/**
+ * This code is responsible for testing the mount utility, including the
+ * mount(8) command lines recorded in dry-run mode, creating mount points,
+ * and unmounting the registered mounts.
+ *
+ * The registry tests mount tmpfs filesystems, and pass without checking
+ * anything where that is not allowed, such as when not run as root.
+ */
+
+#include "../../all.h"
+
+#define TEST_MOUNT_ROOT "/tmp/limeos-test-mount"
+
+/** Sets up the test environment before each test. */
+static int setup(void **state)
+{
+    (void)state;
+    reset_store();
+    close_dry_run_log();
+    unlink(CONFIG_DRY_RUN_LOG_PATH);
+    return 0;
+}
+
+/** Cleans up the test environment after each test. */
+static int teardown(void **state)
+{
+    (void)state;
+    close_dry_run_log();
+    unlink(CONFIG_DRY_RUN_LOG_PATH);
+    umount2(TEST_MOUNT_ROOT "/home", MNT_DETACH);
+    umount2(TEST_MOUNT_ROOT "/boot", MNT_DETACH);
+    umount2(TEST_MOUNT_ROOT, MNT_DETACH);
+    rmdir(TEST_MOUNT_ROOT "/boot/efi");
+    rmdir(TEST_MOUNT_ROOT "/boot");
+    rmdir(TEST_MOUNT_ROOT);
+    return 0;
+}
+
+/** Helper to check whether a directory is a mount point. */
+static int is_test_mounted(const char *path)
+{
+    FILE *file = fopen(MOUNT_INFO_PATH, "r");
+    assert_non_null(file);
+    int mounted = 0;
+    char line[4096];
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        char mount_point[4096];
+        if (sscanf(line, "%*s %*s %*s %*s %4095s", mount_point) == 1 && strcmp(mount_point, path) == 0)
+        {
+            mounted = 1;
+        }
+    }
+    fclose(file);
+    return mounted;
+}
+
+/** Helper to mount a tmpfs, returning whether that is allowed. */
+static int mount_test_tmpfs(const char *path)
+{
+    if (geteuid() != 0)
+    {
+        return 0;
+    }
+    assert_int_equal(0, create_mount_point(path));
+    return mount_filesystem("tmpfs", path, "tmpfs", 0, "size=1m") == 0;
+}
+
+/** Helper to read the first line of the dry-run log. */
+static void read_first_log_line(char *out_line, size_t line_size)
+{
+    close_dry_run_log();
+    FILE *file = fopen(CONFIG_DRY_RUN_LOG_PATH, "r");
+    assert_non_null(file);
+    assert_non_null(fgets(out_line, (int)line_size, file));
+    fclose(file);
+}
+
+/** Verifies mount_filesystem() records a mount with its type and options. */
+static void test_mount_filesystem_dry_run_logs_options(void **state)
+{
+    (void)state;
+    get_store()->dry_run = 1;
+
+    assert_int_equal(0, mount_filesystem("/dev/sda2", "/mnt/home", "ext4", MS_NOATIME, "commit=60"));
+
+    char line[256];
+    read_first_log_line(line, sizeof(line));
+    assert_string_equal("mount -t ext4 -o noatime,commit=60 /dev/sda2 /mnt/home\n", line);
+}
+
+/** Verifies mount_filesystem() records a bind mount. */
+static void test_mount_filesystem_dry_run_logs_bind(void **state)
+{
+    (void)state;
+    get_store()->dry_run = 1;
+
+    assert_int_equal(0, mount_filesystem("/dev", "/mnt/dev", NULL, MS_BIND, NULL));
+
+    char line[256];
+    read_first_log_line(line, sizeof(line));
+    assert_string_equal("mount --bind /dev /mnt/dev\n", line);
+}
+
+/** Verifies mount_filesystem() records a remount without a source. */
+static void test_mount_filesystem_dry_run_logs_remount(void **state)
+{
+    (void)state;
+    get_store()->dry_run = 1;
+
+    assert_int_equal(0, mount_filesystem(NULL, "/mnt", NULL, MS_REMOUNT | MS_RELATIME, "commit=5"));
+
+    char line[256];
+    read_first_log_line(line, sizeof(line));
+    assert_string_equal("mount -o remount,relatime,commit=5 /mnt\n", line);
+}
+
+/** Verifies unmount_filesystem() records the unmount. */
+static void test_unmount_filesystem_dry_run_logs_umount(void **state)
+{
+    (void)state;
+    get_store()->dry_run = 1;
+
+    assert_int_equal(0, unmount_filesystem("/mnt/boot/efi"));
+
+    char line[256];
+    read_first_log_line(line, sizeof(line));
+    assert_string_equal("umount /mnt/boot/efi\n", line);
+}
+
+/** Verifies unmount_filesystem() fails for a directory that is not mounted. */
+static void test_unmount_filesystem_fails_when_not_mounted(void **state)
+{
+    (void)state;
+    assert_int_equal(0, mkdir(TEST_MOUNT_ROOT, 0755));
+
+    assert_int_equal(-1, unmount_filesystem(TEST_MOUNT_ROOT));
+}
+
+/** Verifies create_mount_point() creates every missing directory. */
+static void test_create_mount_point_creates_ancestors(void **state)
+{
+    (void)state;
+
+    assert_int_equal(0, create_mount_point(TEST_MOUNT_ROOT "/boot/efi"));
+
+    struct stat directory_stat;
+    assert_int_equal(0, stat(TEST_MOUNT_ROOT "/boot/efi", &directory_stat));
+    assert_true(S_ISDIR(directory_stat.st_mode));
+
+    // Existing directories are accepted.
+    assert_int_equal(0, create_mount_point(TEST_MOUNT_ROOT "/boot/efi"));
+}
+
+/** Verifies create_mount_point() rejects a relative path. */
+static void test_create_mount_point_rejects_relative_path(void **state)
+{
+    (void)state;
+    assert_int_equal(-1, create_mount_point("mnt/home"));
+}
+
+/** Verifies create_mount_point() fails when a file is in the way. */
+static void test_create_mount_point_fails_on_file(void **state)
+{
+    (void)state;
+    FILE *file = fopen(TEST_MOUNT_ROOT, "w");
+    assert_non_null(file);
+    fclose(file);
+
+    assert_int_equal(-2, create_mount_point(TEST_MOUNT_ROOT "/boot"));
+    unlink(TEST_MOUNT_ROOT);
+}
+
+/** Verifies unmount_registered_filesystems() unmounts nested mounts first. */
+static void test_unmount_registered_filesystems_unmounts_nested(void **state)
+{
+    (void)state;
+    if (!mount_test_tmpfs(TEST_MOUNT_ROOT))
+    {
+        return;
+    }
+    assert_true(mount_test_tmpfs(TEST_MOUNT_ROOT "/boot"));
+    assert_true(mount_test_tmpfs(TEST_MOUNT_ROOT "/home"));
+
+    assert_int_equal(0, unmount_registered_filesystems(NULL, NULL));
+
+    assert_false(is_test_mounted(TEST_MOUNT_ROOT "/boot"));
+    assert_false(is_test_mounted(TEST_MOUNT_ROOT "/home"));
+    assert_false(is_test_mounted(TEST_MOUNT_ROOT));
+}
+
+/** Helper to count the targets passed to the unmount callback. */
+static void count_unmount_target(const char *target, void *context)
+{
+    (void)target;
+    (*(int *)context)++;
+}
+
+/** Verifies unmount_registered_filesystems() skips what is no longer mounted. */
+static void test_unmount_registered_filesystems_skips_unmounted(void **state)
+{
+    (void)state;
+    if (!mount_test_tmpfs(TEST_MOUNT_ROOT))
+    {
+        return;
+    }
+    assert_true(mount_test_tmpfs(TEST_MOUNT_ROOT "/boot"));
+    assert_int_equal(0, umount2(TEST_MOUNT_ROOT "/boot", 0));
+    int calls = 0;
+
+    assert_int_equal(0, unmount_registered_filesystems(count_unmount_target, &calls));
+
+    assert_int_equal(1, calls);
+    assert_false(is_test_mounted(TEST_MOUNT_ROOT));
+}
+
+/** Verifies unmount_registered_filesystems() detaches a busy mount. */
+static void test_unmount_registered_filesystems_detaches_busy(void **state)
+{
+    (void)state;
+    if (!mount_test_tmpfs(TEST_MOUNT_ROOT))
+    {
+        return;
+    }
+    int fd = open(TEST_MOUNT_ROOT "/busy", O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+    assert_true(fd >= 0);
+
+    assert_int_equal(1, unmount_registered_filesystems(NULL, NULL));
+    close(fd);
+
+    assert_false(is_test_mounted(TEST_MOUNT_ROOT));
+
+    // The detached mount is no longer registered.
+    assert_int_equal(0, unmount_registered_filesystems(NULL, NULL));
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_mount_filesystem_dry_run_logs_options, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_mount_filesystem_dry_run_logs_bind, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_mount_filesystem_dry_run_logs_remount, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_unmount_filesystem_dry_run_logs_umount, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_unmount_filesystem_fails_when_not_mounted, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_create_mount_point_creates_ancestors, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_create_mount_point_rejects_relative_path, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_create_mount_point_fails_on_file, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_unmount_registered_filesystems_unmounts_nested, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_unmount_registered_filesystems_skips_unmounted, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_unmount_registered_filesystems_detaches_busy, setup, teardown),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,166 @@
+/**
+ * This code is responsible for testing the output ring, including reading
+ * published lines, skipping overwritten ones and concurrent publishing.
+ */
+
+#include "../../all.h"
+
+/** The number of threads publishing at once in concurrency tests. */
+#define TEST_PRODUCERS 4
+
+/** The number of lines each producer publishes in concurrency tests. */
+#define TEST_PRODUCER_LINES 5000
+
+/** Helper to publish a NUL-terminated line. */
+static void publish_text(const char *text)
+{
+    publish_output_line(text, strlen(text));
+}
+
+/** Sets up the test environment before each test. */
+static int setup(void **state)
+{
+    (void)state;
+    return 0;
+}
+
+/** Cleans up the test environment after each test. */
+static int teardown(void **state)
+{
+    (void)state;
+    return 0;
+}
+
+/** Verifies read_output_line() returns lines in the order they were published. */
+static void test_read_output_line_returns_lines_in_order(void **state)
+{
+    (void)state;
+    OutputCursor cursor = { get_output_head(), 0 };
+
+    publish_text("first");
+    publish_text("second");
+
+    char line[OUTPUT_LINE_BYTES];
+    assert_int_equal(1, read_output_line(&cursor, line, sizeof(line)));
+    assert_string_equal("first", line);
+    assert_int_equal(1, read_output_line(&cursor, line, sizeof(line)));
+    assert_string_equal("second", line);
+    assert_int_equal(0, read_output_line(&cursor, line, sizeof(line)));
+}
+
+/** Verifies every cursor sees every line independently. */
+static void test_read_output_line_broadcasts_to_each_cursor(void **state)
+{
+    (void)state;
+    OutputCursor first = { get_output_head(), 0 };
+    OutputCursor second = first;
+
+    publish_text("shared");
+
+    char line[OUTPUT_LINE_BYTES];
+    assert_int_equal(1, read_output_line(&first, line, sizeof(line)));
+    assert_string_equal("shared", line);
+    assert_int_equal(1, read_output_line(&second, line, sizeof(line)));
+    assert_string_equal("shared", line);
+}
+
+/** Verifies publish_output_line() truncates lines longer than a slot. */
+static void test_publish_output_line_truncates_long_lines(void **state)
+{
+    (void)state;
+    OutputCursor cursor = { get_output_head(), 0 };
+
+    char text[OUTPUT_LINE_BYTES * 2];
+    memset(text, 'x', sizeof(text));
+    publish_output_line(text, sizeof(text));
+
+    char line[OUTPUT_LINE_BYTES];
+    assert_int_equal(1, read_output_line(&cursor, line, sizeof(line)));
+    assert_int_equal(OUTPUT_LINE_BYTES - 1, strlen(line));
+}
+
+/** Verifies a cursor that falls behind skips and counts overwritten lines. */
+static void test_read_output_line_counts_overwritten_lines(void **state)
+{
+    (void)state;
+    OutputCursor cursor = { get_output_head(), 0 };
+
+    char text[32];
+    for (int i = 0; i < OUTPUT_RING_LINES + 10; i++)
+    {
+        snprintf(text, sizeof(text), "line %d", i);
+        publish_text(text);
+    }
+
+    char line[OUTPUT_LINE_BYTES];
+    assert_int_equal(1, read_output_line(&cursor, line, sizeof(line)));
+    assert_int_equal(10, cursor.dropped);
+    assert_string_equal("line 10", line);
+}
+
+/** Publishes numbered lines tagged with the producer's index. */
+static void *publish_numbered_lines(void *argument)
+{
+    int producer = (int)(intptr_t)argument;
+    char text[32];
+    for (int i = 0; i < TEST_PRODUCER_LINES; i++)
+    {
+        int length = snprintf(text, sizeof(text), "%d:%d", producer, i);
+        publish_output_line(text, (size_t)length);
+    }
+    return NULL;
+}
+
+/** Verifies concurrent producers never tear lines or reorder their own. */
+static void test_publish_output_line_concurrent_producers(void **state)
+{
+    (void)state;
+    OutputCursor cursor = { get_output_head(), 0 };
+
+    pthread_t threads[TEST_PRODUCERS];
+    for (int i = 0; i < TEST_PRODUCERS; i++)
+    {
+        assert_int_equal(0, pthread_create(&threads[i], NULL, publish_numbered_lines, (void *)(intptr_t)i));
+    }
+
+    // Read while the producers publish, checking each line is intact and
+    // that every producer's lines arrive in order.
+    int next[TEST_PRODUCERS] = { 0 };
+    unsigned long long seen = 0;
+    unsigned long long total = (unsigned long long)TEST_PRODUCERS * TEST_PRODUCER_LINES;
+    char line[OUTPUT_LINE_BYTES];
+    while (seen + cursor.dropped < total)
+    {
+        if (!read_output_line(&cursor, line, sizeof(line)))
+        {
+            sched_yield();
+            continue;
+        }
+        int producer;
+        int number;
+        assert_int_equal(2, sscanf(line, "%d:%d", &producer, &number));
+        assert_in_range(producer, 0, TEST_PRODUCERS - 1);
+        assert_true(number >= next[producer]);
+        next[producer] = number + 1;
+        seen++;
+    }
+
+    for (int i = 0; i < TEST_PRODUCERS; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    assert_true(seen > 0);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_read_output_line_returns_lines_in_order, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_read_output_line_broadcasts_to_each_cursor, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_publish_output_line_truncates_long_lines, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_read_output_line_counts_overwritten_lines, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_publish_output_line_concurrent_producers, setup, teardown),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,184 @@
+/**
+ * This code is responsible for testing the runtime event loop, including
+ * process supervision, timer ticks and watched descriptors.
+ */
+
+#include "../../all.h"
+
+// Count tick invocations.
+static int tick_count;
+
+/** Test tick callback that counts invocations. */
+static void count_tick(void)
+{
+    tick_count++;
+}
+
+/** Helper to start a shell command as a child process. */
+static pid_t spawn_shell(const char *command)
+{
+    const char *const argv[] = { "sh", "-c", command, NULL };
+    pid_t pid;
+    if (posix_spawn(&pid, "/bin/sh", NULL, NULL, (char *const *)argv, environ) != 0)
+    {
+        return -1;
+    }
+    return pid;
+}
+
+/** Helper to measure elapsed time in milliseconds. */
+static double get_elapsed_ms(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) * 1000.0 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+/** Sets up the test environment before each test. */
+static int setup(void **state)
+{
+    (void)state;
+    tick_count = 0;
+    return 0;
+}
+
+/** Cleans up the test environment after each test. */
+static int teardown(void **state)
+{
+    (void)state;
+    return 0;
+}
+
+/** Verifies wait_runtime_process() returns the exit status of the process. */
+static void test_wait_runtime_process_returns_exit_status(void **state)
+{
+    (void)state;
+    Runtime runtime;
+    assert_int_equal(0, open_runtime(&runtime, NULL, 0));
+
+    pid_t pid = spawn_shell("exit 7");
+    assert_true(pid > 0);
+    assert_int_equal(0, add_runtime_process(&runtime, pid));
+    assert_int_equal(7, wait_runtime_process(&runtime, pid));
+
+    close_runtime(&runtime);
+}
+
+/** Verifies wait_runtime_process() reports abnormal termination. */
+static void test_wait_runtime_process_reports_signal(void **state)
+{
+    (void)state;
+    Runtime runtime;
+    assert_int_equal(0, open_runtime(&runtime, NULL, 0));
+
+    pid_t pid = spawn_shell("kill -9 $$");
+    assert_true(pid > 0);
+    assert_int_equal(0, add_runtime_process(&runtime, pid));
+    assert_int_equal(-1, wait_runtime_process(&runtime, pid));
+
+    close_runtime(&runtime);
+}
+
+/** Verifies completion is observed without waiting for a tick interval. */
+static void test_wait_runtime_process_observes_completion_immediately(void **state)
+{
+    (void)state;
+    Runtime runtime;
+    assert_int_equal(0, open_runtime(&runtime, count_tick, COMMAND_TICK_INTERVAL_MS));
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t pid = spawn_shell("true");
+    assert_true(pid > 0);
+    assert_int_equal(0, add_runtime_process(&runtime, pid));
+    assert_int_equal(0, wait_runtime_process(&runtime, pid));
+
+    // Completing before the first tick shows the timer did not gate it.
+    assert_true(get_elapsed_ms(&start) < COMMAND_TICK_INTERVAL_MS);
+    assert_int_equal(0, tick_count);
+
+    close_runtime(&runtime);
+}
+
+/** Verifies a runtime supervises several processes at once. */
+static void test_run_runtime_supervises_several_processes(void **state)
+{
+    (void)state;
+    Runtime runtime;
+    assert_int_equal(0, open_runtime(&runtime, NULL, 0));
+
+    pid_t slow = spawn_shell("sleep 0.3; exit 2");
+    pid_t fast = spawn_shell("exit 1");
+    assert_true(slow > 0 && fast > 0);
+    assert_int_equal(0, add_runtime_process(&runtime, slow));
+    assert_int_equal(0, add_runtime_process(&runtime, fast));
+
+    // The fast process finishes first while the slow one keeps running.
+    int result;
+    while (take_runtime_process(&runtime, fast, &result, NULL) == 0)
+    {
+        assert_true(run_runtime(&runtime, -1) >= 0);
+    }
+    assert_int_equal(1, result);
+    assert_int_equal(0, take_runtime_process(&runtime, slow, &result, NULL));
+    assert_int_equal(-1, take_runtime_process(&runtime, fast, &result, NULL));
+
+    assert_int_equal(2, wait_runtime_process(&runtime, slow));
+
+    close_runtime(&runtime);
+}
+
+/** Verifies the timer invokes the tick callback while a process runs. */
+static void test_run_runtime_ticks_on_timer(void **state)
+{
+    (void)state;
+    Runtime runtime;
+    assert_int_equal(0, open_runtime(&runtime, count_tick, 0));
+
+    pid_t pid = spawn_shell("sleep 0.25");
+    assert_true(pid > 0);
+    assert_int_equal(0, add_runtime_process(&runtime, pid));
+    assert_int_equal(0, wait_runtime_process(&runtime, pid));
+
+    // Expect about one tick per interval, starting straight away.
+    assert_true(tick_count >= 3);
+    assert_true(tick_count <= 250 / COMMAND_TICK_INTERVAL_MS + 2);
+
+    close_runtime(&runtime);
+}
+
+/** Verifies run_runtime() wakes up when a watched descriptor is readable. */
+static void test_run_runtime_wakes_on_watched_descriptor(void **state)
+{
+    (void)state;
+    Runtime runtime;
+    assert_int_equal(0, open_runtime(&runtime, NULL, 0));
+
+    int wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    assert_true(wake_fd >= 0);
+    assert_int_equal(0, watch_runtime_descriptor(&runtime, wake_fd));
+
+    // Nothing is ready yet.
+    assert_int_equal(0, run_runtime(&runtime, 0));
+
+    uint64_t wake = 1;
+    assert_int_equal(sizeof(wake), write(wake_fd, &wake, sizeof(wake)));
+    assert_int_equal(1, run_runtime(&runtime, -1));
+
+    close(wake_fd);
+    close_runtime(&runtime);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_wait_runtime_process_returns_exit_status, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_wait_runtime_process_reports_signal, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_wait_runtime_process_observes_completion_immediately, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_run_runtime_supervises_several_processes, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_run_runtime_ticks_on_timer, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_run_runtime_wakes_on_watched_descriptor, setup, teardown),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,162 @@
+/**
+ * This code is responsible for testing the installation trace, including
+ * recording spans and exporting them as Chrome trace-event JSON.
+ */
+
+#include "../../all.h"
+
+/** The path of the trace written by tests. */
+#define TEST_TRACE_PATH "/tmp/limeos-test-trace.json"
+
+/** Helper to read the written trace into a buffer. */
+static void read_trace(char *buffer, size_t size)
+{
+    FILE *file = fopen(TEST_TRACE_PATH, "r");
+    assert_non_null(file);
+    size_t length = fread(buffer, 1, size - 1, file);
+    buffer[length] = '\0';
+    fclose(file);
+}
+
+/** Sets up the test environment before each test. */
+static int setup(void **state)
+{
+    (void)state;
+    reset_store();
+    start_trace();
+    return 0;
+}
+
+/** Cleans up the test environment after each test. */
+static int teardown(void **state)
+{
+    (void)state;
+    stop_trace();
+    unlink(TEST_TRACE_PATH);
+    return 0;
+}
+
+/** Verifies write_trace() writes recorded spans as complete events. */
+static void test_write_trace_writes_complete_events(void **state)
+{
+    (void)state;
+    TraceSpan span;
+    begin_trace_span(&span, "phase", "Partitions");
+    ProcessUsage usage = { 1500, 250, 4096, 8192 };
+    end_trace_span(&span, 3, &usage);
+
+    assert_int_equal(0, write_trace(TEST_TRACE_PATH));
+
+    char buffer[1024];
+    read_trace(buffer, sizeof(buffer));
+    assert_non_null(strstr(buffer, "\"traceEvents\":["));
+    assert_non_null(strstr(buffer, "\"name\":\"Partitions\",\"cat\":\"phase\",\"ph\":\"X\""));
+    assert_non_null(strstr(buffer, "\"status\":3"));
+    assert_non_null(strstr(buffer, "\"user_ms\":1.500,\"system_ms\":0.250"));
+    assert_non_null(strstr(buffer, "\"read_bytes\":4096,\"write_bytes\":8192"));
+}
+
+/** Verifies write_trace() escapes span names for JSON. */
+static void test_write_trace_escapes_names(void **state)
+{
+    (void)state;
+    TraceSpan span;
+    begin_trace_span(&span, "command", "echo \"a\\b\"\t");
+    end_trace_span(&span, 0, NULL);
+
+    assert_int_equal(0, write_trace(TEST_TRACE_PATH));
+
+    char buffer[1024];
+    read_trace(buffer, sizeof(buffer));
+    assert_non_null(strstr(buffer, "\"name\":\"echo \\\"a\\\\b\\\"\\u0009\""));
+}
+
+/** Verifies spans ended while tracing is off are not recorded. */
+static void test_end_trace_span_ignores_spans_when_off(void **state)
+{
+    (void)state;
+    stop_trace();
+    TraceSpan span;
+    begin_trace_span(&span, "phase", "Ignored");
+    end_trace_span(&span, 0, NULL);
+    start_trace();
+
+    assert_int_equal(0, write_trace(TEST_TRACE_PATH));
+
+    char buffer[1024];
+    read_trace(buffer, sizeof(buffer));
+    assert_null(strstr(buffer, "Ignored"));
+}
+
+/** Verifies commands are recorded with their status and CPU time. */
+static void test_run_install_argv_records_command_span(void **state)
+{
+    (void)state;
+    const char *const argv[] = { "sh", "-c", "i=0; while [ $i -lt 20000 ]; do i=$((i+1)); done; exit 2", NULL };
+    assert_int_equal(2, run_install_argv(argv, &COMMAND_QUIET));
+
+    assert_int_equal(0, write_trace(TEST_TRACE_PATH));
+
+    char buffer[2048];
+    read_trace(buffer, sizeof(buffer));
+    assert_non_null(strstr(buffer, "\"cat\":\"command\""));
+    assert_non_null(strstr(buffer, "\"status\":2"));
+
+    // The loop takes measurable CPU time.
+    char *user = strstr(buffer, "\"user_ms\":");
+    assert_non_null(user);
+    assert_true(atof(user + strlen("\"user_ms\":")) + atof(strstr(buffer, "\"system_ms\":") + 12) > 0);
+}
+
+/** Verifies chroot commands are traced under their label, not their text. */
+static void test_run_chroot_command_keeps_password_out_of_trace(void **state)
+{
+    (void)state;
+
+    // Stand in for the helper with pipes, its status already written.
+    int command_pipe[2];
+    int status_pipe[2];
+    assert_int_equal(0, pipe(command_pipe));
+    assert_int_equal(0, pipe(status_pipe));
+    assert_int_equal(2, write(status_pipe[1], "0\n", 2));
+    ChrootSession session;
+    memset(&session, 0, sizeof(session));
+    session.pid = getpid();
+    session.command_fd = command_pipe[1];
+    session.status_fd = status_pipe[0];
+    session.output_fd = -1;
+
+    assert_int_equal(0, run_chroot_command(&session, "chpasswd", "echo 'user:hunter2' | chpasswd"));
+    close(command_pipe[0]);
+    close(command_pipe[1]);
+    close(status_pipe[0]);
+    close(status_pipe[1]);
+
+    assert_int_equal(0, write_trace(TEST_TRACE_PATH));
+
+    char buffer[1024];
+    read_trace(buffer, sizeof(buffer));
+    assert_non_null(strstr(buffer, "\"name\":\"chpasswd\",\"cat\":\"chroot\""));
+    assert_null(strstr(buffer, "hunter2"));
+}
+
+/** Verifies write_trace() reports a path that cannot be opened. */
+static void test_write_trace_fails_on_bad_path(void **state)
+{
+    (void)state;
+    assert_int_equal(-1, write_trace("/nonexistent/limeos/trace.json"));
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_write_trace_writes_complete_events, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_write_trace_escapes_names, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_end_trace_span_ignores_spans_when_off, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_run_install_argv_records_command_span, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_run_chroot_command_keeps_password_out_of_trace, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_write_trace_fails_on_bad_path, setup, teardown),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}